@@ -0,0 +1,516 @@
+// bench/bench_audio_server.cpp
+// Headless benchmarks for the hot paths: graph processing, event dispatch,
+// schedule parsing, builtin plugins and the IPC round trip.  No PortAudio
+// stream is opened.
+//
+// Usage:
+//   bench_audio_server [--quick] [--out results.json] [--only <group>]
+//                      [--block-size 256] [--workers 0]
+//                      [--plugins-dir <dir>] [--sf2 <path>]
+//
+// Groups: graph, dispatch, schedule, plugins, ipc.  Results go to stdout
+// (or --out) as one JSON document; progress goes to stderr.  Every figure
+// is the median of several timed repetitions after a warm-up run, and all
+// inputs (graphs, schedules, audio) are generated deterministically, so two
+// runs on one machine are directly comparable.  Compare Release builds:
+// the report records the CMake build type it came from.
+
+#include "audio_engine.h"
+#include "synth_node.h"
+#include "plugin_api.h"
+#include "plugin_loader.h"
+#include "dsp_kernels.h"
+#include "ipc.h"
+#include "perf_stats.h"
+#include "protocol.h"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef AS_PLATFORM_WINDOWS
+#include <unistd.h>
+#endif
+
+#ifndef AS_BENCH_PLUGINS_DIR
+#define AS_BENCH_PLUGINS_DIR "../plugins"
+#endif
+#ifndef AS_BENCH_BUILD_TYPE
+#define AS_BENCH_BUILD_TYPE ""
+#endif
+
+#ifdef AS_PLATFORM_WINDOWS
+static constexpr const char* PLUGIN_SUFFIX = ".dll";
+#else
+static constexpr const char* PLUGIN_SUFFIX = ".so";
+#endif
+
+using json = nlohmann::json;
+
+void register_builtin_plugins();   // builtin_plugins.cpp
+
+namespace {
+
+constexpr float SAMPLE_RATE = 44100.0f;
+constexpr int   REPS        = 5;      // timed repetitions per measurement
+
+struct Options {
+    bool        quick       = false;
+    std::string out_path;
+    std::string only;
+    int         block_size  = 256;
+    int         workers     = 0;
+    std::string plugins_dir = AS_BENCH_PLUGINS_DIR;
+    std::string sf2_path;
+};
+
+double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+// Run fn() once untimed, then REPS times; median wall time in ns.
+template <class Fn>
+double median_run_ns(Fn&& fn) {
+    fn();
+    std::vector<double> runs;
+    for (int r = 0; r < REPS; ++r) {
+        uint64_t t0 = perf::now_ns();
+        fn();
+        runs.push_back(double(perf::now_ns() - t0));
+    }
+    return median(runs);
+}
+
+// Deterministic noise in [-0.5, 0.5) for effect inputs.
+void fill_noise(float* buf, int n, uint32_t seed) {
+    for (int i = 0; i < n; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = float(seed >> 8) / float(1u << 24) - 0.5f;
+    }
+}
+
+ProcessContext make_ctx(int block_size, double beat = 0.0) {
+    const float bpm = 120.0f;
+    return { block_size, SAMPLE_RATE, bpm, beat, bpm / 60.0 / SAMPLE_RATE };
+}
+
+// Blocks per timed run: about `seconds` of audio at this block size.
+int blocks_for(double seconds, int block_size) {
+    return std::max(8, int(seconds * SAMPLE_RATE / block_size));
+}
+
+// ---------------------------------------------------------------------------
+// Graph::process throughput vs node count and block size
+// ---------------------------------------------------------------------------
+// n sine nodes, four held notes each, summed by one mixer.
+
+json sine_bank_graph(int n) {
+    json nodes = json::array(), conns = json::array();
+    for (int i = 0; i < n; ++i) {
+        std::string id = "sine" + std::to_string(i);
+        nodes.push_back({{"id", id}, {"type", "sine"}});
+        conns.push_back({{"from_node", id}, {"from_port", "audio_out_L"},
+                         {"to_node", "mixer"}, {"to_port", "audio_in_L_" + std::to_string(i)}});
+        conns.push_back({{"from_node", id}, {"from_port", "audio_out_R"},
+                         {"to_node", "mixer"}, {"to_port", "audio_in_R_" + std::to_string(i)}});
+    }
+    nodes.push_back({{"id", "mixer"}, {"type", "mixer"}, {"channel_count", n}});
+    return {{"nodes", nodes}, {"connections", conns}};
+}
+
+void bench_graph(const Options& opt, json& results) {
+    std::unique_ptr<GraphExecutor> executor;
+    if (opt.workers > 0) executor = std::make_unique<GraphExecutor>(opt.workers);
+
+    const double seconds = opt.quick ? 0.5 : 4.0;
+    for (int n : { 1, 8, 32, 128 }) {
+        for (int block : { 64, 256, 1024 }) {
+            std::string err;
+            auto g = Graph::from_json(sine_bank_graph(n).dump(), err);
+            if (!g) { std::cerr << "graph: " << err << "\n"; return; }
+            g->set_executor(executor.get());
+            if (!g->activate(SAMPLE_RATE, block)) { std::cerr << "graph: activate failed\n"; return; }
+            for (int i = 0; i < n; ++i) {
+                Node* s = g->find_node("sine" + std::to_string(i));
+                for (int k = 0; k < 4; ++k) s->note_on(0, 48 + i % 24 + k * 4, 100);
+            }
+
+            const int blocks = blocks_for(seconds, block);
+            ProcessContext ctx = make_ctx(block);
+            double ns = median_run_ns([&] {
+                for (int b = 0; b < blocks; ++b) g->process(ctx);
+            }) / blocks;
+            g->deactivate();
+
+            const double budget_ns = block * 1e9 / SAMPLE_RATE;
+            results.push_back({{"group", "graph"}, {"nodes", n + 1}, {"block_size", block},
+                               {"workers", opt.workers},
+                               {"ns_per_block", ns}, {"ns_per_sample", ns / block},
+                               {"realtime_x", budget_ns / ns}});
+            std::fprintf(stderr, "graph     %4d nodes  block %4d  %10.0f ns/block  %8.1fx realtime\n",
+                         n + 1, block, ns, budget_ns / ns);
+        }
+    }
+
+    // Sparse arrangement: 128 sines, only every eighth one sounding.  The
+    // silent ones are skipped (Node::idle()) and the mixer passes over
+    // their inputs.
+    const int n = 128, block = 256;
+    std::string err;
+    auto g = Graph::from_json(sine_bank_graph(n).dump(), err);
+    if (!g) { std::cerr << "graph: " << err << "\n"; return; }
+    g->set_executor(executor.get());
+    if (!g->activate(SAMPLE_RATE, block)) { std::cerr << "graph: activate failed\n"; return; }
+    for (int i = 0; i < n; i += 8) {
+        Node* s = g->find_node("sine" + std::to_string(i));
+        for (int k = 0; k < 4; ++k) s->note_on(0, 48 + i % 24 + k * 4, 100);
+    }
+    const int blocks = blocks_for(seconds, block);
+    ProcessContext ctx = make_ctx(block);
+    double ns = median_run_ns([&] {
+        for (int b = 0; b < blocks; ++b) g->process(ctx);
+    }) / blocks;
+    const int idle = g->idle_steps();
+    g->deactivate();
+
+    const double budget_ns = block * 1e9 / SAMPLE_RATE;
+    results.push_back({{"group", "graph"}, {"nodes", n + 1}, {"block_size", block},
+                       {"workers", opt.workers}, {"sounding", n / 8}, {"idle_steps", idle},
+                       {"ns_per_block", ns}, {"ns_per_sample", ns / block},
+                       {"realtime_x", budget_ns / ns}});
+    std::fprintf(stderr, "graph     %4d nodes  block %4d  %10.0f ns/block  %8.1fx realtime"
+                 "  (%d sounding, %d idle)\n", n + 1, block, ns, budget_ns / ns, n / 8, idle);
+}
+
+// ---------------------------------------------------------------------------
+// Dispatcher::dispatch cost vs event density
+// ---------------------------------------------------------------------------
+// track_source → sine → mixer; `density` notes per beat over 32 beats.
+// Only the dispatch() calls are timed; the graph still processes each block
+// so voices are released as they would be live.
+
+json dense_schedule(int density, double beats, const std::string& node) {
+    json events = json::array();
+    const int notes = int(density * beats);
+    for (int i = 0; i < notes; ++i) {
+        double on = i / double(density);
+        int pitch = 36 + (i * 7) % 60;
+        events.push_back({{"beat", on}, {"type", "note_on"}, {"node_id", node},
+                          {"channel", i % 16}, {"pitch", pitch}, {"velocity", 90}});
+        events.push_back({{"beat", on + 0.5 / density}, {"type", "note_off"}, {"node_id", node},
+                          {"channel", i % 16}, {"pitch", pitch}, {"velocity", 0}});
+    }
+    return {{"events", events}};
+}
+
+void bench_dispatch(const Options& opt, json& results) {
+    json gdesc = {
+        {"nodes", {
+            {{"id", "ts"},    {"type", "track_source"}},
+            {{"id", "synth"}, {"type", "sine"}},
+            {{"id", "mixer"}, {"type", "mixer"}, {"channel_count", 1}}
+        }},
+        {"connections", {
+            {{"from_node", "ts"},    {"from_port", "events"},
+             {"to_node", "synth"},   {"to_port", "events"}},
+            {{"from_node", "synth"}, {"from_port", "audio_out_L"},
+             {"to_node", "mixer"},   {"to_port", "audio_in_L_0"}},
+            {{"from_node", "synth"}, {"from_port", "audio_out_R"},
+             {"to_node", "mixer"},   {"to_port", "audio_in_R_0"}}
+        }}
+    };
+    const int    block = opt.block_size;
+    const double beats = opt.quick ? 8.0 : 32.0;
+
+    for (int density : { 1, 16, 128, 1024 }) {
+        std::string err;
+        auto g = Graph::from_json(gdesc.dump(), err);
+        std::shared_ptr<const Schedule> sched =
+            Schedule::from_json(dense_schedule(density, beats, "ts").dump(), err);
+        if (!g || !sched || !g->activate(SAMPLE_RATE, block)) {
+            std::cerr << "dispatch: setup failed: " << err << "\n";
+            return;
+        }
+
+        Dispatcher disp;
+        disp.swap_schedule(sched);
+        disp.check_pending();
+
+        ProcessContext ctx = make_ctx(block);
+        const double length = sched->total_length_beats();
+        uint64_t dispatch_ns = 0;
+        std::vector<double> runs;
+        for (int r = 0; r <= REPS; ++r) {
+            disp.seek(0.0);
+            dispatch_ns = 0;
+            for (double beat = 0.0; beat < length; beat += block * ctx.beats_per_sample) {
+                double end = beat + block * ctx.beats_per_sample;
+                uint64_t t0 = perf::now_ns();
+                disp.dispatch(beat, end, block, g.get());
+                dispatch_ns += perf::now_ns() - t0;
+                ctx.beat_position = beat;
+                g->process(ctx);
+            }
+            if (r > 0) runs.push_back(double(dispatch_ns));   // r == 0 warms up
+        }
+        g->deactivate();
+
+        const double total  = median(runs);
+        const double events = double(sched->event_count());
+        const double blocks = std::ceil(length / (block * ctx.beats_per_sample));
+        results.push_back({{"group", "dispatch"}, {"events_per_beat", density * 2},
+                           {"block_size", block}, {"events", events},
+                           {"ns_per_event", total / events}, {"ns_per_block", total / blocks}});
+        std::fprintf(stderr, "dispatch  %5d ev/beat  %8.1f ns/event  %8.0f ns/block\n",
+                     density * 2, total / events, total / blocks);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Schedule::from_json / from_packed parse time for large arrangements
+// ---------------------------------------------------------------------------
+// 16 tracks of eighth notes; events counts note_on + note_off.
+
+void bench_schedule(const Options& opt, json& results) {
+    std::vector<int> sizes = { 1000, 10000, 100000 };
+    if (!opt.quick) sizes.push_back(1000000);
+
+    const std::vector<std::string> nodes = [] {
+        std::vector<std::string> v;
+        for (int t = 0; t < 16; ++t) v.push_back("track_" + std::to_string(t));
+        return v;
+    }();
+
+    for (int target : sizes) {
+        json events = json::array();
+        std::vector<uint8_t> packed;
+        packed.reserve(size_t(target) * protocol::PACKED_EVENT_BYTES);
+        auto pack = [&](double beat, uint32_t node, uint8_t type, uint8_t pitch, uint8_t vel) {
+            uint8_t r[protocol::PACKED_EVENT_BYTES] = {};
+            std::memcpy(r, &beat, 8);
+            std::memcpy(r + 12, &node, 4);
+            r[16] = type; r[18] = pitch; r[19] = vel;
+            packed.insert(packed.end(), r, r + sizeof(r));
+        };
+        for (int i = 0; i < target / 2; ++i) {
+            const std::string& node = nodes[i % 16];
+            double on = (i / 16) * 0.5;
+            int pitch = 36 + (i * 5) % 60;
+            events.push_back({{"beat", on}, {"type", "note_on"}, {"node_id", node},
+                              {"channel", 0}, {"pitch", pitch}, {"velocity", 100}});
+            events.push_back({{"beat", on + 0.45}, {"type", "note_off"}, {"node_id", node},
+                              {"channel", 0}, {"pitch", pitch}, {"velocity", 0}});
+            pack(on, uint32_t(i % 16), 0, uint8_t(pitch), 100);
+            pack(on + 0.45, uint32_t(i % 16), 1, uint8_t(pitch), 0);
+        }
+        const std::string doc = json{{"events", events}}.dump();
+        events = nullptr;
+
+        std::string err;
+        double ns = median_run_ns([&] {
+            auto s = Schedule::from_json(doc, err);
+            if (!s) std::cerr << "schedule: " << err << "\n";
+        });
+        double packed_ns = median_run_ns([&] {
+            auto s = Schedule::from_packed(packed.data(), packed.size(), nodes, err);
+            if (!s) std::cerr << "schedule: " << err << "\n";
+        });
+        results.push_back({{"group", "schedule"}, {"format", "json"}, {"events", target},
+                           {"bytes", doc.size()}, {"ms", ns / 1e6}, {"ns_per_event", ns / target},
+                           {"mb_per_s", doc.size() / (ns / 1e3)}});
+        results.push_back({{"group", "schedule"}, {"format", "packed"}, {"events", target},
+                           {"bytes", packed.size()}, {"ms", packed_ns / 1e6},
+                           {"ns_per_event", packed_ns / target},
+                           {"mb_per_s", packed.size() / (packed_ns / 1e3)}});
+        std::fprintf(stderr, "schedule  %8d events  %9.2f ms  %7.1f ns/event  (packed %7.1f ns/event)\n",
+                     target, ns / 1e6, ns / target, packed_ns / target);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Per-plugin ns/sample, driven through PluginAdapterNode
+// ---------------------------------------------------------------------------
+// Audio inputs carry noise, control inputs sit at their defaults and
+// instruments hold a four-note chord (the arpeggiator arpeggiates it).
+
+struct PluginCase {
+    const char* id;
+    const char* library;     // arranger_plugin_<library> when not linked in
+    bool        needs_sf2;
+};
+
+void bench_plugins(const Options& opt, json& results) {
+    const PluginCase cases[] = {
+        { "builtin.sine",        nullptr,       false },
+        { "builtin.mixer",       nullptr,       false },
+        { "builtin.reverb",      "reverb",      false },
+        { "builtin.arpeggiator", "arpeggiator", false },
+        { "builtin.fluidsynth",  "fluidsynth",  true  },
+    };
+    const int    block   = opt.block_size;
+    const double seconds = opt.quick ? 0.5 : 4.0;
+
+    for (auto& pc : cases) {
+        auto skip = [&](const std::string& why) {
+            results.push_back({{"group", "plugins"}, {"plugin", pc.id}, {"skipped", why}});
+            std::fprintf(stderr, "plugins   %-20s skipped: %s\n", pc.id, why.c_str());
+        };
+        if (pc.needs_sf2 && opt.sf2_path.empty()) { skip("needs --sf2"); continue; }
+        if (!PluginRegistry::find_descriptor(pc.id) && pc.library) {
+            auto r = load_plugin_library(opt.plugins_dir + "/arranger_plugin_" + pc.library + PLUGIN_SUFFIX);
+            if (!r.ok) { skip(r.error); continue; }
+        }
+        if (!PluginRegistry::find_descriptor(pc.id)) { skip("not registered"); continue; }
+
+        NodeDesc desc;
+        desc.id       = "bench";
+        desc.type     = pc.id;
+        desc.sf2_path = pc.needs_sf2 ? opt.sf2_path : "";
+        std::string err;
+        auto node = make_node(desc, err);
+        if (!node) { skip(err); continue; }
+        node->activate(SAMPLE_RATE, block);
+
+        std::vector<std::vector<float>> storage;
+        std::vector<PortBuffer> inputs, outputs;
+        for (auto& p : node->declare_ports()) {
+            PortBuffer pb;
+            pb.type    = p.type;
+            pb.control = p.default_value;
+            if (p.type == PortType::AudioMono) {
+                storage.emplace_back(block, 0.0f);
+                pb.audio = storage.back().data();
+                if (!p.is_output) fill_noise(pb.audio, block, uint32_t(storage.size()));
+            }
+            (p.is_output ? outputs : inputs).push_back(pb);
+        }
+        for (int k = 0; k < 4; ++k) node->note_on(0, 60 + k * 4, 100);
+
+        const int blocks = blocks_for(seconds, block);
+        ProcessContext ctx = make_ctx(block);
+        double ns = median_run_ns([&] {
+            for (int b = 0; b < blocks; ++b) {
+                ctx.beat_position = b * block * ctx.beats_per_sample;
+                node->process(ctx, inputs, outputs);
+            }
+        }) / blocks;
+        node->deactivate();
+
+        results.push_back({{"group", "plugins"}, {"plugin", pc.id}, {"block_size", block},
+                           {"ns_per_block", ns}, {"ns_per_sample", ns / block}});
+        std::fprintf(stderr, "plugins   %-20s %8.2f ns/sample\n", pc.id, ns / block);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// IPC round-trip latency (echo server, no engine)
+// ---------------------------------------------------------------------------
+
+void bench_ipc(const Options& opt, json& results) {
+#ifdef AS_PLATFORM_WINDOWS
+    const std::string addr = "\\\\.\\pipe\\AudioServerBench";
+#else
+    const std::string addr = "/tmp/bench_audio_server." + std::to_string(getpid()) + ".sock";
+#endif
+    IpcServer server(addr);
+    std::string err = server.start([](const std::string& req) { return req; });
+    if (!err.empty()) { std::cerr << "ipc: " << err << "\n"; return; }
+
+    IpcClient client(addr);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        err = client.connect();
+        if (err.empty()) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!err.empty()) { std::cerr << "ipc: " << err << "\n"; server.stop(); return; }
+
+    struct Case { const char* name; size_t payload; int count; };
+    const Case cases[] = {
+        { "ping",  0,         opt.quick ? 200 : 5000 },
+        { "1kb",   1024,      opt.quick ? 200 : 5000 },
+        { "64kb",  64 * 1024, opt.quick ? 50  : 1000 },
+    };
+    for (auto& c : cases) {
+        const std::string req = json{{"cmd", "ping"}, {"data", std::string(c.payload, 'x')}}.dump();
+        std::string resp;
+        std::vector<double> us;
+        for (int i = 0; i < c.count + 10; ++i) {
+            uint64_t t0 = perf::now_ns();
+            err = client.send(req, resp);
+            if (!err.empty()) { std::cerr << "ipc: " << err << "\n"; break; }
+            if (i >= 10) us.push_back((perf::now_ns() - t0) / 1e3);   // first 10 warm up
+        }
+        if (us.empty()) break;
+        std::sort(us.begin(), us.end());
+        double mean = 0.0;
+        for (double v : us) mean += v;
+        mean /= us.size();
+        const double p50 = us[us.size() / 2];
+        const double p99 = us[std::min(us.size() - 1, us.size() * 99 / 100)];
+        results.push_back({{"group", "ipc"}, {"message", c.name}, {"bytes", req.size()},
+                           {"round_trips", us.size()}, {"mean_us", mean},
+                           {"p50_us", p50}, {"p99_us", p99}});
+        std::fprintf(stderr, "ipc       %-6s  p50 %7.1f us  p99 %7.1f us\n", c.name, p50, p99);
+    }
+    client.disconnect();
+    server.stop();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick")                          opt.quick       = true;
+        else if (arg == "--out"         && i+1 < argc) opt.out_path    = argv[++i];
+        else if (arg == "--only"        && i+1 < argc) opt.only        = argv[++i];
+        else if (arg == "--block-size"  && i+1 < argc) opt.block_size  = std::stoi(argv[++i]);
+        else if (arg == "--workers"     && i+1 < argc) opt.workers     = std::stoi(argv[++i]);
+        else if (arg == "--plugins-dir" && i+1 < argc) opt.plugins_dir = argv[++i];
+        else if (arg == "--sf2"         && i+1 < argc) opt.sf2_path    = argv[++i];
+        else { std::cerr << "unknown argument: " << arg << "\n"; return 2; }
+    }
+    opt.block_size = std::clamp(opt.block_size, 1, MAX_BLOCK_SIZE);
+
+    register_builtin_plugins();
+
+    json results = json::array();
+    auto want = [&](const char* group) { return opt.only.empty() || opt.only == group; };
+    if (want("graph"))    bench_graph(opt, results);
+    if (want("dispatch")) bench_dispatch(opt, results);
+    if (want("schedule")) bench_schedule(opt, results);
+    if (want("plugins"))  bench_plugins(opt, results);
+    if (want("ipc"))      bench_ipc(opt, results);
+
+    json report = {
+        {"bench",       "audio_server"},
+        {"version",     "0.1.0"},
+        {"build_type",  AS_BENCH_BUILD_TYPE},
+        {"kernels",     dsp::backend()},
+        {"sample_rate", SAMPLE_RATE},
+        {"quick",       opt.quick},
+        {"workers",     opt.workers},
+        {"repetitions", REPS},
+        {"results",     results},
+    };
+    if (opt.out_path.empty()) {
+        std::cout << report.dump(2) << "\n";
+    } else {
+        std::ofstream f(opt.out_path);
+        if (!f) { std::cerr << "cannot write " << opt.out_path << "\n"; return 1; }
+        f << report.dump(2) << "\n";
+    }
+    return 0;
+}
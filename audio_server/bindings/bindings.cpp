@@ -1,15 +1,28 @@
 // bindings/bindings.cpp
-// pybind11 extension module: exposes ServerHandler::handle() to Python.
+// pybind11 extension module: exposes ServerHandler::handle() to Python,
+// plus typed methods for the hot paths that skip JSON entirely:
+//
+//   render()            offline render as a (frames, 2) float32 array that
+//                       owns the engine's buffer — no copy, no base64
+//   resolve_params()    (node, param) names → int32 handles, once per graph
+//   set_params()        handle and value arrays
+//   set_schedule()      structured array of EVENT_DTYPE records (the packed
+//   patch_schedule()    event layout of protocol.h), read in place
+//   position()          (beat, playing)
 //
 // Build with -DENABLE_PYTHON_BINDINGS=ON.
 // Output: standalone/arranger_engine.cpython-3xx-<platform>.so
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include "server_handler.h"
 #include "audio_engine.h"
 #include "plugin_api.h"
 #include "plugin_loader.h"
+#include "protocol.h"
+#include "scheduler.h"
+#include <algorithm>
 
 namespace py = pybind11;
 
@@ -36,6 +49,44 @@ static py::list _list_plugins() {
     return result;
 }
 
+// numpy dtype of one packed event record (protocol.h "Packed events").
+// Offsets are explicit: the record is 20 bytes with no padding, which no
+// C++ struct holding a double has, so PYBIND11_NUMPY_DTYPE cannot describe it.
+static py::dtype _event_dtype() {
+    py::list names, formats, offsets;
+    for (const char* n : { "beat", "value", "node", "type", "channel", "pitch", "velocity" })
+        names.append(n);
+    for (const char* f : { "<f8", "<f4", "<u4", "u1", "u1", "u1", "u1" })
+        formats.append(f);
+    for (int o : { 0, 8, 12, 16, 17, 18, 19 })
+        offsets.append(o);
+    return py::dtype(names, formats, offsets, protocol::PACKED_EVENT_BYTES);
+}
+
+// The bytes of a C-contiguous EVENT_DTYPE array, checked for layout.
+// equal() is Python ==, which for structured dtypes compares every field's
+// name, format and offset, and the itemsize.
+static py::buffer_info _packed_events(const py::array& events) {
+    if (!events.dtype().equal(_event_dtype()))
+        throw py::type_error("events must be a numpy array of arranger_engine.EVENT_DTYPE");
+    if (!(events.flags() & py::array::c_style))
+        throw py::value_error("events must be C-contiguous");
+    return events.request();
+}
+
+static void _check(const std::string& err) {
+    if (!err.empty()) throw std::runtime_error(err);
+}
+
+// Interleaved stereo as (frames, 2) float32.  The vector moves into the
+// capsule that is the array's base, so the array owns the render buffer.
+static py::array_t<float> _wrap_stereo(std::vector<float>&& pcm) {
+    auto* owned = new std::vector<float>(std::move(pcm));
+    py::capsule base(owned, [](void* p) { delete static_cast<std::vector<float>*>(p); });
+    const py::ssize_t frames = static_cast<py::ssize_t>(owned->size() / 2);
+    return py::array_t<float>({ frames, py::ssize_t(2) }, owned->data(), base);   // C order
+}
+
 PYBIND11_MODULE(arranger_engine, m) {
     m.doc() = "Arranger audio engine — in-process Python bindings";
 
@@ -47,7 +98,13 @@ PYBIND11_MODULE(arranger_engine, m) {
         .def(py::init<>())
         .def_readwrite("sample_rate",   &AudioEngineConfig::sample_rate)
         .def_readwrite("block_size",    &AudioEngineConfig::block_size)
-        .def_readwrite("output_device", &AudioEngineConfig::output_device);
+        .def_readwrite("output_device", &AudioEngineConfig::output_device)
+        .def_readwrite("worker_threads", &AudioEngineConfig::worker_threads)
+        .def_readwrite("render_worker_threads", &AudioEngineConfig::render_worker_threads)
+        .def_readwrite("backend",        &AudioEngineConfig::backend)
+        .def_readwrite("output_channels", &AudioEngineConfig::output_channels);
+
+    m.attr("EVENT_DTYPE") = _event_dtype();
 
     py::class_<ServerHandler>(m, "AudioServer")
         .def(py::init<const AudioEngineConfig&>(),
@@ -55,7 +112,90 @@ PYBIND11_MODULE(arranger_engine, m) {
         // Release GIL so the audio callback thread can never accidentally
         // try to acquire it while we're inside C++.
         .def("handle", &ServerHandler::handle,
-             py::call_guard<py::gil_scoped_release>());
+             py::call_guard<py::gil_scoped_release>())
+
+        // Errors from the typed methods raise RuntimeError.
+        .def("render",
+             [](ServerHandler& self, float tail_seconds, double duration_beats) {
+                 std::vector<float> pcm;
+                 {
+                     py::gil_scoped_release release;
+                     pcm = self.engine().render_offline(tail_seconds, duration_beats);
+                 }
+                 if (pcm.empty()) throw std::runtime_error("nothing to render");
+                 return _wrap_stereo(std::move(pcm));
+             },
+             py::arg("tail_seconds") = 1.0f, py::arg("duration_beats") = 0.0,
+             "Render offline; returns a (frames, 2) float32 array.")
+
+        .def("resolve_params",
+             [](ServerHandler& self, const std::vector<std::string>& node_ids,
+                const std::vector<std::string>& param_ids) {
+                 if (node_ids.size() != param_ids.size())
+                     throw py::value_error("node_ids and param_ids differ in length");
+                 std::vector<std::pair<std::string, std::string>> ids;
+                 ids.reserve(node_ids.size());
+                 for (size_t i = 0; i < node_ids.size(); ++i)
+                     ids.emplace_back(node_ids[i], param_ids[i]);
+                 std::vector<int> handles;
+                 uint32_t serial = self.engine().resolve_params(ids, handles);
+                 if (serial == 0) throw std::runtime_error("no active graph");
+                 py::array_t<int32_t> out(static_cast<py::ssize_t>(handles.size()));
+                 std::copy(handles.begin(), handles.end(), out.mutable_data());
+                 return py::make_tuple(serial, out);
+             },
+             py::arg("node_ids"), py::arg("param_ids"),
+             "Resolve parameter names; returns (graph, int32 handles), -1 for unknown nodes.")
+
+        .def("set_params",
+             [](ServerHandler& self, uint32_t graph,
+                py::array_t<int32_t, py::array::c_style | py::array::forcecast> handles,
+                py::array_t<float,   py::array::c_style | py::array::forcecast> values) {
+                 if (handles.size() != values.size())
+                     throw py::value_error("handles and values differ in length");
+                 std::vector<std::pair<int, float>> batch(static_cast<size_t>(handles.size()));
+                 const int32_t* h = handles.data();
+                 const float*   v = values.data();
+                 for (size_t i = 0; i < batch.size(); ++i) batch[i] = { h[i], v[i] };
+                 py::gil_scoped_release release;
+                 _check(self.engine().set_params(graph, batch));
+             },
+             py::arg("graph"), py::arg("handles"), py::arg("values"),
+             "Apply values through handles from resolve_params(), in one block.")
+
+        .def("set_schedule",
+             [](ServerHandler& self, const py::array& events,
+                const std::vector<std::string>& nodes) {
+                 auto buf = _packed_events(events);
+                 py::gil_scoped_release release;
+                 std::string err;
+                 auto sched = Schedule::from_packed(static_cast<const uint8_t*>(buf.ptr),
+                                                    static_cast<size_t>(buf.size) * buf.itemsize,
+                                                    nodes, err);
+                 _check(sched ? self.engine().set_schedule(std::move(sched)) : err);
+             },
+             py::arg("events"), py::arg("nodes"),
+             "Replace the schedule; each event's node indexes nodes.")
+
+        .def("patch_schedule",
+             [](ServerHandler& self, const std::string& node_id, const py::array& events) {
+                 auto buf = _packed_events(events);
+                 py::gil_scoped_release release;
+                 std::string err;
+                 auto track = Schedule::track_from_packed(node_id,
+                                                          static_cast<const uint8_t*>(buf.ptr),
+                                                          static_cast<size_t>(buf.size) * buf.itemsize,
+                                                          err);
+                 _check(track ? self.engine().patch_schedule(std::move(track)) : err);
+             },
+             py::arg("node_id"), py::arg("events"),
+             "Replace one node's events (their node field must be 0).")
+
+        .def("position",
+             [](ServerHandler& self) {
+                 return py::make_tuple(self.engine().current_beat(), self.engine().is_playing());
+             },
+             "(beat, playing) without a get_position round trip.");
 
     m.def("list_plugins", &_list_plugins,
           "Return brief descriptors for all registered plugins.");
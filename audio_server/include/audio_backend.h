@@ -0,0 +1,62 @@
+#pragma once
+// audio_backend.h
+// The audio device behind AudioEngine.  A backend owns the stream and calls
+// the engine once per device period with one non-interleaved float buffer
+// per output channel, so the graph renders straight into device memory.
+//
+//   portaudio  default; whatever host API PortAudio picks (ALSA, PulseAudio,
+//              WASAPI, ...), opened non-interleaved
+//   jack       native JACK client with one port per channel (ENABLE_JACK);
+//              PipeWire serves it through its JACK library (pipewire-jack)
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AudioBackendConfig {
+    float       sample_rate     = 44100.0f;
+    int         block_size      = 512;             // a hint: periods may differ
+    int         output_device   = -1;              // PortAudio device, -1 = default
+    int         output_channels = 2;
+    std::string client_name     = "audio_server";  // JACK client name
+    bool        autoconnect     = true;            // JACK: connect to playback ports
+};
+
+class AudioBackend {
+public:
+    // Conditions reported by the device since the previous period.
+    enum Status : uint32_t {
+        OutputUnderflow = 1u << 0,
+        OutputOverflow  = 1u << 1,
+        InputUnderflow  = 1u << 2,
+        InputOverflow   = 1u << 3,
+        PrimingOutput   = 1u << 4,
+    };
+
+    struct Period {
+        float* const* outputs  = nullptr;   // channels buffers of frames floats
+        int           channels = 0;
+        int           frames   = 0;
+        uint32_t      status   = 0;         // Status bits
+        double        output_latency_s = 0.0;   // period start to DAC; 0 = unknown
+    };
+
+    // Audio thread.  Must fill every output buffer.
+    using Callback = void (*)(const Period& period, void* user);
+
+    virtual ~AudioBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // Open and start the stream; cb runs on the audio thread until close().
+    // Returns error string on failure, empty on success.
+    virtual std::string open(const AudioBackendConfig& cfg, Callback cb, void* user) = 0;
+
+    // Stop the stream.  cb is not running and will not run again on return.
+    virtual void close() = 0;
+};
+
+// "portaudio" or "jack".  Returns nullptr and sets error_out for a name this
+// build does not include.
+std::unique_ptr<AudioBackend> make_audio_backend(const std::string& name,
+                                                 std::string& error_out);
@@ -1,25 +1,38 @@
 #pragma once
 // audio_engine.h
-// Owns the PortAudio stream, the signal graph, and the event dispatcher.
+// Owns the audio backend (see audio_backend.h), the signal graph, and the
+// event dispatcher.
 //
 // Threading model mirrors the Python engine exactly:
 //   Main thread: set_graph(), set_schedule(), play/stop/seek, set_param()
 //   Audio thread: callback only — reads graph + dispatcher, never allocates
 
-#include <portaudio.h>
+#include "audio_backend.h"
 #include "graph.h"
+#include "rt_check.h"
 #include "scheduler.h"
+#include "shared_state.h"
+#include "spsc_queue.h"
 #include <memory>
 #include <atomic>
 #include <string>
 #include <functional>
 #include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 struct AudioEngineConfig {
     float sample_rate  = 44100.0f;
     int   block_size   = 512;
     int   output_device = -1;    // -1 = default
+    int   worker_threads = 0;    // extra graph worker threads; 0 = serial process()
+    int   render_worker_threads = 0;   // the same for offline renders, a pool of their own
+    std::string backend = "portaudio";   // see make_audio_backend()
+    // Device channels.  0/1 carry the mixer; graph "outputs" routes fill the
+    // rest, unrouted channels play silence.  2..Graph::MAX_OUTPUT_CHANNELS.
+    int   output_channels = 2;
 };
 
 class AudioEngine {
@@ -27,7 +40,7 @@ public:
     explicit AudioEngine(const AudioEngineConfig& cfg = {});
     ~AudioEngine();
 
-    // Not copyable or movable — owns a PortAudio stream.
+    // Not copyable or movable — owns the audio stream.
     AudioEngine(const AudioEngine&) = delete;
     AudioEngine& operator=(const AudioEngine&) = delete;
 
@@ -35,14 +48,14 @@ public:
     // Setup (main thread)
     // -----------------------------------------------------------------------
 
-    // Open the PortAudio stream. Call before play().
+    // Open the backend's stream. Call before play().
     // Returns error string on failure, empty on success.
     std::string open();
 
     // Close stream and free resources.
     void close();
 
-    bool is_open() const { return stream_ != nullptr; }
+    bool is_open() const { return backend_ != nullptr; }
 
     // -----------------------------------------------------------------------
     // Graph management (main thread)
@@ -52,11 +65,23 @@ public:
     // Returns error string on failure.
     std::string set_graph(const std::string& graph_json);
 
+    // Apply an incremental edit (see Graph::patched()) to the current graph.
+    // Unchanged nodes keep running with their state; only added nodes are
+    // built.  Param handles are invalidated as with set_graph().
+    std::string patch_graph(const std::string& patch_json);
+
     // -----------------------------------------------------------------------
     // Schedule management (main thread)
     // -----------------------------------------------------------------------
 
     std::string set_schedule(const std::string& schedule_json);
+    std::string set_schedule(std::unique_ptr<Schedule> sched);   // prebuilt (packed events)
+
+    // Replace one target node's events (see Schedule::patched()); the other
+    // tracks are shared with the current schedule and keep their playback
+    // position.  Cost is O(events in the patch), not O(song).
+    std::string patch_schedule(const std::string& node_id, const std::string& events_json);
+    std::string patch_schedule(std::shared_ptr<const ScheduleTrack> track);
 
     // -----------------------------------------------------------------------
     // Transport (main thread — thread-safe)
@@ -78,18 +103,34 @@ public:
 
     void set_param(const std::string& node_id, const std::string& param, float value);
 
+    // Resolve (node_id, param) pairs to integer handles for the current graph
+    // (-1 for an unknown node).  Returns the graph's serial — pass it back to
+    // set_params() — or 0 if no graph is set.  Handles stay valid until the
+    // next set_graph().
+    uint32_t resolve_params(const std::vector<std::pair<std::string, std::string>>& ids,
+                            std::vector<int>& handles_out);
+
+    // Queue (handle, value) pairs from resolve_params().  The batch is
+    // published to the audio thread in one step and applied at the start of a
+    // single block (batches larger than the command ring are split).
+    // graph_serial 0 = use the current graph.  Returns an error string if the
+    // handles belong to a graph that has been replaced.
+    std::string set_params(uint32_t graph_serial,
+                           const std::vector<std::pair<int, float>>& values);
+
     // -----------------------------------------------------------------------
     // Preview note injection (main thread — bypasses schedule/transport)
     // -----------------------------------------------------------------------
     // These route to TrackSourceNode::preview_note_on/off, which are
-    // thread-safe and queue events for the next audio block.
+    // thread-safe and queue events for the next audio block.  Returns an
+    // error string if the source's preview queue is full.
 
     // node_id should be a track_source node (e.g. "track_abc").
     // If empty, routes to the first track_source found (convenience fallback).
-    void preview_note_on (const std::string& node_id, int channel, int pitch, int velocity);
-    void preview_note_off(const std::string& node_id, int channel, int pitch);
+    std::string preview_note_on (const std::string& node_id, int channel, int pitch, int velocity);
+    std::string preview_note_off(const std::string& node_id, int channel, int pitch);
     // Silence all preview notes on the given source node (or all if node_id is empty).
-    void preview_all_notes_off(const std::string& node_id);
+    std::string preview_all_notes_off(const std::string& node_id);
 
     // -----------------------------------------------------------------------
     // Live node reconfiguration (main thread)
@@ -104,8 +145,12 @@ public:
     std::string get_node_data(const std::string& node_id, const std::string& port_id);
 
     // -----------------------------------------------------------------------
-    // Offline render (main thread — blocking, uses same graph+schedule)
+    // Offline render (main thread — blocking)
     // -----------------------------------------------------------------------
+    // Renders run on a private graph instance rebuilt from the last set_graph
+    // description, plus the parameter values written since, driven by its
+    // own Dispatcher over the current schedule.  The live graph and the
+    // realtime stream are never touched, so playback continues throughout.
 
     // Returns interleaved stereo float32 PCM.
     // Renders until arrangement_length + tail_seconds.
@@ -114,10 +159,97 @@ public:
     std::vector<float> render_offline(float tail_seconds = 1.0f,
                                       double duration_beats = 0.0);
 
-    // Convenience: returns WAV file bytes.
+    // Convenience: returns WAV file bytes (16-bit PCM).
     std::vector<uint8_t> render_offline_wav(float tail_seconds = 1.0f,
                                             double duration_beats = 0.0);
 
+    enum class RenderFormat { Wav, RawF32 };
+
+    // Chunk sink for render_offline_stream.  data is only valid for the
+    // duration of the call.  Return false to abort the render.
+    using RenderSink = std::function<bool(const uint8_t* data, size_t bytes,
+                                          int64_t frames_done, int64_t total_frames)>;
+
+    // Streaming render: the same audio as render_offline, encoded as fmt and
+    // handed to sink every chunk_frames frames (rounded up to whole blocks),
+    // so memory stays at one chunk however long the arrangement is.  For Wav
+    // the first chunk starts with the header — the concatenated chunks are
+    // the complete file.
+    // Returns frames rendered, 0 if there is nothing to render, -1 if the
+    // sink aborted or the render graph could not be built (error_out says
+    // which when given).
+    static constexpr int DEFAULT_RENDER_CHUNK_FRAMES = 16384;
+    int64_t render_offline_stream(RenderFormat fmt, const RenderSink& sink,
+                                  int chunk_frames = DEFAULT_RENDER_CHUNK_FRAMES,
+                                  float tail_seconds = 1.0f,
+                                  double duration_beats = 0.0,
+                                  std::string* error_out = nullptr);
+
+    // One stem of render_stems: the schedule events for these nodes (usually
+    // track_source ids).  Events for nodes listed by another stem are
+    // dropped; events for nodes no stem lists (automation lanes, shared
+    // controls) play in every stem.
+    struct StemSpec {
+        std::string              name;
+        std::vector<std::string> nodes;
+    };
+
+    // Like RenderSink, plus the index of the stem the chunk belongs to.
+    using StemSink = std::function<bool(size_t stem, const uint8_t* data, size_t bytes,
+                                        int64_t frames_done, int64_t total_frames)>;
+
+    // Render each stem on its own render graph (see above), up to threads
+    // stems at a time (0 = one per core).  sink runs on the render threads:
+    // concurrently for different stems, in order within one stem.
+    // Returns error string on failure, empty on success.
+    std::string render_stems(const std::vector<StemSpec>& stems, RenderFormat fmt,
+                             const StemSink& sink, int threads = 0,
+                             int chunk_frames = DEFAULT_RENDER_CHUNK_FRAMES,
+                             float tail_seconds = 1.0f,
+                             double duration_beats = 0.0);
+
+    // -----------------------------------------------------------------------
+    // Instrumentation (any thread)
+    // -----------------------------------------------------------------------
+    // Callback and node timings are only collected when built with
+    // AS_ENABLE_STATS (enabled == false and zeros otherwise); xrun counts
+    // come from the backend's status of each period.  Queue depths
+    // and event overflows are always reported.  realtime holds what the
+    // realtime-safety checker caught (AS_ENABLE_RT_CHECK; see rt_check.h).
+
+    struct Stats {
+        bool              enabled   = perf::enabled;
+        perf::LoadSummary callback;             // whole backend callback
+        uint64_t          budget_ns = 0;        // duration of the last callback's block
+        uint64_t          overruns  = 0;        // callbacks that took longer than their block
+        uint64_t          output_underflows = 0;
+        uint64_t          output_overflows  = 0;
+        uint64_t          input_underflows  = 0;
+        uint64_t          input_overflows   = 0;
+        uint64_t          priming_outputs   = 0;
+        double            output_latency_s  = 0.0;   // DAC time − callback time, last callback
+        std::vector<std::pair<std::string, perf::LoadSummary>> nodes;   // live graph, plan order
+        size_t            cmd_queue_depth    = 0;
+        size_t            cmd_queue_capacity = 0;
+        std::vector<std::pair<std::string, size_t>> preview_queue_depths;
+        size_t            preview_queue_capacity = 0;
+        uint64_t          event_overflows = 0;   // since the live graph's nodes were activated
+        rtcheck::Report   realtime;              // process-wide; empty unless AS_ENABLE_RT_CHECK
+    };
+
+    // Snapshot the counters; reset zeroes the timings and xrun counts
+    // afterwards (node timings also restart whenever the graph is replaced).
+    Stats get_stats(bool reset = false);
+
+    // -----------------------------------------------------------------------
+    // Shared-memory state (main thread)
+    // -----------------------------------------------------------------------
+    // Create the SharedState region on first call; the audio thread then
+    // publishes transport, meters and control_monitor values into it every
+    // block.  Later calls return the same region.
+    // Returns error string on failure, empty on success.
+    std::string open_shared_state(std::string& name_out, size_t& size_out);
+
     float sample_rate() const { return cfg_.sample_rate; }
     int   block_size()  const { return cfg_.block_size;  }
 
@@ -125,7 +257,19 @@ public:
 
 private:
     AudioEngineConfig cfg_;
-    void* stream_ = nullptr;  // PaStream* — opaque to avoid PortAudio header in API
+    std::unique_ptr<AudioBackend> backend_;   // non-null while open
+
+    // Parallel graph executor for the live graph and its patched()
+    // successors.  Null when worker_threads == 0.  Declared before the
+    // graphs so it outlives them.
+    std::unique_ptr<GraphExecutor> executor_;
+
+    // Offline render graphs use their own pool, so a bounce never takes the
+    // live callback's workers (which would push it onto its serial
+    // fallback).  Null when render_worker_threads == 0.  Concurrent renders
+    // (stems) share it: one runs parallel, the others find it busy and run
+    // serially (see GraphExecutor::run).
+    std::unique_ptr<GraphExecutor> render_executor_;
 
     // Graph — swapped atomically. Audio thread reads active_graph_.
     //
@@ -145,49 +289,129 @@ private:
     std::mutex                   graph_mutex_;
     std::atomic<uint64_t>        graph_epoch_   { 0 };
 
+    // Last set_graph description and the parameter values written since
+    // (handle into owned_graph_ → value), so offline renders can rebuild an
+    // equivalent graph.  Guarded by graph_mutex_.
+    std::string                    graph_desc_;
+    std::unordered_map<int, float> param_values_;
+
+    // Swap g in as the active graph and free the old one once the audio
+    // thread has moved on.  Caller holds graph_mutex_.
+    void publish_graph(std::unique_ptr<Graph> g);
+
     // Dispatcher — lives on audio thread
     Dispatcher dispatcher_;
 
+    // Latest schedule, shared with dispatcher_ and offline render cursors.
+    // Patches are built from it, so producers hold schedule_mutex_ until the
+    // swap has been handed to dispatcher_.
+    void install_schedule(std::shared_ptr<const Schedule> sched);
+    std::shared_ptr<const Schedule> schedule_;
+    std::mutex                      schedule_mutex_;
+
     // Transport state (written by audio thread, readable from main)
     std::atomic<double> current_beat_ { 0.0 };
     std::atomic<bool>   playing_      { false };
 
     // Loop state (written by main, read by audio — via command queue)
-    struct LoopState { double start = 0; double end = 0; bool enabled = false; };
-    std::atomic<LoopState*>  pending_loop_ { nullptr };
-    LoopState*               active_loop_  { nullptr };
-
-    // Simple command queue (same pattern as Python engine)
-    enum class Cmd { Play, Stop, Seek, AllNotesOff, SetParam };
+    // A state the audio thread replaces goes on retired_loops_ and is freed
+    // by the next publish_loop().
+    struct LoopState { double start = 0; double end = 0; bool enabled = false;
+                       LoopState* next = nullptr; };
+    std::atomic<LoopState*>  pending_loop_  { nullptr };
+    LoopState*               active_loop_   { nullptr };
+    std::atomic<LoopState*>  retired_loops_ { nullptr };
+    void publish_loop(LoopState* ls);
+
+    // Command queue: main/IPC threads → audio thread.
+    // Entries are POD — node/param names are resolved to a Graph param handle
+    // on the producer side — so the callback never locks, allocates or frees
+    // while draining it.  Producers serialise on cmd_push_mutex_; the audio
+    // thread never touches that mutex.
+    enum class Cmd : uint8_t { Play, Stop, Seek, AllNotesOff, SetParam };
     struct CmdEntry {
-        Cmd         cmd;
-        double      arg = 0.0;
-        std::string node_id;
-        std::string param;
-        float       value = 0.0f;
+        Cmd      cmd    = Cmd::Play;
+        double   arg    = 0.0;    // Seek: target beat
+        uint32_t graph  = 0;      // SetParam: Graph::serial() the handle belongs to
+        int      handle = -1;     // SetParam: Graph::param_handle()
+        float    value  = 0.0f;   // SetParam
     };
-    std::vector<CmdEntry>    cmd_queue_;
-    std::mutex               cmd_mutex_;
+    static constexpr size_t CMD_QUEUE_CAPACITY = 1024;
+    SpscQueue<CmdEntry, CMD_QUEUE_CAPACITY> cmd_queue_;
+    std::mutex                              cmd_push_mutex_;
 
     float bpm_ = 120.0f;  // set from graph JSON or set_bpm(); read by callback + render
 
-    // Heap-allocated scratch buffers for the PortAudio callback.
-    // Allocated in open() to avoid the 32 KB stack overflow that two
-    // MAX_BLOCK_SIZE float arrays would cause in an 8 KB ALSA callback stack.
-    std::vector<float> scratch_L_;
-    std::vector<float> scratch_R_;
-
     void send_cmd(Cmd c, double arg = 0.0);
     void send_param_cmd(const std::string& node_id, const std::string& param, float value);
-
-    // PortAudio callback — static trampoline
-    static int pa_callback(
-        const void* input, void* output,
-        unsigned long frames,
-        const PaStreamCallbackTimeInfo* time_info,
-        PaStreamCallbackFlags status_flags,
-        void* user_data
-    );
-
-    void process_block(float* out_L, float* out_R, int frames);
+    void record_param(int handle, float value);  // graph_mutex_ held
+    void push_cmds(const CmdEntry* entries, size_t count);
+
+    // Backend callback — static trampoline.  Renders each period in place,
+    // in slices of at most block_size frames.
+    static void audio_callback(const AudioBackend::Period& period, void* user);
+
+    // One slice: out[0..channels) each hold frames floats.
+    void process_block(float* const* out, int channels, int frames);
+
+    // Run graph for ctx into out at offset: bound outputs render in place,
+    // channels the graph does not write are zeroed.
+    void render_into(Graph* graph, const ProcessContext& ctx,
+                     float* const* out, int channels, int offset);
+
+    // Region from open_shared_state(); the audio thread only reads the
+    // atomic.  Lives until the engine is destroyed (after the stream).
+    std::unique_ptr<SharedState> shared_state_owner_;
+    std::atomic<SharedState*>    shared_state_ { nullptr };
+    std::mutex                   shared_state_mutex_;
+
+    void publish_shared_state(const Graph* graph);
+
+    // Written by the audio thread (record_callback), read and reset by
+    // get_stats().  Untouched unless built with AS_ENABLE_STATS.
+    struct CallbackStats {
+        perf::LoadHistogram   duration;
+        std::atomic<uint64_t> budget_ns         { 0 };
+        std::atomic<uint64_t> overruns          { 0 };
+        std::atomic<uint64_t> output_underflows { 0 };
+        std::atomic<uint64_t> output_overflows  { 0 };
+        std::atomic<uint64_t> input_underflows  { 0 };
+        std::atomic<uint64_t> input_overflows   { 0 };
+        std::atomic<uint64_t> priming_outputs   { 0 };
+        std::atomic<double>   output_latency_s  { 0.0 };
+    };
+    CallbackStats cb_stats_;
+
+    void record_callback(uint64_t start_ns, const AudioBackend::Period& period);
+
+    // --- Offline render internals ---
+    // Everything a render graph is rebuilt from, captured once per render so
+    // a set_graph / set_schedule arriving mid-render cannot mix arrangements.
+    struct RenderSnapshot {
+        std::string                                              desc;
+        std::vector<std::tuple<std::string, std::string, float>> params;
+        std::shared_ptr<const Schedule>                          schedule;
+        float                                                    bpm          = 120.0f;
+        int64_t                                                  total_frames = 0;
+    };
+    // Returns error string ("nothing to render", "no active graph"), empty on success.
+    std::string take_render_snapshot(float tail_seconds, double duration_beats,
+                                     RenderSnapshot& out);
+
+    // Build and activate a render graph from snap, run it from beat 0 for
+    // snap.total_frames, skipping schedule events for excluded nodes, and
+    // hand each block's outputs (null if the graph has none) to fn.  fn
+    // returns false to stop early.  Returns error string, empty on success.
+    using RenderBlockFn = std::function<bool(const float* L, const float* R, int frames)>;
+    std::string render_snapshot(const RenderSnapshot& snap,
+                                std::unordered_set<std::string> excluded,
+                                const RenderBlockFn& fn);
+
+    // Graph construction goes through the plugin registry and plugin
+    // loaders, which are not thread-safe; every graph build (set_graph,
+    // patch_graph, render graphs) takes this.  owned_graph_ and graph_desc_
+    // are also only replaced with it held, so a patch builds from them
+    // under this alone and takes graph_mutex_ just to publish.  Lock order:
+    // this, then graph_mutex_.
+    std::mutex render_build_mutex_;
 };
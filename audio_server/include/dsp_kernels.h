@@ -0,0 +1,45 @@
+#pragma once
+// dsp_kernels.h
+// Block-level DSP kernels shared by the builtin nodes and the engine.
+//
+// Each kernel has AVX2 (x86, picked at runtime from the CPU's feature
+// bits), NEON (AArch64) and scalar implementations; the backend is chosen
+// once, on first use.  All kernels are realtime-safe and accept any n and
+// unaligned pointers.
+
+#include <cstring>
+
+namespace dsp {
+
+// dst[i] += src[i] * gain
+void gain_accumulate(float* dst, const float* src, float gain, int n);
+
+// buf[i] = fast_tanh(buf[i])
+void soft_clip(float* buf, int n);
+
+// out[2i] = L[i], out[2i+1] = R[i]
+void interleave(float* out, const float* L, const float* R, int n);
+
+// peak = max |buf[i]|, energy = sum buf[i]^2  (for meters: rms = sqrt(energy / n))
+void peak_energy(const float* buf, int n, float& peak, float& energy);
+
+// Rational (Padé 7/6) tanh, saturated to +/-1: within 1e-4 of std::tanh
+// everywhere and far closer for |x| < 3.  The vector kernels use the same
+// formula.
+inline float fast_tanh(float x) {
+    x = x < -4.97f ? -4.97f : (x > 4.97f ? 4.97f : x);
+    float x2 = x * x;
+    float p  = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)));
+    float q  = 135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f));
+    float r  = p / q;
+    return r < -1.0f ? -1.0f : (r > 1.0f ? 1.0f : r);
+}
+
+// libc's memset/memcpy already pick vector paths at runtime.
+inline void zero(float* buf, int n) { std::memset(buf, 0, n * sizeof(float)); }
+inline void copy(float* dst, const float* src, int n) { std::memcpy(dst, src, n * sizeof(float)); }
+
+// Active backend: "avx2", "neon" or "scalar".
+const char* backend();
+
+} // namespace dsp
@@ -14,8 +14,16 @@
 #include <functional>
 #include <atomic>
 #include <optional>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <tuple>
+#include <cstddef>
 
-// PortAudio buffer size upper bound (for stack-allocating scratch buffers)
+#include "graph_executor.h"
+#include "perf_stats.h"
+
+// Largest block a graph processes; longer device periods are split.
 constexpr int MAX_BLOCK_SIZE = 4096;
 
 // ---------------------------------------------------------------------------
@@ -30,11 +38,31 @@ enum class PortType {
 
 // A buffer that flows between nodes on the audio thread.
 // For audio ports: pointer into a pre-allocated pool (no heap allocation in hot path).
-// For control ports: just a float.
+// For control ports: just a float, optionally with a ramp segment.
 struct PortBuffer {
     PortType type = PortType::AudioMono;
     float*   audio = nullptr;   // non-owning pointer, valid for one process() call
     float    control = 0.0f;    // used when type == Control
+    // Optional sample-accurate ramp for Control ports: the value moves
+    // linearly from ramp_from at frame 0 to `control` at frame ramp_frames,
+    // then holds.  ramp_frames == 0 means `control` for the whole block, so
+    // nodes that only read `control` see the value the block settles on.
+    float    ramp_from   = 0.0f;
+    int      ramp_frames = 0;
+
+    // Audio ports: the pool's silence flag for this buffer — how many
+    // leading frames are known to be zero (see BufferPool).  A node may
+    // skip reading an input that is_silent() for the block, and may
+    // set_silent() an output it filled with zeros.  Outputs start each
+    // block flagged not silent.
+    int*     silent_frames = nullptr;
+
+    float control_at(int frame) const {
+        if (frame >= ramp_frames) return control;
+        return ramp_from + (control - ramp_from) * (static_cast<float>(frame) / ramp_frames);
+    }
+    bool is_silent(int frames) const { return silent_frames && *silent_frames >= frames; }
+    void set_silent(int frames) const { if (silent_frames) *silent_frames = frames; }
 };
 
 // ---------------------------------------------------------------------------
@@ -47,6 +75,7 @@ struct ProcessContext {
     float bpm;
     double beat_position;  // beat at start of this block
     double beats_per_sample;
+    bool   offline = false;   // render_offline: no deadline (PluginProcessContext::offline)
 };
 
 class Node {
@@ -82,9 +111,29 @@ public:
         std::vector<PortBuffer>&       outputs
     ) = 0;
 
+    // Audio thread, before process(): true if, while every audio input is
+    // silent, process() would only write silence and nothing it does
+    // matters later — e.g. a synth with no sounding voices, or an effect
+    // whose tail has died out.  Graph::process() then skips the node and
+    // leaves its audio outputs zeroed and flagged silent.  Default: never.
+    virtual bool idle() const { return false; }
+
+    // Main thread, after construction: names state this node changes while
+    // processing that other nodes share (e.g. a FluidSynth font's voice
+    // counts).  The graph never runs two nodes with the same non-empty key
+    // at once.  Default: none.
+    virtual std::string shared_state_key() const { return {}; }
+
     // Main thread: set a named parameter (thread-safe via atomic where needed).
     virtual void set_param(const std::string& name, float value) {}
 
+    // Integer path for set_param().  param_index() is resolved once on the
+    // main thread; set_param_index() is then called on the audio thread with
+    // no string handling.  -1 = no such parameter; Graph::param_handle() then
+    // refuses a handle.  A node with string params should implement both.
+    virtual int  param_index(const std::string& name) const { return -1; }
+    virtual void set_param_index(int index, float value) {}
+
     // Note events — called from audio thread before process().
     virtual void note_on (int channel, int pitch, int velocity) {}
     virtual void note_off(int channel, int pitch) {}
@@ -96,12 +145,27 @@ public:
     // Control event — sets a queued value that will be applied at process() time.
     // normalized_value is 0..1; the node maps it to its internal range.
     virtual void push_control(double beat, float normalized_value) {}
+
+    // Sub-block timing for the event callbacks above: the sample offset,
+    // within the next process() block, of the event being delivered.  The
+    // dispatcher sets it around each call (TrackSourceNode and event routes
+    // pass it on); everything else (previews, all_notes_off) sees 0, the
+    // start of the block.  Nodes that render in segments between events
+    // read it; the rest can ignore it.
+    void set_event_frame(int frame) { event_frame_ = frame; }
+    int  event_frame() const { return event_frame_; }
+
+private:
+    int event_frame_ = 0;
 };
 
 // ---------------------------------------------------------------------------
 // Graph
 // ---------------------------------------------------------------------------
 
+class PluginAdapterNode;
+class TrackSourceNode;
+
 struct Connection {
     std::string from_node;
     std::string from_port;
@@ -111,19 +175,35 @@ struct Connection {
 
 // Scratch buffer pool — pre-allocated on graph activation, handed out to ports.
 // One pool per graph instance; audio thread uses it exclusively.
+//
+// All buffers live in one zeroed arena.  Each starts on a 64-byte boundary
+// (cache line, and the widest SIMD load), with the stride rounded up to
+// match.
+//
+// Each buffer also carries a silence flag: the number of leading frames
+// known to be zero (0 = unknown).  Whoever writes the buffer keeps it
+// true — the graph clears it before a node writes an output and sets it
+// when it zeroes the output of a skipped node.
 class BufferPool {
 public:
+    static constexpr size_t ALIGNMENT = 64;
+
     void allocate(int num_buffers, int block_size);
     float* get(int index);  // panics if index out of range
-    int    count() const { return static_cast<int>(buffers_.size()); }
+    int*   silent_frames(int index);   // same indices as get()
+    int    count() const { return count_; }
 private:
-    std::vector<std::vector<float>> buffers_;
+    struct ArenaFree { void operator()(float* p) const; };
+    std::unique_ptr<float[], ArenaFree> arena_;
+    std::unique_ptr<int[]>              silent_;
+    size_t                              stride_ = 0;   // floats per buffer
+    int                                 count_  = 0;
 };
 
 class Graph {
 public:
     Graph()  = default;
-    ~Graph();   // deactivates all nodes
+    ~Graph();   // deactivates the nodes it does not share (see patched())
 
     // Build from JSON (runs on main thread). Returns nullptr on error.
     static std::unique_ptr<Graph> from_json(
@@ -133,8 +213,29 @@ public:
 
     // Activate: allocate buffers, call node->activate(), compute eval order.
     bool activate(float sample_rate, int max_block_size);
+    // Deactivates every node not also held by another graph.
     void deactivate();
 
+    // Build an activated successor of this (activated) graph with an edit
+    // applied (main thread; this graph may keep running on the audio thread
+    // meanwhile).  patch_json:
+    //   {"remove_connections": [Connection...], "remove_nodes": [id...],
+    //    "add_nodes": [NodeDesc...], "add_connections": [Connection...]}
+    // applied in that order; removing a node drops its connections and
+    // output routes too.
+    // Surviving nodes are shared with the successor as they are — no
+    // rebuild, no reactivation, state and parameters intact — and only the
+    // new ones are built and activated.  The successor gets its own plan,
+    // buffers, DAG and serial.  Returns nullptr + error_out on failure.
+    std::unique_ptr<Graph> patched(const std::string& patch_json,
+                                   std::string& error_out) const;
+
+    // Audio thread: call once per block before dispatching events.  The
+    // first call on a patched() graph moves the track_source fan-out and
+    // adapter connection flags of shared nodes over to the new wiring (the
+    // old graph may still be using them until then).  No-op otherwise.
+    void commit_wiring();
+
     // Audio thread: process one block.
     // MIDI events for this block should be injected via node->note_on() etc.
     // before calling process().
@@ -145,21 +246,184 @@ public:
     const float* output_L() const;
     const float* output_R() const;
 
+    // --- Output channels ---
+    // The mixer's audio_out_L/R play on output channels 0 and 1.  "outputs"
+    // in the description routes further audio outputs (stems, buses) to
+    // channels 2 and up, one port per channel:
+    //   "outputs": [{"node": str, "port": str, "channel": int}, ...]
+    static constexpr int MAX_OUTPUT_CHANNELS = 64;
+    struct OutputRoute {
+        std::string node;
+        std::string port;
+        int         channel = 0;
+    };
+    const std::vector<OutputRoute>& output_routes() const { return output_routes_; }
+
+    // Whether some output plays on channel c (mixer or route).
+    bool writes_channel(int c) const;
+
+    // Audio thread, before process(): point each routed output — and every
+    // input reading it — at channels[c] (block_size floats), so the graph
+    // renders into the caller's buffers in place.  Channels past count or
+    // null fall back to the graph's own buffers, as does bind_outputs(nullptr,
+    // 0).  output_L()/output_R() follow the binding.  Lasts until the next
+    // call.
+    void bind_outputs(float* const* channels, int count);
+
     // Main thread: parameter updates (atomic).
     void set_param(const std::string& node_id, const std::string& param, float value);
 
+    // --- Parameter handles ---
+    // Resolve (node_id, param) to an integer handle on the main thread so the
+    // audio thread can apply values without touching strings.  Handles stay
+    // valid for the graph's lifetime.  Every control input port is interned at
+    // activate(); other names (e.g. mixer "gain_N") are interned on first use.
+    // Returns -1 if the node does not exist, has no such parameter, or the
+    // handle table is full.
+    int  param_handle(const std::string& node_id, const std::string& param);
+
+    // Audio thread: apply a value through a handle from param_handle().
+    void set_param(int handle, float value);
+
+    // Main thread: the (node_id, param) a handle was resolved from.
+    // Returns false for an unknown handle.
+    bool param_target(int handle, std::string& node_id, std::string& param) const;
+
+    // Process-unique id, so queued handles can be checked against the graph
+    // they were resolved for.
+    uint32_t serial() const { return serial_; }
+
+    // "bpm" from the description passed to from_json(); 0 if absent.
+    float bpm() const { return bpm_; }
+
     // Look up a node by id (main thread or audio thread, read-only).
     Node* find_node(const std::string& id) const;
 
     // Evaluation order (computed by activate()).
     const std::vector<std::string>& eval_order() const { return eval_order_; }
 
+    // Dependencies between eval_order() steps for the executor (computed by
+    // activate(); see build_dag()).
+    const TaskDag& dag() const { return dag_; }
+
+    // Pool buffers in use after buffer assignment, including the silent one.
+    // Control ports do not take pool buffers (see control_slot_count()).
+    int buffer_count() const { return pool_.count(); }
+
+    // Control slots in use, including the constant-zero one.
+    int control_slot_count() const { return static_cast<int>(control_slots_.size()); }
+
+    // Plugin events refused by full event lists since the nodes were
+    // activated (see MidiEventList).  Any thread.
+    uint64_t event_overflows() const;
+
+    // Time spent in each node's process() since activation or the last
+    // reset_node_loads(), in plan order.  Empty unless built with
+    // AS_ENABLE_STATS.  Any thread.
+    std::vector<std::pair<std::string, perf::LoadSummary>> node_loads() const;
+    void reset_node_loads();
+
+    // Plan steps skipped by the last process() because their inputs were
+    // silent and the node was idle (see Node::idle()).  Audio thread.
+    int idle_steps() const { return idle_steps_.load(std::memory_order_relaxed); }
+
+    // Preview events waiting for the next block, per track_source node.
+    // Any thread.
+    std::vector<std::pair<std::string, size_t>> preview_queue_depths() const;
+
+    // --- Metering ---
+    // With metering on, process() measures each connected input pair of the
+    // "mixer" node (id = the node feeding it) and then the graph output
+    // ("master", always last), and records the control_in value of every
+    // builtin.control_monitor node.  Values are for the last block; read
+    // them on the audio thread after process().  The engine publishes them
+    // to clients through SharedState.
+    struct Meter {
+        std::string id;
+        float peak_L = 0.0f, peak_R = 0.0f;
+        float rms_L  = 0.0f, rms_R  = 0.0f;
+    };
+    struct Monitor {
+        std::string id;
+        float       value = 0.0f;
+    };
+
+    // Set before activate(); patched() successors inherit it.
+    void set_metering(bool on) { metering_ = on; }
+    const std::vector<Meter>&   meters()   const { return meters_; }
+    const std::vector<Monitor>& monitors() const { return monitors_; }
+
+    // Run independent plan steps concurrently on ex's worker pool.
+    // nullptr (the default) runs the plan serially.  The executor must
+    // outlive the graph; set before the graph is handed to the audio thread.
+    void set_executor(GraphExecutor* ex) { executor_ = ex; }
+
 private:
+    // --- Execution plan ---
+    // Compiled by activate() from eval_order_ and the buffer assignment so
+    // that process() walks a flat array: no id lookups, no PortBuffer vector
+    // construction and no dynamic_cast on the audio thread.
+
+    enum class StepKind : uint8_t {
+        Native,          // plain Node subclass
+        PluginAdapter,   // PluginAdapterNode — may produce event outputs
+    };
+
+    // A control output's value for the current block — the scalar part of
+    // a PortBuffer.  Slot 0 is never written and reads as a constant 0 for
+    // unconnected control inputs.
+    struct ControlSlot {
+        float value       = 0.0f;
+        float ramp_from   = 0.0f;
+        int   ramp_frames = 0;
+    };
+
+    // Links a PortBuffer index to its control slot so it can be loaded/stored
+    // per block.
+    struct ControlLink {
+        int          slot;     // index into ExecStep::inputs / outputs
+        ControlSlot* value;    // &control_slots_[slot_idx]
+    };
+
+    // One destination of a PluginAdapterNode event output port, resolved at
+    // activate() from connections_.
+    struct EventRoute {
+        Node*              dest         = nullptr;
+        PluginAdapterNode* dest_adapter = nullptr;  // non-null → batch delivery
+        int                dest_port    = -1;       // dest_adapter event input ordinal
+    };
+
+    // Inputs of a step measured after its process() (see set_metering()).
+    struct MeterTap   { int meter;   int in_L; int in_R; };   // indices into meters_ / inputs
+    struct MonitorTap { int monitor; int input; };
+
+    struct ExecStep {
+        Node*                    node    = nullptr;
+        PluginAdapterNode*       adapter = nullptr;  // set when kind == PluginAdapter
+        StepKind                 kind    = StepKind::Native;
+        // Pre-sized and pre-wired; process() only refreshes control values.
+        std::vector<PortBuffer>  inputs;
+        std::vector<PortBuffer>  outputs;
+        std::vector<ControlLink> control_inputs;
+        std::vector<ControlLink> control_outputs;
+        // Indexed like adapter->event_outputs(): destinations per output port.
+        std::vector<std::vector<EventRoute>> event_routes;
+        perf::LoadHistogram*     load = nullptr;     // into step_loads_; null without stats
+        // Audio outputs only (no control or event outputs), so the step can
+        // be skipped when idle without anyone downstream missing a value.
+        bool                     bypassable = false;
+        std::vector<MeterTap>    meter_taps;
+        std::vector<MonitorTap>  monitor_taps;
+    };
+
     struct NodeEntry {
-        std::unique_ptr<Node>        node;
+        std::shared_ptr<Node>        node;   // shared with patched() successors
         std::vector<Node::PortDecl>  ports;
-        std::vector<int>             input_buf_indices;   // index into pool
-        std::vector<int>             output_buf_indices;
+        // Index into pool_, or into control_slots_ for Control ports.
+        std::vector<int>             input_buf_indices;
+        std::vector<int>             output_buf_indices;  // may share a pool buffer
+                                                          // with a port whose
+                                                          // lifetime has ended
         // Params from the JSON NodeDesc, applied after activate()
         std::unordered_map<std::string, float> init_params;
     };
@@ -168,16 +432,107 @@ private:
     std::unordered_map<std::string, int>          node_index_;  // id → nodes_ index
     std::vector<Connection>                       connections_;
     std::vector<std::string>                      eval_order_;
+    std::vector<ExecStep>                         plan_;
+    std::unique_ptr<perf::LoadHistogram[]>        step_loads_;   // one per plan_ step
+
+    bool                                          metering_ = false;
+    std::vector<Meter>                            meters_;
+    std::vector<Monitor>                          monitors_;
+
+    // Dependencies between plan_ steps for GraphExecutor (built with plan_).
+    TaskDag                                       dag_;
+    std::unique_ptr<std::atomic<int>[]>           dag_pending_;
+    GraphExecutor*                                executor_ = nullptr;
+    const ProcessContext*                         run_ctx_  = nullptr;  // valid during process()
+    std::atomic<int>                              idle_steps_ { 0 };
+
+    // Handle → (node, param name).  Capacity is reserved at activate() and
+    // never exceeded, so appends on the main thread never move entries the
+    // audio thread may be reading.
+    struct ParamTarget {
+        Node*       node;
+        std::string param;
+        int         index;    // Node::param_index(param), -1 = no such param (ignored)
+    };
+    static constexpr int MAX_DYNAMIC_PARAMS = 1024;
+    std::vector<ParamTarget>                      param_targets_;
+    // Entries of param_targets_ the audio thread may read: stored (release)
+    // after each append, so set_param never reads the vector's own size.
+    std::atomic<int>                              param_count_ { 0 };
+    std::unordered_map<std::string, int>          param_handles_;  // "node\x1fparam" → handle
+    mutable std::mutex                            param_mutex_;    // guards appends (main thread)
+    uint32_t                                      serial_ = next_serial();
+    float                                         bpm_    = 0.0f;
 
     BufferPool                                    pool_;
+    // Steps (by node) that must finish before another step may write a pool
+    // buffer they used: (earlier user, later writer).  Found by
+    // assign_buffers(), turned into DAG edges by build_dag().
+    std::vector<std::pair<const Node*, const Node*>> buffer_reuse_deps_;
+    // One slot per control output (never recycled: a few bytes each).  Sized
+    // by assign_buffers(); ControlLinks point into it.
+    std::vector<ControlSlot>                      control_slots_;
     float*                                        output_L_ = nullptr;
     float*                                        output_R_ = nullptr;
+
+    // One per output channel the graph writes (mixer first), built with
+    // plan_.  ports are the producing output and its consumers' inputs.
+    struct OutputBinding {
+        int                      channel = 0;
+        float*                   own        = nullptr;   // pool buffer
+        int*                     own_silent = nullptr;
+        int                      silent     = 0;         // flag while bound
+        float**                  master     = nullptr;   // &output_L_ / &output_R_
+        std::vector<PortBuffer*> ports;
+    };
+    std::vector<OutputRoute>                      output_routes_;
+    std::vector<OutputBinding>                    output_bindings_;
     int                                           block_size_ = 0;
+    float                                         sample_rate_ = 0.0f;
     bool                                          activated_ = false;
 
+    // Wiring for nodes shared with the graph this one was patched from,
+    // applied by commit_wiring().  After the swap the vectors hold the
+    // previous fan-out lists, so they are freed off the audio thread.
+    struct PendingWiring {
+        std::vector<std::pair<TrackSourceNode*, std::vector<Node*>>> downstream;
+        // Every control input of each shared adapter: (adapter, port, connected).
+        std::vector<std::tuple<PluginAdapterNode*, std::string, bool>> control_connected;
+    };
+    PendingWiring                                 pending_wiring_;
+    std::atomic<bool>                             wiring_pending_ { false };
+
+    // topo_sort → assign_buffers → build_plan → build_dag → build_param_table.
+    void compile();
+
+    // Distinct nodes connected from source_id (a TrackSourceNode's fan-out).
+    std::vector<Node*> downstream_of(const std::string& source_id) const;
+
     // Build topological eval order from connections_.
     bool topo_sort(std::string& error_out);
 
-    // Wire up buffer indices from pool after topo sort.
+    // Wire up buffer indices from pool after topo sort, recycling each
+    // output's buffer once its last consumer in eval order has run.
     void assign_buffers();
+
+    // Intern every control input port into param_targets_.
+    void build_param_table();
+
+    static uint32_t next_serial();
+
+    // Resolve the mixer and output_routes_ into output_bindings_ (after
+    // build_plan()).
+    void build_output_bindings();
+
+    // Compile plan_ from eval_order_ (after assign_buffers()).
+    void build_plan();
+
+    // Derive dag_ from connections_ and the event routes (after build_plan()).
+    void build_dag();
+
+    // Fill meters_/monitors_ and the steps' taps (after build_plan()).
+    void build_taps();
+
+    void run_step(ExecStep& step, const ProcessContext& ctx);
+    static void run_step_task(void* graph, int step_index);
 };
@@ -0,0 +1,113 @@
+#pragma once
+// graph_executor.h
+// Optional multi-threaded executor for Graph::process().
+//
+// A Graph compiles its execution plan into a TaskDag (successor lists plus
+// per-task predecessor counts).  GraphExecutor::run() executes one block of
+// that DAG on a pool of worker threads:
+//
+//   - Each task's pending counter starts at its predecessor count and is
+//     decremented as predecessors finish; a task becomes runnable at zero.
+//   - Runnable tasks go onto the finishing thread's own lock-free deque
+//     (Chase-Lev).  Idle threads steal from the top of other deques.
+//   - The calling thread (the PortAudio callback, or render_offline) takes
+//     part as worker 0 and run() returns only once every task has finished
+//     and every worker has left the block — so the graph is never touched
+//     after process() returns.
+//
+// Nothing here allocates or locks on the hot path.  Workers spin briefly
+// after a block and then park on a futex (Linux); the caller wakes parked
+// workers with a single FUTEX_WAKE and takes no lock.  Other platforms park
+// on a condition variable, and waking them there does take its mutex.
+//
+// Workers are pinned to cores and given SCHED_FIFO priority where the
+// platform allows it (Linux); failure to do so is not an error.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Dependency graph over Graph execution-plan steps (indices into plan_).
+struct TaskDag {
+    std::vector<int> succ_offsets;   // size n+1; successors of i are succ[offsets[i]..offsets[i+1])
+    std::vector<int> succ;
+    std::vector<int> dep_count;      // initial pending count per task
+    std::vector<int> roots;          // tasks with dep_count == 0
+
+    int size() const { return static_cast<int>(dep_count.size()); }
+};
+
+class GraphExecutor {
+public:
+    using TaskFn = void (*)(void* user, int task);
+
+    // Upper bound on tasks per run; graphs with more steps run serially.
+    static constexpr int MAX_TASKS = 4096;
+
+    // worker_count extra threads are started; the caller of run() is the
+    // additional worker 0.
+    explicit GraphExecutor(int worker_count);
+    ~GraphExecutor();
+
+    GraphExecutor(const GraphExecutor&) = delete;
+    GraphExecutor& operator=(const GraphExecutor&) = delete;
+
+    int worker_count() const { return static_cast<int>(workers_.size()); }
+
+    // Execute every task of dag once, respecting dependencies.
+    // pending must point at dag.size() counters owned by the caller.
+    // Returns false without running anything if the DAG is too large or
+    // another run() is in progress — the caller should then run serially.
+    bool run(const TaskDag& dag, std::atomic<int>* pending, TaskFn fn, void* user);
+
+private:
+    // Fixed-capacity Chase-Lev work-stealing deque of task indices.
+    // Owner pushes/pops at the bottom; thieves steal from the top.
+    // Indices grow monotonically, so no reset is needed between runs.
+    struct alignas(64) Deque {
+        std::atomic<int64_t> top    { 0 };
+        std::atomic<int64_t> bottom { 0 };
+        std::unique_ptr<std::atomic<int>[]> ring;
+
+        void init();
+        void push(int task);
+        bool pop(int& task);
+        bool steal(int& task);
+    };
+
+    std::unique_ptr<Deque[]> deques_;     // [0] = caller, [1..] = workers
+    int                      deque_count_ = 0;
+    std::vector<std::thread> workers_;
+
+    // Current job — written by run() before remaining_ is published.
+    const TaskDag*           dag_     = nullptr;
+    std::atomic<int>*        pending_ = nullptr;
+    TaskFn                   fn_      = nullptr;
+    void*                    user_    = nullptr;
+
+    alignas(64) std::atomic<int>      remaining_  { 0 };  // tasks not yet finished
+    alignas(64) std::atomic<int>      active_     { 0 };  // workers inside a block
+    alignas(64) std::atomic<uint64_t> generation_ { 0 };  // bumped per run()
+    std::atomic<bool>                 busy_       { false };
+    std::atomic<bool>                 quit_       { false };
+
+    // Parking for idle workers: they sleep while wake_seq_ is unchanged,
+    // and run() bumps it when parked_ says anyone is asleep.
+    alignas(64) std::atomic<uint32_t> wake_seq_ { 0 };
+    std::atomic<int>                  parked_   { 0 };
+#ifndef __linux__
+    std::mutex               park_mutex_;
+    std::condition_variable  park_cv_;
+#endif
+
+    void park(uint32_t seq);         // sleep until wake_seq_ != seq (or spuriously)
+    void wake_parked();
+
+    void worker_main(int self);
+    void work(int self);             // execute/steal until remaining_ == 0
+    void execute(int self, int task);
+};
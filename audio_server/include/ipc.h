@@ -1,29 +1,93 @@
 #pragma once
 // ipc.h
 // Length-prefixed JSON IPC over Unix domain socket (Linux) or named pipe (Windows).
-// Single-client: accepts one connection at a time; previous connection is closed
-// when a new one arrives. This is appropriate for a local per-user server.
+// Any number of clients may be connected at once.  One thread accepts and
+// reads every connection (epoll on Linux; on Windows one overlapped reader
+// per pipe instance) and hands each request to a worker lane:
+//
+//   Fast lane — one thread, requests run in arrival order.  For commands
+//               that return in microseconds (transport, preview, params).
+//   Slow lane — a small pool for renders and graph builds.  A connection
+//               has at most one slow request running; different
+//               connections' slow requests run side by side.
+//
+// The RequestRouter picks the lane.  Requests that carry no request id are
+// "ordered": they wait for everything the connection sent before them and
+// hold back everything after, so a client that does not tag its requests
+// sees strict request/reply order exactly as with a serial server.  Tagged
+// requests may finish out of order; the handler echoes the id so the
+// client can match replies (see "Request ids" in protocol.h).
+//
+// Frames are either plain JSON or binary (JSON header + raw payload); see
+// "Binary framing" in protocol.h.
 
 #include <string>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// One framed message.  payload is only carried by binary frames.
+struct IpcMessage {
+    std::string          json;
+    std::vector<uint8_t> payload;
+    bool                 binary = false;   // frame type (replies mirror the request)
+};
 
 // Handler: receives a request JSON string, returns a response JSON string.
 // Called on the IPC thread (not the audio thread, not the main thread).
 using RequestHandler = std::function<std::string(const std::string& request_json)>;
 
+// Handler for both frame types.  The server sends the reply in the same
+// frame type as the request regardless of reply.binary.
+using MessageHandler = std::function<IpcMessage(const IpcMessage& request)>;
+
+// Writes an intermediate frame (progress report, streamed chunk) to the
+// client ahead of the final reply, in the request's frame type.  Returns
+// false once the client has gone away.
+using ReplyWriter = std::function<bool(const IpcMessage& frame)>;
+
+// Handler that may emit intermediate frames through write before returning
+// its final reply.
+using StreamingHandler = std::function<IpcMessage(const IpcMessage& request,
+                                                  const ReplyWriter& write)>;
+
+// Worker lane and ordering for one request (see the top of this file).
+enum class IpcLane : uint8_t { Fast, Slow };
+
+struct IpcRoute {
+    IpcLane lane    = IpcLane::Slow;
+    bool    ordered = true;    // untagged: serialise with the connection's other requests
+};
+
+// Called on the reader thread for every request; keep it cheap.
+using RequestRouter = std::function<IpcRoute(const IpcMessage& request)>;
+
 class IpcServer {
 public:
-    explicit IpcServer(const std::string& address);
+    static constexpr int DEFAULT_SLOW_WORKERS = 2;
+
+    explicit IpcServer(const std::string& address, int slow_workers = DEFAULT_SLOW_WORKERS);
     ~IpcServer();
 
     // Not copyable.
     IpcServer(const IpcServer&) = delete;
     IpcServer& operator=(const IpcServer&) = delete;
 
-    // Start listening. handler is called for each incoming message.
+    // Start listening. handler is called for each incoming message, on the
+    // lane router picks (no router: everything runs ordered on the slow
+    // lane, i.e. serially per connection).  handler must be safe to call
+    // from several threads at once.
     // Returns error string on failure, empty on success.
+    std::string start(StreamingHandler handler, RequestRouter router = nullptr);
+
+    // Single-reply handler.
+    std::string start(MessageHandler handler);
+
+    // JSON-only convenience: binary requests get their JSON header passed
+    // through and an empty payload back.
     std::string start(RequestHandler handler);
 
     // Stop the server and close the socket/pipe.
@@ -32,21 +96,34 @@ public:
     bool is_running() const { return running_.load(); }
 
 private:
-    std::string     address_;
+    struct Job;
+    struct Connection;
+    struct Lanes;
+
+    std::string       address_;
+    int               slow_workers_;
     std::atomic<bool> running_ { false };
-    std::thread     thread_;
+    std::thread       thread_;      // accept + read loop
+    StreamingHandler  handler_;
+    RequestRouter     router_;
+    std::unique_ptr<Lanes> lanes_;
+
+    // Queue a request read from c and release whatever may now run.
+    void submit(const std::shared_ptr<Connection>& c, IpcMessage msg);
+    // Move c's runnable waiting requests onto their lanes (lanes_ mutex held).
+    void release(Connection& c);
+    // The connection went away: drop its waiting requests.
+    void drop(Connection& c);
+    void start_lanes();
+    void stop_lanes();
+    void run_lane(IpcLane lane);
 
 #ifdef AS_PLATFORM_WINDOWS
-    void* pipe_handle_ = nullptr;  // HANDLE — opaque
-    void run_windows(RequestHandler handler);
-    std::string send_response(void* handle, const std::string& data);
-    std::string read_message(void* handle, std::string& out);
+    void run_windows();
 #else
     int  server_fd_ = -1;
-    int  client_fd_ = -1;
-    void run_unix(RequestHandler handler);
-    bool send_all(int fd, const void* buf, size_t len);
-    bool recv_all(int fd, void* buf, size_t len);
+    int  wake_fd_   = -1;   // eventfd: stop() wakes the epoll loop
+    void run_unix();
 #endif
 };
 
@@ -68,6 +145,18 @@ public:
     // Returns error string on failure; response_out is set on success.
     std::string send(const std::string& request_json, std::string& response_out);
 
+    // Send a binary frame (request.binary is ignored) and receive the
+    // binary reply.
+    std::string send(const IpcMessage& request, IpcMessage& response_out);
+
+    // Read the next frame from the server (either type).  Used after send()
+    // for commands that stream intermediate frames before their final reply.
+    std::string receive(IpcMessage& frame_out);
+
+    // Send a frame without waiting for the reply (pipelined, tagged
+    // requests); collect replies with receive().
+    std::string post(const IpcMessage& request);
+
 private:
     std::string address_;
 
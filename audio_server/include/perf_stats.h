@@ -0,0 +1,124 @@
+#pragma once
+// perf_stats.h
+// Hot-path timing for the audio callback and graph nodes.
+//
+// Define AS_ENABLE_STATS at compile time (CMake ENABLE_STATS) to activate.
+// Instrumentation sites wrap their clock reads in AS_STATS(...), which
+// expands to nothing otherwise, so a build without stats carries no timing
+// code on the hot path.
+//
+// Usage:
+//   AS_STATS(const uint64_t t0 = perf::now_ns();)
+//   node->process(ctx, inputs, outputs);
+//   AS_STATS(hist.record(perf::now_ns() - t0);)
+//
+// Thread safety: a LoadHistogram has one writer at a time (the audio thread,
+// or whichever graph worker runs the node that block) and any number of
+// readers.  Everything is a relaxed atomic — no locks, no allocation.  A
+// summary taken while a block is being recorded may be off by that block.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifdef AS_ENABLE_STATS
+#define AS_STATS(...) __VA_ARGS__
+#else
+#define AS_STATS(...)
+#endif
+
+namespace perf {
+
+#ifdef AS_ENABLE_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+// Monotonic nanoseconds.  steady_clock is a vDSO read on Linux, cheap
+// enough to take twice per node per block.
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct LoadSummary {
+    uint64_t count    = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns   = 0;
+    // Upper edge of the bucket holding the percentile, capped at max_ns.
+    uint64_t p50_ns   = 0;
+    uint64_t p99_ns   = 0;
+
+    double mean_ns() const { return count ? double(total_ns) / double(count) : 0.0; }
+};
+
+// Durations in power-of-two buckets: bucket 0 holds everything under
+// 1.024 µs, bucket b holds [2^(b+9), 2^(b+10)) ns, and the last bucket is
+// open-ended (about 0.5 s and up).
+class LoadHistogram {
+public:
+    static constexpr int BUCKETS = 20;
+
+    void record(uint64_t ns) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > max_.load(std::memory_order_relaxed))
+            max_.store(ns, std::memory_order_relaxed);   // single writer
+        buckets_[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    LoadSummary summary() const {
+        LoadSummary s;
+        uint64_t counts[BUCKETS];
+        for (int b = 0; b < BUCKETS; ++b) {
+            counts[b] = buckets_[b].load(std::memory_order_relaxed);
+            s.count  += counts[b];
+        }
+        s.total_ns = total_.load(std::memory_order_relaxed);
+        s.max_ns   = max_.load(std::memory_order_relaxed);
+        s.p50_ns   = percentile(counts, s.count, s.max_ns, 50);
+        s.p99_ns   = percentile(counts, s.count, s.max_ns, 99);
+        return s;
+    }
+
+    void reset() {
+        count_.store(0, std::memory_order_relaxed);
+        total_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    static int bucket_of(uint64_t ns) {
+        uint64_t v = ns >> 10;
+        if (v == 0) return 0;
+        int b = 64 - __builtin_clzll(v);
+        return b < BUCKETS ? b : BUCKETS - 1;
+    }
+
+private:
+    static uint64_t percentile(const uint64_t* counts, uint64_t total,
+                               uint64_t max_ns, int pct) {
+        if (total == 0) return 0;
+        const uint64_t rank = (total * pct + 99) / 100;   // 1-based, rounded up
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= rank) {
+                if (b == BUCKETS - 1) return max_ns;
+                uint64_t upper = uint64_t(1024) << b;
+                return upper < max_ns ? upper : max_ns;
+            }
+        }
+        return max_ns;
+    }
+
+    std::atomic<uint64_t> count_ { 0 };
+    std::atomic<uint64_t> total_ { 0 };
+    std::atomic<uint64_t> max_   { 0 };
+    std::atomic<uint64_t> buckets_[BUCKETS] {};
+};
+
+} // namespace perf
@@ -8,7 +8,8 @@
 //   - Translates PluginDescriptor ports into Node::PortDecl
 //   - Manages buffer mapping between PluginBuffers and the flat PortBuffer vectors
 //   - Handles stereo expansion (AudioStereo → two AudioMono PortDecls)
-//   - Routes MIDI events from TrackSourceNode fan-out to the plugin
+//   - Routes MIDI events from TrackSourceNode fan-out to the plugin, splitting
+//     process() at event frames for plugins without event input ports
 //   - Manages event output ports (plugin → downstream nodes)
 //   - Bridges set_param() to control port values
 
@@ -35,7 +36,15 @@ public:
         std::vector<PortBuffer>&       outputs
     ) override;
 
+    // Quiet (no events, silent audio inputs) for at least the plugin's
+    // tail_frames().
+    bool idle() const override;
+
+    std::string shared_state_key() const override { return plugin_->shared_state_key(); }
+
     void set_param(const std::string& name, float value) override;
+    int  param_index(const std::string& name) const override;   // control_map_ index
+    void set_param_index(int index, float value) override;
 
     // MIDI events from TrackSourceNode fan-out
     void note_on (int channel, int pitch, int velocity) override;
@@ -59,10 +68,28 @@ public:
 
     /// Get event output buffers after process() — for the engine to route
     /// events to downstream nodes.
-    const std::vector<std::pair<std::string, std::vector<MidiEvent>>>& event_outputs() const {
+    const std::vector<std::pair<std::string, MidiEventList>>& event_outputs() const {
         return event_output_storage_;
     }
 
+    /// Events refused by full event lists since activation (any thread).
+    uint64_t events_dropped() const { return events_dropped_.load(std::memory_order_relaxed); }
+
+    /// Capacity of every event input and output list, per block.
+    static constexpr size_t EVENT_LIST_CAPACITY = 1024;
+
+    /// Ordinal of the named event input port among this plugin's event inputs,
+    /// or -1 if there is no such port.  Resolved once by Graph::activate() to
+    /// build the event routing table.
+    int event_input_index(const std::string& port_id) const;
+
+    /// Audio thread: deliver a batch of events from an upstream event output
+    /// into the given event input port (ordinal from event_input_index(); -1
+    /// selects the first event input).  The batch is appended to that port's
+    /// EventPortBuffer and also forwarded through the plugin's MIDI
+    /// convenience virtuals, exactly as note_on()/note_off() would.
+    void deliver_events(int port_index, const MidiEvent* events, size_t count);
+
     /// Called by Graph::activate() after assign_buffers() to tell the adapter
     /// which control input ports have live upstream connections.  Connected
     /// ports use the graph value; unconnected ports use the pending default.
@@ -116,16 +143,57 @@ private:
     // Pre-allocated PluginBuffers (reused each process call)
     PluginBuffers buffers_;
 
-    // Event input accumulator — filled by note_on/off etc, consumed in process()
-    std::vector<MidiEvent> event_input_accum_;
+    // Event input storage, one list per event input port (in event_map_
+    // order).  Filled by deliver_events() and note_on/off etc. (which target
+    // the first event input), consumed and cleared in process().
+    std::vector<MidiEventList> event_input_storage_;
 
     // Event output storage — filled by plugin in process(), read by engine after
-    std::vector<std::pair<std::string, std::vector<MidiEvent>>> event_output_storage_;
+    std::vector<std::pair<std::string, MidiEventList>> event_output_storage_;
+
+    // Backing store for every list above, EVENT_LIST_CAPACITY events each,
+    // allocated in activate().  Until then the lists have no capacity.
+    std::unique_ptr<MidiEvent[]> event_arena_;
+    std::atomic<uint64_t>        events_dropped_{0};
 
     // Input index counters for mapping flat arrays
     int n_input_decls_  = 0;
     int n_output_decls_ = 0;
 
+    // Sub-block timing for plugins without event input ports, which only see
+    // the convenience virtuals: calls stamped with a frame offset wait here
+    // (frame order) and process() runs the plugin in segments between them.
+    // Capacity is reserved at activate(); when full, calls go through at once.
+    enum class CallKind : uint8_t { NoteOn, NoteOff, Program, Bend, Volume };
+    struct TimedCall {
+        int      frame;
+        CallKind kind;
+        int      channel, a, b;
+    };
+    static constexpr size_t MAX_TIMED_CALLS = 256;
+    std::vector<TimedCall>         timed_calls_;
+    std::vector<ControlPortBuffer> block_controls_;   // full-block inputs while split
+    std::vector<size_t>            event_out_marks_;  // per event output, segment start
+
+    // Frames since the last event or non-silent audio input, saturating;
+    // compared against Plugin::tail_frames() by idle().  woken_ is set by
+    // every event delivered ahead of the next process().
+    int  quiet_frames_ = 0;
+    bool woken_        = false;
+
+    // Queue (or, without sub-block timing, make) one convenience call.
+    void post_call(CallKind kind, int frame, int channel, int a, int b = 0);
+    void make_call(const TimedCall& c);
+    // Run the plugin over [offset, offset+frames) of the wired block.
+    void process_segment(const PluginProcessContext& block_ctx, int offset, int frames);
+
     // Build mappings from descriptor
     void build_port_mapping();
+
+    // Append to the first event input's storage (legacy fan-out path).
+    void accumulate_event(const MidiEvent& ev);
+
+    // Invoke the plugin's convenience virtual matching ev's status byte (at
+    // ev.frame for plugins run in segments).
+    void forward_to_plugin(const MidiEvent& ev);
 };
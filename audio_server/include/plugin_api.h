@@ -25,12 +25,24 @@
 //
 // ==========================================================================
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <memory>
 #include <functional>
 #include <cstdint>
 
+/// Layout version of everything in this header a plugin library compiles
+/// against: the Plugin vtable and the structs passed to process().  Bump it
+/// with any change to either; load_plugin_library() refuses a library built
+/// with a different value (see REGISTER_PLUGIN_DYNAMIC).
+///   1  unversioned libraries (before the check existed)
+///   2  port handles, control slots, fixed-capacity event lists
+///   3  AudioPortBuffer::silent, Plugin::tail_frames()
+///   4  PluginProcessContext::offline
+///   5  Plugin::shared_state_key()
+constexpr int PLUGIN_ABI_VERSION = 5;
+
 // ==========================================================================
 // Port and control types
 // ==========================================================================
@@ -154,6 +166,10 @@ struct PluginProcessContext {
     float  bpm;
     double beat_position;     ///< Beat at start of this block.
     double beats_per_sample;
+    /// True in offline renders: there is no deadline, so process() may wait
+    /// for work another thread is doing (e.g. disk streaming) rather than
+    /// drop it.  Still no allocation or locks shared with the live graph.
+    bool   offline = false;
 };
 
 /// A single MIDI-style event with a sample offset within the block.
@@ -170,23 +186,105 @@ struct AudioPortBuffer {
     float* left   = nullptr;  ///< Always valid. For mono ports, this is the buffer.
     float* right  = nullptr;  ///< Non-null for stereo ports; null for mono.
     int    frames  = 0;       ///< Number of samples (== block_size).
+
+    /// Inputs: true when the engine knows every frame is zero, so the plugin
+    /// may skip reading the buffer.  Outputs: false on entry; a plugin that
+    /// wrote only zeros may set it so downstream nodes can skip the buffer.
+    bool   silent  = false;
 };
 
 /// Control port value.
 struct ControlPortBuffer {
     float  value   = 0.0f;    ///< Current value for this block.
+
+    /// Optional sample-accurate ramp: the value moves linearly from
+    /// ramp_from at frame 0 to `value` at frame ramp_frames, then holds.
+    /// ramp_frames == 0 (the default) means `value` for the whole block, so
+    /// plugins that only read `value` see the value the block settles on.
+    float  ramp_from   = 0.0f;
+    int    ramp_frames = 0;
+
+    float at(int frame) const {
+        if (frame >= ramp_frames) return value;
+        return ramp_from + (value - ramp_from) * (static_cast<float>(frame) / ramp_frames);
+    }
+};
+
+/// Fixed-capacity list of MidiEvents over storage the engine allocates at
+/// activate().  Appending never allocates: events past capacity() are
+/// refused and counted, and the engine reports the count in its stats.
+class MidiEventList {
+public:
+    MidiEventList() = default;
+    MidiEventList(MidiEvent* storage, size_t capacity)
+        : data_(storage), capacity_(capacity) {}
+
+    /// Append ev; false (and counted as dropped) if the list is full.
+    bool push_back(const MidiEvent& ev) {
+        if (size_ == capacity_) { ++dropped_; return false; }
+        data_[size_++] = ev;
+        return true;
+    }
+    /// Append up to n events; returns how many fit.
+    size_t append(const MidiEvent* events, size_t n) {
+        size_t fit = std::min(n, capacity_ - size_);
+        for (size_t i = 0; i < fit; ++i) data_[size_ + i] = events[i];
+        size_    += fit;
+        dropped_ += n - fit;
+        return fit;
+    }
+    void clear() { size_ = 0; }
+
+    size_t size()     const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool   empty()    const { return size_ == 0; }
+
+    MidiEvent*       data()        { return data_; }
+    const MidiEvent* data()  const { return data_; }
+    MidiEvent*       begin()       { return data_; }
+    MidiEvent*       end()         { return data_ + size_; }
+    const MidiEvent* begin() const { return data_; }
+    const MidiEvent* end()   const { return data_ + size_; }
+    MidiEvent&       operator[](size_t i)       { return data_[i]; }
+    const MidiEvent& operator[](size_t i) const { return data_[i]; }
+
+    /// Engine: events refused since the last call, resetting the count.
+    uint64_t take_dropped() { uint64_t d = dropped_; dropped_ = 0; return d; }
+
+private:
+    MidiEvent* data_     = nullptr;
+    size_t     size_     = 0;
+    size_t     capacity_ = 0;
+    uint64_t   dropped_  = 0;
 };
 
 /// Event port buffer — a sequence of MIDI events for this block.
 struct EventPortBuffer {
     /// Events received this block (for input ports), sorted by frame.
-    const std::vector<MidiEvent>* events = nullptr;
+    const MidiEventList* events = nullptr;
 
     /// Events to emit this block (for output ports).
-    /// Plugin appends events here during process().
-    std::vector<MidiEvent>* output_events = nullptr;
+    /// Plugin appends events here during process(); see MidiEventList for
+    /// what happens past its capacity.
+    MidiEventList* output_events = nullptr;
+};
+
+/// Resolved reference to one port's buffer in PluginBuffers.
+///
+/// Each PluginBuffers map holds its ports in descriptor order: audio (mono
+/// and stereo), control and event ports are numbered separately, and a
+/// handle is that number.  Resolve handles once with Plugin::port_handle()
+/// (or find_port()) in activate(), then index the maps with them in
+/// process() — no string compares on the audio thread.
+struct PortHandle {
+    int index = -1;
+    bool valid() const { return index >= 0; }
 };
 
+/// Handle of port id within its map, or an invalid handle if desc has no
+/// such port.  Main thread.
+PortHandle find_port(const PluginDescriptor& desc, const std::string& id);
+
 /// All port buffers for a plugin, keyed by port ID.
 ///
 /// The engine pre-populates these maps before each process() call.
@@ -194,13 +292,21 @@ struct EventPortBuffer {
 /// to internal buffer indices at activate() time and fills these structs
 /// with direct pointers each block.
 ///
-/// Plugins that want to cache pointers can do so in activate() or on
-/// first process() call, but the map API is the primary interface.
+/// Plugins should index the maps with PortHandles resolved in activate()
+/// (see above).  get(id) is a linear string-compare scan, kept for plugins
+/// that have not been migrated.
 struct PluginBuffers {
     /// Audio port buffers, keyed by PortDescriptor::id.
     struct AudioMap {
         AudioPortBuffer* get(const std::string& id);
         const AudioPortBuffer* get(const std::string& id) const;
+        /// nullptr for an invalid handle.
+        AudioPortBuffer* get(PortHandle h) {
+            return h.valid() && h.index < static_cast<int>(entries.size())
+                 ? &entries[h.index].second : nullptr;
+        }
+        /// Unchecked: h must be a valid handle for this plugin.
+        AudioPortBuffer& operator[](PortHandle h) { return entries[h.index].second; }
         // Internal storage — plugins shouldn't touch these directly.
         std::vector<std::pair<std::string, AudioPortBuffer>> entries;
     } audio;
@@ -209,6 +315,11 @@ struct PluginBuffers {
     struct ControlMap {
         ControlPortBuffer* get(const std::string& id);
         const ControlPortBuffer* get(const std::string& id) const;
+        ControlPortBuffer* get(PortHandle h) {
+            return h.valid() && h.index < static_cast<int>(entries.size())
+                 ? &entries[h.index].second : nullptr;
+        }
+        ControlPortBuffer& operator[](PortHandle h) { return entries[h.index].second; }
         // Internal storage.
         std::vector<std::pair<std::string, ControlPortBuffer>> entries;
     } control;
@@ -217,6 +328,11 @@ struct PluginBuffers {
     struct EventMap {
         EventPortBuffer* get(const std::string& id);
         const EventPortBuffer* get(const std::string& id) const;
+        EventPortBuffer* get(PortHandle h) {
+            return h.valid() && h.index < static_cast<int>(entries.size())
+                 ? &entries[h.index].second : nullptr;
+        }
+        EventPortBuffer& operator[](PortHandle h) { return entries[h.index].second; }
         // Internal storage.
         std::vector<std::pair<std::string, EventPortBuffer>> entries;
     } events;
@@ -256,6 +372,10 @@ public:
     /// key is ConfigParam::id; value is the new string-encoded value.
     virtual void configure(const std::string& key, const std::string& value) {}
 
+    /// Handle for one of this plugin's ports (see PortHandle).  Calls
+    /// descriptor(), so resolve handles in activate(), not process().
+    PortHandle port_handle(const std::string& id) const { return find_port(descriptor(), id); }
+
     // --- Realtime processing (audio thread) ---
 
     /// Process one block. Called on the audio thread — must not allocate,
@@ -266,8 +386,30 @@ public:
     ///
     /// Event input ports contain events for this block (sorted by frame).
     /// Event output ports should be populated by the plugin.
+    ///
+    /// A plugin without Event input ports only learns of notes through the
+    /// convenience interface below, so for sample-accurate timing the engine
+    /// splits the block at each event: process() is then called on
+    /// consecutive sub-ranges (ctx.block_size and buffer frames shrink,
+    /// ctx.beat_position advances) with the note calls made in between.
     virtual void process(const PluginProcessContext& ctx, PluginBuffers& buffers) = 0;
 
+    /// Frames of non-silent output the plugin may still produce if its audio
+    /// inputs stay silent and no events arrive, given its current state:
+    /// 0 = none (e.g. a synth with no sounding voices), N = a decaying tail
+    /// (e.g. a reverb), -1 = unknown or unbounded (the default).  Once the
+    /// inputs have been quiet that long the engine skips process() and hands
+    /// downstream silent buffers until something changes.  Audio thread,
+    /// between process() calls; must be cheap.
+    virtual int tail_frames() const { return -1; }
+
+    /// Names state this instance changes during process() or the event
+    /// calls that other instances share — e.g. a cache entry whose
+    /// bookkeeping is not thread-safe.  The engine never runs two plugins
+    /// with the same non-empty key at once.  Main thread, after configure();
+    /// default: none.
+    virtual std::string shared_state_key() const { return {}; }
+
     // --- MIDI event convenience interface (audio thread) ---
     //
     // These are called by the engine to deliver events from the legacy
@@ -375,6 +517,9 @@ public:
 #  undef REGISTER_PLUGIN
 #  define REGISTER_PLUGIN(PluginClass)  /* suppressed: register_plugin() handles it */
 #  define REGISTER_PLUGIN_DYNAMIC(PluginClass)                             \
+    extern "C" int arranger_plugin_abi_version() {                         \
+        return ::PLUGIN_ABI_VERSION;                                       \
+    }                                                                      \
     extern "C" void register_plugin(::PluginRegistry* /*registry*/) {     \
         static ::PluginRegistration _dyn_reg = [] {                        \
             auto tmp = std::make_unique<PluginClass>();                    \
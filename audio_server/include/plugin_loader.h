@@ -33,10 +33,13 @@ struct LoadPluginResult {
 
 /// Load a plugin shared library and register its plugin(s) with PluginRegistry.
 ///
-/// The library must export:
+/// The library must export (REGISTER_PLUGIN_DYNAMIC defines both):
+///   extern "C" int  arranger_plugin_abi_version();   // == PLUGIN_ABI_VERSION
 ///   extern "C" void register_plugin(PluginRegistry* registry);
 ///
-/// That function is called immediately after the library is loaded.
+/// A library without the version symbol, or built against a different
+/// plugin_api.h layout, is rejected before any of its code runs.  Otherwise
+/// register_plugin() is called immediately after the library is loaded.
 /// The library handle is intentionally never closed (plugins must remain live
 /// for the duration of the process).
 LoadPluginResult load_plugin_library(const std::string& path);
@@ -70,6 +73,8 @@ inline LoadPluginResult load_plugin_library(const std::string& path) {
         result.error = "LoadLibrary failed: " + std::string(msg);
         return result;
     }
+    using AbiFn = int(*)();
+    auto* abi = reinterpret_cast<AbiFn>(GetProcAddress(handle, "arranger_plugin_abi_version"));
     using RegisterFn = void(*)(PluginRegistry*);
     auto* fn = reinterpret_cast<RegisterFn>(GetProcAddress(handle, "register_plugin"));
     if (!fn) {
@@ -91,8 +96,20 @@ inline LoadPluginResult load_plugin_library(const std::string& path) {
         result.error = path + ": " + sym_err;
         return result;
     }
+    using AbiFn = int(*)();
+    auto* abi = reinterpret_cast<AbiFn>(dlsym(handle, "arranger_plugin_abi_version"));
 #endif
 
+    // --- Check the plugin ABI before running any plugin code ---
+
+    const int abi_version = abi ? abi() : 1;
+    if (abi_version != PLUGIN_ABI_VERSION) {
+        result.error = path + ": built for plugin ABI " + std::to_string(abi_version) +
+                       ", this server uses " + std::to_string(PLUGIN_ABI_VERSION) +
+                       " (rebuild the plugin against this plugin_api.h)";
+        return result;
+    }
+
     // --- Call the registration function ---
 
     // Snapshot registry size so we can report what was added.
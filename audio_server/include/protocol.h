@@ -4,6 +4,8 @@
 //
 // Transport: Unix domain socket (Linux) or named pipe (Windows).
 // Framing:   4-byte little-endian length prefix, then UTF-8 JSON payload.
+//            Optional binary frames carry a JSON header plus raw bytes
+//            (see "Binary framing" below).
 //
 // All messages are JSON objects with a required "cmd" field.
 // Responses always have "status": "ok" | "error", plus cmd-specific fields.
@@ -34,6 +36,74 @@ namespace protocol {
 // Max message size: 64 MB (generous upper bound for large graph descriptions)
 constexpr uint32_t MAX_MESSAGE_BYTES = 64 * 1024 * 1024;
 
+// -------------------------------------------------------------------------
+// Binary framing
+// -------------------------------------------------------------------------
+// Negotiation: the "features" list in the ping response contains
+// "binary_framing".  A client that sees it may send binary frames; the
+// server answers a binary frame with a binary frame and a plain JSON frame
+// with a plain JSON frame, so the two can be mixed on one connection.
+//
+// Binary frame = [uint32_t len | BINARY_FRAME_FLAG (LE)]
+//                [uint32_t json_len (LE)] [json_len bytes UTF-8 JSON]
+//                [len - 4 - json_len bytes raw payload]
+//
+// Payload use by command (binary frames only):
+//   render         reply payload = WAV file bytes or raw interleaved f32 PCM;
+//                  the JSON header has no "data" field
+//   set_schedule,  request payload, if non-empty, is the EventBatch JSON
+//   patch_schedule document itself (parsed once, never embedded in a string),
+//                  or packed event records with "format": "packed" (below)
+//   get_node_data  reply payload = the plugin's data; no "data" field
+//   render stream  each progress frame's payload = the next output chunk
+//   render_stems   reply payload = all stems back to back (see offsets)
+// Other commands ignore the payload and reply with an empty one.
+constexpr uint32_t BINARY_FRAME_FLAG   = 0x80000000u;
+// Binary replies may exceed MAX_MESSAGE_BYTES (long renders); requests may not.
+constexpr uint32_t MAX_BINARY_FRAME_BYTES = 0x7FFFFFFFu;
+
+// -------------------------------------------------------------------------
+// Packed events
+// -------------------------------------------------------------------------
+// Negotiation: "packed_events" in the ping features.  A binary set_schedule
+// or patch_schedule whose header has "format": "packed" carries its events
+// as an array of PACKED_EVENT_BYTES-byte little-endian records:
+//
+//   offset 0   f64  beat       (negative = setup event, as in JSON)
+//          8   f32  value
+//          12  u32  node       set_schedule: index into the header's
+//                              "nodes": [str, ...]; patch_schedule: 0
+//          16  u8   type       note_on 0, note_off 1, program 2, volume 3,
+//                              bend 4, control 5
+//          17  u8   channel
+//          18  u8   pitch
+//          19  u8   velocity
+//
+// e.g. {"cmd": "set_schedule", "format": "packed", "nodes": ["track_a"]}
+constexpr uint32_t PACKED_EVENT_BYTES = 20;
+
+// -------------------------------------------------------------------------
+// Request ids and concurrency
+// -------------------------------------------------------------------------
+// Negotiation: "request_ids" in the ping features.  The server takes any
+// number of connections.  A request may carry a top-level "id" (any JSON
+// value); the reply and any progress frames of that request then carry the
+// same "id", and tagged requests may be answered out of order:
+//
+//   fast lane   ping, shutdown, play, stop, seek, set_loop, set_bpm,
+//               get_position, set_param, resolve_params, set_params,
+//               note_on, note_off, all_notes_off, get_stats,
+//               get_node_data, open_shared_state — one thread, run in
+//               arrival order, never queued behind a render
+//   slow lane   everything else (render*, set_graph, patch_graph,
+//               set_schedule, plugin loading, ...) — a small pool; one
+//               slow request per connection at a time, in order
+//
+// Untagged requests keep the strict one-reply-per-request order of a
+// serial server: each waits for the connection's earlier requests and
+// holds back its later ones.  So "stop" can overtake a render only if both
+// are tagged, or if it is sent on another connection.
+
 // -------------------------------------------------------------------------
 // Commands  (cmd field values)
 // -------------------------------------------------------------------------
@@ -46,6 +116,13 @@ constexpr const char* CMD_SHUTDOWN      = "shutdown";       // → {status}
 // Set the complete signal graph. Replaces any existing graph atomically.
 // Payload: see GraphDesc below.
 constexpr const char* CMD_SET_GRAPH     = "set_graph";      // → {status}
+// Edit the current graph in place of a full set_graph rebuild.
+// {remove_connections?: [Connection...], remove_nodes?: [id...],
+//  add_nodes?: [NodeDesc...], add_connections?: [Connection...]} → {status}
+// Applied in that order; removing a node drops its connections.  Nodes the
+// patch leaves alone keep their state (voices, loaded SoundFonts, params).
+// Param handles are invalidated as with set_graph.
+constexpr const char* CMD_PATCH_GRAPH   = "patch_graph";    // → {status}
 
 // -- Transport --
 constexpr const char* CMD_PLAY          = "play";           // → {status}
@@ -59,28 +136,79 @@ constexpr const char* CMD_SET_BPM       = "set_bpm";        // {bpm: float} →
 // Send a batch of timed MIDI-style events (replaces current schedule).
 // Payload: see EventBatch below.
 constexpr const char* CMD_SET_SCHEDULE  = "set_schedule";   // → {status}
+// Replace the events of one target node, leaving the rest of the schedule
+// (and its playback position) alone.  Events may omit node_id; any other
+// node_id is an error.  An empty list clears the node's events.
+// {node_id: str, events: [Event...]} → {status}
+constexpr const char* CMD_PATCH_SCHEDULE = "patch_schedule";
 
 // -- Offline render --
 // Render the entire schedule offline, return raw PCM as base64.
 // {format: "wav"|"raw_f32"} → {status, data: "<base64>", sample_rate, channels}
+//
+// Chunked variants keep server memory at one chunk regardless of length:
+//   {stream: true, chunk_frames?: int}
+//     → N × {status: "progress", frames_done, total_frames, data | payload_bytes}
+//     → {status: "ok", format, sample_rate, channels, frames, bytes}
+//     Each progress frame carries the next chunk (base64 "data" in JSON
+//     frames, raw payload in binary frames); concatenated they equal the
+//     non-streamed output, WAV header included.
+//   {path: str, progress?: bool, chunk_frames?: int}
+//     Writes the output straight to path on the server's filesystem.  With
+//     progress: true, data-less progress frames are sent per chunk.
+//     → {status: "ok", ..., path}
+// Clients read frames until status != "progress".
 constexpr const char* CMD_RENDER        = "render";
+constexpr int MAX_RENDER_CHUNK_FRAMES   = 1 << 20;
+
+// Render one stem per group of nodes in one call, in parallel on private
+// copies of the graph; the realtime stream keeps playing.
+// {stems: [{name: str, nodes: [str, ...]}, ...], format?: "wav"|"raw_f32",
+//  dir?: str, threads?: int, progress?: bool, duration_beats?: float}
+//   → {status, format, sample_rate, channels, frames, stems: [...]}
+// A stem plays the schedule events for its nodes (usually track_source ids)
+// plus events for nodes that no stem lists (shared automation).
+// Without dir, stems[i] = {name, data: "<base64>"} in JSON frames, or
+// {name, offset, bytes} into the reply payload in binary frames.
+// With dir, each stem is streamed to <dir>/<name>.wav (or .f32) and
+// stems[i] = {name, path, bytes}.
+// progress: true sends {status: "progress", stem, frames_done, total_frames}
+// frames as the stems advance.
+constexpr const char* CMD_RENDER_STEMS  = "render_stems";
 
 // -- Node parameter control (realtime, low-latency path) --
 // {node_id: str, param_id: str, value: float} → {status}
 constexpr const char* CMD_SET_PARAM     = "set_param";
+// Resolve parameters to integer handles once, then stream values by handle.
+// {params: [{node_id: str, param_id: str}, ...]}
+//   → {status, graph: int, handles: [int, ...]}     handle -1 = unknown node
+// Handles stay valid until the next set_graph or patch_graph.
+constexpr const char* CMD_RESOLVE_PARAMS = "resolve_params";
+// {graph: int (optional), values: [[handle, value], ...]} → {status}
+// The whole batch is applied at the start of one audio block.  Returns an
+// error if "graph" no longer matches the current graph (re-resolve).
+constexpr const char* CMD_SET_PARAMS    = "set_params";
 
 // -- Plugin management --
 // {uri: str} → {status, node_id: str, ports: [...]}   (LV2 URI)
 constexpr const char* CMD_LOAD_PLUGIN   = "load_plugin";
 // {path: str} → {status, node_id: str}                (SF2 file)
 constexpr const char* CMD_LOAD_SF2      = "load_sf2";
+// {paths: [str, ...]} → {status}
+// Start loading SoundFonts into the shared cache in the background, so a
+// later set_graph naming them does not wait on disk.  Load errors surface
+// from that set_graph.  Errors if the server was built without SF2.
+constexpr const char* CMD_PRELOAD_SF2   = "preload_sf2";
 // {node_id: str} → {status}
 constexpr const char* CMD_UNLOAD_NODE   = "unload_node";
 
 // -- Query --
 // → {nodes: [...], connections: [...]}
 constexpr const char* CMD_GET_GRAPH     = "get_graph";
-// {uri_prefix: str (optional)} → {plugins: [...]}
+// {uri_prefix: str (optional)} → {plugins: [...]}  installed LV2 plugins.
+// Served from $XDG_CACHE_HOME/arranger/lv2_plugins.json (default
+// ~/.cache/...), keyed by bundle path and mtime; changed bundles are
+// re-parsed on the next listing.
 constexpr const char* CMD_LIST_PLUGINS  = "list_plugins";
 
 // -- Plugin descriptor query (new plugin API) --
@@ -100,6 +228,36 @@ constexpr const char* CMD_ALL_NOTES_OFF = "all_notes_off";
 // {node_id: str, config: {key: value, ...}} → {status}
 constexpr const char* CMD_SET_NODE_CONFIG = "set_node_config";
 
+// -- Instrumentation --
+// {reset?: bool} → {status, enabled, sample_rate, block_size,
+//   callback: {count, budget_us, mean_us, p50_us, p99_us, max_us,
+//              mean_load, peak_load, overruns},
+//   xruns: {output_underflow, output_overflow, input_underflow,
+//           input_overflow, priming_output},
+//   output_latency_ms,
+//   nodes: [{id, count, mean_us, p50_us, p99_us, max_us, mean_load}, ...],
+//   queues: {commands: {depth, capacity},
+//            preview: [{node_id, depth, capacity}, ...]},
+//   event_overflows,
+//   realtime: {enabled, allocations, frees, locks, blocking, unrecorded,
+//              sites: [{kind, call, count, stack: [str, ...]}, ...]}}
+// Loads are fractions of the block's duration (budget_us); percentiles are
+// the upper edge of a power-of-two histogram bucket.  callback and nodes
+// are zero with enabled == false (server built without ENABLE_STATS).
+// realtime counts calls the audio thread must not make (allocation, locks,
+// blocking I/O and sleeps) with one stack per distinct site; all zero with
+// enabled == false (server built without ENABLE_RT_CHECK).
+// reset clears timings, xrun and realtime counts after the reply is taken.
+constexpr const char* CMD_GET_STATS     = "get_stats";
+
+// {} → {status, name: str, size: int, version: int}
+// Creates (once) the shared-memory region the server publishes transport,
+// per-track meters and control_monitor histories into every audio block;
+// map name read-only (/dev/shm/<name> on Linux, file mapping
+// "Local\<name without '/'>" on Windows) and read it under the seqlock
+// described in shared_state.h, which also fixes the layout.
+constexpr const char* CMD_OPEN_SHARED_STATE = "open_shared_state";
+
 /// Retrieve plugin-specific graph/monitor data for a node.
 /// {node_id: str, port_id: str} → {status, data: str (JSON)}
 constexpr const char* CMD_GET_NODE_DATA = "get_node_data";
@@ -112,14 +270,21 @@ constexpr const char* CMD_GET_NODE_DATA = "get_node_data";
 //   "bpm": float,
 //   "sample_rate": int,           // must match server start-up SR (ignored if mismatch)
 //   "nodes": [NodeDesc, ...],
-//   "connections": [Connection, ...]
+//   "connections": [Connection, ...],
+//   "outputs": [OutputRoute, ...]   // optional: extra device channels
+// }
+//
+// OutputRoute = {                 // the mixer always plays on channels 0/1
+//   "node":    str,
+//   "port":    str,               // an audio output, e.g. "audio_out_L"
+//   "channel": int                // 2.. (server --outputs - 1); one port each
 // }
 //
 // NodeDesc = {
 //   "id": str,                    // unique within graph, chosen by caller
 //   "type": "fluidsynth"          // SF2-backed MIDI synth
 //           | "sine"              // built-in sine fallback
-//           | "sampler"           // sample player (pitch+vel adjusted)
+//           | "sampler"           // disk-streaming sample player (builtin.sampler)
 //           | "lv2"               // LV2 plugin
 //           | "mixer"             // N-input stereo mixer (always one, id="mixer")
 //           | "control_source"    // emits control values from event stream
@@ -129,8 +294,18 @@ constexpr const char* CMD_GET_NODE_DATA = "get_node_data";
 //   // type-specific fields:
 //   "sf2_path": str,              // fluidsynth only
 //   "lv2_uri": str,               // lv2 only
-//   "sample_path": str,           // sampler only
+//   "sample_path": str,           // sampler: PCM WAV, memory-mapped and streamed;
+//                                 //   params.root_key (default 60) plays it unpitched
 //   "channel_count": int,         // mixer: number of input channels (default 2)
+//   "audio_outputs": int,         // fluidsynth: stereo outputs, 1..16 (default 1);
+//                                 //   MIDI channel c plays on output c % N, each with
+//                                 //   its own reverb/chorus.  Output 0 is
+//                                 //   audio_out_L/R, output k audio_out_k_L/R
+//   "polyphony": int,             // sine: voice pool size (default 64, max 1024);
+//                                 //   sampler: default 32, max 256;
+//                                 //   further notes steal a voice
+//   "ramp": bool,                 // control_source: glide to each value, landing on
+//                                 //   its exact sample (default false: block steps)
 //   "params": {str: float, ...}   // initial parameter values
 // }
 //
@@ -0,0 +1,96 @@
+#pragma once
+// rt_check.h
+// Realtime-safety checker: reports what the audio thread does that it must
+// not — allocate or free memory, lock a mutex, or make a blocking call.
+//
+// Define AS_ENABLE_RT_CHECK at compile time (CMake ENABLE_RT_CHECK, Linux
+// with glibc only) to activate.  The server then interposes malloc/free and
+// friends, pthread mutex/condition/rwlock waits, and the blocking file,
+// socket and sleep calls.  Each call made on a thread inside an
+// AudioThreadScope is counted, and its stack is kept, one entry per
+// distinct call site, for get_stats.  Outside a scope the interposed calls
+// only add a thread_local read.  Without the define AudioThreadScope is
+// empty and report() returns an empty Report.
+//
+// The scopes cover the backend callback, graph workers while they run a
+// block, and each block of an offline render (not its sink), so a plugin
+// from load_plugin_library that allocates in process() shows up here.
+//
+// Usage:
+//   void callback(...) {
+//       rtcheck::AudioThreadScope rt;   // until the end of the block
+//       ...
+//   }
+//
+// Thread safety: recording is lock-free and allocation-free (site table of
+// fixed size; sites beyond it are counted as unrecorded).  report() is a
+// main-thread call and allocates to symbolize the stacks.
+//
+// Interposition is process-wide, so a build with this on must not also use
+// a sanitizer that replaces malloc (ASan, TSan).
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rtcheck {
+
+#ifdef AS_ENABLE_RT_CHECK
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+enum Kind : int { Alloc, Free, Lock, Blocking, KIND_COUNT };
+
+struct Site {
+    Kind                     kind  = Alloc;
+    std::string              call;          // interposed function, e.g. "malloc"
+    uint64_t                 count = 0;
+    std::vector<std::string> stack;         // innermost first
+};
+
+struct Report {
+    bool              enabled = rtcheck::enabled;
+    uint64_t          counts[KIND_COUNT] = {};
+    uint64_t          unrecorded = 0;       // calls whose site did not fit the table
+    std::vector<Site> sites;                // by count, highest first
+};
+
+#ifdef AS_ENABLE_RT_CHECK
+
+// Marks the calling thread as running audio for its lifetime.  Nests.
+class AudioThreadScope {
+public:
+    AudioThreadScope();
+    ~AudioThreadScope();
+    AudioThreadScope(const AudioThreadScope&) = delete;
+    AudioThreadScope& operator=(const AudioThreadScope&) = delete;
+};
+
+// Counts and sites since the last reset; reset zeroes them afterwards
+// (recorded sites keep their slot, so ones that recur remain listed).
+Report report(bool reset = false);
+
+#else
+
+class AudioThreadScope {
+public:
+    AudioThreadScope() {}
+};
+
+inline Report report(bool = false) { return {}; }
+
+#endif
+
+inline const char* kind_name(Kind kind) {
+    switch (kind) {
+        case Alloc:    return "alloc";
+        case Free:     return "free";
+        case Lock:     return "lock";
+        case Blocking: return "blocking";
+        default:       return "?";
+    }
+}
+
+} // namespace rtcheck
@@ -0,0 +1,138 @@
+#pragma once
+// sample_stream.h
+// Disk streaming for sample playback: memory-mapped sample files with a
+// resident attack head, and a background prefetch thread that feeds the
+// rest of each sounding sample through a lock-free ring.
+//
+// A SampleFile maps its WAV file read-only and decodes the first
+// HEAD_FRAMES frames into memory at load.  A voice starts from that head
+// straight away; meanwhile a SampleStream it has claimed is filled from
+// the frame after the head by the prefetch thread.  Page faults on the
+// mapping therefore only ever happen on the prefetch thread, and the pages
+// it has decoded are dropped from the mapping again, so the resident set
+// is the heads plus the rings however large the files are.
+//
+// Stream ownership passes by an atomic state, never a lock:
+//   Idle     audio thread may claim() it
+//   Active   prefetch thread writes the ring, audio thread reads it
+//   Retired  prefetch thread returns it to Idle when it next passes
+// Only the prefetch thread moves a stream back to Idle, so a claimed
+// stream can never still be in the middle of an earlier fill.
+//
+// Thread model: SampleFileCache::acquire() and SampleStreamer::add()/
+// remove() are main-thread calls that may block; SampleStream's claim(),
+// read side and retire() are audio-thread calls and never block.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SampleFile {
+public:
+    /// Frames decoded at load and kept resident: the part of a note that
+    /// must play before the prefetch thread has delivered anything.
+    static constexpr int HEAD_FRAMES = 16384;
+
+    ~SampleFile();
+
+    const std::string& path() const { return path_; }
+    float   sample_rate() const { return sample_rate_; }
+    int     channels()    const { return channels_; }
+    int64_t frames()      const { return frames_; }
+
+    /// Interleaved stereo frames [0, head_frames()); mono is duplicated.
+    const float* head() const { return head_.data(); }
+    int          head_frames() const { return static_cast<int>(head_.size() / 2); }
+
+    /// Decode n frames from start into out (interleaved stereo).  Reads the
+    /// mapping and may fault pages in: prefetch thread (or load) only.
+    void decode(int64_t start, int n, float* out) const;
+
+    /// Hint that [start, start + n) is wanted soon / no longer needed here.
+    void will_need(int64_t start, int64_t n) const;
+    void release(int64_t start, int64_t n) const;
+
+private:
+    friend class SampleFileCache;
+    std::string        path_;
+    const uint8_t*     map_      = nullptr;   // whole file
+    size_t             map_size_ = 0;
+    const uint8_t*     data_     = nullptr;   // first frame of the data chunk
+    float              sample_rate_ = 44100.0f;
+    int                channels_ = 0;
+    int                format_   = 0;         // see sample_stream.cpp
+    int                frame_bytes_ = 0;
+    int64_t            frames_   = 0;
+    std::vector<float> head_;
+
+    void advise(int64_t start, int64_t n, bool drop) const;
+};
+
+class SampleFileCache {
+public:
+    /// The mapped file for path, loading it if no node holds it already.
+    /// Accepts PCM WAV (16/24/32-bit integer or 32-bit float; mono or
+    /// stereo).  Returns nullptr and sets error_out on failure.
+    static std::shared_ptr<SampleFile> acquire(const std::string& path,
+                                               std::string& error_out);
+};
+
+/// One voice's feed: source frames [HEAD_FRAMES + read, HEAD_FRAMES + write)
+/// of its file are in the ring.
+class SampleStream {
+public:
+    static constexpr int RING_FRAMES = 16384;   // power of two
+
+    SampleStream();
+
+    /// Audio thread: take an idle stream for file, or false if it is busy.
+    bool claim(const SampleFile* file);
+
+    /// Audio thread: hand the stream back; the prefetch thread frees it.
+    void retire() { state_.store(Retired, std::memory_order_release); }
+
+    /// Audio thread, while claimed: source frame `frame` (>= the head) into
+    /// L/R, or false if the prefetch thread has not delivered it yet.
+    bool frame(int64_t frame, float& l, float& r) const {
+        const int64_t k = frame - file_head_;
+        if (k >= write_.load(std::memory_order_acquire)) return false;
+        const float* f = &ring_[static_cast<size_t>(k & (RING_FRAMES - 1)) * 2];
+        l = f[0];
+        r = f[1];
+        return true;
+    }
+
+    /// Audio thread, while claimed: frames before `frame` are consumed.
+    void consumed(int64_t frame) {
+        const int64_t k = frame - file_head_;
+        if (k > read_.load(std::memory_order_relaxed))
+            read_.store(k, std::memory_order_release);
+    }
+
+    /// Prefetch thread: top an active ring up by at most max_frames, or
+    /// return a retired stream to Idle.  Returns the frames decoded.
+    int service(int max_frames);
+
+private:
+    enum State : int { Idle, Active, Retired };
+
+    std::atomic<int>     state_ { Idle };
+    const SampleFile*    file_      = nullptr;   // written by claim() while Idle
+    int64_t              file_head_ = 0;
+    std::atomic<int64_t> read_  { 0 };           // audio thread
+    std::atomic<int64_t> write_ { 0 };           // prefetch thread
+    std::vector<float>   ring_;                  // RING_FRAMES stereo frames
+};
+
+/// The process-wide prefetch thread, started by the first add().
+class SampleStreamer {
+public:
+    /// Main thread: service streams[0, count) until remove(streams).
+    static void add(SampleStream* streams, int count);
+
+    /// Main thread: stop servicing streams; returns once the prefetch
+    /// thread is no longer touching them.
+    static void remove(SampleStream* streams);
+};
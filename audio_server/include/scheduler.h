@@ -10,6 +10,7 @@
 #include <string>
 #include <atomic>
 #include <memory>
+#include <unordered_set>
 #include "graph.h"
 
 // ---------------------------------------------------------------------------
@@ -25,36 +26,88 @@ enum class EventType : uint8_t {
     Control     = 5,   // value=normalized 0..1, delivered to control_source node
 };
 
+// Packed: the target is implied by the ScheduleTrack holding the event, so
+// a 200k-note arrangement is 16 bytes per event with no per-event strings.
 struct SchedEvent {
     double    beat;
+    float     value;       // used by Control events
     EventType type;
     uint8_t   channel;
     uint8_t   pitch;
     uint8_t   velocity;
-    float     value;       // used by Control events
-    std::string node_id;   // target node
 };
 
 // ---------------------------------------------------------------------------
 // Schedule
 // ---------------------------------------------------------------------------
+// Events are partitioned by target node.  Each partition is an immutable
+// ScheduleTrack shared between schedule versions, so patching one track
+// allocates only that track's events and leaves the rest untouched.
+
+struct ScheduleTrack {
+    std::string             node_id;
+    std::vector<SchedEvent> events;        // sorted (see Schedule::from_json)
+    double                  length = 0.0;  // last event beat
+};
 
 class Schedule {
 public:
-    // Build from JSON EventBatch. Returns nullptr on parse error.
+    // Build from JSON EventBatch in one pass, without a DOM; keys other
+    // than "events" are ignored, so a whole set_schedule request works.
+    // Returns nullptr on parse error.
     static std::unique_ptr<Schedule> from_json(
         const std::string& json,
         std::string& error_out
     );
 
-    // Sorted event list (by beat, then type priority: off < bend/prog < on).
-    const std::vector<SchedEvent>& events() const { return events_; }
+    // Build from packed event records (protocol.h "Packed events"); each
+    // record's node indexes node_ids.  Returns nullptr on a malformed record.
+    static std::unique_ptr<Schedule> from_packed(
+        const uint8_t* data, size_t bytes,
+        const std::vector<std::string>& node_ids,
+        std::string& error_out
+    );
+
+    // One node's events, for patched(): an EventBatch whose events target
+    // node_id or omit node_id, or packed records with node 0.
+    static std::shared_ptr<ScheduleTrack> track_from_json(
+        const std::string& node_id, const std::string& json, std::string& error_out);
+    static std::shared_ptr<ScheduleTrack> track_from_packed(
+        const std::string& node_id, const uint8_t* data, size_t bytes, std::string& error_out);
+
+    // Copy of base with track's node replaced by track (an empty track
+    // clears it; an unknown node is added).  Every other track is shared
+    // with base.
+    static std::unique_ptr<Schedule> patched(
+        const Schedule& base, std::shared_ptr<const ScheduleTrack> track);
+
+    // patched() with track_from_json().  Returns nullptr on parse error.
+    static std::unique_ptr<Schedule> patched(
+        const Schedule& base,
+        const std::string& node_id,
+        const std::string& json,
+        std::string& error_out
+    );
+
+    // One track per distinct target node, in first-seen order.  A patch
+    // keeps the replaced track's index, so indices are stable across
+    // patches (Dispatcher relies on this to keep its cursors).
+    const std::vector<std::shared_ptr<const ScheduleTrack>>& tracks() const { return tracks_; }
+
+    // node_ids()[i] == tracks()[i]->node_id.
+    const std::vector<std::string>& node_ids() const { return node_ids_; }
+
+    size_t event_count() const;
 
     double total_length_beats() const { return total_length_; }
 
 private:
-    std::vector<SchedEvent> events_;
+    std::vector<std::shared_ptr<const ScheduleTrack>> tracks_;
+    std::vector<std::string>                          node_ids_;
     double total_length_ = 0.0;
+
+    static std::unique_ptr<Schedule> from_tracks(std::vector<std::shared_ptr<ScheduleTrack>> tracks);
+    void update_length();
 };
 
 // ---------------------------------------------------------------------------
@@ -62,30 +115,84 @@ private:
 // ---------------------------------------------------------------------------
 // Lives on the audio thread. Holds a reference to the current schedule
 // and dispatches events to nodes in the graph.
+//
+// Schedules are shared and immutable, so several dispatchers (the live one
+// and offline render cursors) can walk the same one independently.
+//
+// Each schedule track is resolved to a Node* once per (schedule, graph)
+// pair — on a schedule swap or when dispatch() sees a graph with a new
+// serial — so the per-event cost is an array lookup.
+//
+// Every track has its own cursor.  A swap keeps the cursors of tracks the
+// new schedule shares with the old one; the others are located by binary
+// search at the next dispatch(), so a patch during playback costs
+// O(log track) on the audio thread rather than a rescan of the song.
 
 class Dispatcher {
 public:
+    Dispatcher() = default;
+    ~Dispatcher();
+    Dispatcher(const Dispatcher&) = delete;
+    Dispatcher& operator=(const Dispatcher&) = delete;
+
     // Swap in a new schedule (called from main thread; atomic pointer swap).
-    // The old schedule is returned so the caller can delete it off the audio thread.
-    Schedule* swap_schedule(Schedule* next);
+    // Takes effect at the next check_pending().
+    void swap_schedule(std::shared_ptr<const Schedule> next);
 
     // Called at the start of each block to check for a pending schedule swap.
     // Returns true if a swap occurred.
     bool check_pending();
 
-    // Dispatch all events in [start_beat, end_beat) to graph nodes.
-    void dispatch(double start_beat, double end_beat, Graph* graph);
+    // Dispatch all events in [start_beat, end_beat) to graph nodes.  The
+    // range covers the next `frames`-sample block; each event is stamped
+    // with its offset in that block via Node::set_event_frame().
+    void dispatch(double start_beat, double end_beat, int frames, Graph* graph);
 
-    // Seek: reindex to the given beat position.
+    // Seek: reindex to the given beat position, by binary search per track.
     void seek(double beat);
 
+    // Audio thread: the loop start (negative = no loop).  The cursors for
+    // it are cached, so the seek on every loop wrap is a copy per track
+    // rather than a search; a schedule swap keeps the entries of shared
+    // tracks.
+    void set_loop_start(double beat);
+
     // Total arrangement length from current schedule (0 if no schedule).
     double arrangement_length() const;
 
+    // Skip events targeting any node in nodes (offline stem renders only;
+    // set before the first dispatch()).
+    void set_excluded_nodes(std::unordered_set<std::string> nodes) { excluded_ = std::move(nodes); }
+
 private:
-    std::atomic<Schedule*>   pending_  { nullptr };
-    Schedule*                current_  { nullptr };
-    size_t                   idx_      { 0 };
+    // A swap carries its target table pre-sized on the main thread, so
+    // binding on the audio thread never allocates.  After the swap the box
+    // holds what it displaced and goes on the retired list.
+    struct Pending {
+        std::shared_ptr<const Schedule> schedule;
+        std::vector<Node*>              targets;
+        std::vector<size_t>             cursors;
+        std::vector<size_t>             loop_cursors;
+        Pending*                        next { nullptr };   // retired_ link
+    };
+
+    static constexpr size_t UNRESOLVED = size_t(-1);   // cursor not located yet
+
+    // Boxed so the hand-off to the audio thread is a single pointer exchange.
+    std::atomic<Pending*>           pending_ { nullptr };
+    // Boxes check_pending() swapped out, pushed by the audio thread and freed
+    // (with the schedule they hold) by the next swap_schedule().
+    std::atomic<Pending*>           retired_ { nullptr };
+    std::shared_ptr<const Schedule> current_;
+    std::unordered_set<std::string> excluded_;
+
+    std::vector<size_t> cursors_;              // next event, per track
+    std::vector<size_t> loop_cursors_;         // cursors_ at loop_beat_, filled lazily
+    double              loop_beat_ { -1.0 };
+    std::vector<Node*>  targets_;              // per track
+    uint32_t           bound_serial_ { 0 };    // graph targets_ points into; 0 = unbound
 
     void reindex(double beat);
+    void bind(Graph* graph);
+    static void free_retired(Pending* list);
 };
@@ -5,8 +5,11 @@
 // the pybind11 extension module (in-process path).
 
 #include "audio_engine.h"
+#include "ipc.h"
 #include "nlohmann/json.hpp"
+#include <mutex>
 #include <string>
+#include <vector>
 
 class ServerHandler {
 public:
@@ -15,12 +18,56 @@ public:
     // Handle a JSON command string; return a JSON response string.
     std::string handle(const std::string& request_json);
 
+    // Handle a framed message.  Binary requests may carry a raw payload and
+    // receive bulk results (render output, node data) as a raw payload
+    // instead of base64/JSON — see "Binary framing" in protocol.h.
+    // write, if given, lets long commands (streamed render) send progress
+    // frames before the reply; without it they answer with an error.
+    IpcMessage handle_message(const IpcMessage& request,
+                              const ReplyWriter& write = nullptr);
+
+    // IpcServer router: the lane for the request's command and whether it
+    // is tagged with an "id" (see "Request ids and concurrency" in
+    // protocol.h).  Scans the JSON header without building it.
+    static IpcRoute route(const IpcMessage& request);
+
     // Direct access for callers that need it (e.g. main.cpp shutdown logic).
     AudioEngine& engine() { return engine_; }
 
 private:
     AudioEngine engine_;
     bool        stream_open_ = false;
+    std::mutex  stream_mutex_;   // lanes may race to open the stream
+
+    std::string ensure_stream_open();
+
+    // Serialized list_registered_plugins array, rebuilt when the registry
+    // grows (see plugin_listing).
+    std::mutex  plugins_mutex_;
+    size_t      registered_count_ = 0;
+    std::string registered_json_;
+
+    // Writes the whole reply for a plugin listing command and returns true;
+    // false for any other command.
+    bool plugin_listing(const std::string& cmd, const nlohmann::json& req,
+                        const nlohmann::json& id, std::string& reply);
+
+    // Raw payloads of a binary request/reply (both null for JSON frames),
+    // and the intermediate-frame writer when the transport has one.
+    struct BinaryIo {
+        const std::vector<uint8_t>* in    = nullptr;
+        std::vector<uint8_t>*       out   = nullptr;
+        const ReplyWriter*          write = nullptr;
+        const nlohmann::json*       id    = nullptr;   // request id to echo in progress frames
+        // The request's JSON text.  req has no top-level "events" (the
+        // schedule commands read them from here without a DOM).
+        const std::string*          text  = nullptr;
+    };
+
+    nlohmann::json dispatch(const std::string& cmd, const nlohmann::json& req,
+                            BinaryIo bin);
 
-    nlohmann::json dispatch(const std::string& cmd, const nlohmann::json& req);
+    // render with "stream" or "path": chunked, bounded-memory render.
+    nlohmann::json render_chunked(const nlohmann::json& req, BinaryIo bin);
+    nlohmann::json render_stems(const nlohmann::json& req, BinaryIo bin);
 };
@@ -0,0 +1,120 @@
+#pragma once
+// shared_state.h
+// Transport, meters and control_monitor histories published by the audio
+// thread into a shared-memory region that clients map read-only, so a UI
+// can refresh its playhead and meters without an IPC round-trip.
+//
+// The region is a POSIX shared memory object ("/audio_server_<pid>", i.e.
+// /dev/shm/audio_server_<pid> on Linux) or, on Windows, a named file mapping
+// ("Local\audio_server_<pid>").  Clients get the name and size from the
+// open_shared_state command (see protocol.h).
+//
+// Layout (little-endian, fixed offsets — readers hard-code them):
+//
+//   0      Header          64 bytes
+//   64     Meter[64]       80 bytes each
+//   5184   Monitor[16]     2128 bytes each
+//   39232  end
+//
+// Consistency is a seqlock on Header::seq: the writer makes it odd, writes
+// everything, then makes it even again.  A reader copies the fields it
+// needs between two loads of seq and retries if they differ or are odd.
+// Monitor histories are published under the same seqlock; readers that only
+// want the newest samples can copy just those.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class Graph;
+
+namespace shm {
+
+constexpr uint32_t MAGIC           = 0x4D485341;   // "ASHM"
+constexpr uint32_t VERSION         = 1;
+constexpr int      MAX_METERS      = 64;
+constexpr int      MAX_MONITORS    = 16;
+constexpr int      ID_LEN          = 64;           // NUL-terminated, truncated
+constexpr int      MONITOR_HISTORY = 512;          // samples (one per block)
+
+struct Header {
+    uint32_t              magic;
+    uint32_t              version;
+    uint32_t              size;             // bytes in the whole region
+    std::atomic<uint32_t> seq;              // seqlock; odd while writing
+    uint64_t              blocks;           // audio blocks published so far
+    double                beat;
+    double                bpm;
+    float                 sample_rate;
+    uint32_t              playing;          // 0 / 1
+    uint32_t              graph_serial;     // Graph::serial() of the metered graph
+    uint32_t              meter_count;
+    uint32_t              monitor_count;
+    uint32_t              monitor_history;  // MONITOR_HISTORY
+};
+
+// One entry per mixer input pair, then "master" (see Graph::meters()).
+struct Meter {
+    char  id[ID_LEN];
+    float peak_L, peak_R;
+    float rms_L,  rms_R;
+};
+
+// Ring of the last MONITOR_HISTORY block values of a control_monitor node.
+// Oldest sample is history[(head - count) mod MONITOR_HISTORY]; head is
+// where the next one goes.
+struct Monitor {
+    char     id[ID_LEN];
+    uint32_t count;
+    uint32_t head;
+    float    latest;
+    uint32_t reserved;
+    float    history[MONITOR_HISTORY];
+};
+
+struct Layout {
+    Header  header;
+    Meter   meters[MAX_METERS];
+    Monitor monitors[MAX_MONITORS];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seq must be lock-free to share");
+static_assert(sizeof(Header) == 64, "shm::Header layout");
+static_assert(sizeof(Meter) == 80, "shm::Meter layout");
+static_assert(sizeof(Monitor) == 2128, "shm::Monitor layout");
+static_assert(offsetof(Layout, meters) == 64, "shm::Layout layout");
+static_assert(offsetof(Layout, monitors) == 5184, "shm::Layout layout");
+static_assert(sizeof(Layout) == 39232, "shm::Layout layout");
+
+} // namespace shm
+
+class SharedState {
+public:
+    // Create (or replace) the region called name and map it.  Returns
+    // nullptr and sets error_out on failure.
+    static std::unique_ptr<SharedState> create(const std::string& name, std::string& error_out);
+
+    // Unmaps and removes the region; mapped clients keep their view.
+    ~SharedState();
+
+    SharedState(const SharedState&) = delete;
+    SharedState& operator=(const SharedState&) = delete;
+
+    const std::string& name() const { return name_; }
+    size_t             size() const { return sizeof(shm::Layout); }
+
+    // Audio thread, once per block after the graph has run (graph may be
+    // null).  Never blocks or allocates.
+    void publish(const Graph* graph, double beat, bool playing, double bpm, float sample_rate);
+
+private:
+    SharedState() = default;
+
+    std::string  name_;
+    shm::Layout* layout_ = nullptr;
+#ifdef AS_PLATFORM_WINDOWS
+    void*        mapping_ = nullptr;   // HANDLE
+#endif
+};
@@ -0,0 +1,63 @@
+#pragma once
+// sine_voice_pool.h
+// Fixed-capacity sine voice pool shared by SineNode and the builtin.sine
+// plugin.
+//
+// Voices live in structure-of-arrays storage sized once by reserve() (main
+// thread, before activation), with the active voices packed at the front.
+// note_on / release / render never allocate, so dense chords on the audio
+// thread cost nothing beyond the voices themselves.  When every voice is
+// busy a new note steals the quietest releasing voice, or failing that the
+// oldest one.
+//
+// render() runs each voice through a vectorised oscillator (SSE2 where
+// available, scalar otherwise): a normalised phase accumulator and an odd
+// polynomial sine, accurate to about 4e-6.
+
+#include <cstdint>
+#include <vector>
+
+class SineVoicePool {
+public:
+    static constexpr int DEFAULT_POLYPHONY = 64;
+    static constexpr int MAX_POLYPHONY     = 1024;
+
+    // Allocate room for polyphony voices (clamped to [1, MAX_POLYPHONY]) and
+    // drop any that are sounding.  Not realtime-safe.
+    void reserve(int polyphony);
+
+    // key identifies the voice for release (channel*128 + pitch).  A key
+    // that is already sounding restarts in place.  freq is in Hz.
+    void note_on(int key, double freq, float sample_rate, float amp);
+
+    // Start the exponential release: the envelope is multiplied by
+    // (1 - rate) every sample and the voice is freed below 1e-4.
+    void release(int key, float rate);
+
+    // Drop voices at once: all of them, or those on one channel.
+    void clear();
+    void clear_channel(int channel);
+
+    // Add frames samples of every active voice, scaled by gain, to out.
+    void render(float* out, int frames, float gain);
+
+    int active()   const { return count_; }
+    int capacity() const { return static_cast<int>(key_.size()); }
+
+private:
+    // Indexed by voice slot, [0, count_) active.
+    std::vector<float>    phase_;   // [0, 1)
+    std::vector<float>    inc_;     // cycles per sample
+    std::vector<float>    amp_;
+    std::vector<float>    env_;
+    std::vector<float>    decay_;   // per-sample envelope multiplier; 1 = held
+    std::vector<int>      key_;
+    std::vector<uint32_t> age_;     // note_on order, for stealing
+
+    int      count_    = 0;
+    uint32_t next_age_ = 0;
+
+    int  find(int key) const;
+    int  steal() const;
+    void remove(int slot);
+};
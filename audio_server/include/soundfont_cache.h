@@ -0,0 +1,76 @@
+#pragma once
+// soundfont_cache.h
+// Process-wide cache of loaded SoundFonts  (compiled only with AS_ENABLE_SF2)
+//
+// FluidSynth nodes no longer sfload their own copy of sf2_path: they acquire
+// a shared SoundFont and add it to their synth with fluid_synth_add_sfont().
+// Sixteen tracks on one SF2 hold one copy of its samples, and a graph rebuild
+// reuses the fonts the outgoing graph still holds.
+//
+// Entries are keyed by path + modification time, so an edited file is loaded
+// afresh while nodes that hold the old version keep it.  A font is freed when
+// the last node releases it; fonts preloaded but never acquired stay resident.
+//
+// Thread model: acquire()/preload() are main-thread (graph build) calls and
+// may block on disk I/O (acquire) — never call them from the audio thread.
+// FluidSynth's per-sample voice counts are not thread-safe, so synths that
+// share a font must never render at once: within a graph they report it as
+// their shared_state_key() and are chained, and graphs that run alongside
+// the live one (offline renders) build under a PrivateScope.
+
+#ifdef AS_ENABLE_SF2
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class SoundFont {
+public:
+    ~SoundFont();
+
+    /// fluid_sfont_t* (opaque to avoid header dep).  Owned by the cache:
+    /// synths that add it must fluid_synth_remove_sfont() it before
+    /// delete_fluid_synth(), which would otherwise free it.
+    void* sfont() const { return sfont_; }
+    const std::string& path() const { return path_; }
+
+private:
+    friend class SoundFontCache;
+    std::string path_;
+    void*       settings_ = nullptr;  // fluid_settings_t* of loader_
+    void*       loader_   = nullptr;  // fluid_synth_t* the font was loaded into
+    void*       sfont_    = nullptr;
+};
+
+class SoundFontCache {
+public:
+    /// The loaded font for path, loading it (or waiting for a preload in
+    /// flight) if needed.  Returns nullptr and sets error_out on failure.
+    static std::shared_ptr<SoundFont> acquire(const std::string& path,
+                                              std::string& error_out);
+
+    /// Start loading path on a background thread if it is not loaded or
+    /// loading already.  Returns immediately; failures surface in acquire().
+    static void preload(const std::string& path);
+
+    /// While one is alive on a thread, acquire() there loads fonts of its
+    /// own, shared only with the scope's other acquirers, and preload()
+    /// does nothing.  Scopes nest; the innermost applies.
+    class PrivateScope {
+    public:
+        PrivateScope();
+        ~PrivateScope();
+        PrivateScope(const PrivateScope&) = delete;
+        PrivateScope& operator=(const PrivateScope&) = delete;
+
+    private:
+        friend class SoundFontCache;
+        PrivateScope* outer_;
+        std::unordered_map<std::string, std::shared_ptr<SoundFont>> fonts_;
+    };
+
+private:
+    static std::shared_ptr<SoundFont> load(const std::string& path);
+};
+
+#endif // AS_ENABLE_SF2
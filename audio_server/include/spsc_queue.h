@@ -0,0 +1,67 @@
+#pragma once
+// spsc_queue.h
+// Bounded lock-free single-producer / single-consumer ring.
+//
+// Used to hand trivially-copyable messages from a main/IPC thread to the
+// audio thread without locks or allocation on the consumer side.  If more
+// than one thread can produce, the producers must serialise push() among
+// themselves (the consumer still never blocks).
+//
+// Capacity must be a power of two.  head and tail are free-running
+// counters, so all Capacity slots are usable.
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscQueue elements must be trivially copyable");
+
+public:
+    // Producer: returns false if the ring is full.
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) return false;
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: push all n items or none.  The items are published with a
+    // single tail store, so the consumer observes the whole batch at once.
+    // Returns false if fewer than n slots are free.
+    bool push_n(const T* items, size_t n) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (Capacity - (tail - head_.load(std::memory_order_acquire)) < n) return false;
+        for (size_t i = 0; i < n; ++i)
+            slots_[(tail + i) & (Capacity - 1)] = items[i];
+        tail_.store(tail + n, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: returns false if the ring is empty.
+    bool pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        out = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push()/pop().
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    alignas(64) std::atomic<size_t> head_ { 0 };   // next slot to pop
+    alignas(64) std::atomic<size_t> tail_ { 0 };   // next slot to push
+    alignas(64) T                   slots_[Capacity];
+};
@@ -5,6 +5,9 @@
 // Factory function at the bottom: make_node() dispatches on NodeDesc.type.
 
 #include "graph.h"
+#include "sine_voice_pool.h"
+#include "soundfont_cache.h"
+#include "spsc_queue.h"
 #include <string>
 #include <memory>
 #include <mutex>
@@ -16,7 +19,8 @@
 
 class SineNode final : public Node {
 public:
-    explicit SineNode(const std::string& id_);
+    explicit SineNode(const std::string& id_,
+                      int polyphony = SineVoicePool::DEFAULT_POLYPHONY);
 
     std::vector<PortDecl> declare_ports() const override;
     void activate(float sample_rate, int max_block_size) override;
@@ -28,27 +32,41 @@ public:
     void note_off(int channel, int pitch) override;
     void all_notes_off(int channel = -1) override;
     void set_param(const std::string& name, float value) override;
+    int  param_index(const std::string& name) const override;   // 0 = "gain"
+    void set_param_index(int index, float value) override;
+    bool idle() const override { return n_timed_ == 0 && voices_.active() == 0; }
 
 private:
-    struct Voice {
-        double phase       = 0.0;
-        double freq        = 440.0;
-        float  amp         = 0.5f;
-        bool   releasing   = false;
-        float  env         = 1.0f;
-        float  env_release = 0.0f;  // per-sample decay rate
-        bool   done        = false;
-    };
-
     float  sample_rate_ = 44100.0f;
     float  gain_        = 0.15f;
+    int    polyphony_;
     // key = channel*128 + pitch
-    std::unordered_map<int, Voice> voices_;
+    SineVoicePool voices_;
+
+    // Notes stamped with a frame offset (Node::event_frame()) wait here, in
+    // frame order, and process() renders the block in segments between
+    // them.  When full, further notes apply at once (start of block).
+    struct TimedNote {
+        int    frame;
+        int    key;
+        bool   on;
+        double freq;   // on
+        float  amp;    // on
+    };
+    static constexpr int MAX_TIMED_NOTES = 256;
+    TimedNote timed_[MAX_TIMED_NOTES];
+    int       n_timed_ = 0;
+
+    bool queue_note(const TimedNote& n);
+    void apply_note(const TimedNote& n);
 };
 
 // ---------------------------------------------------------------------------
 // MixerNode — sums N stereo pairs into one stereo output
 // ---------------------------------------------------------------------------
+// Each pair is scaled by its "gain_N" times "master_gain" and accumulated
+// with dsp::gain_accumulate(); inputs marked silent are skipped outright.
+// The sum then goes through dsp::soft_clip() (fast tanh) so overs saturate.
 
 class MixerNode final : public Node {
 public:
@@ -61,6 +79,9 @@ public:
                  const std::vector<PortBuffer>& inputs,
                  std::vector<PortBuffer>& outputs) override;
     void set_param(const std::string& name, float value) override;  // "gain_N" → channel N gain
+    int  param_index(const std::string& name) const override;   // 0 = master, 1 + N = "gain_N"
+    void set_param_index(int index, float value) override;
+    bool idle() const override { return true; }   // silent in, silent out
 
 private:
     int              input_count_;
@@ -83,6 +104,11 @@ private:
 // from schedule-driven notes. stop/seek/all_notes_off on the transport does
 // NOT clear preview notes; the explicit note_off or all_notes_off IPC command
 // does.
+//
+// Preview events travel through a lock-free ring stamped with their arrival
+// time.  process() places each one a fixed block after it arrived (clamped to
+// the block start), so live playing has one block of constant latency rather
+// than a block of jitter.
 
 class TrackSourceNode final : public Node {
 public:
@@ -95,6 +121,8 @@ public:
 
     // Called by Graph::activate() to register downstream synth nodes.
     void set_downstream(std::vector<Node*> nodes);
+    // Audio thread: exchange the downstream list (Graph::commit_wiring()).
+    void swap_downstream(std::vector<Node*>& nodes) { downstream_.swap(nodes); }
 
     // Scheduled events — forwarded immediately to all downstream nodes.
     void note_on (int channel, int pitch, int velocity) override;
@@ -108,18 +136,30 @@ public:
     void all_notes_off(int channel = -1) override;
 
     // Preview injection (from IPC note_on / note_off commands).
-    // Thread-safe: uses a lock so the IPC thread can call these.
-    void preview_note_on (int channel, int pitch, int velocity);
-    void preview_note_off(int channel, int pitch);
-    void preview_all_notes_off();  // called by all_notes_off IPC with no transport flag
+    // Any thread; the audio thread never waits on a caller.  Returns false
+    // if PREVIEW_CAPACITY events are already waiting for the next block.
+    bool preview_note_on (int channel, int pitch, int velocity);
+    bool preview_note_off(int channel, int pitch);
+    bool preview_all_notes_off();  // called by all_notes_off IPC with no transport flag
+
+    static constexpr size_t PREVIEW_CAPACITY = 1024;
+
+    // Preview events queued for the next block (any thread, approximate).
+    size_t preview_pending() const { return preview_.size(); }
 
 private:
-    struct PreviewNote { int channel; int pitch; int velocity; };
+    struct PreviewEvent {
+        enum Kind : uint8_t { NoteOn, NoteOff, AllOff } kind;
+        int     channel, pitch, velocity;
+        int64_t arrival_ns;   // steady_clock
+    };
+    bool post_preview(PreviewEvent::Kind kind, int channel, int pitch, int velocity);
 
     std::vector<Node*>      downstream_;   // non-owning, valid for graph lifetime
-    std::mutex              preview_mutex_;
-    std::vector<PreviewNote> pending_on_;   // injected but not yet forwarded
-    std::vector<std::pair<int,int>> pending_off_; // (channel, pitch) — -1,-1 = all
+    // Single consumer (process()); producers serialise on preview_push_mutex_,
+    // which the audio thread never takes.
+    SpscQueue<PreviewEvent, PREVIEW_CAPACITY> preview_;
+    std::mutex                                preview_push_mutex_;
 };
 
 // ---------------------------------------------------------------------------
@@ -127,11 +167,15 @@ private:
 // ---------------------------------------------------------------------------
 // This is the "event output" concept: a node with no audio output, only a
 // control output port. The scheduler pushes timestamped values via
-// push_control(); process() outputs the interpolated value each block.
+// push_control() into a lock-free ring; process() drains it each block and
+// outputs the latest value, plus (with ramp) a glide from the previous value
+// that lands on the scheduled frame.
 
 class ControlSourceNode final : public Node {
 public:
-    explicit ControlSourceNode(const std::string& id_);
+    // ramp = glide from the previous value to each scheduled value, arriving
+    // on its exact frame; otherwise values switch at block boundaries.
+    explicit ControlSourceNode(const std::string& id_, bool ramp = false);
 
     std::vector<PortDecl> declare_ports() const override;
     void process(const ProcessContext& ctx,
@@ -150,6 +194,7 @@ private:
     std::atomic<int> write_idx_ { 0 };
     int              read_idx_  { 0 };
     float            current_   { 0.0f };
+    bool             ramp_      { false };
 };
 
 // ---------------------------------------------------------------------------
@@ -160,7 +205,11 @@ private:
 
 class FluidSynthNode final : public Node {
 public:
-    FluidSynthNode(const std::string& id_, const std::string& sf2_path);
+    // audio_outputs stereo pairs (1..MAX_OUTPUTS): MIDI channel c plays on
+    // pair c % audio_outputs, with that pair's reverb and chorus mixed in.
+    // Pair 0 is audio_out_L/R, pair k is audio_out_k_L/R.
+    FluidSynthNode(const std::string& id_, const std::string& sf2_path,
+                   int audio_outputs = 1);
     ~FluidSynthNode() override;
 
     std::vector<PortDecl> declare_ports() const override;
@@ -177,16 +226,38 @@ public:
     void channel_volume(int channel, int volume) override;
     void all_notes_off(int channel = -1) override;
 
+    // Nodes on one SoundFont share it (see SoundFontCache).
+    std::string shared_state_key() const override { return "sf2:" + sf2_path_; }
+
 private:
     std::string sf2_path_;
     void*       fs_   = nullptr;  // fluid_synth_t* (opaque to avoid header dep)
     void*       fset_ = nullptr;  // fluid_settings_t*
+    std::shared_ptr<SoundFont> sfont_;   // shared via SoundFontCache
     int         sfid_ = -1;
     float       sample_rate_ = 44100.0f;
     int         block_size_  = 0;
 
-    // Temp interleaved buffer: fluidsynth gives us int16 interleaved
-    std::vector<int16_t> raw_buf_;
+    static constexpr int MAX_OUTPUTS = 16;
+    int         n_outputs_ = 1;
+
+    // Render [pos, pos+frames) straight into the output port buffers.
+    void render(std::vector<PortBuffer>& outputs, int pos, int frames);
+
+    // Events stamped with a frame offset wait here in frame order;
+    // process() renders between them.  When full, events apply at once.
+    enum class EvKind : uint8_t { NoteOn, NoteOff, Program, Bend, Volume };
+    struct TimedEvent {
+        int    frame;
+        EvKind kind;
+        int    channel, a, b;
+    };
+    static constexpr int MAX_TIMED_EVENTS = 256;
+    TimedEvent timed_[MAX_TIMED_EVENTS];
+    int        n_timed_ = 0;
+
+    void post(EvKind kind, int channel, int a, int b = 0);
+    void apply(const TimedEvent& ev);
 };
 
 #endif // AS_ENABLE_SF2
@@ -209,6 +280,8 @@ public:
                  const std::vector<PortBuffer>& inputs,
                  std::vector<PortBuffer>& outputs) override;
     void set_param(const std::string& name, float value) override;
+    int  param_index(const std::string& name) const override;   // impl_->ports index
+    void set_param_index(int index, float value) override;
 
     // MIDI event support — forwarded from TrackSourceNode
     void note_on(int channel, int pitch, int velocity) override;
@@ -221,14 +294,19 @@ private:
 };
 
 // Shared LilvWorld singleton — acquire/release around any lilv use.
-// Thread-safe; world is constructed once and remains read-only after that.
+// Thread-safe; the world starts empty apart from the LV2 specifications.
 // Returns void* to avoid pulling <lilv/lilv.h> into every translation unit;
 // callers that need the real type cast it after including lilv.h themselves.
 void* lv2_world_acquire();
 void  lv2_world_release();
 
-// List all installed LV2 plugins via lilv.
-// Returns JSON array: [{uri, name, author, ports:[{symbol,type,direction}]}]
+// The LilvPlugin for uri in an acquired world, loading its bundle on first
+// use.  Returns nullptr if no installed bundle provides it.
+const void* lv2_world_load_plugin(void* world, const std::string& uri);
+
+// List all installed LV2 plugins, from the on-disk descriptor cache; only
+// bundles added or modified since it was written are parsed.
+// Returns JSON array: [{uri, name, category, ports:[{symbol,type,direction,...}]}]
 std::string list_lv2_plugins(const std::string& uri_prefix = "");
 
 #endif // AS_ENABLE_LV2
@@ -270,8 +348,10 @@ public:
     void note_off(int channel, int pitch) override;
     void all_notes_off(int channel = -1) override;
 
-    // set_param: "pitch_lo", "pitch_hi" (0-127), "mode" (0-3)
+    // set_param: "pitch_lo", "pitch_hi" (0-127), "mode" (0-3); indices 0-2
     void set_param(const std::string& name, float value) override;
+    int  param_index(const std::string& name) const override;
+    void set_param_index(int index, float value) override;
 
 private:
     int   pitch_lo_  = 0;
@@ -297,11 +377,14 @@ struct NodeDesc {
     std::string type;          // "fluidsynth"|"sine"|"lv2"|"mixer"|"control_source"|"track_source"|"note_gate"
     std::string sf2_path;      // fluidsynth
     std::string lv2_uri;       // lv2
-    std::string sample_path;   // sampler (future)
+    std::string sample_path;   // sampler (builtin.sampler)
     int         channel_count = 2;  // mixer
+    int         audio_outputs = 1;  // fluidsynth: stereo output pairs
+    int         polyphony     = SineVoicePool::DEFAULT_POLYPHONY;  // sine
     int         pitch_lo      = 0;   // note_gate
     int         pitch_hi      = 127; // note_gate
     int         gate_mode     = 0;   // note_gate: 0=gate 1=velocity 2=pitch 3=note_count
+    bool        ramp          = false;  // control_source: sample-accurate glides
     std::unordered_map<std::string, float> params;
 };
 
@@ -168,6 +168,16 @@ public:
         current_note_   = -1;
         last_step_beat_ = -1e9;
         rng_state_      = 12345;
+
+        events_out_ = port_handle("events_out");
+        pattern_    = port_handle("pattern");
+        rate_       = port_handle("rate");
+        gate_       = port_handle("gate");
+        octaves_    = port_handle("octaves");
+        velocity_   = port_handle("velocity");
+        scale_mode_ = port_handle("scale_mode");
+        scale_      = port_handle("scale");
+        root_       = port_handle("root");
     }
 
     void deactivate() override {
@@ -208,26 +218,18 @@ public:
     }
 
     void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
-        auto* evt_out = buffers.events.get("events_out");
+        auto* evt_out = buffers.events.get(events_out_);
         if (!evt_out || !evt_out->output_events) return;
 
-        auto* pattern_ctl    = buffers.control.get("pattern");
-        auto* rate_ctl       = buffers.control.get("rate");
-        auto* gate_ctl       = buffers.control.get("gate");
-        auto* octaves_ctl    = buffers.control.get("octaves");
-        auto* velocity_ctl   = buffers.control.get("velocity");
-        auto* scale_mode_ctl = buffers.control.get("scale_mode");
-        auto* scale_ctl      = buffers.control.get("scale");
-        auto* root_ctl       = buffers.control.get("root");
-
-        int   pattern    = pattern_ctl    ? std::clamp(int(pattern_ctl->value    + 0.5f), 0, NUM_PATTERNS - 1) : 0;
-        float step_beats = rate_ctl       ? std::clamp(rate_ctl->value, 0.0625f, 4.0f)                        : 0.25f;
-        float gate       = gate_ctl       ? std::clamp(gate_ctl->value, 0.05f, 1.0f)                          : 0.8f;
-        int   octaves    = octaves_ctl    ? std::clamp(int(octaves_ctl->value    + 0.5f), 1, 4)                : 1;
-        int   vel_ovr    = velocity_ctl   ? int(velocity_ctl->value + 0.5f)                                   : 0;
-        int   scale_mode = scale_mode_ctl ? std::clamp(int(scale_mode_ctl->value + 0.5f), 0, 2)               : 0;
-        int   scale_idx  = scale_ctl      ? std::clamp(int(scale_ctl->value      + 0.5f), 0, NUM_SCALES - 1)  : 0;
-        int   root       = root_ctl       ? std::clamp(int(root_ctl->value       + 0.5f), 0, NUM_ROOTS - 1)   : 0;
+        auto& c = buffers.control;
+        int   pattern    = std::clamp(int(c[pattern_].value    + 0.5f), 0, NUM_PATTERNS - 1);
+        float step_beats = std::clamp(c[rate_].value, 0.0625f, 4.0f);
+        float gate       = std::clamp(c[gate_].value, 0.05f, 1.0f);
+        int   octaves    = std::clamp(int(c[octaves_].value    + 0.5f), 1, 4);
+        int   vel_ovr    = int(c[velocity_].value + 0.5f);
+        int   scale_mode = std::clamp(int(c[scale_mode_].value + 0.5f), 0, 2);
+        int   scale_idx  = std::clamp(int(c[scale_].value      + 0.5f), 0, NUM_SCALES - 1);
+        int   root       = std::clamp(int(c[root_].value       + 0.5f), 0, NUM_ROOTS - 1);
 
         double gate_beats = step_beats * gate;
 
@@ -312,6 +314,10 @@ private:
     double   last_step_beat_ = -1e9;
     uint32_t rng_state_      = 12345;
 
+    // Resolved in activate()
+    PortHandle events_out_, pattern_, rate_, gate_, octaves_, velocity_,
+               scale_mode_, scale_, root_;
+
     // -----------------------------------------------------------------------
 
     static MidiEvent make_note_off(int frame, int channel, int pitch) {
@@ -78,16 +78,24 @@ public:
     void activate(float sample_rate, int /*max_block_size*/) override {
         sample_rate_ = sample_rate;
         phase_ = 0.0;
+        out_       = port_handle("control_out");
+        frequency_ = port_handle("frequency");
+        amplitude_ = port_handle("amplitude");
+        offset_    = port_handle("offset");
+        shape_     = port_handle("shape");
+        sync_      = port_handle("sync");
+        beats_     = port_handle("beats");
     }
 
     void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
-        // Read params (with fallback to defaults for unconnected ports)
-        float freq  = param(buffers, "frequency", 1.0f);
-        float amp   = param(buffers, "amplitude", 0.5f);
-        float off   = param(buffers, "offset",    0.5f);
-        int   shape = std::clamp(static_cast<int>(param(buffers, "shape", 0.0f)), 0, 3);
-        bool  sync  = param(buffers, "sync",  0.0f) >= 0.5f;
-        float beats = std::max(0.0625f, param(buffers, "beats", 4.0f));
+        // Read params (unconnected ports carry their defaults)
+        auto& c = buffers.control;
+        float freq  = c[frequency_].value;
+        float amp   = c[amplitude_].value;
+        float off   = c[offset_].value;
+        int   shape = std::clamp(static_cast<int>(c[shape_].value), 0, 3);
+        bool  sync  = c[sync_].value >= 0.5f;
+        float beats = std::max(0.0625f, c[beats_].value);
 
         double phase;
         if (sync) {
@@ -106,18 +114,15 @@ public:
         // raw is in [-1, 1]; map to [offset - amplitude, offset + amplitude]
         float value = std::clamp(off + amp * raw, 0.0f, 1.0f);
 
-        auto* out = buffers.control.get("control_out");
-        if (out) out->value = value;
+        c[out_].value = value;
     }
 
 private:
     float  sample_rate_ = 44100.0f;
     double phase_       = 0.0;  // free-running phase accumulator [0, 1)
 
-    static float param(PluginBuffers& b, const char* id, float fallback) {
-        auto* p = b.control.get(id);
-        return p ? p->value : fallback;
-    }
+    // Resolved in activate()
+    PortHandle out_, frequency_, amplitude_, offset_, shape_, sync_, beats_;
 
     // Returns a value in [-1, 1] for phase in [0, 1)
     static float evaluate(int shape, float phase) {
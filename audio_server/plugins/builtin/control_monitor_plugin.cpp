@@ -63,11 +63,11 @@ public:
         _latest.store(0.0f);
         _min.store(0.0f);
         _max.store(0.0f);
+        _in = port_handle("control_in");
     }
 
     void process(const PluginProcessContext& /*ctx*/, PluginBuffers& buffers) override {
-        auto* in = buffers.control.get("control_in");
-        float v = in ? in->value : 0.0f;
+        float v = buffers.control[_in].value;
 
         // Write into circular buffer (audio thread — no allocation/lock)
         int h = _head.load(std::memory_order_relaxed);
@@ -133,6 +133,7 @@ private:
     std::atomic<float> _latest{0.0f};
     std::atomic<float> _min{0.0f};
     std::atomic<float> _max{0.0f};
+    PortHandle         _in;
 };
 
 REGISTER_PLUGIN(ControlMonitorPlugin);
@@ -37,11 +37,17 @@ public:
         return d;
     }
 
+    void activate(float /*sample_rate*/, int /*max_block_size*/) override {
+        in_  = port_handle("control_in");
+        out_ = port_handle("control_out");
+    }
+
     void process(const PluginProcessContext& /*ctx*/, PluginBuffers& buffers) override {
-        auto* in  = buffers.control.get("control_in");
-        auto* out = buffers.control.get("control_out");
-        if (out) out->value = in ? in->value : 0.0f;
+        buffers.control[out_] = buffers.control[in_];   // keeps any ramp
     }
+
+private:
+    PortHandle in_, out_;
 };
 
 REGISTER_PLUGIN(ControlSourcePlugin);
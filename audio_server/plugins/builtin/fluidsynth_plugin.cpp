@@ -2,16 +2,22 @@
 // Port of FluidSynthNode to the Plugin API.
 // SF2 soundfont-based MIDI synthesizer.
 //
+// configure("audio_outputs", "N") before activate() gives N stereo outputs
+// (audio_out, audio_out_1, ...): MIDI channel c plays on output c % N with
+// its own reverb and chorus.
+//
 // Only compiled when AS_ENABLE_SF2 is defined (same as original).
 
 #ifdef AS_ENABLE_SF2
 
 #include "plugin_api.h"
+#include "soundfont_cache.h"
 #include <fluidsynth.h>
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 class FluidSynthPlugin final : public Plugin {
 public:
@@ -30,11 +36,20 @@ public:
             { "audio_out", "Audio Out", "Stereo audio output",
               PluginPortType::AudioStereo, PortRole::Output },
         };
+        for (int k = 1; k < n_outputs_; ++k) {
+            std::string idx = std::to_string(k);
+            d.ports.push_back({
+                "audio_out_" + idx, "Audio Out " + idx,
+                "Stereo output for MIDI channels " + idx + " mod " + std::to_string(n_outputs_),
+                PluginPortType::AudioStereo, PortRole::Output });
+        }
 
         d.config_params = {
             { "sf2_path", "Soundfont", "Path to .sf2 soundfont file",
               ConfigType::FilePath, "",
               "SF2 Files (*.sf2);;All Files (*)" },
+            { "audio_outputs", "Outputs", "Number of stereo outputs",
+              ConfigType::Integer, std::to_string(n_outputs_) },
         };
 
         return d;
@@ -43,21 +58,36 @@ public:
     void configure(const std::string& key, const std::string& value) override {
         if (key == "sf2_path") {
             sf2_path_ = value;
-            // If already activated, reload the soundfont
+            // If already activated, reload the soundfont; otherwise start
+            // loading it now so activate() finds it in the cache.
             if (fs_) {
                 reload_sf2();
+            } else {
+                SoundFontCache::preload(sf2_path_);
             }
+        } else if (key == "audio_outputs") {
+            int n = std::stoi(value);
+            if (n >= 1 && n <= MAX_OUTPUTS && !fs_) n_outputs_ = n;
         }
     }
 
     void activate(float sample_rate, int max_block_size) override {
         sample_rate_ = sample_rate;
         block_size_  = max_block_size;
+        audio_out_.clear();
+        audio_out_.push_back(port_handle("audio_out"));
+        for (int k = 1; k < n_outputs_; ++k)
+            audio_out_.push_back(port_handle("audio_out_" + std::to_string(k)));
 
         fset_ = new_fluid_settings();
         fluid_settings_setnum(fset_, "synth.sample-rate", sample_rate);
         fluid_settings_setnum(fset_, "synth.gain", 0.15);
         fluid_settings_setint(fset_, "synth.threadsafe-api", 0);
+        // One output pair and one reverb/chorus unit per group; MIDI
+        // channels are assigned to groups modulo the group count.
+        fluid_settings_setint(fset_, "synth.audio-channels", n_outputs_);
+        fluid_settings_setint(fset_, "synth.audio-groups",   n_outputs_);
+        fluid_settings_setint(fset_, "synth.effects-groups", n_outputs_);
 
         fs_ = new_fluid_synth(fset_);
 
@@ -104,20 +134,47 @@ public:
         }
     }
 
+    // Instances on one SoundFont share it (see SoundFontCache); the key
+    // matches FluidSynthNode's.
+    std::string shared_state_key() const override {
+        return sf2_path_.empty() ? std::string() : "sf2:" + sf2_path_;
+    }
+
     void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
-        auto* audio = buffers.audio.get("audio_out");
-        if (!audio || !fs_) return;
+        if (!fs_) return;
+        const int n = ctx.block_size;
 
-        fluid_synth_write_float(fs_, ctx.block_size,
-                                audio->left, 0, 1,
-                                audio->right, 0, 1);
+        if (n_outputs_ == 1) {
+            // Stereo: the float writer mixes the effects into the dry pair.
+            auto& audio = buffers.audio[audio_out_[0]];
+            fluid_synth_write_float(fs_, n, audio.left, 0, 1, audio.right, 0, 1);
+        } else {
+            // fluid_synth_process() adds into its buffers and sends effects to
+            // separate ones, laid out per group as reverb L/R then chorus L/R;
+            // point each group's effects at its own dry pair.
+            float* out[2 * MAX_OUTPUTS];
+            float* fx[4 * MAX_OUTPUTS];
+            for (int g = 0; g < n_outputs_; ++g) {
+                auto& audio = buffers.audio[audio_out_[g]];
+                out[2 * g]     = audio.left;
+                out[2 * g + 1] = audio.right;
+                std::fill(audio.left,  audio.left  + n, 0.0f);
+                std::fill(audio.right, audio.right + n, 0.0f);
+                fx[4 * g + 0] = fx[4 * g + 2] = audio.left;
+                fx[4 * g + 1] = fx[4 * g + 3] = audio.right;
+            }
+            fluid_synth_process(fs_, n, 4 * n_outputs_, fx, 2 * n_outputs_, out);
+        }
 
         // Conditional soft clip (only when approaching clipping)
-        for (int i = 0; i < ctx.block_size; ++i) {
-            if (audio->left[i]  >  0.95f || audio->left[i]  < -0.95f)
-                audio->left[i]  = std::tanh(audio->left[i]);
-            if (audio->right[i] >  0.95f || audio->right[i] < -0.95f)
-                audio->right[i] = std::tanh(audio->right[i]);
+        for (auto h : audio_out_) {
+            auto& audio = buffers.audio[h];
+            for (int i = 0; i < n; ++i) {
+                if (audio.left[i]  >  0.95f || audio.left[i]  < -0.95f)
+                    audio.left[i]  = std::tanh(audio.left[i]);
+                if (audio.right[i] >  0.95f || audio.right[i] < -0.95f)
+                    audio.right[i] = std::tanh(audio.right[i]);
+            }
         }
     }
 
@@ -125,28 +182,41 @@ private:
     std::string       sf2_path_;
     fluid_synth_t*    fs_   = nullptr;
     fluid_settings_t* fset_ = nullptr;
+    std::shared_ptr<SoundFont> sfont_;   // shared via SoundFontCache
     int               sfid_ = -1;
     float             sample_rate_ = 44100.0f;
     int               block_size_  = 0;
 
+    static constexpr int MAX_OUTPUTS = 16;
+    int                     n_outputs_ = 1;
+    std::vector<PortHandle> audio_out_;   // one stereo port per output group
+
     void reload_sf2() {
         if (!fs_ || sf2_path_.empty()) return;
-        // Unload previous if any
-        if (sfid_ >= 0) {
-            fluid_synth_sfunload(fs_, sfid_, 1);
-            sfid_ = -1;
-        }
-        sfid_ = fluid_synth_sfload(fs_, sf2_path_.c_str(), 1);
+        release_sf2();
+        std::string err;
+        sfont_ = SoundFontCache::acquire(sf2_path_, err);
+        if (!sfont_) return;  // Silently fail — no audio output until valid sf2 loaded
+        sfid_ = fluid_synth_add_sfont(fs_, static_cast<fluid_sfont_t*>(sfont_->sfont()));
         if (sfid_ == FLUID_FAILED) {
-            sfid_ = -1;
-            return;  // Silently fail — no audio output until valid sf2 loaded
+            release_sf2();
+            return;
         }
         for (int ch = 0; ch < 16; ++ch)
             if (ch != 9)
                 fluid_synth_program_select(fs_, ch, sfid_, 0, 0);
     }
 
+    // The cache owns the font: take it back before the synth would free it.
+    void release_sf2() {
+        if (fs_ && sfid_ >= 0 && sfont_)
+            fluid_synth_remove_sfont(fs_, static_cast<fluid_sfont_t*>(sfont_->sfont()));
+        sfont_.reset();
+        sfid_ = -1;
+    }
+
     void teardown() {
+        release_sf2();
         if (fs_)   { delete_fluid_synth(fs_);     fs_   = nullptr; }
         if (fset_) { delete_fluid_settings(fset_); fset_ = nullptr; }
         sfid_ = -1;
@@ -8,8 +8,8 @@
 // The descriptor is built dynamically based on channel_count_.
 
 #include "plugin_api.h"
+#include "dsp_kernels.h"
 #include <algorithm>
-#include <cmath>
 #include <cstring>
 #include <vector>
 
@@ -64,38 +64,55 @@ public:
         }
     }
 
+    void activate(float /*sample_rate*/, int /*max_block_size*/) override {
+        out_    = port_handle("audio_out");
+        master_ = port_handle("master_gain");
+        in_.clear();
+        gain_.clear();
+        for (int ch = 0; ch < channel_count_; ++ch) {
+            std::string idx = std::to_string(ch);
+            in_.push_back(port_handle("audio_in_" + idx));
+            gain_.push_back(port_handle("gain_" + idx));
+        }
+    }
+
+    // A pure sum: silent inputs make a silent output.
+    int tail_frames() const override { return 0; }
+
     void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
-        auto* out = buffers.audio.get("audio_out");
-        if (!out) return;
+        auto& out = buffers.audio[out_];
 
         // Output is pre-zeroed by the adapter
 
-        auto* master = buffers.control.get("master_gain");
-        float mg = master ? master->value : 1.0f;
+        const auto& master = buffers.control[master_];
 
         for (int ch = 0; ch < channel_count_; ++ch) {
-            std::string idx = std::to_string(ch);
-            auto* in   = buffers.audio.get("audio_in_" + idx);
-            auto* gain = buffers.control.get("gain_" + idx);
-            if (!in) continue;
-
-            float g = (gain ? gain->value : 1.0f) * mg;
-
-            for (int i = 0; i < ctx.block_size; ++i) {
-                out->left[i]  += in->left[i]  * g;
-                out->right[i] += in->right[i] * g;
+            const auto& in   = buffers.audio[in_[ch]];
+            if (in.silent) continue;
+            const auto& gain = buffers.control[gain_[ch]];
+            // Ramped head per sample, settled tail through the vector kernel.
+            int ramp = std::min(std::max(gain.ramp_frames, master.ramp_frames), ctx.block_size);
+            for (int i = 0; i < ramp; ++i) {
+                float g = gain.at(i) * master.at(i);
+                out.left[i]  += in.left[i]  * g;
+                out.right[i] += in.right[i] * g;
             }
+            float g = gain.value * master.value;
+            dsp::gain_accumulate(out.left  + ramp, in.left  + ramp, g, ctx.block_size - ramp);
+            dsp::gain_accumulate(out.right + ramp, in.right + ramp, g, ctx.block_size - ramp);
         }
 
         // Soft clip
-        for (int i = 0; i < ctx.block_size; ++i) {
-            out->left[i]  = std::tanh(out->left[i]);
-            out->right[i] = std::tanh(out->right[i]);
-        }
+        dsp::soft_clip(out.left,  ctx.block_size);
+        dsp::soft_clip(out.right, ctx.block_size);
     }
 
 private:
     int channel_count_ = 2;
+
+    // Resolved in activate()
+    PortHandle              out_, master_;
+    std::vector<PortHandle> in_, gain_;
 };
 
 REGISTER_PLUGIN(MixerPlugin);
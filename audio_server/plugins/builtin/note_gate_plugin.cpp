@@ -45,6 +45,13 @@ public:
         return d;
     }
 
+    void activate(float /*sample_rate*/, int /*max_block_size*/) override {
+        mode_in_  = port_handle("mode");
+        lo_in_    = port_handle("pitch_lo");
+        hi_in_    = port_handle("pitch_hi");
+        ctrl_out_ = port_handle("control_out");
+    }
+
     void note_on(int channel, int pitch, int velocity) override {
         if (!in_band(pitch)) return;
         active_[channel * 128 + pitch] = velocity;
@@ -71,19 +78,14 @@ public:
 
     void process(const PluginProcessContext& /*ctx*/, PluginBuffers& buffers) override {
         // Read control inputs (allows modulating mode/band from other nodes)
-        auto* mode_ctl = buffers.control.get("mode");
-        auto* lo_ctl   = buffers.control.get("pitch_lo");
-        auto* hi_ctl   = buffers.control.get("pitch_hi");
-
-        if (mode_ctl) mode_     = std::max(0, std::min(3, static_cast<int>(mode_ctl->value)));
-        if (lo_ctl)   pitch_lo_ = std::max(0, std::min(127, static_cast<int>(lo_ctl->value)));
-        if (hi_ctl)   pitch_hi_ = std::max(0, std::min(127, static_cast<int>(hi_ctl->value)));
+        mode_     = std::max(0, std::min(3,   static_cast<int>(buffers.control[mode_in_].value)));
+        pitch_lo_ = std::max(0, std::min(127, static_cast<int>(buffers.control[lo_in_].value)));
+        pitch_hi_ = std::max(0, std::min(127, static_cast<int>(buffers.control[hi_in_].value)));
 
         // Recompute in case band changed
         recompute();
 
-        auto* out = buffers.control.get("control_out");
-        if (out) out->value = current_value_;
+        buffers.control[ctrl_out_].value = current_value_;
     }
 
 private:
@@ -92,6 +94,8 @@ private:
     int   pitch_hi_ = 127;
     float current_value_ = 0.0f;
 
+    PortHandle mode_in_, lo_in_, hi_in_, ctrl_out_;   // resolved in activate()
+
     // key = channel*128 + pitch, value = velocity
     std::unordered_map<int, int> active_;
 
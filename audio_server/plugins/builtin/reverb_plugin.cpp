@@ -1,67 +1,263 @@
 // reverb_plugin.cpp
-// Schroeder-style stereo reverb: 8 comb filters (4 per channel, slightly
-// detuned L vs R for stereo width) feeding into 2 series allpass filters.
+// Stereo reverb with two tank engines behind the same controls:
 //
-// Controls: room_size (feedback), damping (lowpass in comb), dry/wet mix.
+//   freeverb (default) — Schroeder/Freeverb: 8 damped comb filters (4 per
+//            channel, slightly detuned L vs R for stereo width) feeding 2
+//            series allpass filters per channel.
+//   fdn      — 8-line feedback delay network with a Hadamard mixing matrix
+//            and the same damping, for a denser tail; the allpasses are
+//            shared with freeverb.
+//
+// Controls: room_size (feedback), damping (lowpass in the loop), dry/wet mix
+// and stereo width.  Config: "mode" selects the engine at any time.
+//
+// Processing is per block.  The four lines of each channel run in the four
+// lanes of one vector (SSE2 where available, otherwise plain arrays the
+// compiler may vectorise), four samples at a time between ring ends, so no
+// sample pays for a wrap check.  The allpasses have no recursion within a
+// block shorter than their delay, so they run over time instead.
 
 #include "plugin_api.h"
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <algorithm>
 #include <vector>
 
-// Delay line with integrated one-pole lowpass (for comb filter damping)
-struct DelayLine {
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AS_REVERB_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Four float lanes
+// ---------------------------------------------------------------------------
+
+#ifdef AS_REVERB_SSE2
+struct F4 { __m128 v; };
+inline F4   f4(float x)                        { return { _mm_set1_ps(x) }; }
+inline F4   f4(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+inline F4   load(const float* p)               { return { _mm_loadu_ps(p) }; }
+inline void store(float* p, F4 a)              { _mm_storeu_ps(p, a.v); }
+inline F4   operator+(F4 a, F4 b)              { return { _mm_add_ps(a.v, b.v) }; }
+inline F4   operator-(F4 a, F4 b)              { return { _mm_sub_ps(a.v, b.v) }; }
+inline F4   operator*(F4 a, F4 b)              { return { _mm_mul_ps(a.v, b.v) }; }
+
+// Rows become columns: r[j].v[k] <-> r[k].v[j].
+inline void transpose4(F4 (&r)[4]) { _MM_TRANSPOSE4_PS(r[0].v, r[1].v, r[2].v, r[3].v); }
+
+// Unnormalised 4-point Hadamard transform.
+inline F4 hadamard4(F4 x) {
+    const __m128 alt  = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+    const __m128 half = _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f);
+    __m128 y = _mm_add_ps(_mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(2, 2, 0, 0)),
+                          _mm_mul_ps(_mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(3, 3, 1, 1)), alt));
+    return { _mm_add_ps(_mm_shuffle_ps(y, y, _MM_SHUFFLE(1, 0, 1, 0)),
+                        _mm_mul_ps(_mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 2, 3, 2)), half)) };
+}
+#else
+struct F4 { float v[4]; };
+inline F4   f4(float x)                        { return { { x, x, x, x } }; }
+inline F4   f4(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+inline F4   load(const float* p)               { return { { p[0], p[1], p[2], p[3] } }; }
+inline void store(float* p, F4 a)              { for (int k = 0; k < 4; ++k) p[k] = a.v[k]; }
+inline F4   operator+(F4 a, F4 b)              { for (int k = 0; k < 4; ++k) a.v[k] += b.v[k]; return a; }
+inline F4   operator-(F4 a, F4 b)              { for (int k = 0; k < 4; ++k) a.v[k] -= b.v[k]; return a; }
+inline F4   operator*(F4 a, F4 b)              { for (int k = 0; k < 4; ++k) a.v[k] *= b.v[k]; return a; }
+
+inline void transpose4(F4 (&r)[4]) {
+    for (int j = 0; j < 4; ++j)
+        for (int k = j + 1; k < 4; ++k) std::swap(r[j].v[k], r[k].v[j]);
+}
+
+inline F4 hadamard4(F4 x) {
+    float y0 = x.v[0] + x.v[1], y1 = x.v[0] - x.v[1];
+    float y2 = x.v[2] + x.v[3], y3 = x.v[2] - x.v[3];
+    return { { y0 + y2, y1 + y3, y0 - y2, y1 - y3 } };
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Delay lines
+// ---------------------------------------------------------------------------
+
+// Four delay lines, one per lane, each a ring of its own length in one
+// allocation.  A loop reads and rewrites the same slot of every line, so
+// until the first line reaches the end of its ring (run()) the next samples
+// are contiguous in all four.  Each lane also carries the state of the
+// one-pole lowpass in its loop.
+struct DelayBank4 {
+    std::vector<float> storage;
+    float* line[4] = {};
+    int    len[4]  = {};
+    int    pos[4]  = {};
+    F4     damped  = f4(0.0f);
+
+    void resize(const int (&lengths)[4]) {
+        size_t total = 0;
+        for (int k = 0; k < 4; ++k) {
+            len[k] = std::max(1, lengths[k]);
+            total += len[k];
+        }
+        storage.assign(total, 0.0f);
+        float* next = storage.data();
+        for (int k = 0; k < 4; ++k) {
+            line[k] = next;
+            next   += len[k];
+        }
+        clear();
+    }
+
+    void clear() {
+        std::fill(storage.begin(), storage.end(), 0.0f);
+        for (int& p : pos) p = 0;
+        damped = f4(0.0f);
+    }
+
+    int run() const {
+        return std::min(std::min(len[0] - pos[0], len[1] - pos[1]),
+                        std::min(len[2] - pos[2], len[3] - pos[3]));
+    }
+
+    void advance(int n) {
+        for (int k = 0; k < 4; ++k)
+            if ((pos[k] += n) == len[k]) pos[k] = 0;
+    }
+
+    // Lowpass one sample's delayed lanes: s = d * (1 - damp) + s * damp.
+    F4 lowpass(F4 delayed, F4 one_minus_damp, F4 damp) {
+        damped = delayed * one_minus_damp + damped * damp;
+        return damped;
+    }
+};
+
+// Walk n samples of two banks.  For sample i, step(i, ra, rb) gets the
+// delayed lanes of each bank and replaces them with the values to write
+// back; sum_a[i] / sum_b[i] receive the sums of the delayed lanes.  Inside
+// a run the banks go four samples at a time: four loads per bank give each
+// line's next four samples, which are also how the sums are formed; a
+// transpose turns them into per-sample lane vectors for step, and another
+// turns the results back for four stores.
+template <typename Step>
+void walk(DelayBank4& a, DelayBank4& b, int n, float* sum_a, float* sum_b, Step step) {
+    int i = 0;
+    while (i < n) {
+        const int c = std::min(n - i, std::min(a.run(), b.run()));
+        float* pa[4];
+        float* pb[4];
+        for (int k = 0; k < 4; ++k) {
+            pa[k] = a.line[k] + a.pos[k];
+            pb[k] = b.line[k] + b.pos[k];
+        }
+        int j = 0;
+        for (; j + 4 <= c; j += 4) {
+            F4 ra[4], rb[4];
+            for (int k = 0; k < 4; ++k) {
+                ra[k] = load(pa[k] + j);
+                rb[k] = load(pb[k] + j);
+            }
+            store(sum_a + i + j, (ra[0] + ra[1]) + (ra[2] + ra[3]));
+            store(sum_b + i + j, (rb[0] + rb[1]) + (rb[2] + rb[3]));
+            transpose4(ra);
+            transpose4(rb);
+            for (int m = 0; m < 4; ++m) step(i + j + m, ra[m], rb[m]);
+            transpose4(ra);
+            transpose4(rb);
+            for (int k = 0; k < 4; ++k) {
+                store(pa[k] + j, ra[k]);
+                store(pb[k] + j, rb[k]);
+            }
+        }
+        for (; j < c; ++j) {
+            F4 ra = f4(pa[0][j], pa[1][j], pa[2][j], pa[3][j]);
+            F4 rb = f4(pb[0][j], pb[1][j], pb[2][j], pb[3][j]);
+            sum_a[i + j] = (pa[0][j] + pa[1][j]) + (pa[2][j] + pa[3][j]);
+            sum_b[i + j] = (pb[0][j] + pb[1][j]) + (pb[2][j] + pb[3][j]);
+            step(i + j, ra, rb);
+            alignas(16) float ta[4], tb[4];
+            store(ta, ra);
+            store(tb, rb);
+            for (int k = 0; k < 4; ++k) {
+                pa[k][j] = ta[k];
+                pb[k][j] = tb[k];
+            }
+        }
+        a.advance(c);
+        b.advance(c);
+        i += c;
+    }
+}
+
+// Schroeder allpass, gain 0.5.  It reads and writes the same slot, so over
+// any stretch that does not cross the end of the ring the samples are
+// independent and the loop runs over time.
+struct AllpassLine {
     std::vector<float> buf;
-    int write_pos = 0;
-    int length    = 0;
-    float filter_state = 0.0f;
+    int length = 1;
+    int pos    = 0;
 
     void resize(int len) {
-        length = len;
-        buf.assign(len, 0.0f);
-        write_pos = 0;
-        filter_state = 0.0f;
+        length = std::max(1, len);
+        buf.assign(length, 0.0f);
+        pos = 0;
     }
 
     void clear() {
         std::fill(buf.begin(), buf.end(), 0.0f);
-        filter_state = 0.0f;
-        write_pos = 0;
+        pos = 0;
     }
 
-    // Comb filter: read delayed, apply lowpass, feedback
-    float process_comb(float input, float feedback, float damp) {
-        float delayed = buf[write_pos];
-        // One-pole lowpass on the feedback path
-        filter_state = delayed * (1.0f - damp) + filter_state * damp;
-        buf[write_pos] = input + filter_state * feedback;
-        if (++write_pos >= length) write_pos = 0;
-        return delayed;
-    }
-
-    // Allpass filter
-    float process_allpass(float input, float feedback) {
-        float delayed = buf[write_pos];
-        float output = delayed - input;
-        buf[write_pos] = input + delayed * feedback;
-        if (++write_pos >= length) write_pos = 0;
-        return output;
+    void process(float* x, int n) {
+        while (n > 0) {
+            int    c = std::min(n, length - pos);
+            float* b = buf.data() + pos;
+            int    i = 0;
+            for (const F4 half = f4(0.5f); i + 4 <= c; i += 4) {
+                F4 delayed = load(b + i), in = load(x + i);
+                store(b + i, in + delayed * half);
+                store(x + i, delayed - in);
+            }
+            for (; i < c; ++i) {
+                float delayed = b[i];
+                b[i] = x[i] + delayed * 0.5f;
+                x[i] = delayed - x[i];
+            }
+            pos += c;
+            if (pos == length) pos = 0;
+            x += c;
+            n -= c;
+        }
     }
 };
 
 // Comb filter delay lengths in samples at 44100 Hz (Freeverb-derived primes)
-static constexpr int COMB_LENGTHS[8] = {
+constexpr int COMB_LENGTHS[8] = {
     1116, 1188, 1277, 1356,   // L channel
     1139, 1211, 1300, 1379,   // R channel (slightly detuned for stereo)
 };
 
+// FDN line lengths at 44100 Hz: mutually prime, spread over the comb range.
+// Lines 0-3 are heard on the left, 4-7 on the right.
+constexpr int FDN_LENGTHS[8] = {
+    1051, 1123, 1187, 1229,
+    1283, 1327, 1361, 1433,
+};
+
 // Allpass delay lengths
-static constexpr int ALLPASS_LENGTHS[4] = {
+constexpr int ALLPASS_LENGTHS[4] = {
     556, 441,    // L channel
     579, 464,    // R channel
 };
 
+// The tail counts as gone once it has decayed by this much (-100 dB).
+constexpr float TAIL_FLOOR = 1e-5f;
+
+enum Mode : int { Freeverb = 0, Fdn = 1 };
+
+} // namespace
+
 class ReverbPlugin final : public Plugin {
 public:
     PluginDescriptor descriptor() const override {
@@ -69,9 +265,10 @@ public:
         d.id           = "builtin.reverb";
         d.display_name = "Reverb";
         d.category     = "Effect";
-        d.doc          = "Schroeder/Freeverb-style stereo reverb.";
+        d.doc          = "Stereo reverb: Freeverb-style comb/allpass tank, or a denser "
+                         "8-line feedback delay network.";
         d.author       = "builtin";
-        d.version      = 1;
+        d.version      = 2;
 
         d.ports = {
             // Audio
@@ -97,83 +294,207 @@ public:
               ControlHint::Continuous, 1.0f, 0.0f, 1.0f },
         };
 
+        d.config_params = {
+            { "mode", "Mode", "Tank engine: freeverb (combs) or fdn (denser)",
+              ConfigType::Categorical, "freeverb", "", { "freeverb", "fdn" } },
+        };
+
         return d;
     }
 
-    void activate(float sample_rate, int /*max_block_size*/) override {
+    // Any thread; the audio thread switches engines at its next block.
+    void configure(const std::string& key, const std::string& value) override {
+        if (key == "mode") mode_.store(value == "fdn" ? Fdn : Freeverb, std::memory_order_relaxed);
+    }
+
+    void activate(float sample_rate, int max_block_size) override {
         float sr_scale = sample_rate / 44100.0f;
-        for (int i = 0; i < 4; ++i) {
-            combs_L_[i].resize(static_cast<int>(COMB_LENGTHS[i] * sr_scale));
-            combs_R_[i].resize(static_cast<int>(COMB_LENGTHS[i + 4] * sr_scale));
+        int comb_L[4], comb_R[4], fdn_A[4], fdn_B[4];
+        for (int k = 0; k < 4; ++k) {
+            comb_L[k] = static_cast<int>(COMB_LENGTHS[k]     * sr_scale);
+            comb_R[k] = static_cast<int>(COMB_LENGTHS[k + 4] * sr_scale);
+            fdn_A[k]  = static_cast<int>(FDN_LENGTHS[k]      * sr_scale);
+            fdn_B[k]  = static_cast<int>(FDN_LENGTHS[k + 4]  * sr_scale);
         }
+        combs_L_.resize(comb_L);
+        combs_R_.resize(comb_R);
+        fdn_A_.resize(fdn_A);
+        fdn_B_.resize(fdn_B);
         for (int i = 0; i < 2; ++i) {
             allpass_L_[i].resize(static_cast<int>(ALLPASS_LENGTHS[i] * sr_scale));
             allpass_R_[i].resize(static_cast<int>(ALLPASS_LENGTHS[i + 2] * sr_scale));
         }
+        longest_comb_ = *std::max_element(std::begin(comb_R), std::end(comb_R));
+        longest_comb_ = std::max(longest_comb_, *std::max_element(std::begin(comb_L), std::end(comb_L)));
+        longest_fdn_  = fdn_B[3];
+        allpass_total_ = std::max(allpass_L_[0].length + allpass_L_[1].length,
+                                  allpass_R_[0].length + allpass_R_[1].length);
+
+        mono_.assign(max_block_size, 0.0f);
+        wet_L_.assign(max_block_size, 0.0f);
+        wet_R_.assign(max_block_size, 0.0f);
+        fdn_feedback_ = -1.0f;
+        active_mode_  = mode_.load(std::memory_order_relaxed);
+
+        audio_in_  = port_handle("audio_in");
+        audio_out_ = port_handle("audio_out");
+        room_size_ = port_handle("room_size");
+        damping_   = port_handle("damping");
+        wet_       = port_handle("wet");
+        dry_       = port_handle("dry");
+        width_     = port_handle("width");
     }
 
     void deactivate() override {
-        for (auto& c : combs_L_) c.clear();
-        for (auto& c : combs_R_) c.clear();
-        for (auto& a : allpass_L_) a.clear();
-        for (auto& a : allpass_R_) a.clear();
+        clear_tanks();
+    }
+
+    // Each trip round a loop loses at least (1 - feedback), so the slowest
+    // line falls below TAIL_FLOOR after log(floor)/log(feedback) trips; the
+    // allpasses (gain 0.5 per trip) are short next to that.  FDN lines all
+    // decay at the rate of the longest one (see set_fdn_gains()).
+    int tail_frames() const override {
+        int loop = active_mode_ == Fdn ? longest_fdn_ : longest_comb_;
+        int loop_trips    = static_cast<int>(std::ceil(std::log(TAIL_FLOOR) / std::log(feedback_)));
+        int allpass_trips = static_cast<int>(std::ceil(std::log(TAIL_FLOOR) / std::log(0.5f)));
+        return loop_trips * loop + allpass_trips * allpass_total_;
     }
 
     void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
-        auto* in  = buffers.audio.get("audio_in");
-        auto* out = buffers.audio.get("audio_out");
-        if (!in || !out) return;
-
-        auto* room_ctl  = buffers.control.get("room_size");
-        auto* damp_ctl  = buffers.control.get("damping");
-        auto* wet_ctl   = buffers.control.get("wet");
-        auto* dry_ctl   = buffers.control.get("dry");
-        auto* width_ctl = buffers.control.get("width");
-
-        float room_size = room_ctl  ? room_ctl->value  : 0.7f;
-        float damping   = damp_ctl  ? damp_ctl->value  : 0.5f;
-        float wet       = wet_ctl   ? wet_ctl->value   : 0.3f;
-        float dry       = dry_ctl   ? dry_ctl->value   : 1.0f;
-        float width     = width_ctl ? width_ctl->value : 1.0f;
+        auto* in  = &buffers.audio[audio_in_];
+        auto* out = &buffers.audio[audio_out_];
+        const int n = std::min(ctx.block_size, static_cast<int>(mono_.size()));
+
+        float room_size = buffers.control[room_size_].value;
+        float damping   = buffers.control[damping_].value;
+        float wet       = buffers.control[wet_].value;
+        float dry       = buffers.control[dry_].value;
+        float width     = buffers.control[width_].value;
 
         // Scale room_size to a usable feedback range
         float feedback = room_size * 0.28f + 0.7f;  // maps [0,1] → [0.7, 0.98]
         feedback = std::min(feedback, 0.98f);
+        feedback_ = feedback;
 
         float wet1 = wet * (width * 0.5f + 0.5f);
         float wet2 = wet * ((1.0f - width) * 0.5f);
 
-        for (int i = 0; i < ctx.block_size; ++i) {
-            float in_L = in->left[i];
-            float in_R = in->right ? in->right[i] : in_L;
-            // Mix to mono for reverb input (standard Freeverb approach)
-            float input = (in_L + in_R) * 0.5f;
-
-            // Parallel comb filters
-            float sum_L = 0.0f, sum_R = 0.0f;
-            for (int c = 0; c < 4; ++c) {
-                sum_L += combs_L_[c].process_comb(input, feedback, damping);
-                sum_R += combs_R_[c].process_comb(input, feedback, damping);
-            }
+        const float* in_L = in->left;
+        const float* in_R = in->right ? in->right : in->left;
 
-            // Series allpass filters
-            for (int a = 0; a < 2; ++a) {
-                sum_L = allpass_L_[a].process_allpass(sum_L, 0.5f);
-                sum_R = allpass_R_[a].process_allpass(sum_R, 0.5f);
-            }
+        // Mix to mono for reverb input (standard Freeverb approach)
+        float* mono = mono_.data();
+        if (in->silent) {
+            std::memset(mono, 0, n * sizeof(float));
+        } else {
+            int i = 0;
+            for (const F4 half = f4(0.5f); i + 4 <= n; i += 4)
+                store(mono + i, (load(in_L + i) + load(in_R + i)) * half);
+            for (; i < n; ++i) mono[i] = (in_L[i] + in_R[i]) * 0.5f;
+        }
 
-            // Mix with stereo width control
-            out->left[i]  = in_L * dry + sum_L * wet1 + sum_R * wet2;
-            if (out->right)
-                out->right[i] = in_R * dry + sum_R * wet1 + sum_L * wet2;
+        int mode = mode_.load(std::memory_order_relaxed);
+        if (mode != active_mode_) {
+            clear_tanks();
+            active_mode_ = mode;
         }
+        if (active_mode_ == Fdn) run_fdn(n, feedback, damping);
+        else                     run_combs(n, feedback, damping);
+
+        // Series allpass filters
+        for (int a = 0; a < 2; ++a) {
+            allpass_L_[a].process(wet_L_.data(), n);
+            allpass_R_[a].process(wet_R_.data(), n);
+        }
+
+        // Mix with stereo width control
+        mix(out->left, in_L, wet_L_.data(), wet_R_.data(), n, dry, wet1, wet2);
+        if (out->right) mix(out->right, in_R, wet_R_.data(), wet_L_.data(), n, dry, wet1, wet2);
     }
 
 private:
-    DelayLine combs_L_[4];
-    DelayLine combs_R_[4];
-    DelayLine allpass_L_[2];
-    DelayLine allpass_R_[2];
+    // Parallel combs, lanes = the four combs of each channel.
+    void run_combs(int n, float feedback, float damping) {
+        const F4 fb = f4(feedback), damp = f4(damping), keep = f4(1.0f - damping);
+        const float* x = mono_.data();
+        walk(combs_L_, combs_R_, n, wet_L_.data(), wet_R_.data(), [&](int i, F4& l, F4& r) {
+            const F4 in = f4(x[i]);
+            l = in + combs_L_.lowpass(l, keep, damp) * fb;
+            r = in + combs_R_.lowpass(r, keep, damp) * fb;
+        });
+    }
+
+    // FDN: the eight damped line outputs go through an orthogonal 8x8
+    // Hadamard matrix ([H4 H4; H4 -H4] / sqrt 8) before feeding back.
+    void run_fdn(int n, float feedback, float damping) {
+        if (feedback != fdn_feedback_) set_fdn_gains(feedback);
+        const F4 damp = f4(damping), keep = f4(1.0f - damping);
+        const F4 norm = f4(0.35355339f);   // 1 / sqrt(8)
+        const float* x = mono_.data();
+        walk(fdn_A_, fdn_B_, n, wet_L_.data(), wet_R_.data(), [&](int i, F4& a, F4& b) {
+            const F4 in = f4(x[i]);
+            const F4 la = fdn_A_.lowpass(a, keep, damp);
+            const F4 lb = fdn_B_.lowpass(b, keep, damp);
+            a = in + hadamard4(la + lb) * norm * gain_A_;
+            b = in + hadamard4(la - lb) * norm * gain_B_;
+        });
+    }
+
+    // out = in * dry + own * wet1 + other * wet2
+    static void mix(float* out, const float* in, const float* own, const float* other,
+                    int n, float dry, float wet1, float wet2) {
+        const F4 vd = f4(dry), v1 = f4(wet1), v2 = f4(wet2);
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            store(out + i, load(in + i) * vd + load(own + i) * v1 + load(other + i) * v2);
+        for (; i < n; ++i) out[i] = in[i] * dry + own[i] * wet1 + other[i] * wet2;
+    }
+
+    // Line k loses feedback^(len_k / longest) per trip, i.e. every line
+    // decays at the rate of a comb of the longest length.
+    void set_fdn_gains(float feedback) {
+        float g[8];
+        for (int k = 0; k < 4; ++k) {
+            g[k]     = std::pow(feedback, float(fdn_A_.len[k]) / longest_fdn_);
+            g[k + 4] = std::pow(feedback, float(fdn_B_.len[k]) / longest_fdn_);
+        }
+        gain_A_ = f4(g[0], g[1], g[2], g[3]);
+        gain_B_ = f4(g[4], g[5], g[6], g[7]);
+        fdn_feedback_ = feedback;
+    }
+
+    void clear_tanks() {
+        combs_L_.clear();
+        combs_R_.clear();
+        fdn_A_.clear();
+        fdn_B_.clear();
+        for (auto& a : allpass_L_) a.clear();
+        for (auto& a : allpass_R_) a.clear();
+    }
+
+    DelayBank4  combs_L_, combs_R_;
+    DelayBank4  fdn_A_, fdn_B_;
+    AllpassLine allpass_L_[2];
+    AllpassLine allpass_R_[2];
+    F4          gain_A_ = f4(0.0f), gain_B_ = f4(0.0f);
+    float       fdn_feedback_ = -1.0f;
+
+    // Block scratch, sized in activate(): the mono input and the tank
+    // output per channel (allpassed in place).
+    std::vector<float> mono_, wet_L_, wet_R_;
+
+    std::atomic<int> mode_ { Freeverb };   // requested by configure()
+    int              active_mode_ = Freeverb;
+
+    // For tail_frames(): the last block's feedback, the longest loop of
+    // each engine and the longer of the two series allpass chains.
+    float feedback_      = 0.98f;
+    int   longest_comb_  = 0;
+    int   longest_fdn_   = 1;
+    int   allpass_total_ = 0;
+
+    // Resolved in activate()
+    PortHandle audio_in_, audio_out_, room_size_, damping_, wet_, dry_, width_;
 };
 
 REGISTER_PLUGIN(ReverbPlugin);
@@ -0,0 +1,264 @@
+// sampler_plugin.cpp
+// Disk-streaming sample player.
+// Plays one WAV file (sample_path) pitched from root_key and scaled by
+// velocity, with a linear release.  The file is memory-mapped through
+// SampleFileCache: each note starts from the resident attack head and
+// continues from a SampleStream the prefetch thread fills, so the audio
+// thread never touches the mapping and files far larger than RAM play from
+// a resident set of heads plus rings (see sample_stream.h).
+// Polyphony is set via configure("polyphony", "N") before activate().
+
+#include "plugin_api.h"
+#include "sample_stream.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SamplerPlugin final : public Plugin {
+public:
+    static constexpr int DEFAULT_POLYPHONY = 32;
+    static constexpr int MAX_POLYPHONY     = 256;
+
+    ~SamplerPlugin() override { deactivate(); }
+
+    PluginDescriptor descriptor() const override {
+        PluginDescriptor d;
+        d.id           = "builtin.sampler";
+        d.display_name = "Sampler";
+        d.category     = "Synth";
+        d.doc          = "Streams a WAV sample from disk, pitched from the root key "
+                         "and scaled by velocity.";
+        d.author       = "builtin";
+        d.version      = 1;
+
+        d.ports = {
+            { "audio_out", "Audio Out", "Stereo audio output",
+              PluginPortType::AudioStereo, PortRole::Output },
+            { "gain", "Gain", "Output volume",
+              PluginPortType::Control, PortRole::Input,
+              ControlHint::Continuous, 0.5f, 0.0f, 1.0f },
+            { "release", "Release", "Release time after note off (s)",
+              PluginPortType::Control, PortRole::Input,
+              ControlHint::Continuous, 0.25f, 0.005f, 5.0f },
+            { "underruns", "Underruns", "Blocks a voice waited on the disk stream",
+              PluginPortType::Control, PortRole::Monitor,
+              ControlHint::Meter, 0.0f, 0.0f, 1e9f },
+        };
+
+        d.config_params = {
+            { "sample_path", "Sample", "Path to a .wav sample file",
+              ConfigType::FilePath, "", "WAV Files (*.wav);;All Files (*)" },
+            { "root_key", "Root Key", "MIDI note that plays the sample unpitched",
+              ConfigType::Integer, std::to_string(root_key_) },
+            { "polyphony", "Polyphony", "Maximum simultaneous voices",
+              ConfigType::Integer, std::to_string(polyphony_) },
+        };
+
+        return d;
+    }
+
+    // Main thread, before activate(): the file is mapped here, so the
+    // graph build pays for reading the head, not the first note.
+    void configure(const std::string& key, const std::string& value) override {
+        if (voices_) return;
+        if (key == "sample_path") {
+            std::string err;
+            file_ = value.empty() ? nullptr : SampleFileCache::acquire(value, err);
+            // As with a missing soundfont: the node is silent until a valid
+            // file is configured.
+        } else if (key == "root_key") {
+            int k = std::atoi(value.c_str());
+            if (k >= 0 && k <= 127) root_key_ = k;
+        } else if (key == "polyphony") {
+            int n = std::atoi(value.c_str());
+            if (n >= 1) polyphony_ = std::min(n, MAX_POLYPHONY);
+        }
+    }
+
+    void activate(float sample_rate, int /*max_block_size*/) override {
+        deactivate();   // a re-activation must hand the old streams back first
+        sample_rate_ = sample_rate;
+        audio_out_   = port_handle("audio_out");
+        gain_        = port_handle("gain");
+        release_     = port_handle("release");
+        underruns_h_ = port_handle("underruns");
+        voices_  = std::make_unique<Voice[]>(polyphony_);
+        count_   = 0;
+        // Twice the voices: a stolen voice's stream stays retired until the
+        // prefetch thread next passes, and the new note needs one at once.
+        n_streams_ = 2 * polyphony_;
+        streams_   = std::make_unique<SampleStream[]>(n_streams_);
+        SampleStreamer::add(streams_.get(), n_streams_);
+    }
+
+    void deactivate() override {
+        if (!streams_) return;
+        SampleStreamer::remove(streams_.get());
+        streams_.reset();
+        voices_.reset();
+        count_ = 0;
+    }
+
+    void note_on(int channel, int pitch, int velocity) override {
+        if (!file_ || !voices_) return;
+        if (velocity == 0) { note_off(channel, pitch); return; }
+        const int key = channel * 128 + pitch;
+
+        int slot = find(key);
+        if (slot < 0) slot = count_ < polyphony_ ? count_++ : steal();
+        Voice& v = voices_[slot];
+        if (v.stream) v.stream->retire();
+
+        v.key    = key;
+        v.age    = next_age_++;
+        v.pos    = 0.0;
+        v.step   = std::pow(2.0, (pitch - root_key_) / 12.0) * file_->sample_rate() / sample_rate_;
+        v.amp    = velocity / 127.0f;
+        v.env    = 1.0f;
+        v.fade   = 0.0f;
+        v.stream = nullptr;
+        // The head alone holds short files; longer ones need a stream, and
+        // without one the note ends where the head does.
+        if (file_->frames() > file_->head_frames()) {
+            for (int i = 0; i < n_streams_; ++i)
+                if (streams_[i].claim(file_.get())) { v.stream = &streams_[i]; break; }
+        }
+    }
+
+    void note_off(int channel, int pitch) override {
+        const int key = channel * 128 + pitch;
+        for (int i = 0; i < count_; ++i)
+            if (voices_[i].key == key && voices_[i].fade == 0.0f) voices_[i].fade = -1.0f;
+    }
+
+    void all_notes_off(int channel) override {
+        for (int i = 0; i < count_; )
+            if (channel == -1 || voices_[i].key / 128 == channel) remove(i);
+            else ++i;
+    }
+
+    int tail_frames() const override { return count_ == 0 ? 0 : -1; }
+
+    float read_monitor(const std::string& port_id) override {
+        if (port_id == "underruns") return static_cast<float>(underruns_.load(std::memory_order_relaxed));
+        return 0.0f;
+    }
+
+    void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
+        float* L = buffers.audio[audio_out_].left;
+        float* R = buffers.audio[audio_out_].right;
+        // Outputs are pre-zeroed by the adapter
+        buffers.control[underruns_h_].value =
+            static_cast<float>(underruns_.load(std::memory_order_relaxed));
+        if (count_ == 0) return;
+
+        const float g    = buffers.control[gain_].value;
+        const float rel  = std::max(buffers.control[release_].value, 0.005f);
+        const float fade = 1.0f / (rel * sample_rate_);
+
+        for (int i = 0; i < count_; ) {
+            Voice& v = voices_[i];
+            if (v.fade < 0.0f) v.fade = fade;   // note_off since the last block
+            if (render(v, L, R, ctx.block_size, g, ctx.offline)) ++i;
+            else remove(i);
+        }
+    }
+
+private:
+    struct Voice {
+        int           key    = -1;
+        uint32_t      age    = 0;
+        double        pos    = 0.0;     // source frame
+        double        step   = 1.0;     // source frames per output frame
+        float         amp    = 0.0f;
+        float         env    = 1.0f;
+        float         fade   = 0.0f;    // per-sample release; 0 = held, <0 = pending
+        SampleStream* stream = nullptr;
+    };
+
+    // Source frame i of the voice's sample, from the head or its stream.
+    bool fetch(const Voice& v, int64_t i, float& l, float& r) const {
+        if (i < file_->head_frames()) {
+            const float* f = file_->head() + 2 * i;
+            l = f[0];
+            r = f[1];
+            return true;
+        }
+        return v.stream && v.stream->frame(i, l, r);
+    }
+
+    // Adds frames of v into L/R; false once the voice has finished.
+    bool render(Voice& v, float* L, float* R, int frames, float gain, bool offline) {
+        const int64_t last = file_->frames() - 1;
+        bool alive = true;
+        for (int n = 0; n < frames; ++n) {
+            const int64_t i = static_cast<int64_t>(v.pos);
+            if (i >= last) { alive = false; break; }
+            float l0, r0, l1, r1;
+            if (!fetch(v, i, l0, r0) || !fetch(v, i + 1, l1, r1)) {
+                // Past the head with no stream: the note is over.  Otherwise
+                // the disk is behind: an offline render waits for it, live
+                // playback holds the voice until the next block.
+                if (!v.stream) { alive = false; break; }
+                if (offline) {
+                    v.stream->consumed(i);
+                    std::this_thread::yield();
+                    --n;
+                    continue;
+                }
+                underruns_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            const float t = static_cast<float>(v.pos - static_cast<double>(i));
+            const float a = gain * v.amp * v.env;
+            L[n] += a * (l0 + t * (l1 - l0));
+            R[n] += a * (r0 + t * (r1 - r0));
+            v.pos += v.step;
+            if (v.fade > 0.0f && (v.env -= v.fade) <= 0.0f) { alive = false; break; }
+        }
+        if (v.stream) v.stream->consumed(static_cast<int64_t>(v.pos));
+        return alive;
+    }
+
+    int find(int key) const {
+        for (int i = 0; i < count_; ++i) if (voices_[i].key == key) return i;
+        return -1;
+    }
+
+    int steal() const {
+        int oldest = 0;
+        for (int i = 1; i < count_; ++i)
+            if (voices_[i].age - voices_[oldest].age > 0x80000000u) oldest = i;
+        return oldest;
+    }
+
+    void remove(int slot) {
+        if (voices_[slot].stream) voices_[slot].stream->retire();
+        voices_[slot] = voices_[--count_];
+        voices_[count_].stream = nullptr;
+    }
+
+    std::shared_ptr<SampleFile>     file_;
+    int                             root_key_  = 60;
+    int                             polyphony_ = DEFAULT_POLYPHONY;
+    float                           sample_rate_ = 44100.0f;
+
+    std::unique_ptr<Voice[]>        voices_;      // [0, count_) sounding
+    int                             count_    = 0;
+    uint32_t                        next_age_ = 0;
+    std::unique_ptr<SampleStream[]> streams_;
+    int                             n_streams_ = 0;
+    std::atomic<uint32_t>           underruns_ { 0 };
+
+    PortHandle audio_out_, gain_, release_, underruns_h_;
+};
+
+REGISTER_PLUGIN(SamplerPlugin);
+REGISTER_PLUGIN_DYNAMIC(SamplerPlugin);
+
+std::unique_ptr<Plugin> make_sampler_plugin() { return std::make_unique<SamplerPlugin>(); }
@@ -1,16 +1,15 @@
 // sine_plugin.cpp
 // Port of SineNode to the Plugin API.
 // Simple polyphonic sine synth with per-voice release envelope.
+// Polyphony is set via configure("polyphony", "N") before activate().
 
 #include "plugin_api.h"
+#include "dsp_kernels.h"
+#include "sine_voice_pool.h"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
-#include <unordered_map>
-#include <vector>
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+#include <string>
 
 class SinePlugin final : public Plugin {
 public:
@@ -31,88 +30,63 @@ public:
               ControlHint::Continuous, 0.15f, 0.0f, 1.0f },
         };
 
+        d.config_params = {
+            { "polyphony", "Polyphony", "Maximum simultaneous voices",
+              ConfigType::Integer, std::to_string(polyphony_) }
+        };
+
         return d;
     }
 
+    void configure(const std::string& key, const std::string& value) override {
+        if (key == "polyphony") {
+            int n = std::atoi(value.c_str());
+            if (n >= 1) polyphony_ = std::min(n, SineVoicePool::MAX_POLYPHONY);
+        }
+    }
+
     void activate(float sample_rate, int /*max_block_size*/) override {
         sample_rate_ = sample_rate;
-        voices_.clear();
+        voices_.reserve(polyphony_);
+        audio_out_ = port_handle("audio_out");
+        gain_      = port_handle("gain");
     }
 
     void note_on(int channel, int pitch, int velocity) override {
-        int key = channel * 128 + pitch;
-        Voice v;
-        v.freq = 440.0 * std::pow(2.0, (pitch - 69) / 12.0);
-        v.amp  = velocity / 127.0f;
-        voices_[key] = v;
+        double freq = 440.0 * std::pow(2.0, (pitch - 69) / 12.0);
+        voices_.note_on(channel * 128 + pitch, freq, sample_rate_, velocity / 127.0f);
     }
 
     void note_off(int channel, int pitch) override {
-        int key = channel * 128 + pitch;
-        auto it = voices_.find(key);
-        if (it != voices_.end()) {
-            it->second.releasing   = true;
-            it->second.env_release = 30.0f / sample_rate_;
-        }
+        voices_.release(channel * 128 + pitch, 30.0f / sample_rate_);
     }
 
     void all_notes_off(int channel) override {
-        if (channel == -1) {
-            voices_.clear();
-        } else {
-            for (auto it = voices_.begin(); it != voices_.end(); ) {
-                if (it->first / 128 == channel) it = voices_.erase(it);
-                else ++it;
-            }
-        }
+        if (channel == -1) voices_.clear();
+        else               voices_.clear_channel(channel);
     }
 
-    void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
-        auto* audio = buffers.audio.get("audio_out");
-        auto* gain  = buffers.control.get("gain");
-
-        float g = gain ? gain->value : 0.15f;
+    // Released voices fade out and free themselves; held ones never end.
+    int tail_frames() const override { return voices_.active() == 0 ? 0 : -1; }
 
-        float* L = audio->left;
-        float* R = audio->right;
+    void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
+        float  g = buffers.control[gain_].value;
+        float* L = buffers.audio[audio_out_].left;
+        float* R = buffers.audio[audio_out_].right;
         // Outputs are pre-zeroed by the adapter
 
-        std::vector<int> dead;
-        for (auto& [key, v] : voices_) {
-            double phase_inc = 2.0 * M_PI * v.freq / sample_rate_;
-            float amp = v.amp * g;
-            for (int i = 0; i < ctx.block_size; ++i) {
-                float env = v.releasing ? (v.env *= (1.0f - v.env_release)) : 1.0f;
-                float sample = static_cast<float>(std::sin(v.phase)) * amp * env;
-                L[i] += sample;
-                R[i] += sample;
-                v.phase += phase_inc;
-                if (v.phase > 2.0 * M_PI) v.phase -= 2.0 * M_PI;
-            }
-            if (v.releasing && v.env < 1e-4f) dead.push_back(key);
-        }
-        for (int k : dead) voices_.erase(k);
+        voices_.render(L, ctx.block_size, g);
 
-        // Soft clip
-        for (int i = 0; i < ctx.block_size; ++i) {
-            L[i] = std::tanh(L[i]);
-            R[i] = std::tanh(R[i]);
-        }
+        // Soft clip; both channels carry the same signal
+        dsp::soft_clip(L, ctx.block_size);
+        dsp::copy(R, L, ctx.block_size);
     }
 
 private:
-    struct Voice {
-        double phase       = 0.0;
-        double freq        = 440.0;
-        float  amp         = 0.5f;
-        bool   releasing   = false;
-        float  env         = 1.0f;
-        float  env_release = 0.0f;
-        bool   done        = false;
-    };
-
-    float sample_rate_ = 44100.0f;
-    std::unordered_map<int, Voice> voices_;
+    float         sample_rate_ = 44100.0f;
+    int           polyphony_   = SineVoicePool::DEFAULT_POLYPHONY;
+    SineVoicePool voices_;
+    PortHandle    audio_out_, gain_;
 };
 
 REGISTER_PLUGIN(SinePlugin);
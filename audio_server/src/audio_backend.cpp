@@ -0,0 +1,145 @@
+// audio_backend.cpp
+// PortAudio backend and the backend factory.  The JACK backend lives in
+// jack_backend.cpp (built with ENABLE_JACK).
+
+#include "audio_backend.h"
+#include <portaudio.h>
+
+#ifndef AS_PLATFORM_WINDOWS
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#ifdef AS_ENABLE_JACK
+std::unique_ptr<AudioBackend> make_jack_backend();
+#endif
+
+namespace {
+
+// The stream is opened paNonInterleaved: PortAudio hands the callback an
+// array of per-channel buffers, which the engine fills directly.  Host APIs
+// that want interleaved samples are adapted inside PortAudio.
+class PortAudioBackend final : public AudioBackend {
+public:
+    ~PortAudioBackend() override { close(); }
+
+    const char* name() const override { return "portaudio"; }
+
+    std::string open(const AudioBackendConfig& cfg, Callback cb, void* user) override {
+        if (stream_) return {};
+        cb_   = cb;
+        user_ = user;
+
+        // Pa_Initialize probes all host APIs (ALSA, JACK, OSS, ...) and spews
+        // warnings about missing/misconfigured devices to stderr. Suppress by
+        // briefly redirecting stderr to /dev/null around the call.
+#ifndef AS_PLATFORM_WINDOWS
+        int saved_stderr = dup(STDERR_FILENO);
+        int devnull = ::open("/dev/null", O_WRONLY);
+        dup2(devnull, STDERR_FILENO);
+        ::close(devnull);
+#endif
+        PaError err = Pa_Initialize();
+#ifndef AS_PLATFORM_WINDOWS
+        dup2(saved_stderr, STDERR_FILENO);
+        ::close(saved_stderr);
+#endif
+        if (err != paNoError)
+            return std::string("PortAudio init error: ") + Pa_GetErrorText(err);
+        initialized_ = true;
+
+        PaStreamParameters out_params;
+        out_params.device = cfg.output_device == -1 ? Pa_GetDefaultOutputDevice()
+                                                    : cfg.output_device;
+        if (out_params.device == paNoDevice) {
+            close();
+            return "PortAudio: no output device found";
+        }
+        const PaDeviceInfo* info = Pa_GetDeviceInfo(out_params.device);
+        if (info && info->maxOutputChannels < cfg.output_channels) {
+            int have = info->maxOutputChannels;
+            close();
+            return "PortAudio: device has " + std::to_string(have) + " output channels, " +
+                   std::to_string(cfg.output_channels) + " requested";
+        }
+
+        out_params.channelCount              = cfg.output_channels;
+        out_params.sampleFormat              = paFloat32 | paNonInterleaved;
+        out_params.suggestedLatency          = info ? info->defaultLowOutputLatency : 0.0;
+        out_params.hostApiSpecificStreamInfo = nullptr;
+
+        err = Pa_OpenStream(&stream_, nullptr, &out_params, cfg.sample_rate,
+                            cfg.block_size, paClipOff, &PortAudioBackend::callback, this);
+        if (err != paNoError) {
+            stream_ = nullptr;
+            close();
+            return std::string("PortAudio open error: ") + Pa_GetErrorText(err);
+        }
+        channels_ = cfg.output_channels;
+
+        err = Pa_StartStream(stream_);
+        if (err != paNoError) {
+            close();
+            return std::string("PortAudio start error: ") + Pa_GetErrorText(err);
+        }
+        return {};
+    }
+
+    void close() override {
+        if (stream_) {
+            Pa_StopStream(stream_);
+            Pa_CloseStream(stream_);
+            stream_ = nullptr;
+        }
+        if (initialized_) {
+            Pa_Terminate();
+            initialized_ = false;
+        }
+    }
+
+private:
+    static int callback(const void* /*input*/, void* output, unsigned long frames,
+                        const PaStreamCallbackTimeInfo* time_info,
+                        PaStreamCallbackFlags status_flags, void* user_data) {
+        auto* self = static_cast<PortAudioBackend*>(user_data);
+
+        Period p;
+        p.outputs  = static_cast<float* const*>(output);
+        p.channels = self->channels_;
+        p.frames   = static_cast<int>(frames);
+        if (status_flags & paOutputUnderflow) p.status |= OutputUnderflow;
+        if (status_flags & paOutputOverflow)  p.status |= OutputOverflow;
+        if (status_flags & paInputUnderflow)  p.status |= InputUnderflow;
+        if (status_flags & paInputOverflow)   p.status |= InputOverflow;
+        if (status_flags & paPrimingOutput)   p.status |= PrimingOutput;
+        // Some host APIs leave the timestamps at 0.
+        if (time_info && time_info->outputBufferDacTime > 0 && time_info->currentTime > 0)
+            p.output_latency_s = time_info->outputBufferDacTime - time_info->currentTime;
+
+        self->cb_(p, self->user_);
+        return paContinue;
+    }
+
+    PaStream* stream_      = nullptr;
+    bool      initialized_ = false;
+    int       channels_    = 0;
+    Callback  cb_          = nullptr;
+    void*     user_        = nullptr;
+};
+
+} // namespace
+
+std::unique_ptr<AudioBackend> make_audio_backend(const std::string& name,
+                                                 std::string& error_out) {
+    if (name.empty() || name == "portaudio") return std::make_unique<PortAudioBackend>();
+    if (name == "jack") {
+#ifdef AS_ENABLE_JACK
+        return make_jack_backend();
+#else
+        error_out = "audio backend 'jack' not built (configure with -DENABLE_JACK=ON)";
+        return nullptr;
+#endif
+    }
+    error_out = "unknown audio backend '" + name + "'";
+    return nullptr;
+}
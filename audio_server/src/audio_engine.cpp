@@ -2,17 +2,24 @@
 #include "audio_engine.h"
 #include "synth_node.h"
 #include "plugin_adapter.h"
+#include "dsp_kernels.h"
+#include "debug.h"
 #include "nlohmann/json.hpp"
 
-#include <portaudio.h>
 #include <cstring>
 #include <stdexcept>
 #include <cassert>
 #include <algorithm>
-
-#ifndef AS_PLATFORM_WINDOWS
+#include <cmath>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+#ifdef AS_PLATFORM_WINDOWS
+#include <windows.h>
+#else
 #include <unistd.h>
-#include <fcntl.h>
 #endif
 
 // WAV header writing (offline render)
@@ -36,25 +43,17 @@ static void write_u32le(std::vector<uint8_t>& buf, uint32_t v) {
     buf.push_back((v >> 24) & 0xFF);
 }
 
-static std::vector<uint8_t> make_wav(const std::vector<float>& pcm_interleaved,
-                                      int sample_rate, int channels)
+// 44-byte canonical header for 16-bit PCM.  The size fields saturate past
+// 4 GB (~6.7 h of 44.1 kHz stereo); readers fall back to the file length.
+static void append_wav_header(std::vector<uint8_t>& wav, int sample_rate,
+                              int channels, int64_t frames)
 {
-    // Convert f32 → s16
-    size_t n_samples = pcm_interleaved.size();
-    std::vector<int16_t> s16(n_samples);
-    for (size_t i = 0; i < n_samples; ++i) {
-        float v = std::max(-1.0f, std::min(1.0f, pcm_interleaved[i]));
-        s16[i] = static_cast<int16_t>(v * 32767.0f);
-    }
-
-    std::vector<uint8_t> wav;
-    uint32_t data_bytes = static_cast<uint32_t>(n_samples * 2);
-    uint32_t file_size  = 36 + data_bytes;
+    uint64_t data_bytes = static_cast<uint64_t>(frames) * channels * 2;
+    uint32_t data_u32   = static_cast<uint32_t>(std::min<uint64_t>(data_bytes, 0xFFFFFFFFull - 36));
 
-    wav.reserve(8 + file_size);
     // RIFF chunk
     wav.insert(wav.end(), {'R','I','F','F'});
-    write_u32le(wav, file_size);
+    write_u32le(wav, 36 + data_u32);
     wav.insert(wav.end(), {'W','A','V','E'});
     // fmt chunk
     wav.insert(wav.end(), {'f','m','t',' '});
@@ -67,10 +66,20 @@ static std::vector<uint8_t> make_wav(const std::vector<float>& pcm_interleaved,
     write_u16le(wav, 16);
     // data chunk
     wav.insert(wav.end(), {'d','a','t','a'});
-    write_u32le(wav, data_bytes);
-    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(s16.data());
-    wav.insert(wav.end(), ptr, ptr + data_bytes);
-    return wav;
+    write_u32le(wav, data_u32);
+}
+
+// Convert f32 → s16 little-endian and append.
+static void append_s16(std::vector<uint8_t>& buf, const float* pcm, size_t n_samples) {
+    size_t at = buf.size();
+    buf.resize(at + n_samples * 2);
+    uint8_t* out = buf.data() + at;
+    for (size_t i = 0; i < n_samples; ++i) {
+        float v = std::max(-1.0f, std::min(1.0f, pcm[i]));
+        int16_t s = static_cast<int16_t>(v * 32767.0f);
+        out[2 * i]     = static_cast<uint8_t>(s & 0xFF);
+        out[2 * i + 1] = static_cast<uint8_t>((s >> 8) & 0xFF);
+    }
 }
 
 // ---------------------------------------------------------------------------
@@ -78,75 +87,45 @@ static std::vector<uint8_t> make_wav(const std::vector<float>& pcm_interleaved,
 // ---------------------------------------------------------------------------
 
 AudioEngine::AudioEngine(const AudioEngineConfig& cfg) : cfg_(cfg) {
-    // Pa_Initialize probes all backends (ALSA, JACK, OSS, ...) and spews
-    // warnings about missing/misconfigured devices to stderr. Suppress by
-    // briefly redirecting stderr to /dev/null around the call.
-#ifndef AS_PLATFORM_WINDOWS
-    int saved_stderr = dup(STDERR_FILENO);
-    int devnull = ::open("/dev/null", O_WRONLY);
-    dup2(devnull, STDERR_FILENO);
-    ::close(devnull);
-#endif
-    Pa_Initialize();
-#ifndef AS_PLATFORM_WINDOWS
-    dup2(saved_stderr, STDERR_FILENO);
-    ::close(saved_stderr);
-#endif
+    cfg_.output_channels = std::clamp(cfg_.output_channels, 2, Graph::MAX_OUTPUT_CHANNELS);
+    if (cfg_.worker_threads > 0)
+        executor_ = std::make_unique<GraphExecutor>(cfg_.worker_threads);
+    if (cfg_.render_worker_threads > 0)
+        render_executor_ = std::make_unique<GraphExecutor>(cfg_.render_worker_threads);
 }
 
 AudioEngine::~AudioEngine() {
     close();
-    Pa_Terminate();
 }
 
 std::string AudioEngine::open() {
-    if (stream_) return {};  // already open
-
-    PaStreamParameters out_params;
-    out_params.device = cfg_.output_device == -1
-        ? Pa_GetDefaultOutputDevice()
-        : cfg_.output_device;
-    if (out_params.device == paNoDevice)
-        return "PortAudio: no output device found";
-
-    out_params.channelCount              = 2;
-    out_params.sampleFormat              = paFloat32;
-    out_params.suggestedLatency          =
-        Pa_GetDeviceInfo(out_params.device)->defaultLowOutputLatency;
-    out_params.hostApiSpecificStreamInfo = nullptr;
-
-    PaError err = Pa_OpenStream(
-        reinterpret_cast<PaStream**>(&stream_),
-        nullptr,
-        &out_params,
-        cfg_.sample_rate,
-        cfg_.block_size,
-        paClipOff,
-        &AudioEngine::pa_callback,
-        this
-    );
-    if (err != paNoError) {
-        stream_ = nullptr;
-        return std::string("PortAudio open error: ") + Pa_GetErrorText(err);
-    }
-
-    // Allocate scratch buffers on the heap so the audio callback doesn't
-    // blow the 8 KB ALSA stack with 2×MAX_BLOCK_SIZE floats.
-    // Use MAX_BLOCK_SIZE, not cfg_.block_size — PortAudio may deliver more
-    // frames than the requested block size (it's a hint, not a guarantee).
-    scratch_L_.resize(MAX_BLOCK_SIZE);
-    scratch_R_.resize(MAX_BLOCK_SIZE);
-
-    Pa_StartStream(static_cast<PaStream*>(stream_));
+    if (backend_) return {};  // already open
+
+    std::string err;
+    auto backend = make_audio_backend(cfg_.backend, err);
+    if (!backend) return err;
+
+    AudioBackendConfig bc;
+    bc.sample_rate     = cfg_.sample_rate;
+    bc.block_size      = cfg_.block_size;
+    bc.output_device   = cfg_.output_device;
+    bc.output_channels = cfg_.output_channels;
+
+    // Resolves the kernel backend here rather than inside the first callback.
+    AS_LOG("engine", "DSP kernels: %s", dsp::backend());
+
+    err = backend->open(bc, &AudioEngine::audio_callback, this);
+    if (!err.empty()) return err;
+    AS_LOG("engine", "audio backend: %s, %d channels", backend->name(), cfg_.output_channels);
+    backend_ = std::move(backend);
     return {};
 }
 
 void AudioEngine::close() {
     stop();
-    if (stream_) {
-        Pa_StopStream(static_cast<PaStream*>(stream_));
-        Pa_CloseStream(static_cast<PaStream*>(stream_));
-        stream_ = nullptr;
+    if (backend_) {
+        backend_->close();
+        backend_.reset();
     }
     // Stop the audio thread from seeing either graph before we free them
     active_graph_.store(nullptr, std::memory_order_release);
@@ -161,75 +140,177 @@ void AudioEngine::close() {
 }
 
 std::string AudioEngine::set_graph(const std::string& graph_json) {
-    std::string err;
-    auto g = Graph::from_json(graph_json, err);
-    if (!g) return err;
-
-    if (!g->activate(cfg_.sample_rate, cfg_.block_size))
-        return "Graph activation failed";
+    std::unique_ptr<Graph> g;
+    {
+        std::lock_guard<std::mutex> lk(render_build_mutex_);
+        std::string err;
+        g = Graph::from_json(graph_json, err);
+        if (!g) return err;
+
+        g->set_executor(executor_.get());
+        g->set_metering(true);    // patched() successors inherit it
+        if (!g->activate(cfg_.sample_rate, cfg_.block_size))
+            return "Graph activation failed";
+    }
 
-    // Extract BPM from graph JSON if present
-    try {
-        auto j = nlohmann::json::parse(graph_json);
-        if (j.contains("bpm")) bpm_ = j["bpm"].get<float>();
-    } catch (...) {}
+    if (g->bpm() > 0.0f) bpm_ = g->bpm();
 
     {
+        // owned_graph_ and graph_desc_ change with both locks held, so
+        // patch_graph() can build from them under render_build_mutex_ alone.
+        std::lock_guard<std::mutex> build(render_build_mutex_);   // before graph_mutex_
         std::lock_guard<std::mutex> lk(graph_mutex_);
+        graph_desc_ = graph_json;
+        param_values_.clear();
+        publish_graph(std::move(g));
+    }
+    return {};
+}
 
-        // --- Safe retirement ---
-        // Record the epoch before we publish the new graph pointer.
-        // Once the audio thread observes the new pointer it will increment
-        // graph_epoch_ at the end of that block, so waiting for epoch+1
-        // guarantees it is no longer executing any code from owned_graph_.
-        uint64_t epoch_before = graph_epoch_.load(std::memory_order_acquire);
-
-        retiring_graph_ = std::move(owned_graph_);
-        owned_graph_    = std::move(g);
-        active_graph_.store(owned_graph_.get(), std::memory_order_release);
-
-        // Wait for the audio thread to complete at least one block with the
-        // new graph.  The stream may not be open yet (first set_graph call),
-        // in which case no callback will ever fire and we just free immediately.
-        if (stream_) {
-            // Spin with a short yield — typically resolves in < 1 callback
-            // period (~10 ms).  No busy-wait: sched_yield lets the audio
-            // thread run.  Timeout after 500 ms to avoid deadlock if the
-            // stream has stalled.
-            constexpr int MAX_ITER = 5000;
-            for (int i = 0; i < MAX_ITER; ++i) {
-                if (graph_epoch_.load(std::memory_order_acquire) > epoch_before)
-                    break;
+// Apply a patch_graph request to a graph description, mirroring
+// Graph::patched() so offline renders rebuild the patched graph.
+static std::string patch_graph_desc(const std::string& desc, const nlohmann::json& patch) {
+    using nlohmann::json;
+    json j = json::parse(desc);
+    json& nodes = j["nodes"];
+    json& conns = j["connections"];
+    if (!nodes.is_array()) nodes = json::array();
+    if (!conns.is_array()) conns = json::array();
+
+    auto same = [](const json& a, const json& b) {
+        for (const char* k : { "from_node", "from_port", "to_node", "to_port" })
+            if (a.value(k, "") != b.value(k, "")) return false;
+        return true;
+    };
+    for (auto& rc : patch.value("remove_connections", json::array())) {
+        for (auto it = conns.begin(); it != conns.end(); ++it)
+            if (same(*it, rc)) { conns.erase(it); break; }
+    }
+    for (auto& rid : patch.value("remove_nodes", json::array())) {
+        std::string id = rid.get<std::string>();
+        for (auto it = nodes.begin(); it != nodes.end(); )
+            it = (it->value("id", "") == id) ? nodes.erase(it) : it + 1;
+        for (auto it = conns.begin(); it != conns.end(); )
+            it = (it->value("from_node", "") == id || it->value("to_node", "") == id)
+                 ? conns.erase(it) : it + 1;
+    }
+    for (auto& n : patch.value("add_nodes", json::array()))       nodes.push_back(n);
+    for (auto& c : patch.value("add_connections", json::array())) conns.push_back(c);
+    return j.dump();
+}
+
+std::string AudioEngine::patch_graph(const std::string& patch_json) {
+    // Building the new nodes (SF2 loads, LV2 instantiation) can take a
+    // while, so it happens under render_build_mutex_ only: that keeps
+    // owned_graph_ and graph_desc_ fixed (see set_graph) without holding up
+    // the preview, parameter and node-data commands that take graph_mutex_.
+    std::lock_guard<std::mutex> build(render_build_mutex_);   // before graph_mutex_
+    if (!owned_graph_) return "no active graph";
+
+    // Edit the description first: a patch it cannot apply is refused before
+    // anything is built, and the live graph and graph_desc_ stay as they are.
+    std::string desc;
+    try {
+        desc = patch_graph_desc(graph_desc_, nlohmann::json::parse(patch_json));
+    } catch (const std::exception& e) {
+        return std::string("patch_graph: invalid patch: ") + e.what();
+    }
+
+    std::string err;
+    auto g = owned_graph_->patched(patch_json, err);
+    if (!g) return err;
+    g->set_executor(executor_.get());
+
+    std::lock_guard<std::mutex> lk(graph_mutex_);
+    graph_desc_ = std::move(desc);
+
+    // Carry recorded values over to the new handles of surviving nodes.
+    std::unordered_map<int, float> remapped;
+    for (auto& [handle, value] : param_values_) {
+        std::string node_id, param;
+        if (!owned_graph_->param_target(handle, node_id, param)) continue;
+        int h = g->param_handle(node_id, param);
+        if (h >= 0) remapped[h] = value;
+    }
+    param_values_ = std::move(remapped);
+
+    publish_graph(std::move(g));
+    return {};
+}
+
+void AudioEngine::publish_graph(std::unique_ptr<Graph> g) {
+    // --- Safe retirement ---
+    // Record the epoch before we publish the new graph pointer.
+    // Once the audio thread observes the new pointer it will increment
+    // graph_epoch_ at the end of that block, so waiting for epoch+1
+    // guarantees it is no longer executing any code from owned_graph_.
+    uint64_t epoch_before = graph_epoch_.load(std::memory_order_acquire);
+
+    retiring_graph_ = std::move(owned_graph_);
+    owned_graph_    = std::move(g);
+    active_graph_.store(owned_graph_.get(), std::memory_order_release);
+
+    // Wait for the audio thread to complete at least one block with the
+    // new graph.  The stream may not be open yet (first set_graph call),
+    // in which case no callback will ever fire and we just free immediately.
+    if (backend_) {
+        // Spin with a short yield — typically resolves in < 1 callback
+        // period (~10 ms).  No busy-wait: sched_yield lets the audio
+        // thread run.  Timeout after 500 ms to avoid deadlock if the
+        // stream has stalled.
+        constexpr int MAX_ITER = 5000;
+        for (int i = 0; i < MAX_ITER; ++i) {
+            if (graph_epoch_.load(std::memory_order_acquire) > epoch_before)
+                break;
 #ifndef AS_PLATFORM_WINDOWS
-                usleep(100);   // 0.1 ms
+            usleep(100);   // 0.1 ms
 #else
-                Sleep(1);
+            Sleep(1);
 #endif
-            }
         }
-
-        // Now safe to destroy the old graph: the audio thread has moved on.
-        retiring_graph_.reset();
     }
-    return {};
+
+    // Now safe to destroy the old graph: the audio thread has moved on.
+    // Nodes it shares with owned_graph_ stay active.
+    retiring_graph_.reset();
 }
 
 std::string AudioEngine::set_schedule(const std::string& schedule_json) {
     std::string err;
     auto sched = Schedule::from_json(schedule_json, err);
     if (!sched) return err;
+    return set_schedule(std::move(sched));
+}
 
-    // Apply immediately on the calling thread so render_offline() and
-    // arrangement_length() work without needing the audio callback to run.
-    // If the stream is active the audio thread will pick up check_pending()
-    // on the next block — the double-apply is harmless.
-    dispatcher_.swap_schedule(sched.release());
-    dispatcher_.check_pending();
+std::string AudioEngine::set_schedule(std::unique_ptr<Schedule> sched) {
+    std::lock_guard<std::mutex> lk(schedule_mutex_);   // one producer at a time
+    install_schedule(std::move(sched));
+    return {};
+}
+
+std::string AudioEngine::patch_schedule(const std::string& node_id,
+                                        const std::string& events_json) {
+    std::string err;
+    auto track = Schedule::track_from_json(node_id, events_json, err);
+    if (!track) return err;
+    return patch_schedule(std::move(track));
+}
+
+std::string AudioEngine::patch_schedule(std::shared_ptr<const ScheduleTrack> track) {
+    std::lock_guard<std::mutex> lk(schedule_mutex_);
+    static const Schedule empty;
+    install_schedule(Schedule::patched(schedule_ ? *schedule_ : empty, std::move(track)));
     return {};
 }
 
+void AudioEngine::install_schedule(std::shared_ptr<const Schedule> sched) {
+    // render snapshots read schedule_; the audio thread picks up the swap
+    // at its next check_pending().
+    schedule_ = sched;
+    dispatcher_.swap_schedule(std::move(sched));
+}
+
 void AudioEngine::play() {
-    dispatcher_.check_pending();  // make sure latest schedule is active
     playing_.store(true, std::memory_order_relaxed);
     send_cmd(Cmd::Play);
 }
@@ -248,15 +329,17 @@ void AudioEngine::seek(double beat) {
 }
 
 void AudioEngine::set_loop(double start, double end) {
-    auto* ls = new LoopState{start, end, true};
-    auto* old = pending_loop_.exchange(ls, std::memory_order_acq_rel);
-    delete old;
+    publish_loop(new LoopState{start, end, true});
 }
 
 void AudioEngine::disable_loop() {
-    auto* ls = new LoopState{0, 0, false};
-    auto* old = pending_loop_.exchange(ls, std::memory_order_acq_rel);
-    delete old;
+    publish_loop(new LoopState{0, 0, false});
+}
+
+void AudioEngine::publish_loop(LoopState* ls) {
+    for (auto* r = retired_loops_.exchange(nullptr, std::memory_order_acquire); r; )
+        delete std::exchange(r, r->next);
+    delete pending_loop_.exchange(ls, std::memory_order_acq_rel);   // never picked up
 }
 
 void AudioEngine::set_param(const std::string& nid, const std::string& param, float val) {
@@ -267,19 +350,102 @@ void AudioEngine::set_param(const std::string& nid, const std::string& param, fl
 }
 
 void AudioEngine::send_cmd(Cmd c, double arg) {
-    std::lock_guard<std::mutex> lk(cmd_mutex_);
-    cmd_queue_.push_back({c, arg});
+    CmdEntry e;
+    e.cmd = c;
+    e.arg = arg;
+    push_cmds(&e, 1);
 }
 
 void AudioEngine::send_param_cmd(const std::string& node_id,
                                   const std::string& param, float value) {
-    std::lock_guard<std::mutex> lk(cmd_mutex_);
     CmdEntry e;
-    e.cmd     = Cmd::SetParam;
-    e.node_id = node_id;
-    e.param   = param;
-    e.value   = value;
-    cmd_queue_.push_back(std::move(e));
+    e.cmd   = Cmd::SetParam;
+    e.value = value;
+    {
+        // Resolve against the graph the audio thread is (or is about to be)
+        // running; set_graph() holds this lock while it swaps graphs.
+        std::lock_guard<std::mutex> lk(graph_mutex_);
+        Graph* g = owned_graph_.get();
+        if (!g) return;
+        e.handle = g->param_handle(node_id, param);
+        e.graph  = g->serial();
+        record_param(e.handle, value);
+    }
+    if (e.handle < 0) return;
+    push_cmds(&e, 1);
+}
+
+uint32_t AudioEngine::resolve_params(
+    const std::vector<std::pair<std::string, std::string>>& ids,
+    std::vector<int>& handles_out)
+{
+    handles_out.clear();
+    std::lock_guard<std::mutex> lk(graph_mutex_);
+    Graph* g = owned_graph_.get();
+    if (!g) {
+        handles_out.assign(ids.size(), -1);
+        return 0;
+    }
+    handles_out.reserve(ids.size());
+    for (auto& [node_id, param] : ids)
+        handles_out.push_back(g->param_handle(node_id, param));
+    return g->serial();
+}
+
+std::string AudioEngine::set_params(uint32_t graph_serial,
+                                    const std::vector<std::pair<int, float>>& values)
+{
+    {
+        std::lock_guard<std::mutex> lk(graph_mutex_);
+        Graph* g = owned_graph_.get();
+        if (!g) return "no active graph";
+        if (graph_serial == 0) graph_serial = g->serial();
+        else if (graph_serial != g->serial())
+            return "stale parameter handles (graph was replaced; call resolve_params again)";
+        for (auto& [handle, value] : values) record_param(handle, value);
+    }
+
+    std::vector<CmdEntry> batch;
+    batch.reserve(values.size());
+    for (auto& [handle, value] : values) {
+        if (handle < 0) continue;
+        CmdEntry e;
+        e.cmd    = Cmd::SetParam;
+        e.graph  = graph_serial;
+        e.handle = handle;
+        e.value  = value;
+        batch.push_back(e);
+    }
+    push_cmds(batch.data(), batch.size());
+    return {};
+}
+
+void AudioEngine::record_param(int handle, float value) {
+    if (handle >= 0) param_values_[handle] = value;
+}
+
+void AudioEngine::push_cmds(const CmdEntry* entries, size_t count) {
+    std::lock_guard<std::mutex> lk(cmd_push_mutex_);
+    // The ring is drained once per block.  If a burst fills it, wait here on
+    // the producer side for the callback to catch up rather than stalling
+    // the callback; give up after ~100 ms or immediately with no stream.
+    constexpr int MAX_ITER = 1000;
+    while (count > 0) {
+        size_t chunk = std::min(count, cmd_queue_.capacity());
+        for (int i = 0; !cmd_queue_.push_n(entries, chunk); ++i) {
+            if (!backend_ || i >= MAX_ITER) {
+                AS_LOG("engine", "command queue full, dropping %zu cmd(s)", count);
+                return;
+            }
+#ifndef AS_PLATFORM_WINDOWS
+            usleep(100);   // 0.1 ms
+#else
+            Sleep(1);
+#endif
+        }
+        entries += chunk;
+        count   -= chunk;
+    }
 }
 
 // ---------------------------------------------------------------------------
@@ -299,33 +465,44 @@ static TrackSourceNode* find_track_source(Graph* g, const std::string& node_id)
     return nullptr;
 }
 
-void AudioEngine::preview_note_on(const std::string& node_id, int channel,
-                                   int pitch, int velocity)
+static const char* PREVIEW_QUEUE_FULL = "preview queue full";
+
+// The IPC lanes call these concurrently with set_graph(), which frees the
+// graph it replaces, so they look up nodes in owned_graph_ under
+// graph_mutex_ like every other main-thread accessor.
+
+std::string AudioEngine::preview_note_on(const std::string& node_id, int channel,
+                                          int pitch, int velocity)
 {
-    Graph* g = active_graph_.load(std::memory_order_acquire);
-    auto* src = find_track_source(g, node_id);
-    if (src) src->preview_note_on(channel, pitch, velocity);
+    std::lock_guard<std::mutex> lk(graph_mutex_);
+    auto* src = find_track_source(owned_graph_.get(), node_id);
+    if (src && !src->preview_note_on(channel, pitch, velocity)) return PREVIEW_QUEUE_FULL;
+    return {};
 }
 
-void AudioEngine::preview_note_off(const std::string& node_id, int channel, int pitch) {
-    Graph* g = active_graph_.load(std::memory_order_acquire);
-    auto* src = find_track_source(g, node_id);
-    if (src) src->preview_note_off(channel, pitch);
+std::string AudioEngine::preview_note_off(const std::string& node_id, int channel, int pitch) {
+    std::lock_guard<std::mutex> lk(graph_mutex_);
+    auto* src = find_track_source(owned_graph_.get(), node_id);
+    if (src && !src->preview_note_off(channel, pitch)) return PREVIEW_QUEUE_FULL;
+    return {};
 }
 
-void AudioEngine::preview_all_notes_off(const std::string& node_id) {
-    Graph* g = active_graph_.load(std::memory_order_acquire);
+std::string AudioEngine::preview_all_notes_off(const std::string& node_id) {
+    std::lock_guard<std::mutex> lk(graph_mutex_);
+    Graph* g = owned_graph_.get();
     if (!node_id.empty()) {
         auto* src = dynamic_cast<TrackSourceNode*>(g ? g->find_node(node_id) : nullptr);
-        if (src) src->preview_all_notes_off();
-        return;
+        if (src && !src->preview_all_notes_off()) return PREVIEW_QUEUE_FULL;
+        return {};
     }
     // Silence all track_source nodes
-    if (!g) return;
+    if (!g) return {};
+    bool full = false;
     for (auto& nid : g->eval_order()) {
         auto* src = dynamic_cast<TrackSourceNode*>(g->find_node(nid));
-        if (src) src->preview_all_notes_off();
+        if (src && !src->preview_all_notes_off()) full = true;
     }
+    return full ? PREVIEW_QUEUE_FULL : std::string();
 }
 
 // ---------------------------------------------------------------------------
@@ -335,7 +512,8 @@ void AudioEngine::preview_all_notes_off(const std::string& node_id) {
 std::string AudioEngine::set_node_config(const std::string& node_id,
                                           const std::string& config_json)
 {
-    Graph* g = active_graph_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lk(graph_mutex_);
+    Graph* g = owned_graph_.get();
     if (!g) return "no active graph";
 
     Node* node = g->find_node(node_id);
@@ -362,8 +540,11 @@ std::string AudioEngine::set_node_config(const std::string& node_id,
 
     // MixerNode: master_gain, channel_count
     if (auto* mx = dynamic_cast<MixerNode*>(node)) {
-        if (cfg.contains("master_gain"))
-            mx->set_param("master_gain", cfg["master_gain"].get<float>());
+        if (cfg.contains("master_gain")) {
+            float gain = cfg["master_gain"].get<float>();
+            mx->set_param("master_gain", gain);
+            record_param(g->param_handle(node_id, "master_gain"), gain);
+        }
         // channel_count changes require a graph rebuild; flag as unsupported live
         if (cfg.contains("channel_count"))
             return "channel_count changes require a set_graph call";
@@ -374,7 +555,8 @@ std::string AudioEngine::set_node_config(const std::string& node_id,
     // LV2Node: named parameter updates — route through the command queue to
     // avoid a data race between this (IPC) thread and the audio thread which
     // may simultaneously read &pi.value inside lilv_instance_run().
-    if (auto* lv = dynamic_cast<LV2Node*>(node)) {
+    if (dynamic_cast<LV2Node*>(node)) {
+        lk.unlock();   // send_param_cmd() takes graph_mutex_ itself
         for (auto& [key, val] : cfg.items()) {
             if (key == "lv2_uri") return "lv2_uri changes require a set_graph call";
             send_param_cmd(node_id, key, val.get<float>());
@@ -401,92 +583,187 @@ std::string AudioEngine::get_node_data(const std::string& node_id,
 }
 
 // ---------------------------------------------------------------------------
-// PortAudio callback (audio thread)
+// Shared-memory state
 // ---------------------------------------------------------------------------
 
-int AudioEngine::pa_callback(const void* /*input*/, void* output,
-                              unsigned long frames,
-                              const PaStreamCallbackTimeInfo* /*time_info*/,
-                              PaStreamCallbackFlags /*status_flags*/,
-                              void* user_data)
-{
-    auto* self = static_cast<AudioEngine*>(user_data);
-    float* out = static_cast<float*>(output);
+std::string AudioEngine::open_shared_state(std::string& name_out, size_t& size_out) {
+    std::lock_guard<std::mutex> lk(shared_state_mutex_);
+    if (!shared_state_owner_) {
+#ifdef AS_PLATFORM_WINDOWS
+        const unsigned long pid = GetCurrentProcessId();
+#else
+        const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+        std::string err;
+        auto s = SharedState::create("/audio_server_" + std::to_string(pid), err);
+        if (!s) return err;
+        shared_state_owner_ = std::move(s);
+        shared_state_.store(shared_state_owner_.get(), std::memory_order_release);
+    }
+    name_out = shared_state_owner_->name();
+    size_out = shared_state_owner_->size();
+    return {};
+}
 
-    // Clamp: PortAudio may deliver more frames than requested block size.
-    if (frames > MAX_BLOCK_SIZE) frames = MAX_BLOCK_SIZE;
+// Audio thread, at the end of process_block (graph is still safe to read).
+void AudioEngine::publish_shared_state(const Graph* graph) {
+    SharedState* s = shared_state_.load(std::memory_order_acquire);
+    if (!s) return;
+    s->publish(graph, current_beat_.load(std::memory_order_relaxed),
+               playing_.load(std::memory_order_relaxed), bpm_, cfg_.sample_rate);
+}
 
-    // Use pre-allocated heap buffers — stack arrays of MAX_BLOCK_SIZE floats
-    // would blow the 8 KB ALSA callback stack.
-    float* L = self->scratch_L_.data();
-    float* R = self->scratch_R_.data();
+// ---------------------------------------------------------------------------
+// Backend callback (audio thread)
+// ---------------------------------------------------------------------------
 
-    self->process_block(L, R, static_cast<int>(frames));
+void AudioEngine::audio_callback(const AudioBackend::Period& period, void* user) {
+    AS_STATS(const uint64_t t0 = perf::now_ns();)
+    rtcheck::AudioThreadScope rt;
+    auto* self = static_cast<AudioEngine*>(user);
+
+    // Graphs are activated for block_size frames; a longer device period
+    // (JACK picks its own) is rendered in slices, still in place.
+    const int channels = std::min(period.channels, Graph::MAX_OUTPUT_CHANNELS);
+    const int slice    = self->cfg_.block_size;
+    float*    out[Graph::MAX_OUTPUT_CHANNELS];
+    for (int done = 0; done < period.frames; done += slice) {
+        for (int c = 0; c < channels; ++c) out[c] = period.outputs[c] + done;
+        self->process_block(out, channels, std::min(slice, period.frames - done));
+    }
+    AS_STATS(self->record_callback(t0, period);)
+}
 
-    // Interleave into PortAudio output buffer
-    for (unsigned long i = 0; i < frames; ++i) {
-        out[i*2    ] = L[i];
-        out[i*2 + 1] = R[i];
+void AudioEngine::record_callback(uint64_t start_ns, const AudioBackend::Period& period) {
+    auto& st = cb_stats_;
+    const uint64_t elapsed = perf::now_ns() - start_ns;
+    const uint64_t budget  = static_cast<uint64_t>(period.frames * 1e9 / cfg_.sample_rate);
+    st.duration.record(elapsed);
+    st.budget_ns.store(budget, std::memory_order_relaxed);
+    if (elapsed > budget) st.overruns.fetch_add(1, std::memory_order_relaxed);
+
+    if (period.status) {
+        auto count = [&](uint32_t flag, std::atomic<uint64_t>& n) {
+            if (period.status & flag) n.fetch_add(1, std::memory_order_relaxed);
+        };
+        count(AudioBackend::OutputUnderflow, st.output_underflows);
+        count(AudioBackend::OutputOverflow,  st.output_overflows);
+        count(AudioBackend::InputUnderflow,  st.input_underflows);
+        count(AudioBackend::InputOverflow,   st.input_overflows);
+        count(AudioBackend::PrimingOutput,   st.priming_outputs);
     }
-    return paContinue;
+    if (period.output_latency_s > 0)
+        st.output_latency_s.store(period.output_latency_s, std::memory_order_relaxed);
 }
 
-void AudioEngine::process_block(float* L, float* R, int frames) {
-    // Process pending commands
+void AudioEngine::render_into(Graph* graph, const ProcessContext& ctx,
+                              float* const* out, int channels, int offset) {
+    float* at[Graph::MAX_OUTPUT_CHANNELS];
+    for (int c = 0; c < channels; ++c) at[c] = out[c] + offset;
+    graph->bind_outputs(at, channels);
+    graph->process(ctx);
+    for (int c = 0; c < channels; ++c)
+        if (!graph->writes_channel(c)) dsp::zero(at[c], ctx.block_size);
+}
+
+AudioEngine::Stats AudioEngine::get_stats(bool reset) {
+    Stats s;
+    auto& st = cb_stats_;
+    s.callback          = st.duration.summary();
+    s.budget_ns         = st.budget_ns.load(std::memory_order_relaxed);
+    s.overruns          = st.overruns.load(std::memory_order_relaxed);
+    s.output_underflows = st.output_underflows.load(std::memory_order_relaxed);
+    s.output_overflows  = st.output_overflows.load(std::memory_order_relaxed);
+    s.input_underflows  = st.input_underflows.load(std::memory_order_relaxed);
+    s.input_overflows   = st.input_overflows.load(std::memory_order_relaxed);
+    s.priming_outputs   = st.priming_outputs.load(std::memory_order_relaxed);
+    s.output_latency_s  = st.output_latency_s.load(std::memory_order_relaxed);
+    s.cmd_queue_depth    = cmd_queue_.size();
+    s.cmd_queue_capacity = cmd_queue_.capacity();
+    s.preview_queue_capacity = TrackSourceNode::PREVIEW_CAPACITY;
+    s.realtime = rtcheck::report(reset);
+
     {
-        std::lock_guard<std::mutex> lk(cmd_mutex_);
-        for (auto& ce : cmd_queue_) {
-            switch (ce.cmd) {
-                case Cmd::Play:
-                    playing_.store(true, std::memory_order_relaxed);
-                    break;
-                case Cmd::Stop: {
-                    playing_.store(false, std::memory_order_relaxed);
-                    Graph* g = active_graph_.load(std::memory_order_acquire);
-                    if (g) {
-                        // all notes off on all synth nodes
-                        for (auto& nid : g->eval_order()) {
-                            auto* n = g->find_node(nid);
-                            if (n) n->all_notes_off(-1);
-                        }
+        // owned_graph_ is the live graph and only changes under graph_mutex_.
+        std::lock_guard<std::mutex> lk(graph_mutex_);
+        if (owned_graph_) {
+            s.nodes                = owned_graph_->node_loads();
+            s.preview_queue_depths = owned_graph_->preview_queue_depths();
+            s.event_overflows      = owned_graph_->event_overflows();
+            if (reset) owned_graph_->reset_node_loads();
+        }
+    }
+
+    if (reset) {
+        st.duration.reset();
+        for (auto* n : { &st.overruns, &st.output_underflows, &st.output_overflows,
+                         &st.input_underflows, &st.input_overflows, &st.priming_outputs })
+            n->store(0, std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void AudioEngine::process_block(float* const* out, int channels, int frames) {
+    // Process pending commands
+    CmdEntry ce;
+    while (cmd_queue_.pop(ce)) {
+        switch (ce.cmd) {
+            case Cmd::Play:
+                playing_.store(true, std::memory_order_relaxed);
+                break;
+            case Cmd::Stop: {
+                playing_.store(false, std::memory_order_relaxed);
+                Graph* g = active_graph_.load(std::memory_order_acquire);
+                if (g) {
+                    // all notes off on all synth nodes
+                    for (auto& nid : g->eval_order()) {
+                        auto* n = g->find_node(nid);
+                        if (n) n->all_notes_off(-1);
                     }
-                    break;
                 }
-                case Cmd::Seek:
-                    dispatcher_.seek(ce.arg);
-                    current_beat_.store(ce.arg, std::memory_order_relaxed);
-                    {
-                        Graph* g = active_graph_.load(std::memory_order_acquire);
-                        if (g) for (auto& nid : g->eval_order()) {
-                            auto* n = g->find_node(nid);
-                            if (n) n->all_notes_off(-1);
-                        }
-                    }
-                    break;
-                case Cmd::AllNotesOff: {
+                break;
+            }
+            case Cmd::Seek:
+                dispatcher_.seek(ce.arg);
+                current_beat_.store(ce.arg, std::memory_order_relaxed);
+                {
                     Graph* g = active_graph_.load(std::memory_order_acquire);
                     if (g) for (auto& nid : g->eval_order()) {
                         auto* n = g->find_node(nid);
                         if (n) n->all_notes_off(-1);
                     }
-                    break;
                 }
-                case Cmd::SetParam: {
-                    Graph* g = active_graph_.load(std::memory_order_acquire);
-                    if (g) g->set_param(ce.node_id, ce.param, ce.value);
-                    break;
+                break;
+            case Cmd::AllNotesOff: {
+                Graph* g = active_graph_.load(std::memory_order_acquire);
+                if (g) for (auto& nid : g->eval_order()) {
+                    auto* n = g->find_node(nid);
+                    if (n) n->all_notes_off(-1);
                 }
+                break;
+            }
+            case Cmd::SetParam: {
+                // Handles are per graph; drop values resolved against a graph
+                // that has since been replaced.
+                Graph* g = active_graph_.load(std::memory_order_acquire);
+                if (g && g->serial() == ce.graph) g->set_param(ce.handle, ce.value);
+                break;
             }
         }
-        cmd_queue_.clear();
     }
 
     // Check for pending loop state
     {
         LoopState* ls = pending_loop_.exchange(nullptr, std::memory_order_acq_rel);
         if (ls) {
-            delete active_loop_;
+            if (active_loop_) {   // hand the old state back to publish_loop()
+                active_loop_->next = retired_loops_.load(std::memory_order_relaxed);
+                while (!retired_loops_.compare_exchange_weak(active_loop_->next, active_loop_,
+                                                             std::memory_order_release,
+                                                             std::memory_order_relaxed)) {}
+            }
             active_loop_ = ls;
+            dispatcher_.set_loop_start(ls->enabled ? ls->start : -1.0);
         }
     }
 
@@ -494,6 +771,7 @@ void AudioEngine::process_block(float* L, float* R, int frames) {
     dispatcher_.check_pending();
 
     Graph* graph = active_graph_.load(std::memory_order_acquire);
+    if (graph) graph->commit_wiring();
 
     if (!playing_.load(std::memory_order_relaxed) || !graph) {
         // Still process graph (for preview notes) but without advancing beat
@@ -502,20 +780,11 @@ void AudioEngine::process_block(float* L, float* R, int frames) {
             double bps  = bpm_ / 60.0 / cfg_.sample_rate;
             ProcessContext ctx { frames, cfg_.sample_rate, bpm_,
                                  beat, bps };
-            graph->process(ctx);
-            const float* gL = graph->output_L();
-            const float* gR = graph->output_R();
-            if (gL && gR) {
-                std::memcpy(L, gL, frames * sizeof(float));
-                std::memcpy(R, gR, frames * sizeof(float));
-            } else {
-                std::memset(L, 0, frames * sizeof(float));
-                std::memset(R, 0, frames * sizeof(float));
-            }
+            render_into(graph, ctx, out, channels, 0);
         } else {
-            std::memset(L, 0, frames * sizeof(float));
-            std::memset(R, 0, frames * sizeof(float));
+            for (int c = 0; c < channels; ++c) dsp::zero(out[c], frames);
         }
+        publish_shared_state(graph);
         graph_epoch_.fetch_add(1, std::memory_order_release);
         return;
     }
@@ -525,36 +794,47 @@ void AudioEngine::process_block(float* L, float* R, int frames) {
 
     double beat_pos = current_beat_.load(std::memory_order_relaxed);
     double bps      = bpm / 60.0 / cfg_.sample_rate;  // beats per sample
-    double end_beat = beat_pos + frames * bps;
 
-    // Dispatch events to graph nodes
-    dispatcher_.dispatch(beat_pos, end_beat, graph);
+    // A loop end inside the block splits it: the graph runs up to the loop
+    // end, then on from the loop start, so the wrap lands on its sample.
+    const LoopState* loop = (active_loop_ && active_loop_->enabled &&
+                             active_loop_->end > active_loop_->start) ? active_loop_ : nullptr;
+    if (loop && beat_pos >= loop->end) {   // loop moved behind the playhead
+        dispatcher_.seek(loop->start);
+        beat_pos = loop->start;
+    }
 
-    // Process graph
-    ProcessContext ctx { frames, cfg_.sample_rate, bpm, beat_pos, bps };
-    graph->process(ctx);
+    int done = 0;
+    while (done < frames) {
+        int    n        = frames - done;
+        double end_beat = beat_pos + n * bps;
+        bool   wrap     = false;
+        if (loop && end_beat >= loop->end) {
+            n        = std::clamp(static_cast<int>(std::ceil((loop->end - beat_pos) / bps)), 1, n);
+            end_beat = loop->end;
+            wrap     = true;
+        }
+
+        // Dispatch events to graph nodes, then process the graph
+        dispatcher_.dispatch(beat_pos, end_beat, n, graph);
+        ProcessContext ctx { n, cfg_.sample_rate, bpm, beat_pos, bps };
+        render_into(graph, ctx, out, channels, done);
+        done += n;
 
-    const float* gL = graph->output_L();
-    const float* gR = graph->output_R();
-    if (gL && gR) {
-        std::memcpy(L, gL, frames * sizeof(float));
-        std::memcpy(R, gR, frames * sizeof(float));
-    } else {
-        std::memset(L, 0, frames * sizeof(float));
-        std::memset(R, 0, frames * sizeof(float));
+        if (wrap) {
+            dispatcher_.seek(loop->start);   // cached cursor: no search
+            beat_pos = loop->start;
+        } else {
+            beat_pos = end_beat;
+        }
     }
 
     // Advance beat
-    current_beat_.store(end_beat, std::memory_order_relaxed);
+    current_beat_.store(beat_pos, std::memory_order_relaxed);
 
-    // Loop / end-of-arrangement
+    // End of arrangement
     double arr_len = dispatcher_.arrangement_length();
-    if (active_loop_ && active_loop_->enabled) {
-        if (end_beat >= active_loop_->end) {
-            dispatcher_.seek(active_loop_->start);
-            current_beat_.store(active_loop_->start, std::memory_order_relaxed);
-        }
-    } else if (arr_len > 0 && end_beat >= arr_len) {
+    if (!loop && arr_len > 0 && beat_pos >= arr_len) {
         playing_.store(false, std::memory_order_relaxed);
         if (graph) for (auto& nid : graph->eval_order()) {
             auto* n = graph->find_node(nid);
@@ -563,6 +843,8 @@ void AudioEngine::process_block(float* L, float* R, int frames) {
         current_beat_.store(0.0, std::memory_order_relaxed);
     }
 
+    publish_shared_state(graph);
+
     // Signal to set_graph() that this block is complete and the audio thread
     // is no longer touching the graph pointer that was active at block start.
     graph_epoch_.fetch_add(1, std::memory_order_release);
@@ -572,77 +854,260 @@ void AudioEngine::process_block(float* L, float* R, int frames) {
 // Offline render
 // ---------------------------------------------------------------------------
 
-std::vector<float> AudioEngine::render_offline(float tail_seconds, double duration_beats) {
-    // Grab current graph and build a fresh schedule-driven render.
-    // This runs on the IPC thread.  The PortAudio callback also calls
-    // graph->process() on the audio thread, so we must stop the stream for
-    // the duration of this render to avoid a data race on the buffer pool.
-
-    Graph* graph = active_graph_.load(std::memory_order_acquire);
-    if (!graph) return {};
+std::string AudioEngine::take_render_snapshot(float tail_seconds, double duration_beats,
+                                              RenderSnapshot& out)
+{
+    {
+        std::lock_guard<std::mutex> lk(graph_mutex_);
+        if (!owned_graph_ || graph_desc_.empty()) return "no active graph";
+        out.desc = graph_desc_;
+        out.params.clear();
+        for (auto& [handle, value] : param_values_) {
+            std::string node_id, param;
+            if (owned_graph_->param_target(handle, node_id, param))
+                out.params.emplace_back(std::move(node_id), std::move(param), value);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lk(schedule_mutex_);
+        out.schedule = schedule_;
+    }
+    out.bpm = bpm_;
 
-    float bpm     = bpm_;
     double length = (duration_beats > 0.0) ? duration_beats
-                                            : dispatcher_.arrangement_length();
-    if (length <= 0.0) return {};
-
-    double total_seconds = length * 60.0 / bpm + tail_seconds;
-    int    total_frames  = static_cast<int>(total_seconds * cfg_.sample_rate);
-    int    block         = cfg_.block_size;
-
-    // Pause real-time stream so the callback doesn't race with our render.
-    // Pa_StopStream waits for the current callback to finish before returning.
-    bool stream_was_running = stream_ != nullptr;
-    double saved_beat = current_beat_.load(std::memory_order_relaxed);
-    if (stream_was_running)
-        Pa_StopStream(static_cast<PaStream*>(stream_));
+                  : out.schedule             ? out.schedule->total_length_beats()
+                                             : 0.0;
+    if (length <= 0.0) return "nothing to render";
+    double total_seconds = length * 60.0 / out.bpm + tail_seconds;
+    out.total_frames = static_cast<int64_t>(total_seconds * cfg_.sample_rate);
+    return {};
+}
 
-    std::vector<float> output;
-    output.reserve(total_frames * 2);
+std::string AudioEngine::render_snapshot(const RenderSnapshot& snap,
+                                         std::unordered_set<std::string> excluded,
+                                         const RenderBlockFn& fn)
+{
+    // Never the live executor: its workers belong to the callback.
+    std::unique_ptr<Graph> graph;
+    {
+        std::lock_guard<std::mutex> lk(render_build_mutex_);
+#ifdef AS_ENABLE_SF2
+        // This graph renders alongside the live one, so its synths cannot
+        // share the live graph's fonts (see soundfont_cache.h).
+        SoundFontCache::PrivateScope own_fonts;
+#endif
+        std::string err;
+        graph = Graph::from_json(snap.desc, err);
+        if (!graph) return err;
+        graph->set_executor(render_executor_.get());
+        if (!graph->activate(cfg_.sample_rate, cfg_.block_size))
+            return "Graph activation failed";
+    }
+    for (auto& [node_id, param, value] : snap.params)
+        graph->set_param(graph->param_handle(node_id, param), value);
 
-    dispatcher_.seek(0.0);
+    Dispatcher cursor;
+    cursor.swap_schedule(snap.schedule);
+    cursor.check_pending();
+    cursor.set_excluded_nodes(std::move(excluded));
 
-    double beat_pos = 0.0;
-    double bps      = bpm / 60.0 / cfg_.sample_rate;
-    int    frames_done = 0;
+    int     block       = cfg_.block_size;
+    double  beat_pos    = 0.0;
+    double  bps         = snap.bpm / 60.0 / cfg_.sample_rate;
+    int64_t frames_done = 0;
 
-    while (frames_done < total_frames) {
-        int n = std::min(block, total_frames - frames_done);
+    while (frames_done < snap.total_frames) {
+        int n = static_cast<int>(std::min<int64_t>(block, snap.total_frames - frames_done));
         double end_beat = beat_pos + n * bps;
 
-        dispatcher_.dispatch(beat_pos, end_beat, graph);
+        {
+            // The block is held to the audio thread's rules; the sink is not.
+            rtcheck::AudioThreadScope rt;
+            cursor.dispatch(beat_pos, end_beat, n, graph.get());
 
-        ProcessContext ctx { n, cfg_.sample_rate, bpm, beat_pos, bps };
-        graph->process(ctx);
-
-        const float* gL = graph->output_L();
-        const float* gR = graph->output_R();
-        if (gL && gR) {
-            for (int i = 0; i < n; ++i) {
-                output.push_back(gL[i]);
-                output.push_back(gR[i]);
-            }
-        } else {
-            output.insert(output.end(), n * 2, 0.0f);
+            ProcessContext ctx { n, cfg_.sample_rate, snap.bpm, beat_pos, bps, true };
+            graph->process(ctx);
         }
 
+        if (!fn(graph->output_L(), graph->output_R(), n)) return "render aborted";
+
         beat_pos = end_beat;
         frames_done += n;
     }
+    return {};
+}
+
+namespace {
+
+// Collects rendered blocks into interleaved chunks of chunk_samples and hands
+// each one, encoded, to a sink.  Wav output gets its header in the first chunk.
+class ChunkEncoder {
+public:
+    ChunkEncoder(AudioEngine::RenderFormat fmt, int sample_rate, int64_t total_frames,
+                 size_t chunk_samples, AudioEngine::RenderSink sink)
+        : fmt_(fmt), total_frames_(total_frames), chunk_samples_(chunk_samples),
+          sink_(std::move(sink))
+    {
+        pcm_.reserve(chunk_samples);
+        bytes_.reserve(44 + chunk_samples * sizeof(float));
+        if (fmt_ == AudioEngine::RenderFormat::Wav)
+            append_wav_header(bytes_, sample_rate, 2, total_frames);
+    }
+
+    bool add(const float* L, const float* R, int n) {
+        size_t at = pcm_.size();
+        pcm_.resize(at + static_cast<size_t>(n) * 2, 0.0f);
+        if (L && R) dsp::interleave(pcm_.data() + at, L, R, n);
+        return pcm_.size() < chunk_samples_ || flush();
+    }
 
-    // Resume the real-time stream, restoring beat position to pre-render state
-    // so live playback isn't disrupted by the offline render scrub.
-    if (stream_was_running) {
-        dispatcher_.seek(saved_beat);
-        current_beat_.store(saved_beat, std::memory_order_relaxed);
-        Pa_StartStream(static_cast<PaStream*>(stream_));
+    bool finish() { return pcm_.empty() || flush(); }
+
+    int64_t frames_done() const { return frames_done_; }
+
+private:
+    bool flush() {
+        if (fmt_ == AudioEngine::RenderFormat::Wav) {
+            append_s16(bytes_, pcm_.data(), pcm_.size());
+        } else {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(pcm_.data());
+            bytes_.insert(bytes_.end(), p, p + pcm_.size() * sizeof(float));
+        }
+        frames_done_ += static_cast<int64_t>(pcm_.size() / 2);
+        pcm_.clear();
+        bool keep_going = sink_(bytes_.data(), bytes_.size(), frames_done_, total_frames_);
+        bytes_.clear();
+        return keep_going;
     }
 
+    AudioEngine::RenderFormat fmt_;
+    int64_t                   total_frames_;
+    size_t                    chunk_samples_;
+    AudioEngine::RenderSink   sink_;
+    std::vector<float>        pcm_;
+    std::vector<uint8_t>      bytes_;
+    int64_t                   frames_done_ = 0;
+};
+
+} // namespace
+
+// Chunk size in interleaved samples: chunk_frames rounded up to whole blocks.
+static size_t chunk_samples_for(int chunk_frames, int block) {
+    int blocks = std::max(1, (chunk_frames + block - 1) / block);
+    return static_cast<size_t>(blocks) * block * 2;
+}
+
+std::vector<float> AudioEngine::render_offline(float tail_seconds, double duration_beats) {
+    RenderSnapshot snap;
+    std::string err = take_render_snapshot(tail_seconds, duration_beats, snap);
+    if (!err.empty()) return {};
+
+    std::vector<float> output;
+    output.reserve(static_cast<size_t>(snap.total_frames) * 2);
+    err = render_snapshot(snap, {}, [&](const float* L, const float* R, int n) {
+        size_t at = output.size();
+        output.resize(at + static_cast<size_t>(n) * 2, 0.0f);
+        if (L && R) dsp::interleave(output.data() + at, L, R, n);
+        return true;
+    });
+    if (!err.empty()) {
+        AS_LOG("engine", "render_offline: %s", err.c_str());
+        return {};
+    }
     return output;
 }
 
 std::vector<uint8_t> AudioEngine::render_offline_wav(float tail_seconds, double duration_beats) {
-    auto pcm = render_offline(tail_seconds, duration_beats);
-    if (pcm.empty()) return {};
-    return make_wav(pcm, static_cast<int>(cfg_.sample_rate), 2);
+    // Encode as we go rather than converting a full float render afterwards.
+    std::vector<uint8_t> wav;
+    int64_t frames = render_offline_stream(
+        RenderFormat::Wav,
+        [&](const uint8_t* data, size_t bytes, int64_t, int64_t total_frames) {
+            if (wav.empty()) wav.reserve(44 + static_cast<size_t>(total_frames) * 4);
+            wav.insert(wav.end(), data, data + bytes);
+            return true;
+        },
+        DEFAULT_RENDER_CHUNK_FRAMES, tail_seconds, duration_beats);
+    if (frames <= 0) return {};
+    return wav;
+}
+
+int64_t AudioEngine::render_offline_stream(RenderFormat fmt, const RenderSink& sink,
+                                           int chunk_frames, float tail_seconds,
+                                           double duration_beats, std::string* error_out)
+{
+    RenderSnapshot snap;
+    std::string err = take_render_snapshot(tail_seconds, duration_beats, snap);
+    if (!err.empty()) {
+        if (error_out) *error_out = err;
+        return 0;
+    }
+
+    ChunkEncoder enc(fmt, static_cast<int>(cfg_.sample_rate), snap.total_frames,
+                     chunk_samples_for(chunk_frames, cfg_.block_size), sink);
+    err = render_snapshot(snap, {}, [&](const float* L, const float* R, int n) {
+        return enc.add(L, R, n);
+    });
+    if (err.empty() && !enc.finish()) err = "render aborted";
+    if (!err.empty()) {
+        if (error_out) *error_out = err;
+        return -1;
+    }
+    return enc.frames_done();
+}
+
+std::string AudioEngine::render_stems(const std::vector<StemSpec>& stems, RenderFormat fmt,
+                                      const StemSink& sink, int threads, int chunk_frames,
+                                      float tail_seconds, double duration_beats)
+{
+    if (stems.empty()) return "no stems";
+
+    RenderSnapshot snap;
+    std::string err = take_render_snapshot(tail_seconds, duration_beats, snap);
+    if (!err.empty()) return err;
+
+    std::unordered_set<std::string> all_nodes;
+    for (auto& st : stems) all_nodes.insert(st.nodes.begin(), st.nodes.end());
+
+    std::mutex          fail_mutex;
+    std::string         failure;
+    std::atomic<bool>   failed { false };
+    std::atomic<size_t> next   { 0 };
+    size_t chunk_samples = chunk_samples_for(chunk_frames, cfg_.block_size);
+
+    auto render_one = [&](size_t i) {
+        std::unordered_set<std::string> excluded = all_nodes;
+        for (auto& n : stems[i].nodes) excluded.erase(n);
+
+        ChunkEncoder enc(fmt, static_cast<int>(cfg_.sample_rate), snap.total_frames, chunk_samples,
+            [&](const uint8_t* data, size_t bytes, int64_t done, int64_t total) {
+                return !failed.load(std::memory_order_relaxed) && sink(i, data, bytes, done, total);
+            });
+        std::string stem_err = render_snapshot(snap, std::move(excluded),
+            [&](const float* L, const float* R, int n) { return enc.add(L, R, n); });
+        if (stem_err.empty() && !enc.finish()) stem_err = "render aborted";
+        if (stem_err.empty()) return;
+
+        std::lock_guard<std::mutex> lk(fail_mutex);
+        if (failure.empty()) failure = "stem '" + stems[i].name + "': " + stem_err;
+        failed.store(true, std::memory_order_relaxed);
+    };
+
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    size_t n_threads = std::min(stems.size(), threads > 0 ? static_cast<size_t>(threads) : hw);
+    auto worker = [&] {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= stems.size()) return;
+            render_one(i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < n_threads; ++t) pool.emplace_back(worker);
+    worker();   // the calling thread renders too
+    for (auto& t : pool) t.join();
+
+    AS_LOG("engine", "rendered %zu stem(s) on %zu thread(s)", stems.size(), n_threads);
+    return failure;
 }
@@ -16,7 +16,7 @@
 // those TUs.
 //
 // STATICALLY LINKED PLUGINS (registered here):
-//   sine, control_source, mixer
+//   sine, control_source, mixer, sampler
 //
 // DYNAMICALLY LOADED PLUGINS (loaded from plugins/ at startup, not here):
 //   note_gate, control_monitor, reverb, arpeggiator, control_lfo, fluidsynth
@@ -30,6 +30,7 @@
 std::unique_ptr<Plugin> make_sine_plugin();
 std::unique_ptr<Plugin> make_control_source_plugin();
 std::unique_ptr<Plugin> make_mixer_plugin();
+std::unique_ptr<Plugin> make_sampler_plugin();
 
 // ---------------------------------------------------------------------------
 // Registration storage and helper
@@ -55,9 +56,10 @@ static void register_one(std::unique_ptr<Plugin>(*factory)()) {
 // ---------------------------------------------------------------------------
 
 void register_builtin_plugins() {
-    registrations().reserve(3);
+    registrations().reserve(4);
 
     register_one(make_sine_plugin);
     register_one(make_control_source_plugin);
     register_one(make_mixer_plugin);
+    register_one(make_sampler_plugin);
 }
@@ -0,0 +1,252 @@
+// dsp_kernels.cpp
+#include "dsp_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AS_DSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AS_TARGET_AVX2
+#else
+#define AS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AS_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace dsp {
+namespace {
+
+struct Backend {
+    const char* name;
+    void (*gain_accumulate)(float*, const float*, float, int);
+    void (*soft_clip)(float*, int);
+    void (*interleave)(float*, const float*, const float*, int);
+    void (*peak_energy)(const float*, int, float&, float&);
+};
+
+// ---------------------------------------------------------------------------
+// Scalar
+// ---------------------------------------------------------------------------
+
+void gain_accumulate_scalar(float* dst, const float* src, float gain, int n) {
+    for (int i = 0; i < n; ++i) dst[i] += src[i] * gain;
+}
+
+void soft_clip_scalar(float* buf, int n) {
+    for (int i = 0; i < n; ++i) buf[i] = fast_tanh(buf[i]);
+}
+
+void interleave_scalar(float* out, const float* L, const float* R, int n) {
+    for (int i = 0; i < n; ++i) {
+        out[i*2    ] = L[i];
+        out[i*2 + 1] = R[i];
+    }
+}
+
+void peak_energy_scalar(const float* buf, int n, float& peak, float& energy) {
+    float pk = 0.0f, e = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float a = buf[i] < 0.0f ? -buf[i] : buf[i];
+        pk = a > pk ? a : pk;
+        e += buf[i] * buf[i];
+    }
+    peak = pk; energy = e;
+}
+
+const Backend SCALAR = { "scalar", gain_accumulate_scalar, soft_clip_scalar, interleave_scalar,
+                         peak_energy_scalar };
+
+// ---------------------------------------------------------------------------
+// AVX2 + FMA
+// ---------------------------------------------------------------------------
+
+#ifdef AS_DSP_X86
+AS_TARGET_AVX2 void gain_accumulate_avx2(float* dst, const float* src, float gain, int n) {
+    __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), g,
+                                                  _mm256_loadu_ps(dst + i)));
+    for (; i < n; ++i) dst[i] += src[i] * gain;
+}
+
+AS_TARGET_AVX2 void soft_clip_avx2(float* buf, int n) {
+    const __m256 lim = _mm256_set1_ps(4.97f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x  = _mm256_loadu_ps(buf + i);
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), lim)), lim);
+        __m256 x2 = _mm256_mul_ps(x, x);
+        __m256 p  = _mm256_fmadd_ps(x2, _mm256_add_ps(x2, _mm256_set1_ps(378.0f)),
+                                    _mm256_set1_ps(17325.0f));
+        p = _mm256_mul_ps(x, _mm256_fmadd_ps(x2, p, _mm256_set1_ps(135135.0f)));
+        __m256 q  = _mm256_fmadd_ps(x2, _mm256_set1_ps(28.0f), _mm256_set1_ps(3150.0f));
+        q = _mm256_fmadd_ps(x2, q, _mm256_set1_ps(62370.0f));
+        q = _mm256_fmadd_ps(x2, q, _mm256_set1_ps(135135.0f));
+        __m256 r  = _mm256_div_ps(p, q);
+        r = _mm256_min_ps(_mm256_max_ps(r, _mm256_sub_ps(_mm256_setzero_ps(), one)), one);
+        _mm256_storeu_ps(buf + i, r);
+    }
+    for (; i < n; ++i) buf[i] = fast_tanh(buf[i]);
+}
+
+AS_TARGET_AVX2 void interleave_avx2(float* out, const float* L, const float* R, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 l  = _mm256_loadu_ps(L + i);
+        __m256 r  = _mm256_loadu_ps(R + i);
+        __m256 lo = _mm256_unpacklo_ps(l, r);   // l0 r0 l1 r1 | l4 r4 l5 r5
+        __m256 hi = _mm256_unpackhi_ps(l, r);   // l2 r2 l3 r3 | l6 r6 l7 r7
+        _mm256_storeu_ps(out + i*2,     _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + i*2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    for (; i < n; ++i) {
+        out[i*2    ] = L[i];
+        out[i*2 + 1] = R[i];
+    }
+}
+
+AS_TARGET_AVX2 void peak_energy_avx2(const float* buf, int n, float& peak, float& energy) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 pk = _mm256_setzero_ps(), e = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(buf + i);
+        pk = _mm256_max_ps(pk, _mm256_and_ps(x, abs_mask));
+        e  = _mm256_fmadd_ps(x, x, e);
+    }
+    alignas(32) float pks[8], es[8];
+    _mm256_store_ps(pks, pk);
+    _mm256_store_ps(es, e);
+    float p = 0.0f, s = 0.0f;
+    for (int k = 0; k < 8; ++k) { p = pks[k] > p ? pks[k] : p; s += es[k]; }
+    for (; i < n; ++i) {
+        float a = buf[i] < 0.0f ? -buf[i] : buf[i];
+        p = a > p ? a : p;
+        s += buf[i] * buf[i];
+    }
+    peak = p; energy = s;
+}
+
+const Backend AVX2 = { "avx2", gain_accumulate_avx2, soft_clip_avx2, interleave_avx2,
+                       peak_energy_avx2 };
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma     = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// NEON
+// ---------------------------------------------------------------------------
+
+#ifdef AS_DSP_NEON
+void gain_accumulate_neon(float* dst, const float* src, float gain, int n) {
+    float32x4_t g = vdupq_n_f32(gain);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(dst + i, vfmaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+    for (; i < n; ++i) dst[i] += src[i] * gain;
+}
+
+void soft_clip_neon(float* buf, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x  = vminq_f32(vmaxq_f32(vld1q_f32(buf + i), vdupq_n_f32(-4.97f)),
+                                   vdupq_n_f32(4.97f));
+        float32x4_t x2 = vmulq_f32(x, x);
+        float32x4_t p  = vfmaq_f32(vdupq_n_f32(17325.0f), x2, vaddq_f32(x2, vdupq_n_f32(378.0f)));
+        p = vmulq_f32(x, vfmaq_f32(vdupq_n_f32(135135.0f), x2, p));
+        float32x4_t q  = vfmaq_f32(vdupq_n_f32(3150.0f), x2, vdupq_n_f32(28.0f));
+        q = vfmaq_f32(vdupq_n_f32(62370.0f), x2, q);
+        q = vfmaq_f32(vdupq_n_f32(135135.0f), x2, q);
+        float32x4_t r  = vdivq_f32(p, q);
+        vst1q_f32(buf + i, vminq_f32(vmaxq_f32(r, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f)));
+    }
+    for (; i < n; ++i) buf[i] = fast_tanh(buf[i]);
+}
+
+void interleave_neon(float* out, const float* L, const float* R, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t lr = { { vld1q_f32(L + i), vld1q_f32(R + i) } };
+        vst2q_f32(out + i*2, lr);
+    }
+    for (; i < n; ++i) {
+        out[i*2    ] = L[i];
+        out[i*2 + 1] = R[i];
+    }
+}
+
+void peak_energy_neon(const float* buf, int n, float& peak, float& energy) {
+    float32x4_t pk = vdupq_n_f32(0.0f), e = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(buf + i);
+        pk = vmaxq_f32(pk, vabsq_f32(x));
+        e  = vfmaq_f32(e, x, x);
+    }
+    float p = vmaxvq_f32(pk), s = vaddvq_f32(e);
+    for (; i < n; ++i) {
+        float a = buf[i] < 0.0f ? -buf[i] : buf[i];
+        p = a > p ? a : p;
+        s += buf[i] * buf[i];
+    }
+    peak = p; energy = s;
+}
+
+const Backend NEON = { "neon", gain_accumulate_neon, soft_clip_neon, interleave_neon,
+                       peak_energy_neon };
+#endif
+
+const Backend& select_backend() {
+#if defined(AS_DSP_X86)
+    if (cpu_has_avx2()) return AVX2;
+#elif defined(AS_DSP_NEON)
+    return NEON;
+#endif
+    return SCALAR;
+}
+
+// Chosen on first use; afterwards one guarded load per call.
+const Backend& active() {
+    static const Backend& b = select_backend();
+    return b;
+}
+
+} // namespace
+
+void gain_accumulate(float* dst, const float* src, float gain, int n) {
+    active().gain_accumulate(dst, src, gain, n);
+}
+
+void soft_clip(float* buf, int n) {
+    active().soft_clip(buf, n);
+}
+
+void interleave(float* out, const float* L, const float* R, int n) {
+    active().interleave(out, L, R, n);
+}
+
+void peak_energy(const float* buf, int n, float& peak, float& energy) {
+    active().peak_energy(buf, n, peak, energy);
+}
+
+const char* backend() {
+    return active().name;
+}
+
+} // namespace dsp
@@ -2,12 +2,16 @@
 #include "graph.h"
 #include "synth_node.h"
 #include "plugin_adapter.h"
+#include "dsp_kernels.h"
 #include "nlohmann/json.hpp"
 
 #include <stdexcept>
 #include <unordered_set>
 #include <algorithm>
 #include <cstring>
+#include <cmath>
+#include <new>
+#include <utility>
 
 using json = nlohmann::json;
 
@@ -15,18 +19,129 @@ using json = nlohmann::json;
 // BufferPool
 // ---------------------------------------------------------------------------
 
+void BufferPool::ArenaFree::operator()(float* p) const {
+    ::operator delete[](p, std::align_val_t(ALIGNMENT));
+}
+
 void BufferPool::allocate(int num_buffers, int block_size) {
-    buffers_.assign(num_buffers, std::vector<float>(block_size, 0.0f));
+    constexpr size_t per_line = ALIGNMENT / sizeof(float);
+    stride_ = (static_cast<size_t>(std::max(block_size, 1)) + per_line - 1) / per_line * per_line;
+    count_  = num_buffers;
+    size_t total = stride_ * static_cast<size_t>(num_buffers);
+    arena_.reset(static_cast<float*>(
+        ::operator new[](total * sizeof(float), std::align_val_t(ALIGNMENT))));
+    std::fill(arena_.get(), arena_.get() + total, 0.0f);
+    silent_ = std::make_unique<int[]>(std::max(num_buffers, 1));
+    std::fill(silent_.get(), silent_.get() + num_buffers, static_cast<int>(stride_));
 }
 
 float* BufferPool::get(int index) {
-    return buffers_.at(index).data();
+    if (index < 0 || index >= count_)
+        throw std::out_of_range("BufferPool::get: index " + std::to_string(index));
+    return arena_.get() + stride_ * static_cast<size_t>(index);
+}
+
+int* BufferPool::silent_frames(int index) {
+    if (index < 0 || index >= count_)
+        throw std::out_of_range("BufferPool::silent_frames: index " + std::to_string(index));
+    return &silent_[index];
 }
 
 // ---------------------------------------------------------------------------
 // Graph::from_json
 // ---------------------------------------------------------------------------
 
+// One NodeDesc → a configured (not yet activated) node.  desc receives the
+// parsed fields, including the numeric params to apply after activate().
+static std::unique_ptr<Node> node_from_json(const json& jn, NodeDesc& desc, std::string& err) {
+    desc.id          = jn.value("id", "");
+    desc.type        = jn.value("type", "sine");
+    desc.sf2_path    = jn.value("sf2_path", "");
+    desc.lv2_uri     = jn.value("lv2_uri", "");
+    desc.sample_path = jn.value("sample_path", "");
+    desc.channel_count = jn.value("channel_count", 2);
+    desc.audio_outputs = jn.value("audio_outputs", 1);
+    desc.polyphony   = jn.value("polyphony", SineVoicePool::DEFAULT_POLYPHONY);
+    desc.pitch_lo    = jn.value("pitch_lo", 0);
+    desc.pitch_hi    = jn.value("pitch_hi", 127);
+    desc.gate_mode   = jn.value("gate_mode", 0);
+    desc.ramp        = jn.value("ramp", false);
+    // Collect string params for configure() calls on plugin-backed nodes.
+    // Numeric params go into desc.params (applied via set_param after activate).
+    std::unordered_map<std::string, std::string> string_params;
+    if (jn.contains("params")) {
+        for (auto& [k, v] : jn["params"].items()) {
+            if (v.is_number())
+                desc.params[k] = v.get<float>();
+            else if (v.is_string())
+                string_params[k] = v.get<std::string>();
+        }
+    }
+    // Also forward the dedicated NodeDesc string fields as configure() keys
+    // so plugin-backed nodes (e.g. builtin.fluidsynth) receive them even
+    // though make_node() only uses them for the legacy hardcoded node types.
+    if (!desc.sf2_path.empty())    string_params.emplace("sf2_path",    desc.sf2_path);
+    if (!desc.lv2_uri.empty())     string_params.emplace("lv2_uri",     desc.lv2_uri);
+    if (!desc.sample_path.empty()) string_params.emplace("sample_path", desc.sample_path);
+
+    std::string node_err;
+    auto node = make_node(desc, node_err);
+    if (!node) {
+        err = "Failed to create node '" + desc.id + "': " + node_err;
+        return nullptr;
+    }
+
+    // For plugin-backed nodes, deliver string config params via configure().
+    // This is how sf2_path reaches FluidSynthPlugin before activate() is called.
+    if (auto* adapter = dynamic_cast<PluginAdapterNode*>(node.get())) {
+        for (auto& [k, v] : string_params)
+            adapter->plugin()->configure(k, v);
+    }
+    return node;
+}
+
+static Connection connection_from_json(const json& jc) {
+    return {
+        jc.value("from_node", ""),
+        jc.value("from_port", ""),
+        jc.value("to_node",   ""),
+        jc.value("to_port",   ""),
+    };
+}
+
+static bool same_connection(const Connection& a, const Connection& b) {
+    return a.from_node == b.from_node && a.from_port == b.from_port &&
+           a.to_node   == b.to_node   && a.to_port   == b.to_port;
+}
+
+static bool routes_from_json(const json& j, const Graph& g,
+                             std::vector<Graph::OutputRoute>& routes, std::string& err) {
+    for (auto& jr : j.value("outputs", json::array())) {
+        Graph::OutputRoute r { jr.value("node", ""), jr.value("port", ""), jr.value("channel", -1) };
+        std::string where = "output " + r.node + "." + r.port;
+        Node* node = g.find_node(r.node);
+        if (!node) { err = where + ": unknown node"; return false; }
+        bool audio_out = false;
+        for (auto& p : node->declare_ports())
+            audio_out |= p.name == r.port && p.is_output && p.type == PortType::AudioMono;
+        if (!audio_out) { err = where + ": not an audio output"; return false; }
+        if (r.channel < 2 || r.channel >= Graph::MAX_OUTPUT_CHANNELS) {
+            err = where + ": channel must be in 2.." + std::to_string(Graph::MAX_OUTPUT_CHANNELS - 1) +
+                  " (0 and 1 are the mixer)";
+            return false;
+        }
+        for (auto& o : routes) {
+            if (o.channel == r.channel) {
+                err = where + ": channel " + std::to_string(r.channel) + " already taken";
+                return false;
+            }
+            if (o.node == r.node && o.port == r.port) { err = where + ": routed twice"; return false; }
+        }
+        routes.push_back(std::move(r));
+    }
+    return true;
+}
+
 std::unique_ptr<Graph> Graph::from_json(const std::string& j_str, std::string& err) {
     json j;
     try { j = json::parse(j_str); }
@@ -36,50 +151,14 @@ std::unique_ptr<Graph> Graph::from_json(const std::string& j_str, std::string& e
     }
 
     auto g = std::make_unique<Graph>();
+    auto bpm = j.find("bpm");
+    if (bpm != j.end() && bpm->is_number()) g->bpm_ = bpm->get<float>();
 
     // --- Nodes ---
     for (auto& jn : j.value("nodes", json::array())) {
         NodeDesc desc;
-        desc.id          = jn.value("id", "");
-        desc.type        = jn.value("type", "sine");
-        desc.sf2_path    = jn.value("sf2_path", "");
-        desc.lv2_uri     = jn.value("lv2_uri", "");
-        desc.sample_path = jn.value("sample_path", "");
-        desc.channel_count = jn.value("channel_count", 2);
-        desc.pitch_lo    = jn.value("pitch_lo", 0);
-        desc.pitch_hi    = jn.value("pitch_hi", 127);
-        desc.gate_mode   = jn.value("gate_mode", 0);
-        // Collect string params for configure() calls on plugin-backed nodes.
-        // Numeric params go into desc.params (applied via set_param after activate).
-        std::unordered_map<std::string, std::string> string_params;
-        if (jn.contains("params")) {
-            for (auto& [k, v] : jn["params"].items()) {
-                if (v.is_number())
-                    desc.params[k] = v.get<float>();
-                else if (v.is_string())
-                    string_params[k] = v.get<std::string>();
-            }
-        }
-        // Also forward the dedicated NodeDesc string fields as configure() keys
-        // so plugin-backed nodes (e.g. builtin.fluidsynth) receive them even
-        // though make_node() only uses them for the legacy hardcoded node types.
-        if (!desc.sf2_path.empty())    string_params.emplace("sf2_path",    desc.sf2_path);
-        if (!desc.lv2_uri.empty())     string_params.emplace("lv2_uri",     desc.lv2_uri);
-        if (!desc.sample_path.empty()) string_params.emplace("sample_path", desc.sample_path);
-
-        std::string node_err;
-        auto node = make_node(desc, node_err);
-        if (!node) {
-            err = "Failed to create node '" + desc.id + "': " + node_err;
-            return nullptr;
-        }
-
-        // For plugin-backed nodes, deliver string config params via configure().
-        // This is how sf2_path reaches FluidSynthPlugin before activate() is called.
-        if (auto* adapter = dynamic_cast<PluginAdapterNode*>(node.get())) {
-            for (auto& [k, v] : string_params)
-                adapter->plugin()->configure(k, v);
-        }
+        auto node = node_from_json(jn, desc, err);
+        if (!node) return nullptr;
 
         NodeEntry entry;
         entry.node        = std::move(node);
@@ -91,18 +170,183 @@ std::unique_ptr<Graph> Graph::from_json(const std::string& j_str, std::string& e
     }
 
     // --- Connections ---
-    for (auto& jc : j.value("connections", json::array())) {
-        g->connections_.push_back({
-            jc.value("from_node", ""),
-            jc.value("from_port", ""),
-            jc.value("to_node",   ""),
-            jc.value("to_port",   ""),
-        });
+    for (auto& jc : j.value("connections", json::array()))
+        g->connections_.push_back(connection_from_json(jc));
+
+    if (!routes_from_json(j, *g, g->output_routes_, err)) return nullptr;
+
+    return g;
+}
+
+// ---------------------------------------------------------------------------
+// Graph::patched
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<Graph> Graph::patched(const std::string& patch_str, std::string& err) const {
+    if (!activated_) { err = "graph is not active"; return nullptr; }
+
+    json patch;
+    try { patch = json::parse(patch_str); }
+    catch (const std::exception& e) {
+        err = std::string("JSON parse error: ") + e.what();
+        return nullptr;
     }
 
+    // --- Connections and nodes of the successor ---
+    std::vector<Connection> connections = connections_;
+    for (auto& jc : patch.value("remove_connections", json::array())) {
+        Connection c = connection_from_json(jc);
+        auto it = std::find_if(connections.begin(), connections.end(),
+            [&](const Connection& x) { return same_connection(x, c); });
+        if (it == connections.end()) {
+            err = "no connection " + c.from_node + "." + c.from_port +
+                  " -> " + c.to_node + "." + c.to_port;
+            return nullptr;
+        }
+        connections.erase(it);
+    }
+
+    std::unordered_set<std::string> removed;
+    for (auto& jid : patch.value("remove_nodes", json::array())) {
+        std::string id = jid.is_string() ? jid.get<std::string>() : std::string();
+        if (!node_index_.count(id)) { err = "unknown node '" + id + "'"; return nullptr; }
+        removed.insert(id);
+    }
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+        [&](const Connection& c) { return removed.count(c.from_node) || removed.count(c.to_node); }),
+        connections.end());
+
+    auto g = std::make_unique<Graph>();
+    for (auto& entry : nodes_) {
+        if (removed.count(entry.node->id)) continue;
+        NodeEntry shared;
+        shared.node  = entry.node;
+        shared.ports = entry.ports;
+        g->node_index_[entry.node->id] = static_cast<int>(g->nodes_.size());
+        g->nodes_.push_back(std::move(shared));
+    }
+    const size_t n_shared = g->nodes_.size();
+
+    for (auto& jn : patch.value("add_nodes", json::array())) {
+        NodeDesc desc;
+        std::string id = jn.value("id", "");
+        if (g->node_index_.count(id)) { err = "node '" + id + "' already exists"; return nullptr; }
+        auto node = node_from_json(jn, desc, err);
+        if (!node) return nullptr;
+
+        NodeEntry entry;
+        entry.node        = std::move(node);
+        entry.ports       = entry.node->declare_ports();
+        entry.init_params = desc.params;
+        g->node_index_[desc.id] = static_cast<int>(g->nodes_.size());
+        g->nodes_.push_back(std::move(entry));
+    }
+
+    for (auto& jc : patch.value("add_connections", json::array())) {
+        Connection c = connection_from_json(jc);
+        if (!g->node_index_.count(c.from_node) || !g->node_index_.count(c.to_node)) {
+            err = "connection " + c.from_node + " -> " + c.to_node + " names an unknown node";
+            return nullptr;
+        }
+        connections.push_back(std::move(c));
+    }
+    g->connections_ = std::move(connections);
+    for (auto& r : output_routes_)
+        if (!removed.count(r.node)) g->output_routes_.push_back(r);
+
+    // --- Compile, activate only the new nodes ---
+    g->sample_rate_ = sample_rate_;
+    g->block_size_  = block_size_;
+    g->metering_    = metering_;
+    g->compile();
+
+    for (size_t i = n_shared; i < g->nodes_.size(); ++i) {
+        auto& entry = g->nodes_[i];
+        entry.node->activate(sample_rate_, block_size_);
+        for (auto& [k, v] : entry.init_params)
+            entry.node->set_param(k, v);
+    }
+
+    // New adapters are not running anywhere yet: flag their connected
+    // control inputs now.  Shared ones are rewired by commit_wiring().
+    for (auto& c : g->connections_) {
+        int ni = g->node_index_[c.to_node];
+        if (ni < static_cast<int>(n_shared)) continue;
+        if (auto* adapter = dynamic_cast<PluginAdapterNode*>(g->nodes_[ni].node.get()))
+            adapter->set_control_connected(c.to_port, true);
+    }
+
+    for (size_t i = 0; i < g->nodes_.size(); ++i) {
+        auto& entry = g->nodes_[i];
+        if (auto* src = dynamic_cast<TrackSourceNode*>(entry.node.get()))
+            g->pending_wiring_.downstream.emplace_back(src, g->downstream_of(entry.node->id));
+        auto* adapter = dynamic_cast<PluginAdapterNode*>(entry.node.get());
+        if (!adapter || i >= n_shared) continue;
+        for (auto& p : entry.ports) {
+            if (p.is_output || p.type != PortType::Control) continue;
+            bool connected = std::any_of(g->connections_.begin(), g->connections_.end(),
+                [&](const Connection& c) { return c.to_node == entry.node->id && c.to_port == p.name; });
+            g->pending_wiring_.control_connected.emplace_back(adapter, p.name, connected);
+        }
+    }
+    g->wiring_pending_.store(true, std::memory_order_release);
+
+    g->activated_ = true;
     return g;
 }
 
+void Graph::commit_wiring() {
+    if (!wiring_pending_.load(std::memory_order_acquire)) return;
+    for (auto& [src, downstream] : pending_wiring_.downstream) src->swap_downstream(downstream);
+    for (auto& [adapter, port, connected] : pending_wiring_.control_connected)
+        adapter->set_control_connected(port, connected);
+    wiring_pending_.store(false, std::memory_order_release);
+}
+
+uint64_t Graph::event_overflows() const {
+    uint64_t n = 0;
+    for (auto& entry : nodes_)
+        if (auto* adapter = dynamic_cast<const PluginAdapterNode*>(entry.node.get()))
+            n += adapter->events_dropped();
+    return n;
+}
+
+std::vector<std::pair<std::string, perf::LoadSummary>> Graph::node_loads() const {
+    std::vector<std::pair<std::string, perf::LoadSummary>> loads;
+    if (!step_loads_) return loads;
+    loads.reserve(plan_.size());
+    for (auto& step : plan_)
+        loads.emplace_back(step.node->id, step.load->summary());
+    return loads;
+}
+
+void Graph::reset_node_loads() {
+    for (auto& step : plan_)
+        if (step.load) step.load->reset();
+}
+
+std::vector<std::pair<std::string, size_t>> Graph::preview_queue_depths() const {
+    std::vector<std::pair<std::string, size_t>> depths;
+    for (auto& entry : nodes_)
+        if (auto* src = dynamic_cast<const TrackSourceNode*>(entry.node.get()))
+            depths.emplace_back(src->id, src->preview_pending());
+    return depths;
+}
+
+std::vector<Node*> Graph::downstream_of(const std::string& source_id) const {
+    std::vector<Node*> downstream;
+    for (auto& c : connections_) {
+        if (c.from_node != source_id) continue;
+        auto ni = node_index_.find(c.to_node);
+        if (ni == node_index_.end()) continue;
+        Node* dest = nodes_[ni->second].node.get();
+        // Avoid duplicates (multiple ports from same source → same dest)
+        if (std::find(downstream.begin(), downstream.end(), dest) == downstream.end())
+            downstream.push_back(dest);
+    }
+    return downstream;
+}
+
 // ---------------------------------------------------------------------------
 // Graph::~Graph
 // ---------------------------------------------------------------------------
@@ -118,17 +362,9 @@ Graph::~Graph() {
 // ---------------------------------------------------------------------------
 
 bool Graph::activate(float sample_rate, int max_block_size) {
-    block_size_ = max_block_size;
-
-    std::string err;
-    if (!topo_sort(err)) {
-        // topo_sort failure is non-fatal: fall back to declaration order
-        // (connections may still work for simple linear chains)
-        eval_order_.clear();
-        for (auto& e : nodes_) eval_order_.push_back(e.node->id);
-    }
-
-    assign_buffers();
+    sample_rate_ = sample_rate;
+    block_size_  = max_block_size;
+    compile();
 
     // Notify plugin adapters which of their control input ports have live
     // upstream connections.  This lets the adapter prefer the graph value over
@@ -154,28 +390,35 @@ bool Graph::activate(float sample_rate, int max_block_size) {
     // note events. This covers synth nodes AND NoteGateNodes.
     for (auto& entry : nodes_) {
         auto* src = dynamic_cast<TrackSourceNode*>(entry.node.get());
-        if (!src) continue;
-
-        std::vector<Node*> downstream;
-        for (auto& c : connections_) {
-            if (c.from_node != entry.node->id) continue;
-            auto ni = node_index_.find(c.to_node);
-            if (ni == node_index_.end()) continue;
-            Node* dest = nodes_[ni->second].node.get();
-            // Avoid duplicates (multiple ports from same source → same dest)
-            bool already = false;
-            for (auto* d : downstream) if (d == dest) { already = true; break; }
-            if (!already) downstream.push_back(dest);
-        }
-        src->set_downstream(std::move(downstream));
+        if (src) src->set_downstream(downstream_of(entry.node->id));
     }
 
     activated_ = true;
     return true;
 }
 
+void Graph::compile() {
+    std::string err;
+    if (!topo_sort(err)) {
+        // topo_sort failure is non-fatal: fall back to declaration order
+        // (connections may still work for simple linear chains)
+        eval_order_.clear();
+        for (auto& e : nodes_) eval_order_.push_back(e.node->id);
+    }
+
+    assign_buffers();
+    build_plan();
+    build_output_bindings();
+    build_taps();
+    build_dag();
+    build_param_table();
+}
+
 void Graph::deactivate() {
-    for (auto& entry : nodes_) entry.node->deactivate();
+    // A node still held by another graph (patched() shares them) is live
+    // there; whichever graph holds it last deactivates it.
+    for (auto& entry : nodes_)
+        if (entry.node.use_count() == 1) entry.node->deactivate();
     activated_ = false;
 }
 
@@ -225,9 +468,26 @@ bool Graph::topo_sort(std::string& err) {
 // ---------------------------------------------------------------------------
 
 void Graph::assign_buffers() {
-    // Count total buffers needed: one per output port across all nodes,
-    // plus a "null" buffer at index 0 for unconnected inputs.
-    int buf_count = 1; // 0 = silent/zero buffer
+    // Liveness over eval order: an output port's buffer is live from its
+    // producer's step to its last consumer's step, then goes back to a free
+    // list for later outputs.  Index 0 is the shared silent buffer for
+    // unconnected inputs.  Buffers are never recycled when they are:
+    //   - read before they are written (a self-connection, or a consumer
+    //     earlier in eval order), since such reads expect the previous
+    //     block's value;
+    //   - the mixer outputs, which are read after process().
+    // Control ports take a ControlSlot instead; slot 0 is the constant zero.
+    const int n_steps = static_cast<int>(eval_order_.size());
+    std::unordered_map<std::string, int> step_of;   // node id → eval position
+    for (int s = 0; s < n_steps; ++s) step_of[eval_order_[s]] = s;
+
+    struct OutPort {
+        int              step;
+        int              last_use;
+        bool             pinned;
+        std::vector<int> readers;   // consumer steps
+    };
+    std::unordered_map<std::string, OutPort> out_ports;  // "node_id/port_name"
 
     for (auto& entry : nodes_) {
         int in_count  = 0, out_count = 0;
@@ -238,34 +498,87 @@ void Graph::assign_buffers() {
         entry.output_buf_indices.assign(out_count, 0);
         entry.input_buf_indices.assign(in_count, 0);
 
-        for (auto& idx : entry.output_buf_indices) {
-            idx = buf_count++;
+        auto si = step_of.find(entry.node->id);
+        int step = si == step_of.end() ? -1 : si->second;
+        for (auto& p : entry.ports) {
+            if (!p.is_output || p.type == PortType::Control) continue;
+            bool graph_out = entry.node->id == "mixer" &&
+                             (p.name == "audio_out_L" || p.name == "audio_out_R");
+            out_ports[entry.node->id + "/" + p.name] = { step, step, graph_out || step < 0, {} };
         }
     }
+    for (auto& c : connections_) {
+        auto op = out_ports.find(c.from_node + "/" + c.from_port);
+        auto si = step_of.find(c.to_node);
+        if (op == out_ports.end() || si == step_of.end()) continue;
+        if (si->second <= op->second.step) op->second.pinned = true;
+        op->second.last_use = std::max(op->second.last_use, si->second);
+        op->second.readers.push_back(si->second);
+    }
 
-    pool_.allocate(buf_count, block_size_);
-
-    // Wire input buffers from connections
-    // Build port-name → buffer index map for outputs
+    // Walk eval order: allocate this step's outputs, then release every
+    // buffer whose last use is this step.
+    std::vector<std::vector<int>> users(1);        // buf_idx → steps touching its occupant
+    std::vector<int>      free_list;
+    std::vector<std::vector<int>> release_at(n_steps);
+    std::vector<std::pair<int, int>> reuse_deps;   // (earlier step, later step)
     std::unordered_map<std::string, int> port_buf; // "node_id/port_name" → buf_idx
+    std::unordered_map<std::string, int> port_slot;// "node_id/port_name" → control slot
+    int n_slots = 1;
 
-    for (auto& entry : nodes_) {
+    auto take_buffer = [&](const OutPort& op) {
+        int idx;
+        if (!op.pinned && !free_list.empty()) {
+            idx = free_list.back();
+            free_list.pop_back();
+            // Everything that touched the previous occupant must finish
+            // before this step overwrites it.
+            for (int u : users[idx]) reuse_deps.emplace_back(u, op.step);
+        } else {
+            idx = static_cast<int>(users.size());
+            users.emplace_back();
+        }
+        users[idx] = op.readers;
+        users[idx].push_back(op.step);
+        return idx;
+    };
+
+    auto allocate_outputs = [&](NodeEntry& entry) {
         int out_i = 0;
-        for (int pi = 0; pi < (int)entry.ports.size(); ++pi) {
-            auto& p = entry.ports[pi];
-            if (p.is_output) {
-                std::string key = entry.node->id + "/" + p.name;
-                port_buf[key] = entry.output_buf_indices[out_i++];
+        for (auto& p : entry.ports) {
+            if (!p.is_output) continue;
+            std::string key = entry.node->id + "/" + p.name;
+            if (p.type == PortType::Control) {
+                entry.output_buf_indices[out_i++] = n_slots;
+                port_slot[key] = n_slots++;
+                continue;
             }
+            const OutPort& op = out_ports[key];
+            int idx = take_buffer(op);
+            entry.output_buf_indices[out_i++] = idx;
+            port_buf[key] = idx;
+            if (!op.pinned) release_at[op.last_use].push_back(idx);
         }
+    };
+
+    for (int s = 0; s < n_steps; ++s) {
+        allocate_outputs(nodes_[node_index_[eval_order_[s]]]);
+        for (int idx : release_at[s]) free_list.push_back(idx);
     }
+    for (auto& entry : nodes_)   // not in eval order: pinned above
+        if (!step_of.count(entry.node->id)) allocate_outputs(entry);
+
+    pool_.allocate(static_cast<int>(users.size()), block_size_);
+    control_slots_.assign(n_slots, ControlSlot{});
 
-    // Assign input buffers from connections
+    // Assign input buffers from connections.  A control output only feeds
+    // control inputs and an audio output only audio inputs; a mismatched
+    // connection leaves the input on the silent buffer / zero slot.
     for (auto& c : connections_) {
         std::string src_key = c.from_node + "/" + c.from_port;
-        auto it = port_buf.find(src_key);
-        if (it == port_buf.end()) continue;
-        int src_buf = it->second;
+        auto bi = port_buf.find(src_key);
+        auto ci = port_slot.find(src_key);
+        if (bi == port_buf.end() && ci == port_slot.end()) continue;
 
         // Find to_node entry
         auto ni = node_index_.find(c.to_node);
@@ -276,13 +589,25 @@ void Graph::assign_buffers() {
         for (auto& p : to_entry.ports) {
             if (p.is_output) continue;
             if (p.name == c.to_port) {
-                to_entry.input_buf_indices[in_i] = src_buf;
+                bool control = p.type == PortType::Control;
+                if (control && ci != port_slot.end())
+                    to_entry.input_buf_indices[in_i] = ci->second;
+                else if (!control && bi != port_buf.end())
+                    to_entry.input_buf_indices[in_i] = bi->second;
                 break;
             }
             in_i++;
         }
     }
 
+    buffer_reuse_deps_.clear();
+    for (auto& [from, to] : reuse_deps) {
+        if (from == to) continue;
+        buffer_reuse_deps_.emplace_back(
+            nodes_[node_index_[eval_order_[from]]].node.get(),
+            nodes_[node_index_[eval_order_[to]]].node.get());
+    }
+
     // Cache mixer output pointers
     auto mixer_it = node_index_.find("mixer");
     if (mixer_it != node_index_.end()) {
@@ -301,86 +626,416 @@ void Graph::assign_buffers() {
 }
 
 // ---------------------------------------------------------------------------
-// Graph::process
+// Graph::build_plan
 // ---------------------------------------------------------------------------
 
-void Graph::process(const ProcessContext& ctx) {
-    if (!activated_) return;
-
-    // Zero the null buffer (index 0)
-    std::memset(pool_.get(0), 0, ctx.block_size * sizeof(float));
+void Graph::build_plan() {
+    plan_.clear();
+    plan_.reserve(eval_order_.size());
 
     for (auto& node_id : eval_order_) {
         auto ni = node_index_.find(node_id);
         if (ni == node_index_.end()) continue;
         auto& entry = nodes_[ni->second];
 
-        // Build PortBuffer vectors for this node
-        std::vector<PortBuffer> inputs, outputs;
+        ExecStep step;
+        step.node        = entry.node.get();
+        step.adapter     = dynamic_cast<PluginAdapterNode*>(step.node);
+        step.kind        = step.adapter ? StepKind::PluginAdapter : StepKind::Native;
 
         int in_i = 0, out_i = 0;
         for (auto& p : entry.ports) {
             PortBuffer pb;
             pb.type = p.type;
-            if (p.is_output) {
-                pb.audio = pool_.get(entry.output_buf_indices[out_i++]);
-                // For control outputs, pre-read the pool slot into .control
-                // so nodes that write .control get a clean slate (0.0f).
-                if (p.type == PortType::Control)
-                    pb.control = 0.0f;
-                outputs.push_back(pb);
+            int idx = p.is_output ? entry.output_buf_indices[out_i++]
+                                  : entry.input_buf_indices[in_i++];
+            auto& ports = p.is_output ? step.outputs : step.inputs;
+            if (p.type == PortType::Control) {
+                // Control inputs read the upstream node's slot (written back
+                // after its process()); no pool buffer behind them.
+                auto& links = p.is_output ? step.control_outputs : step.control_inputs;
+                links.push_back({static_cast<int>(ports.size()), &control_slots_[idx]});
             } else {
-                int buf_idx = entry.input_buf_indices[in_i++];
-                pb.audio = pool_.get(buf_idx);
-                // For control inputs, load the upstream value from pool[0].
-                // The upstream node's process() wrote its .control value back
-                // into the pool buffer below.
-                if (p.type == PortType::Control)
-                    pb.control = pool_.get(buf_idx)[0];
-                inputs.push_back(pb);
+                pb.audio         = pool_.get(idx);
+                pb.silent_frames = pool_.silent_frames(idx);
             }
+            ports.push_back(pb);
         }
 
-        entry.node->process(ctx, inputs, outputs);
+        // Event routing table: output port index → destinations.
+        if (step.adapter) {
+            for (auto& out : step.adapter->event_outputs()) {
+                std::vector<EventRoute> routes;
+                for (auto& c : connections_) {
+                    if (c.from_node != node_id || c.from_port != out.first) continue;
+                    auto dest_it = node_index_.find(c.to_node);
+                    if (dest_it == node_index_.end()) continue;
+                    EventRoute r;
+                    r.dest         = nodes_[dest_it->second].node.get();
+                    r.dest_adapter = dynamic_cast<PluginAdapterNode*>(r.dest);
+                    if (r.dest_adapter)
+                        r.dest_port = r.dest_adapter->event_input_index(c.to_port);
+                    routes.push_back(r);
+                }
+                step.event_routes.push_back(std::move(routes));
+            }
+        }
+
+        bool audio_out = false;
+        for (auto& out : step.outputs) audio_out |= out.type == PortType::AudioMono;
+        step.bypassable = audio_out && step.control_outputs.empty() &&
+                          (!step.adapter || step.adapter->event_outputs().empty());
+
+        plan_.push_back(std::move(step));
+    }
 
-        // Write control output values back into their pool buffers so that
-        // downstream nodes can read them via pool[buf_idx][0] above.
-        out_i = 0;
+    if (perf::enabled) {
+        step_loads_ = std::make_unique<perf::LoadHistogram[]>(plan_.size());
+        for (size_t i = 0; i < plan_.size(); ++i) plan_[i].load = &step_loads_[i];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Graph::build_output_bindings
+// ---------------------------------------------------------------------------
+
+void Graph::build_output_bindings() {
+    output_bindings_.clear();
+
+    std::unordered_map<const Node*, ExecStep*> step_of;
+    for (auto& step : plan_) step_of[step.node] = &step;
+
+    // The PortBuffer of (node, port) in its step, nullptr if unknown.
+    auto port_buffer = [&](const std::string& node_id, const std::string& port,
+                           bool output) -> PortBuffer* {
+        auto ni = node_index_.find(node_id);
+        if (ni == node_index_.end()) return nullptr;
+        auto& entry = nodes_[ni->second];
+        auto  si    = step_of.find(entry.node.get());
+        if (si == step_of.end()) return nullptr;
+        int i = 0;
         for (auto& p : entry.ports) {
-            if (!p.is_output) continue;
-            if (p.type == PortType::Control)
-                pool_.get(entry.output_buf_indices[out_i])[0] = outputs[out_i].control;
-            out_i++;
+            if (p.is_output != output) continue;
+            if (p.name == port)
+                return p.type == PortType::AudioMono
+                        ? &(output ? si->second->outputs : si->second->inputs)[i] : nullptr;
+            ++i;
         }
+        return nullptr;
+    };
 
-        // --- Route event outputs from PluginAdapterNodes ---
-        // If this node produced events on output ports, forward them to
-        // connected downstream nodes via note_on/off/etc.
-        auto* adapter = dynamic_cast<PluginAdapterNode*>(entry.node.get());
-        if (adapter) {
-            for (auto& [port_id, events] : adapter->event_outputs()) {
-                if (events.empty()) continue;
-                // Find all connections from this node's event output port
-                for (auto& c : connections_) {
-                    if (c.from_node != node_id || c.from_port != port_id) continue;
-                    auto dest_it = node_index_.find(c.to_node);
-                    if (dest_it == node_index_.end()) continue;
-                    Node* dest = nodes_[dest_it->second].node.get();
-                    // Deliver events via the MIDI convenience interface
-                    for (auto& ev : events) {
-                        uint8_t type = ev.status & 0xF0;
-                        int ch = ev.channel;
-                        if (type == 0x90 && ev.data2 > 0) {
-                            dest->note_on(ch, ev.data1, ev.data2);
-                        } else if (type == 0x80 || (type == 0x90 && ev.data2 == 0)) {
-                            dest->note_off(ch, ev.data1);
-                        } else if (type == 0xE0) {
-                            dest->pitch_bend(ch, ev.data1 | (ev.data2 << 7));
-                        } else if (type == 0xC0) {
-                            dest->program_change(ch, 0, ev.data1);
-                        }
-                    }
+    auto bind = [&](const std::string& node_id, const std::string& port, int channel,
+                    float** master) {
+        PortBuffer* out = port_buffer(node_id, port, true);
+        if (!out) return;
+        OutputBinding b;
+        b.channel    = channel;
+        b.own        = out->audio;
+        b.own_silent = out->silent_frames;
+        b.master     = master;
+        b.ports.push_back(out);
+        for (auto& c : connections_)
+            if (c.from_node == node_id && c.from_port == port)
+                if (PortBuffer* in = port_buffer(c.to_node, c.to_port, false))
+                    b.ports.push_back(in);
+        output_bindings_.push_back(std::move(b));
+    };
+
+    if (output_L_ && output_R_) {
+        bind("mixer", "audio_out_L", 0, &output_L_);
+        bind("mixer", "audio_out_R", 1, &output_R_);
+    }
+    for (auto& r : output_routes_) bind(r.node, r.port, r.channel, nullptr);
+}
+
+bool Graph::writes_channel(int c) const {
+    for (auto& b : output_bindings_)
+        if (b.channel == c) return true;
+    return false;
+}
+
+void Graph::bind_outputs(float* const* channels, int count) {
+    for (auto& b : output_bindings_) {
+        float* ext  = b.channel < count ? channels[b.channel] : nullptr;
+        float* data = ext ? ext : b.own;
+        int*   flag = ext ? &b.silent : b.own_silent;
+        b.silent = 0;   // the caller's buffer holds anything
+        for (PortBuffer* p : b.ports) {
+            p->audio         = data;
+            p->silent_frames = flag;
+        }
+        if (b.master) *b.master = data;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Graph::build_taps
+// ---------------------------------------------------------------------------
+
+void Graph::build_taps() {
+    meters_.clear();
+    monitors_.clear();
+    if (!metering_) return;
+
+    auto feeding = [&](const std::string& node, const std::string& port) -> const Connection* {
+        for (auto& c : connections_)
+            if (c.to_node == node && c.to_port == port) return &c;
+        return nullptr;
+    };
+
+    for (auto& step : plan_) {
+        const auto& entry = nodes_[node_index_.at(step.node->id)];
+
+        // Mixer audio inputs come in L/R pairs in declaration order.
+        if (step.node->id == "mixer") {
+            std::vector<std::pair<int, const std::string*>> audio_in;   // input index, port
+            int in_i = 0;
+            for (auto& p : entry.ports) {
+                if (p.is_output) continue;
+                if (p.type == PortType::AudioMono) audio_in.emplace_back(in_i, &p.name);
+                ++in_i;
+            }
+            for (size_t k = 0; k + 1 < audio_in.size(); k += 2) {
+                const Connection* c = feeding("mixer", *audio_in[k].second);
+                if (!c) c = feeding("mixer", *audio_in[k + 1].second);
+                if (!c) continue;
+                std::string id = c->from_node;
+                for (auto& m : meters_)
+                    if (m.id == id) { id += "." + c->from_port; break; }
+                step.meter_taps.push_back({static_cast<int>(meters_.size()),
+                                           audio_in[k].first, audio_in[k + 1].first});
+                meters_.push_back({id});
+            }
+        }
+
+        if (step.adapter &&
+            step.adapter->plugin_descriptor().id == "builtin.control_monitor") {
+            int in_i = 0;
+            for (auto& p : entry.ports) {
+                if (p.is_output) continue;
+                if (p.name == "control_in") {
+                    step.monitor_taps.push_back({static_cast<int>(monitors_.size()), in_i});
+                    monitors_.push_back({step.node->id});
                 }
+                ++in_i;
+            }
+        }
+    }
+    if (output_L_ && output_R_) meters_.push_back({"master"});
+}
+
+static void measure(Graph::Meter& m, const float* L, const float* R, int n) {
+    float energy_L = 0.0f, energy_R = 0.0f;
+    dsp::peak_energy(L, n, m.peak_L, energy_L);
+    dsp::peak_energy(R, n, m.peak_R, energy_R);
+    m.rms_L = std::sqrt(energy_L / n);
+    m.rms_R = std::sqrt(energy_R / n);
+}
+
+// Deliver one event through the Node MIDI convenience interface (used for
+// destinations that are not PluginAdapterNodes).
+static void deliver_event(Node* dest, const MidiEvent& ev) {
+    uint8_t type = ev.status & 0xF0;
+    int ch = ev.channel;
+    dest->set_event_frame(ev.frame);
+    if (type == 0x90 && ev.data2 > 0) {
+        dest->note_on(ch, ev.data1, ev.data2);
+    } else if (type == 0x80 || (type == 0x90 && ev.data2 == 0)) {
+        dest->note_off(ch, ev.data1);
+    } else if (type == 0xE0) {
+        dest->pitch_bend(ch, ev.data1 | (ev.data2 << 7));
+    } else if (type == 0xC0) {
+        dest->program_change(ch, 0, ev.data1);
+    }
+    dest->set_event_frame(0);
+}
+
+// ---------------------------------------------------------------------------
+// Graph::build_dag
+// ---------------------------------------------------------------------------
+// Edges come from three sources:
+//   1. Every connection — the consumer reads the producer's pool buffer.
+//   2. Event fan-in — steps that push events into the same destination
+//      (TrackSourceNode forwarding notes, adapter event routes) mutate that
+//      destination's state, so they are chained to run one at a time.
+//   3. Buffer reuse — a step that takes over a recycled pool buffer waits
+//      for every step that wrote or read the previous occupant.
+//   4. Shared state — steps whose nodes report the same shared_state_key()
+//      are chained, so e.g. synths on one cached SoundFont run one at a time.
+// Each edge points from the earlier to the later step in plan_ order, which
+// keeps the DAG acyclic and reproduces the serial results exactly (including
+// the declaration-order fallback when topo_sort() found a cycle).
+
+void Graph::build_dag() {
+    const int n = static_cast<int>(plan_.size());
+
+    std::unordered_map<const Node*, int> step_of;
+    for (int i = 0; i < n; ++i) step_of[plan_[i].node] = i;
+    auto step_for_node = [&](const Node* node) -> int {
+        auto it = step_of.find(node);
+        return it == step_of.end() ? -1 : it->second;
+    };
+    auto step_for_id = [&](const std::string& id) {
+        return step_for_node(find_node(id));
+    };
+
+    std::vector<std::vector<int>> succ(n);
+    std::unordered_set<int64_t>   seen;
+    auto add_edge = [&](int a, int b) {
+        if (a < 0 || b < 0 || a == b) return;
+        if (a > b) std::swap(a, b);
+        if (seen.insert(static_cast<int64_t>(a) * n + b).second)
+            succ[a].push_back(b);
+    };
+
+    // Destination step → steps that deliver events to it (plan order).
+    std::unordered_map<int, std::vector<int>> senders;
+    auto add_sender = [&](int dest, int src) {
+        if (dest < 0) return;
+        auto& v = senders[dest];
+        if (v.empty() || v.back() != src) v.push_back(src);
+    };
+
+    for (auto& c : connections_) {
+        int from = step_for_id(c.from_node);
+        int to   = step_for_id(c.to_node);
+        add_edge(from, to);
+        if (from >= 0 && dynamic_cast<TrackSourceNode*>(plan_[from].node))
+            add_sender(to, from);
+    }
+    for (int i = 0; i < n; ++i) {
+        for (auto& routes : plan_[i].event_routes)
+            for (auto& r : routes) add_sender(step_for_node(r.dest), i);
+    }
+    for (auto& [dest, v] : senders) {
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+        for (size_t k = 1; k < v.size(); ++k) add_edge(v[k - 1], v[k]);
+    }
+
+    for (auto& [earlier, later] : buffer_reuse_deps_)
+        add_edge(step_for_node(earlier), step_for_node(later));
+
+    std::unordered_map<std::string, int> last_sharer;
+    for (int i = 0; i < n; ++i) {
+        std::string key = plan_[i].node->shared_state_key();
+        if (key.empty()) continue;
+        auto [it, first] = last_sharer.try_emplace(std::move(key), i);
+        if (!first) add_edge(std::exchange(it->second, i), i);
+    }
+
+    dag_ = TaskDag{};
+    dag_.dep_count.assign(n, 0);
+    dag_.succ_offsets.reserve(n + 1);
+    dag_.succ_offsets.push_back(0);
+    for (int i = 0; i < n; ++i) {
+        for (int s : succ[i]) {
+            dag_.succ.push_back(s);
+            dag_.dep_count[s]++;
+        }
+        dag_.succ_offsets.push_back(static_cast<int>(dag_.succ.size()));
+    }
+    for (int i = 0; i < n; ++i)
+        if (dag_.dep_count[i] == 0) dag_.roots.push_back(i);
+
+    dag_pending_ = std::make_unique<std::atomic<int>[]>(n);
+}
+
+// ---------------------------------------------------------------------------
+// Graph::process
+// ---------------------------------------------------------------------------
+
+void Graph::process(const ProcessContext& ctx) {
+    if (!activated_) return;
+
+    // Zero the null buffer (index 0)
+    std::memset(pool_.get(0), 0, ctx.block_size * sizeof(float));
+    *pool_.silent_frames(0) = ctx.block_size;
+    idle_steps_.store(0, std::memory_order_relaxed);
+
+    bool ran = false;
+    if (executor_ && plan_.size() > 1) {
+        run_ctx_ = &ctx;
+        ran = executor_->run(dag_, dag_pending_.get(), &Graph::run_step_task, this);
+        run_ctx_ = nullptr;
+        // Executor busy or plan too large — fall through to serial.
+    }
+    if (!ran)
+        for (auto& step : plan_) run_step(step, ctx);
+
+    if (metering_ && output_L_ && output_R_)
+        measure(meters_.back(), output_L_, output_R_, ctx.block_size);
+}
+
+void Graph::run_step_task(void* graph, int step_index) {
+    auto* self = static_cast<Graph*>(graph);
+    self->run_step(self->plan_[step_index], *self->run_ctx_);
+}
+
+void Graph::run_step(ExecStep& step, const ProcessContext& ctx) {
+    // Load control inputs from upstream slots; control outputs start from a
+    // clean slate (0.0f, no ramp) each block.
+    for (auto& cl : step.control_inputs) {
+        auto& in = step.inputs[cl.slot];
+        in.control     = cl.value->value;
+        in.ramp_from   = cl.value->ramp_from;
+        in.ramp_frames = cl.value->ramp_frames;
+    }
+    for (auto& cl : step.control_outputs) {
+        auto& out = step.outputs[cl.slot];
+        out.control     = 0.0f;
+        out.ramp_frames = 0;
+    }
+
+    // Idle node with silent inputs: its outputs are silence.  Zero them
+    // unless they already are, and skip process().
+    const int n = ctx.block_size;
+    bool skip = step.bypassable;
+    for (size_t i = 0; skip && i < step.inputs.size(); ++i)
+        skip = step.inputs[i].type != PortType::AudioMono || step.inputs[i].is_silent(n);
+    if (skip && step.node->idle()) {
+        for (auto& out : step.outputs) {
+            if (out.type != PortType::AudioMono || out.is_silent(n)) continue;
+            dsp::zero(out.audio, n);
+            out.set_silent(n);
+        }
+        idle_steps_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        for (auto& out : step.outputs)
+            if (out.type == PortType::AudioMono) out.set_silent(0);
+        AS_STATS(const uint64_t t0 = perf::now_ns();)
+        step.node->process(ctx, step.inputs, step.outputs);
+        AS_STATS(step.load->record(perf::now_ns() - t0);)
+    }
+
+    // Taps read the inputs this step just consumed, before any later step
+    // can recycle their buffers.
+    for (auto& t : step.meter_taps)
+        measure(meters_[t.meter], step.inputs[t.in_L].audio, step.inputs[t.in_R].audio,
+                ctx.block_size);
+    for (auto& t : step.monitor_taps)
+        monitors_[t.monitor].value = step.inputs[t.input].control;
+
+    // Write control output values back into their slots so that downstream
+    // nodes can read them via ControlLink::value above.
+    for (auto& cl : step.control_outputs) {
+        const auto& out = step.outputs[cl.slot];
+        *cl.value = { out.control, out.ramp_from, out.ramp_frames };
+    }
+
+    // --- Route event outputs from PluginAdapterNodes ---
+    // Forward anything this node emitted to the destinations resolved in
+    // build_plan(); adapter destinations receive the whole batch at once.
+    if (step.kind != StepKind::PluginAdapter) return;
+    auto& outs = step.adapter->event_outputs();
+    for (size_t oi = 0; oi < outs.size(); ++oi) {
+        auto& events = outs[oi].second;
+        if (events.empty()) continue;
+        for (auto& r : step.event_routes[oi]) {
+            if (r.dest_adapter) {
+                r.dest_adapter->deliver_events(r.dest_port, events.data(), events.size());
+            } else {
+                for (auto& ev : events) deliver_event(r.dest, ev);
             }
         }
     }
@@ -394,6 +1049,78 @@ void Graph::set_param(const std::string& nid, const std::string& param, float va
     if (n) n->set_param(param, val);
 }
 
+// ---------------------------------------------------------------------------
+// Parameter handles
+// ---------------------------------------------------------------------------
+
+uint32_t Graph::next_serial() {
+    static std::atomic<uint32_t> counter { 0 };
+    return ++counter;
+}
+
+static std::string param_key(const std::string& node_id, const std::string& param) {
+    return node_id + '\x1f' + param;
+}
+
+void Graph::build_param_table() {
+    std::lock_guard<std::mutex> lk(param_mutex_);
+    param_targets_.clear();
+    param_handles_.clear();
+    param_count_.store(0, std::memory_order_relaxed);
+
+    size_t port_count = 0;
+    for (auto& entry : nodes_)
+        for (auto& p : entry.ports)
+            if (!p.is_output && p.type == PortType::Control) port_count++;
+    param_targets_.reserve(port_count + MAX_DYNAMIC_PARAMS);
+
+    for (auto& entry : nodes_) {
+        for (auto& p : entry.ports) {
+            if (p.is_output || p.type != PortType::Control) continue;
+            param_handles_[param_key(entry.node->id, p.name)] =
+                static_cast<int>(param_targets_.size());
+            param_targets_.push_back({entry.node.get(), p.name,
+                                      entry.node->param_index(p.name)});
+        }
+    }
+    param_count_.store(static_cast<int>(param_targets_.size()), std::memory_order_release);
+}
+
+int Graph::param_handle(const std::string& nid, const std::string& param) {
+    std::lock_guard<std::mutex> lk(param_mutex_);
+    auto key = param_key(nid, param);
+    auto it = param_handles_.find(key);
+    if (it != param_handles_.end()) return it->second;
+
+    Node* node = find_node(nid);
+    if (!node) return -1;
+    int index = node->param_index(param);
+    if (index < 0) return -1;
+    if (param_targets_.size() == param_targets_.capacity()) return -1;
+
+    int handle = static_cast<int>(param_targets_.size());
+    param_targets_.push_back({node, param, index});
+    param_count_.store(handle + 1, std::memory_order_release);
+    param_handles_.emplace(std::move(key), handle);
+    return handle;
+}
+
+void Graph::set_param(int handle, float val) {
+    // The reserve keeps entries in place while param_handle() appends; the
+    // acquire on param_count_ makes entry `handle` visible once it counts.
+    if (handle < 0 || handle >= param_count_.load(std::memory_order_acquire)) return;
+    auto& t = param_targets_[handle];
+    if (t.index >= 0) t.node->set_param_index(t.index, val);
+}
+
+bool Graph::param_target(int handle, std::string& node_id, std::string& param) const {
+    std::lock_guard<std::mutex> lk(param_mutex_);
+    if (handle < 0 || handle >= static_cast<int>(param_targets_.size())) return false;
+    node_id = param_targets_[handle].node->id;
+    param   = param_targets_[handle].param;
+    return true;
+}
+
 Node* Graph::find_node(const std::string& id) const {
     auto it = node_index_.find(id);
     if (it == node_index_.end()) return nullptr;
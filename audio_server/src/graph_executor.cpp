@@ -0,0 +1,257 @@
+// graph_executor.cpp
+#include "graph_executor.h"
+#include "debug.h"
+#include "rt_check.h"
+
+#include <algorithm>
+
+#ifdef AS_PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Iterations a worker spins waiting for the next block before parking.
+// ~50-100 µs on current hardware — enough to ride out back-to-back blocks in
+// render_offline without a futex round-trip per block.
+static constexpr int SPIN_LIMIT = 20000;
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Pin a worker to a core and raise it to realtime priority so it is not
+// preempted by ordinary threads while the audio callback waits on it.
+static void configure_worker_thread(std::thread& t, int self) {
+#ifdef AS_PLATFORM_LINUX
+    unsigned ncpu = std::thread::hardware_concurrency();
+    if (ncpu > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(self % ncpu, &set);
+        if (pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) != 0)
+            AS_LOG("executor", "worker %d: could not set CPU affinity", self);
+    }
+
+    sched_param sp {};
+    int lo = sched_get_priority_min(SCHED_FIFO);
+    int hi = sched_get_priority_max(SCHED_FIFO);
+    sp.sched_priority = std::max(lo, hi - 20);
+    if (pthread_setschedparam(t.native_handle(), SCHED_FIFO, &sp) != 0)
+        AS_LOG("executor", "worker %d: SCHED_FIFO unavailable, using default policy", self);
+#else
+    (void)t; (void)self;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Deque (Chase-Lev, after Lê et al. 2013 "Correct and Efficient Work-Stealing
+// for Weak Memory Models")
+// ---------------------------------------------------------------------------
+
+static constexpr int64_t RING_MASK = GraphExecutor::MAX_TASKS - 1;
+static_assert((GraphExecutor::MAX_TASKS & RING_MASK) == 0, "MAX_TASKS must be a power of two");
+
+void GraphExecutor::Deque::init() {
+    ring = std::make_unique<std::atomic<int>[]>(MAX_TASKS);
+}
+
+void GraphExecutor::Deque::push(int task) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    ring[b & RING_MASK].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+bool GraphExecutor::Deque::pop(int& task) {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {                       // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    task = ring[b & RING_MASK].load(std::memory_order_relaxed);
+    if (t == b) {                      // last item — race thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool GraphExecutor::Deque::steal(int& task) {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) return false;
+    task = ring[t & RING_MASK].load(std::memory_order_relaxed);
+    return top.compare_exchange_strong(t, t + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed);
+}
+
+// ---------------------------------------------------------------------------
+// GraphExecutor
+// ---------------------------------------------------------------------------
+
+GraphExecutor::GraphExecutor(int worker_count) {
+    worker_count = std::max(0, worker_count);
+    deque_count_ = worker_count + 1;
+    deques_      = std::make_unique<Deque[]>(deque_count_);
+    for (int i = 0; i < deque_count_; ++i) deques_[i].init();
+
+    workers_.reserve(worker_count);
+    for (int w = 1; w <= worker_count; ++w) {
+        workers_.emplace_back(&GraphExecutor::worker_main, this, w);
+        configure_worker_thread(workers_.back(), w);
+    }
+    AS_LOG("executor", "started %d worker thread(s)", worker_count);
+}
+
+GraphExecutor::~GraphExecutor() {
+    quit_.store(true, std::memory_order_seq_cst);
+    wake_parked();
+    for (auto& t : workers_) t.join();
+}
+
+// A worker reads wake_seq_ after announcing itself in parked_ and before its
+// last look at generation_; run() bumps generation_, then reads parked_ and
+// bumps wake_seq_.  All seq_cst, so either the worker sees the new
+// generation or the wait finds wake_seq_ changed and returns at once.
+#ifdef __linux__
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+              std::atomic<uint32_t>::is_always_lock_free, "futex word must be a plain uint32_t");
+
+void GraphExecutor::park(uint32_t seq) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wake_seq_), FUTEX_WAIT_PRIVATE,
+            seq, nullptr, nullptr, 0);
+}
+
+void GraphExecutor::wake_parked() {
+    wake_seq_.fetch_add(1, std::memory_order_seq_cst);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wake_seq_), FUTEX_WAKE_PRIVATE,
+            INT_MAX, nullptr, nullptr, 0);
+}
+#else
+void GraphExecutor::park(uint32_t seq) {
+    std::unique_lock<std::mutex> lk(park_mutex_);
+    park_cv_.wait(lk, [&] { return wake_seq_.load(std::memory_order_seq_cst) != seq; });
+}
+
+void GraphExecutor::wake_parked() {
+    {
+        // Orders the bump after a parking worker's predicate check.
+        std::lock_guard<std::mutex> lk(park_mutex_);
+        wake_seq_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    park_cv_.notify_all();
+}
+#endif
+
+bool GraphExecutor::run(const TaskDag& dag, std::atomic<int>* pending,
+                        TaskFn fn, void* user)
+{
+    int n = dag.size();
+    if (n == 0) return true;
+    if (n > MAX_TASKS) return false;
+    if (busy_.exchange(true, std::memory_order_acquire)) return false;
+
+    dag_     = &dag;
+    pending_ = pending;
+    fn_      = fn;
+    user_    = user;
+    for (int i = 0; i < n; ++i)
+        pending[i].store(dag.dep_count[i], std::memory_order_relaxed);
+    remaining_.store(n, std::memory_order_release);
+
+    // Job fields above become visible to thieves through the push fence.
+    for (int r : dag.roots) deques_[0].push(r);
+
+    generation_.fetch_add(1, std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_seq_cst) > 0) wake_parked();
+
+    work(0);
+
+    // Join: wait for workers still finishing a steal attempt to leave the
+    // block so nothing touches the graph once process() returns.
+    while (active_.load(std::memory_order_acquire) > 0) cpu_relax();
+
+    busy_.store(false, std::memory_order_release);
+    return true;
+}
+
+void GraphExecutor::worker_main(int self) {
+    uint64_t seen = generation_.load(std::memory_order_acquire);
+
+    for (;;) {
+        uint64_t g;
+        int spins = 0;
+        while ((g = generation_.load(std::memory_order_acquire)) == seen &&
+               !quit_.load(std::memory_order_relaxed))
+        {
+            if (++spins < SPIN_LIMIT) { cpu_relax(); continue; }
+
+            parked_.fetch_add(1, std::memory_order_seq_cst);
+            const uint32_t seq = wake_seq_.load(std::memory_order_seq_cst);
+            if (generation_.load(std::memory_order_seq_cst) == seen &&
+                !quit_.load(std::memory_order_seq_cst))
+                park(seq);
+            parked_.fetch_sub(1, std::memory_order_relaxed);
+            spins = 0;
+        }
+        if (quit_.load(std::memory_order_acquire)) return;
+
+        seen = g;
+        active_.fetch_add(1, std::memory_order_acq_rel);
+        {
+            rtcheck::AudioThreadScope rt;   // running the audio thread's block
+            work(self);
+        }
+        active_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void GraphExecutor::work(int self) {
+    while (remaining_.load(std::memory_order_acquire) > 0) {
+        int task;
+        if (deques_[self].pop(task)) {
+            execute(self, task);
+            continue;
+        }
+        bool stolen = false;
+        for (int k = 1; k < deque_count_ && !stolen; ++k)
+            stolen = deques_[(self + k) % deque_count_].steal(task);
+        if (stolen) execute(self, task);
+        else        cpu_relax();
+    }
+}
+
+void GraphExecutor::execute(int self, int task) {
+    fn_(user_, task);
+
+    // Release successors.  Everything the task wrote happens-before the
+    // successor runs via the acq_rel decrement (and the deque push).
+    const TaskDag& dag = *dag_;
+    for (int i = dag.succ_offsets[task]; i < dag.succ_offsets[task + 1]; ++i) {
+        int s = dag.succ[i];
+        if (pending_[s].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            deques_[self].push(s);
+    }
+    remaining_.fetch_sub(1, std::memory_order_acq_rel);
+}
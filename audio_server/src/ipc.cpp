@@ -2,15 +2,23 @@
 #include "ipc.h"
 #include "protocol.h"
 
+#include <chrono>
 #include <cstring>
 #include <stdexcept>
 #include <iostream>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
 #ifdef AS_PLATFORM_WINDOWS
 #  include <windows.h>
 #else
 #  include <sys/socket.h>
 #  include <sys/un.h>
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <poll.h>
 #  include <unistd.h>
 #  include <errno.h>
 #  include <fcntl.h>
@@ -22,42 +30,265 @@
 
 static constexpr uint32_t MAX_MSG = protocol::MAX_MESSAGE_BYTES;
 
-// Little-endian 4-byte length prefix.
+// A server reply frame must be written within this long.  A client that
+// stops reading would otherwise hold the lane writing to it (the fast lane
+// is one thread); past the deadline the connection is closed instead.
+static constexpr int SEND_TIMEOUT_MS = 2000;
+
+// Little-endian 4-byte length prefix.  Bit 31 marks a binary frame:
+// [json_len][json][payload] follows instead of bare JSON.
+//
+// read_frame / write_frame are written against a pair of "move exactly n
+// bytes" callables so the Unix socket and Windows pipe paths share them.
+// Bodies are read straight into the destination strings/vectors.
+
+template <typename ReadAll>
+static std::string read_frame(ReadAll&& read_all, IpcMessage& out, uint32_t max_len) {
+    uint32_t prefix = 0;
+    if (!read_all(&prefix, 4)) return "read length failed";
+
+    out.binary = (prefix & protocol::BINARY_FRAME_FLAG) != 0;
+    uint32_t len = prefix & ~protocol::BINARY_FRAME_FLAG;
+    if (len == 0 || len > max_len) return "invalid length";
+
+    if (!out.binary) {
+        out.payload.clear();
+        out.json.resize(len);
+        if (!read_all(&out.json[0], len)) return "read body failed";
+        return {};
+    }
 
-#ifndef AS_PLATFORM_WINDOWS
+    uint32_t json_len = 0;
+    if (len < 4 || !read_all(&json_len, 4)) return "read header length failed";
+    if (json_len > len - 4) return "invalid header length";
+    out.json.resize(json_len);
+    out.payload.resize(len - 4 - json_len);
+    if (json_len && !read_all(&out.json[0], json_len)) return "read header failed";
+    if (!out.payload.empty() && !read_all(out.payload.data(), out.payload.size()))
+        return "read payload failed";
+    return {};
+}
 
-bool IpcServer::send_all(int fd, const void* buf, size_t len) {
-    const char* p = static_cast<const char*>(buf);
-    while (len > 0) {
-        ssize_t n = write(fd, p, len);
-        if (n <= 0) return false;
-        p   += n;
-        len -= n;
+template <typename WriteAll>
+static std::string write_frame(WriteAll&& write_all, const IpcMessage& msg, bool binary) {
+    if (!binary) {
+        uint32_t len = static_cast<uint32_t>(msg.json.size());
+        if (!write_all(&len, 4)) return "write length failed";
+        if (!write_all(msg.json.data(), len)) return "write body failed";
+        return {};
     }
-    return true;
+
+    uint64_t total = 4ull + msg.json.size() + msg.payload.size();
+    if (total > protocol::MAX_BINARY_FRAME_BYTES) return "frame too large";
+    uint32_t prefix   = static_cast<uint32_t>(total) | protocol::BINARY_FRAME_FLAG;
+    uint32_t json_len = static_cast<uint32_t>(msg.json.size());
+    if (!write_all(&prefix, 4))   return "write length failed";
+    if (!write_all(&json_len, 4)) return "write header length failed";
+    if (json_len && !write_all(msg.json.data(), json_len)) return "write header failed";
+    if (!msg.payload.empty() && !write_all(msg.payload.data(), msg.payload.size()))
+        return "write payload failed";
+    return {};
 }
 
-bool IpcServer::recv_all(int fd, void* buf, size_t len) {
-    char* p = static_cast<char*>(buf);
-    while (len > 0) {
-        ssize_t n = read(fd, p, len);
-        if (n <= 0) return false;
-        p   += n;
-        len -= n;
+// ---------------------------------------------------------------------------
+// IpcServer — connections and worker lanes (both platforms)
+// ---------------------------------------------------------------------------
+
+struct IpcServer::Job {
+    std::shared_ptr<Connection> conn;
+    IpcMessage                  msg;
+    IpcRoute                    route;
+};
+
+struct IpcServer::Connection {
+#ifdef AS_PLATFORM_WINDOWS
+    explicit Connection(HANDLE p) : pipe(p) {}
+    ~Connection() { DisconnectNamedPipe(pipe); CloseHandle(pipe); }
+    HANDLE pipe;
+#else
+    explicit Connection(int f) : fd(f) {}
+    ~Connection() { close(fd); }
+    int         fd;
+    std::string inbuf;               // reader thread only: bytes of a partial frame
+#endif
+    std::atomic<bool> open { true };
+    std::mutex        write_mutex;   // one frame at a time from any lane
+
+    // Guarded by Lanes::mutex.
+    std::deque<Job> waiting;
+    int             inflight         = 0;
+    bool            ordered_inflight = false;
+    bool            slow_inflight    = false;
+
+    // Write one whole frame; false once the peer is gone.
+    bool send(const IpcMessage& frame, bool binary);
+};
+
+struct IpcServer::Lanes {
+    std::mutex               mutex;
+    std::condition_variable  ready;
+    std::deque<Job>          fast, slow;
+    bool                     stopping = false;
+    std::vector<std::thread> threads;
+};
+
+void IpcServer::submit(const std::shared_ptr<Connection>& c, IpcMessage msg) {
+    IpcRoute route = router_ ? router_(msg) : IpcRoute{};
+    {
+        std::lock_guard<std::mutex> lk(lanes_->mutex);
+        c->waiting.push_back({c, std::move(msg), route});
+        release(*c);
+    }
+    lanes_->ready.notify_all();
+}
+
+void IpcServer::release(Connection& c) {
+    // An untagged request may not overtake, or be overtaken by, anything on
+    // its connection.  Tagged slow requests keep their order among
+    // themselves; tagged fast requests go straight through.
+    bool slow_waiting = false;
+    for (auto it = c.waiting.begin(); it != c.waiting.end() && !c.ordered_inflight; ) {
+        const IpcRoute r = it->route;
+        if (r.ordered) {
+            if (c.inflight > 0 || slow_waiting) break;
+        } else if (r.lane == IpcLane::Slow && (c.slow_inflight || slow_waiting)) {
+            slow_waiting = true;
+            ++it;
+            continue;
+        }
+        ++c.inflight;
+        c.ordered_inflight = r.ordered;
+        if (r.lane == IpcLane::Slow) c.slow_inflight = true;
+        (r.lane == IpcLane::Fast ? lanes_->fast : lanes_->slow).push_back(std::move(*it));
+        it = c.waiting.erase(it);
+    }
+}
+
+void IpcServer::drop(Connection& c) {
+    c.open.store(false);
+    std::deque<Job> dropped;   // destroyed outside the lock (they own c)
+    {
+        std::lock_guard<std::mutex> lk(lanes_->mutex);
+        dropped.swap(c.waiting);
     }
-    return true;
 }
 
+void IpcServer::run_lane(IpcLane lane) {
+    auto& queue = (lane == IpcLane::Fast) ? lanes_->fast : lanes_->slow;
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(lanes_->mutex);
+            lanes_->ready.wait(lk, [&] { return lanes_->stopping || !queue.empty(); });
+            if (lanes_->stopping) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        Connection& c = *job.conn;
+        const bool binary = job.msg.binary;
+        ReplyWriter write = [&c, binary](const IpcMessage& frame) {
+            return c.send(frame, binary);
+        };
+        write(handler_(job.msg, write));
+
+        {
+            std::lock_guard<std::mutex> lk(lanes_->mutex);
+            --c.inflight;
+            if (job.route.ordered)            c.ordered_inflight = false;
+            if (job.route.lane == IpcLane::Slow) c.slow_inflight = false;
+            release(c);
+        }
+        lanes_->ready.notify_all();
+    }
+}
+
+void IpcServer::start_lanes() {
+    lanes_ = std::make_unique<Lanes>();
+    lanes_->threads.emplace_back([this] { run_lane(IpcLane::Fast); });
+    for (int i = 0; i < slow_workers_; ++i)
+        lanes_->threads.emplace_back([this] { run_lane(IpcLane::Slow); });
+}
+
+void IpcServer::stop_lanes() {
+    if (!lanes_) return;
+    std::deque<Job> dropped;
+    {
+        std::lock_guard<std::mutex> lk(lanes_->mutex);
+        lanes_->stopping = true;
+        dropped.swap(lanes_->fast);
+        for (auto& j : lanes_->slow) dropped.push_back(std::move(j));
+        lanes_->slow.clear();
+    }
+    lanes_->ready.notify_all();
+    // A lane still inside the handler finishes that request first.
+    for (auto& t : lanes_->threads) t.join();
+    lanes_.reset();
+}
+
+std::string IpcServer::start(MessageHandler handler) {
+    return start(StreamingHandler([handler = std::move(handler)](const IpcMessage& req,
+                                                                 const ReplyWriter&) {
+        return handler(req);
+    }));
+}
+
+std::string IpcServer::start(RequestHandler handler) {
+    return start(MessageHandler([handler = std::move(handler)](const IpcMessage& req) {
+        IpcMessage resp;
+        resp.json = handler(req.json);
+        return resp;
+    }));
+}
+
+#ifndef AS_PLATFORM_WINDOWS
+
 // ---------------------------------------------------------------------------
 // IpcServer — Unix
 // ---------------------------------------------------------------------------
 
-IpcServer::IpcServer(const std::string& address) : address_(address) {}
+bool IpcServer::Connection::send(const IpcMessage& frame, bool binary) {
+    std::lock_guard<std::mutex> lk(write_mutex);
+    if (!open.load()) return false;
+    // The socket is non-blocking for the reader; wait out a full send
+    // buffer here, up to SEND_TIMEOUT_MS for the frame.  MSG_NOSIGNAL: a
+    // vanished client is an error, not SIGPIPE.
+    const auto deadline = std::chrono::steady_clock::now()
+                        + std::chrono::milliseconds(SEND_TIMEOUT_MS);
+    auto write_all = [this, deadline](const void* buf, size_t len) {
+        const char* p = static_cast<const char*>(buf);
+        while (len > 0) {
+            ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+                if (left <= 0) return false;
+                pollfd pfd { fd, POLLOUT, 0 };
+                if (poll(&pfd, 1, static_cast<int>(left)) < 0 && errno != EINTR) return false;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p   += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    };
+    if (write_frame(write_all, frame, binary).empty()) return true;
+    // A partial frame leaves the stream unusable: hang up, and the reader
+    // loop drops the connection when it sees the hangup.
+    open.store(false);
+    shutdown(fd, SHUT_RDWR);
+    return false;
+}
+
+IpcServer::IpcServer(const std::string& address, int slow_workers)
+    : address_(address), slow_workers_(slow_workers < 1 ? 1 : slow_workers) {}
 
 IpcServer::~IpcServer() { stop(); }
 
-std::string IpcServer::start(RequestHandler handler) {
-    server_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+std::string IpcServer::start(StreamingHandler handler, RequestRouter router) {
+    server_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (server_fd_ < 0) return "socket() failed";
 
     // Allow reuse of socket path
@@ -70,70 +301,125 @@ std::string IpcServer::start(RequestHandler handler) {
     if (bind(server_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
         return std::string("bind() failed: ") + strerror(errno);
 
-    if (listen(server_fd_, 1) < 0)
+    if (listen(server_fd_, SOMAXCONN) < 0)
         return std::string("listen() failed: ") + strerror(errno);
 
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) return std::string("eventfd() failed: ") + strerror(errno);
+
+    handler_ = std::move(handler);
+    router_  = std::move(router);
+    start_lanes();
     running_.store(true);
-    thread_ = std::thread([this, handler = std::move(handler)]() {
-        run_unix(std::move(handler));
-    });
+    thread_ = std::thread([this] { run_unix(); });
     return {};
 }
 
-void IpcServer::run_unix(RequestHandler handler) {
+void IpcServer::run_unix() {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        std::cerr << "[ipc] epoll_create1 failed: " << strerror(errno) << "\n";
+        return;
+    }
+    auto watch = [ep](int fd) {
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+        return epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) == 0;
+    };
+    watch(server_fd_);
+    watch(wake_fd_);
+
+    std::unordered_map<int, std::shared_ptr<Connection>> conns;
+    std::vector<char> chunk(64 * 1024);
+
+    // Read what the socket has; hand every complete frame to submit().
+    // false = closed, failed, or sent an invalid frame.
+    auto service = [&](const std::shared_ptr<Connection>& c) {
+        for (;;) {
+            ssize_t n = read(c->fd, chunk.data(), chunk.size());
+            if (n > 0) { c->inbuf.append(chunk.data(), static_cast<size_t>(n)); continue; }
+            if (n == 0) return false;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        size_t off = 0;
+        while (c->inbuf.size() - off >= 4) {
+            uint32_t prefix = 0;
+            std::memcpy(&prefix, c->inbuf.data() + off, 4);
+            const uint32_t len = prefix & ~protocol::BINARY_FRAME_FLAG;
+            if (len == 0 || len > MAX_MSG) return false;
+            if (c->inbuf.size() - off - 4 < len) break;
+
+            const char* p   = c->inbuf.data() + off;
+            size_t     left = 4 + size_t(len);
+            auto read_all = [&](void* dst, size_t k) {
+                if (k > left) return false;
+                std::memcpy(dst, p, k);
+                p += k; left -= k;
+                return true;
+            };
+            IpcMessage msg;
+            if (!read_frame(read_all, msg, MAX_MSG).empty()) return false;
+            off += 4 + size_t(len);
+            submit(c, std::move(msg));
+        }
+        c->inbuf.erase(0, off);
+        return true;
+    };
+
+    epoll_event events[32];
     while (running_.load()) {
-        // Set socket non-blocking for accept so we can check running_
-        fcntl(server_fd_, F_SETFL, O_NONBLOCK);
-
-        int client = -1;
-        while (running_.load()) {
-            client = accept(server_fd_, nullptr, nullptr);
-            if (client >= 0) break;
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                usleep(10000);  // 10ms poll
+        int n = epoll_wait(ep, events, 32, 100);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t v;
+                while (read(wake_fd_, &v, sizeof(v)) > 0) {}
                 continue;
             }
-            break;  // real error
-        }
-        if (client < 0) continue;
-        client_fd_ = client;
-
-        // Restore blocking mode for the client socket
-        int flags = fcntl(client_fd_, F_GETFL, 0);
-        fcntl(client_fd_, F_SETFL, flags & ~O_NONBLOCK);
-
-        // Serve this client until disconnect or stop
-        while (running_.load()) {
-            // Read 4-byte length prefix
-            uint32_t len_le = 0;
-            if (!recv_all(client_fd_, &len_le, 4)) break;
-
-            uint32_t len = len_le;  // already LE on x86
-            if (len == 0 || len > MAX_MSG) break;
-
-            std::string msg(len, '\0');
-            if (!recv_all(client_fd_, msg.data(), len)) break;
-
-            std::string response = handler(msg);
-
-            uint32_t resp_len = static_cast<uint32_t>(response.size());
-            if (!send_all(client_fd_, &resp_len, 4)) break;
-            if (!send_all(client_fd_, response.data(), resp_len)) break;
+            if (fd == server_fd_) {
+                int client;
+                while ((client = accept4(server_fd_, nullptr, nullptr,
+                                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    auto c = std::make_shared<Connection>(client);
+                    if (watch(client)) conns.emplace(client, std::move(c));
+                }
+                continue;
+            }
+            auto it = conns.find(fd);
+            if (it == conns.end()) continue;
+            if (!service(it->second)) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+                drop(*it->second);
+                conns.erase(it);   // fd closes once in-flight requests let go
+            }
         }
-
-        close(client_fd_);
-        client_fd_ = -1;
     }
+
+    for (auto& [fd, c] : conns) drop(*c);
+    close(ep);
 }
 
 void IpcServer::stop() {
     running_.store(false);
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        if (write(wake_fd_, &one, sizeof(one)) < 0) { /* loop still times out in 100 ms */ }
+    }
+    if (thread_.joinable()) thread_.join();
+    stop_lanes();
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
     if (server_fd_ >= 0) {
         close(server_fd_);
         server_fd_ = -1;
         unlink(address_.c_str());
     }
-    if (thread_.joinable()) thread_.join();
 }
 
 // ---------------------------------------------------------------------------
@@ -198,30 +484,132 @@ std::string IpcClient::send(const std::string& req, std::string& resp_out) {
     return {};
 }
 
+std::string IpcClient::send(const IpcMessage& req, IpcMessage& resp_out) {
+    auto read_all  = [this](void* p, size_t n)       { return recv_all(p, n); };
+    auto write_all = [this](const void* p, size_t n) { return send_all(p, n); };
+    std::string err = write_frame(write_all, req, true);
+    if (!err.empty()) return err;
+    return read_frame(read_all, resp_out, protocol::MAX_BINARY_FRAME_BYTES);
+}
+
+std::string IpcClient::receive(IpcMessage& frame_out) {
+    auto read_all = [this](void* p, size_t n) { return recv_all(p, n); };
+    return read_frame(read_all, frame_out, protocol::MAX_BINARY_FRAME_BYTES);
+}
+
+std::string IpcClient::post(const IpcMessage& req) {
+    auto write_all = [this](const void* p, size_t n) { return send_all(p, n); };
+    return write_frame(write_all, req, req.binary);
+}
+
 #else  // AS_PLATFORM_WINDOWS
 
 // ---------------------------------------------------------------------------
 // IpcServer — Windows Named Pipe
 // ---------------------------------------------------------------------------
 
-IpcServer::IpcServer(const std::string& address) : address_(address) {}
+IpcServer::IpcServer(const std::string& address, int slow_workers)
+    : address_(address), slow_workers_(slow_workers < 1 ? 1 : slow_workers) {}
+
 IpcServer::~IpcServer() { stop(); }
 
-std::string IpcServer::start(RequestHandler handler) {
+// Move exactly n bytes over a named pipe (ReadFile/WriteFile may be partial).
+static bool pipe_read_all(HANDLE pipe, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        DWORD got = 0;
+        if (!ReadFile(pipe, p, static_cast<DWORD>(len), &got, nullptr) || got == 0) return false;
+        p += got; len -= got;
+    }
+    return true;
+}
+
+static bool pipe_write_all(HANDLE pipe, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        DWORD written = 0;
+        if (!WriteFile(pipe, p, static_cast<DWORD>(len), &written, nullptr) || written == 0) return false;
+        p += written; len -= written;
+    }
+    return true;
+}
+
+// The server opens its pipe instances for overlapped I/O so a lane can
+// write a reply while the reader thread is blocked reading the next request
+// (synchronous handles serialise all I/O on the handle).  Gives up, and
+// cancels the transfer, once timeout_ms has passed.
+static bool overlapped_io(HANDLE pipe, bool writing, void* buf, size_t len,
+                          DWORD timeout_ms = INFINITE) {
+    const ULONGLONG deadline = GetTickCount64() + timeout_ms;
+    OVERLAPPED ov{};
+    ov.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    if (!ov.hEvent) return false;
+    char* p  = static_cast<char*>(buf);
+    bool  ok = true;
+    while (len > 0) {
+        DWORD n = 0;
+        ResetEvent(ov.hEvent);
+        BOOL r = writing ? WriteFile(pipe, p, static_cast<DWORD>(len), &n, &ov)
+                         : ReadFile (pipe, p, static_cast<DWORD>(len), &n, &ov);
+        if (!r && GetLastError() != ERROR_IO_PENDING) { ok = false; break; }
+        if (timeout_ms != INFINITE) {
+            ULONGLONG now = GetTickCount64();
+            DWORD left = now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+            if (WaitForSingleObject(ov.hEvent, left) != WAIT_OBJECT_0) {
+                CancelIoEx(pipe, &ov);
+                GetOverlappedResult(pipe, &ov, &n, TRUE);   // let the cancel land
+                ok = false;
+                break;
+            }
+        }
+        if (!GetOverlappedResult(pipe, &ov, &n, TRUE) || n == 0) { ok = false; break; }
+        p += n; len -= n;
+    }
+    CloseHandle(ov.hEvent);
+    return ok;
+}
+
+bool IpcServer::Connection::send(const IpcMessage& frame, bool binary) {
+    std::lock_guard<std::mutex> lk(write_mutex);
+    if (!open.load()) return false;
+    const ULONGLONG deadline = GetTickCount64() + SEND_TIMEOUT_MS;
+    auto write_all = [this, deadline](const void* p, size_t n) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) return false;
+        return overlapped_io(pipe, true, const_cast<void*>(p), n,
+                             static_cast<DWORD>(deadline - now));
+    };
+    if (write_frame(write_all, frame, binary).empty()) return true;
+    // As on Unix: disconnecting fails the reader's pending read, and it
+    // drops the connection.
+    open.store(false);
+    DisconnectNamedPipe(pipe);
+    return false;
+}
+
+std::string IpcServer::start(StreamingHandler handler, RequestRouter router) {
+    handler_ = std::move(handler);
+    router_  = std::move(router);
+    start_lanes();
     running_.store(true);
-    thread_ = std::thread([this, handler = std::move(handler)]() {
-        run_windows(std::move(handler));
-    });
+    thread_ = std::thread([this] { run_windows(); });
     return {};
 }
 
-void IpcServer::run_windows(RequestHandler handler) {
+void IpcServer::run_windows() {
+    struct Reader {
+        std::shared_ptr<Connection> conn;
+        std::thread                 thread;
+    };
+    std::vector<Reader> readers;
+    HANDLE connected = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
     while (running_.load()) {
         HANDLE pipe = CreateNamedPipeA(
             address_.c_str(),
-            PIPE_ACCESS_DUPLEX,
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
             PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-            1,        // max instances
+            PIPE_UNLIMITED_INSTANCES,
             65536,    // out buffer
             65536,    // in buffer
             0,        // default timeout
@@ -232,64 +620,56 @@ void IpcServer::run_windows(RequestHandler handler) {
             continue;
         }
 
-        // Wait for client connection
-        if (!ConnectNamedPipe(pipe, nullptr)) {
-            if (GetLastError() != ERROR_PIPE_CONNECTED) {
-                CloseHandle(pipe);
-                continue;
+        // Wait for a client, checking running_ every 100 ms.
+        OVERLAPPED ov{};
+        ResetEvent(connected);
+        ov.hEvent = connected;
+        bool ok = ConnectNamedPipe(pipe, &ov) != 0;
+        if (!ok) {
+            DWORD e = GetLastError();
+            if (e == ERROR_PIPE_CONNECTED) {
+                ok = true;
+            } else if (e == ERROR_IO_PENDING) {
+                while (running_.load() && WaitForSingleObject(connected, 100) == WAIT_TIMEOUT) {}
+                DWORD unused = 0;
+                if (!running_.load()) CancelIoEx(pipe, &ov);
+                ok = GetOverlappedResult(pipe, &ov, &unused, TRUE) != 0 && running_.load();
             }
         }
-        pipe_handle_ = pipe;
-
-        while (running_.load()) {
-            std::string msg;
-            std::string recv_err = read_message(pipe, msg);
-            if (!recv_err.empty()) break;
-
-            std::string response = handler(msg);
-            std::string send_err = send_response(pipe, response);
-            if (!send_err.empty()) break;
+        if (!ok) {
+            CloseHandle(pipe);
+            continue;
         }
 
-        DisconnectNamedPipe(pipe);
-        CloseHandle(pipe);
-        pipe_handle_ = nullptr;
+        auto c = std::make_shared<Connection>(pipe);
+        std::thread t([this, c] {
+            auto read_all = [&c](void* p, size_t n) { return overlapped_io(c->pipe, false, p, n); };
+            IpcMessage msg;
+            while (running_.load() && read_frame(read_all, msg, MAX_MSG).empty())
+                submit(c, std::move(msg));
+            drop(*c);
+        });
+        readers.push_back({std::move(c), std::move(t)});
+
+        // Reap readers whose client has gone.
+        for (auto it = readers.begin(); it != readers.end(); ) {
+            if (it->conn->open.load()) { ++it; continue; }
+            it->thread.join();
+            it = readers.erase(it);
+        }
     }
-}
 
-std::string IpcServer::read_message(void* handle, std::string& out) {
-    HANDLE pipe = static_cast<HANDLE>(handle);
-    uint32_t len = 0;
-    DWORD read = 0;
-    if (!ReadFile(pipe, &len, 4, &read, nullptr) || read != 4)
-        return "read length failed";
-    if (len == 0 || len > MAX_MSG) return "invalid length";
-    out.resize(len);
-    DWORD total = 0;
-    while (total < len) {
-        DWORD got = 0;
-        if (!ReadFile(pipe, out.data() + total, len - total, &got, nullptr)) return "read body failed";
-        total += got;
+    for (auto& r : readers) {
+        CancelIoEx(r.conn->pipe, nullptr);   // unblock a pending read
+        r.thread.join();
     }
-    return {};
-}
-
-std::string IpcServer::send_response(void* handle, const std::string& data) {
-    HANDLE pipe = static_cast<HANDLE>(handle);
-    uint32_t len = static_cast<uint32_t>(data.size());
-    DWORD written = 0;
-    if (!WriteFile(pipe, &len, 4, &written, nullptr)) return "write length failed";
-    if (!WriteFile(pipe, data.data(), len, &written, nullptr)) return "write body failed";
-    return {};
+    CloseHandle(connected);
 }
 
 void IpcServer::stop() {
     running_.store(false);
-    // Connect to ourselves to unblock ConnectNamedPipe
-    HANDLE h = CreateFileA(address_.c_str(), GENERIC_READ, 0, nullptr,
-                           OPEN_EXISTING, 0, nullptr);
-    if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
     if (thread_.joinable()) thread_.join();
+    stop_lanes();
 }
 
 // ---------------------------------------------------------------------------
@@ -341,4 +721,25 @@ std::string IpcClient::send(const std::string& req, std::string& resp_out) {
     return {};
 }
 
+std::string IpcClient::send(const IpcMessage& req, IpcMessage& resp_out) {
+    HANDLE pipe = static_cast<HANDLE>(pipe_handle_);
+    std::string err = write_frame(
+        [pipe](const void* p, size_t n) { return pipe_write_all(pipe, p, n); }, req, true);
+    if (!err.empty()) return err;
+    return read_frame([pipe](void* p, size_t n) { return pipe_read_all(pipe, p, n); },
+                      resp_out, protocol::MAX_BINARY_FRAME_BYTES);
+}
+
+std::string IpcClient::receive(IpcMessage& frame_out) {
+    HANDLE pipe = static_cast<HANDLE>(pipe_handle_);
+    return read_frame([pipe](void* p, size_t n) { return pipe_read_all(pipe, p, n); },
+                      frame_out, protocol::MAX_BINARY_FRAME_BYTES);
+}
+
+std::string IpcClient::post(const IpcMessage& req) {
+    HANDLE pipe = static_cast<HANDLE>(pipe_handle_);
+    return write_frame([pipe](const void* p, size_t n) { return pipe_write_all(pipe, p, n); },
+                       req, req.binary);
+}
+
 #endif // AS_PLATFORM_WINDOWS
@@ -0,0 +1,150 @@
+// jack_backend.cpp
+// Native JACK client: one output port per engine channel ("out_1", ...).
+// The process callback passes JACK's own port buffers to the engine, so
+// each channel is rendered in place — no scratch buffer, no interleave and
+// no buffering beyond the server's period.  PipeWire runs it unchanged
+// through its JACK library.
+//
+// Built with ENABLE_JACK.
+
+#include "audio_backend.h"
+#include <jack/jack.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace {
+
+class JackBackend final : public AudioBackend {
+public:
+    ~JackBackend() override { close(); }
+
+    const char* name() const override { return "jack"; }
+
+    std::string open(const AudioBackendConfig& cfg, Callback cb, void* user) override {
+        if (client_) return {};
+        cb_   = cb;
+        user_ = user;
+
+        jack_status_t status;
+        client_ = jack_client_open(cfg.client_name.c_str(), JackNoStartServer, &status);
+        if (!client_) return "JACK: cannot connect to server (status 0x" + hex(status) + ")";
+
+        // Plugins are activated at the engine rate; the server cannot be
+        // resampled behind their back.
+        const jack_nframes_t rate = jack_get_sample_rate(client_);
+        if (static_cast<float>(rate) != cfg.sample_rate) {
+            close();
+            return "JACK: server runs at " + std::to_string(rate) + " Hz, engine at " +
+                   std::to_string(static_cast<int>(cfg.sample_rate)) + " Hz";
+        }
+
+        for (int c = 0; c < cfg.output_channels; ++c) {
+            std::string port_name = "out_" + std::to_string(c + 1);
+            jack_port_t* port = jack_port_register(client_, port_name.c_str(),
+                                                   JACK_DEFAULT_AUDIO_TYPE,
+                                                   JackPortIsOutput, 0);
+            if (!port) {
+                close();
+                return "JACK: cannot register port " + port_name;
+            }
+            ports_.push_back(port);
+        }
+        buffers_.assign(ports_.size(), nullptr);
+
+        jack_set_process_callback(client_, &JackBackend::process, this);
+        jack_set_xrun_callback(client_, &JackBackend::xrun, this);
+        jack_set_latency_callback(client_, &JackBackend::latency, this);
+
+        if (jack_activate(client_) != 0) {
+            close();
+            return "JACK: cannot activate client";
+        }
+        active_ = true;
+        update_latency();
+
+        // Channel k goes to the k-th physical playback port, if there is one.
+        if (cfg.autoconnect) {
+            const char** playback = jack_get_ports(client_, nullptr, JACK_DEFAULT_AUDIO_TYPE,
+                                                   JackPortIsPhysical | JackPortIsInput);
+            if (playback) {
+                for (size_t k = 0; k < ports_.size() && playback[k]; ++k)
+                    jack_connect(client_, jack_port_name(ports_[k]), playback[k]);
+                jack_free(playback);
+            }
+        }
+        return {};
+    }
+
+    void close() override {
+        if (!client_) return;
+        if (active_) jack_deactivate(client_);   // process() has returned for good
+        active_ = false;
+        jack_client_close(client_);
+        client_ = nullptr;
+        ports_.clear();
+        buffers_.clear();
+    }
+
+private:
+    static int process(jack_nframes_t frames, void* arg) {
+        auto* self = static_cast<JackBackend*>(arg);
+        for (size_t k = 0; k < self->ports_.size(); ++k)
+            self->buffers_[k] = static_cast<float*>(jack_port_get_buffer(self->ports_[k], frames));
+
+        Period p;
+        p.outputs  = self->buffers_.data();
+        p.channels = static_cast<int>(self->buffers_.size());
+        p.frames   = static_cast<int>(frames);
+        if (self->xruns_.exchange(0, std::memory_order_relaxed) > 0)
+            p.status |= OutputUnderflow;
+        p.output_latency_s = self->latency_s_.load(std::memory_order_relaxed);
+
+        self->cb_(p, self->user_);
+        return 0;
+    }
+
+    // JACK notification thread.
+    static int xrun(void* arg) {
+        static_cast<JackBackend*>(arg)->xruns_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    static void latency(jack_latency_callback_mode_t mode, void* arg) {
+        if (mode == JackPlaybackLatency) static_cast<JackBackend*>(arg)->update_latency();
+    }
+
+    // Worst case over our ports, from the start of the period to the DAC.
+    void update_latency() {
+        jack_nframes_t worst = 0;
+        for (auto* port : ports_) {
+            jack_latency_range_t range;
+            jack_port_get_latency_range(port, JackPlaybackLatency, &range);
+            if (range.max > worst) worst = range.max;
+        }
+        latency_s_.store(static_cast<double>(worst) / jack_get_sample_rate(client_),
+                         std::memory_order_relaxed);
+    }
+
+    static std::string hex(unsigned v) {
+        static const char digits[] = "0123456789abcdef";
+        std::string s;
+        do { s.insert(s.begin(), digits[v & 15]); v >>= 4; } while (v);
+        return s;
+    }
+
+    jack_client_t*             client_ = nullptr;
+    bool                       active_ = false;
+    std::vector<jack_port_t*>  ports_;
+    std::vector<float*>        buffers_;   // this period's port buffers
+    std::atomic<int>           xruns_     { 0 };
+    std::atomic<double>        latency_s_ { 0.0 };
+    Callback                   cb_   = nullptr;
+    void*                      user_ = nullptr;
+};
+
+} // namespace
+
+std::unique_ptr<AudioBackend> make_jack_backend() {
+    return std::make_unique<JackBackend>();
+}
@@ -3,57 +3,59 @@
 //
 // Shared LilvWorld singleton
 // --------------------------
-// All LV2Node instances and list_lv2_plugins() share one LilvWorld loaded
-// once at first use and kept alive until lv2_world_release() is called at
-// shutdown. This avoids:
+// All LV2Node instances share one LilvWorld, kept alive while any node holds
+// it (lv2_world_acquire() / lv2_world_release() reference-count it).  This
+// avoids:
 //   - per-instance world construction cost
 //   - concurrent lilv/librdf init that triggers libgomp thread-pool races
 //     (TSan observed malloc/free collisions in libgomp when multiple worlds
 //      are constructed from different threads simultaneously)
 //
-// lv2_world_acquire() / lv2_world_release() use a reference-count so the
-// world is freed only after the last user is done. A mutex serialises
-// construction and destruction; once constructed the world is read-only
-// and requires no locking for queries.
+// The world is not populated with lilv_world_load_all(): it starts with the
+// LV2 core specification only, and lv2_world_load_plugin() loads a plugin's
+// bundle the first time a node asks for that plugin.  With hundreds of
+// bundles installed, building a graph parses the handful it uses.
+//
+// Descriptor cache
+// ----------------
+// list_lv2_plugins() answers from an index of every bundle on the LV2 path,
+// persisted to $XDG_CACHE_HOME/arranger/lv2_plugins.json and keyed by bundle
+// path and modification time (the newest of the bundle directory and its
+// top-level .ttl files).  A listing stats the bundles, parses only those
+// that are new or changed into a private world, and otherwise returns the
+// serialized array kept from the previous call.  The same index tells
+// lv2_world_load_plugin() which bundle holds a URI.
+//
+// s_mutex serialises everything here: world construction and destruction,
+// bundle loading and the index.  Queries on an acquired world need no lock;
+// the bundles loaded into it by graph builds are only ever added, and graph
+// builds are serialised by the engine.
 
 #ifdef AS_ENABLE_LV2
 
 #include "synth_node.h"
+#include "debug.h"
 #include "nlohmann/json.hpp"
 #include <lilv/lilv.h>
 #include <lv2/atom/atom.h>
 #include <lv2/midi/midi.h>
 #include <lv2/urid/urid.h>
-#include <string>
-#include <mutex>
-#include <atomic>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-// ---------------------------------------------------------------------------
-// Shared world singleton
-// ---------------------------------------------------------------------------
+namespace fs = std::filesystem;
+using json = nlohmann::json;
 
-static std::mutex        s_world_mutex;
-static LilvWorld*        s_world     = nullptr;
-static int               s_world_ref = 0;
-
-void* lv2_world_acquire() {
-    std::lock_guard<std::mutex> lk(s_world_mutex);
-    if (s_world_ref == 0) {
-        s_world = lilv_world_new();
-        lilv_world_load_all(s_world);
-    }
-    ++s_world_ref;
-    return s_world;
-}
-
-void lv2_world_release() {
-    std::lock_guard<std::mutex> lk(s_world_mutex);
-    if (--s_world_ref == 0) {
-        lilv_world_free(s_world);
-        s_world = nullptr;
-    }
-}
+static std::mutex s_mutex;
 
 // ---------------------------------------------------------------------------
 // Helpers
@@ -74,175 +76,461 @@ static float lilv_node_as_number(const LilvNode* n, float fallback) {
     return v;
 }
 
-// ---------------------------------------------------------------------------
-// list_lv2_plugins
-// ---------------------------------------------------------------------------
-// Returns a JSON array of installed LV2 plugins with full port metadata
-// including range, default, and UI hint properties (toggled, integer,
-// logarithmic, enumeration, scale points).
+// The directories lilv itself searches: LV2_PATH, else the platform default.
+static std::vector<fs::path> lv2_search_path() {
+#ifdef _WIN32
+    const char sep = ';';
+    std::string spec = "%APPDATA%\\LV2;%COMMONPROGRAMFILES%\\LV2";
+#elif defined(__APPLE__)
+    const char sep = ':';
+    std::string spec = "~/Library/Audio/Plug-Ins/LV2:~/.lv2:/usr/local/lib/lv2:"
+                       "/usr/lib/lv2:/Library/Audio/Plug-Ins/LV2";
+#else
+    const char sep = ':';
+    std::string spec = "~/.lv2:/usr/lib/lv2:/usr/local/lib/lv2";
+#endif
+    if (const char* env = std::getenv("LV2_PATH"); env && *env) spec = env;
+
+    std::vector<fs::path> dirs;
+    size_t from = 0;
+    while (from <= spec.size()) {
+        size_t to = spec.find(sep, from);
+        if (to == std::string::npos) to = spec.size();
+        std::string dir = spec.substr(from, to - from);
+        from = to + 1;
+        if (dir.empty()) continue;
+        if (dir[0] == '~') {
+            const char* home = std::getenv("HOME");
+            if (!home) continue;
+            dir = home + dir.substr(1);
+        }
+#ifdef _WIN32
+        // Expand a leading %VAR%, as in the default path.
+        if (dir[0] == '%') {
+            size_t end = dir.find('%', 1);
+            const char* v = end == std::string::npos ? nullptr
+                          : std::getenv(dir.substr(1, end - 1).c_str());
+            if (!v) continue;
+            dir = v + dir.substr(end + 1);
+        }
+#endif
+        dirs.emplace_back(dir);
+    }
+    return dirs;
+}
 
-std::string list_lv2_plugins(const std::string& uri_prefix) {
-    LilvWorld* world = static_cast<LilvWorld*>(lv2_world_acquire());
+// Bundle directories are identified by path with a trailing separator, the
+// form lilv's bundle URIs take.
+static std::string bundle_key(const fs::path& dir) {
+    std::string s = dir.lexically_normal().string();
+    if (s.empty() || (s.back() != '/' && s.back() != fs::path::preferred_separator))
+        s += fs::path::preferred_separator;
+    return s;
+}
 
-    const LilvPlugins* plugins = lilv_world_get_all_plugins(world);
+static int64_t stamp_of(const fs::file_time_type& t) {
+    return static_cast<int64_t>(t.time_since_epoch().count());
+}
 
-    LilvNode* audio_class   = lilv_new_uri(world, LILV_URI_AUDIO_PORT);
-    LilvNode* control_class = lilv_new_uri(world, LILV_URI_CONTROL_PORT);
-    LilvNode* input_class   = lilv_new_uri(world, LILV_URI_INPUT_PORT);
-    LilvNode* output_class  = lilv_new_uri(world, LILV_URI_OUTPUT_PORT);
-    LilvNode* atom_class    = lilv_new_uri(world, LV2_ATOM__AtomPort);
-    LilvNode* event_class   = lilv_new_uri(world, LILV_URI_EVENT_PORT);
+struct BundleStamp {
+    std::string path;
+    int64_t     mtime = 0;
+};
+
+// Every *.lv2 directory on the search path, in search order.
+static std::vector<BundleStamp> scan_bundles() {
+    std::vector<BundleStamp> out;
+    std::unordered_set<std::string> seen;
+    std::error_code ec;
+    for (auto& dir : lv2_search_path()) {
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->path().extension() != ".lv2" || !it->is_directory(ec)) continue;
+            BundleStamp b;
+            b.path = bundle_key(it->path());
+            if (!seen.insert(b.path).second) continue;   // first on the path wins
+            b.mtime = stamp_of(fs::last_write_time(it->path(), ec));
+            for (fs::directory_iterator f(it->path(), ec), fend; !ec && f != fend; f.increment(ec))
+                if (f->path().extension() == ".ttl")
+                    b.mtime = std::max(b.mtime, stamp_of(fs::last_write_time(f->path(), ec)));
+            ec.clear();
+            out.push_back(std::move(b));
+        }
+        ec.clear();
+    }
+    return out;
+}
 
-    // Port property URIs for UI hints
-    LilvNode* prop_toggled    = lilv_new_uri(world, LV2_CORE__toggled);
-    LilvNode* prop_integer    = lilv_new_uri(world, LV2_CORE__integer);
-    LilvNode* prop_logarithmic = lilv_new_uri(world, "http://lv2plug.in/ns/ext/port-props#logarithmic");
-    LilvNode* prop_enumeration = lilv_new_uri(world, LV2_CORE__enumeration);
+static LilvNode* bundle_uri(LilvWorld* world, const std::string& path) {
+    return lilv_new_file_uri(world, nullptr, path.c_str());
+}
 
+// A world holding the LV2 core specification (for plugin class labels) and
+// nothing else.  Caller holds s_mutex.
+static LilvWorld* new_world() {
+    LilvWorld* world = lilv_world_new();
+    for (auto& dir : lv2_search_path()) {
+        std::error_code ec;
+        fs::path core = dir / "lv2core.lv2";
+        if (!fs::is_directory(core, ec)) continue;
+        LilvNode* uri = bundle_uri(world, bundle_key(core));
+        lilv_world_load_bundle(world, uri);
+        lilv_node_free(uri);
+        break;
+    }
+    lilv_world_load_specifications(world);
+    lilv_world_load_plugin_classes(world);
+    return world;
+}
+
+// ---------------------------------------------------------------------------
+// Plugin description
+// ---------------------------------------------------------------------------
+// One list_lv2_plugins entry: full port metadata including range, default,
+// and UI hint properties (toggled, integer, logarithmic, enumeration, scale
+// points).
+
+namespace {
+
+struct DescribeUris {
+    LilvNode* audio_class;
+    LilvNode* control_class;
+    LilvNode* input_class;
+    LilvNode* output_class;
+    LilvNode* atom_class;
+    LilvNode* event_class;
+    // Port property URIs for UI hints
+    LilvNode* prop_toggled;
+    LilvNode* prop_integer;
+    LilvNode* prop_logarithmic;
+    LilvNode* prop_enumeration;
     // For detecting MIDI atom ports
-    LilvNode* atom_supports   = lilv_new_uri(world, LV2_ATOM__supports);
-    LilvNode* midi_event_uri  = lilv_new_uri(world, LV2_MIDI__MidiEvent);
-
-    nlohmann::json arr = nlohmann::json::array();
-
-    LILV_FOREACH(plugins, i, plugins) {
-        const LilvPlugin* p = lilv_plugins_get(plugins, i);
-
-        const LilvNode* uri_node = lilv_plugin_get_uri(p);
-        std::string uri = lilv_node_as_uri(uri_node);
-
-        if (!uri_prefix.empty() && uri.find(uri_prefix) != 0)
-            continue;
-
-        LilvNode* name_node = lilv_plugin_get_name(p);
-        std::string name = name_node ? lilv_node_as_string(name_node) : "";
-        lilv_node_free(name_node);
-
-        // Collect port descriptors
-        nlohmann::json ports_arr = nlohmann::json::array();
-        uint32_t n_ports = lilv_plugin_get_num_ports(p);
-        for (uint32_t pi = 0; pi < n_ports; ++pi) {
-            const LilvPort* port = lilv_plugin_get_port_by_index(p, pi);
-
-            const LilvNode* sym   = lilv_port_get_symbol(p, port);
-            LilvNode*       pname = lilv_port_get_name(p, port);
-
-            bool is_audio   = lilv_port_is_a(p, port, audio_class);
-            bool is_control = lilv_port_is_a(p, port, control_class);
-            bool is_input   = lilv_port_is_a(p, port, input_class);
-            bool is_output  = lilv_port_is_a(p, port, output_class);
-            bool is_atom    = lilv_port_is_a(p, port, atom_class);
-            bool is_event   = lilv_port_is_a(p, port, event_class);
-
-            std::string type_str;
-            if (is_audio)        type_str = "audio";
-            else if (is_control) type_str = "control";
-            else if (is_atom)    type_str = "atom";
-            else if (is_event)   type_str = "event";
-            else                 type_str = "other";
-
-            std::string dir_str  = is_input  ? "input"
-                                 : is_output ? "output"
-                                 :             "unknown";
-
-            nlohmann::json port_obj = {
-                {"symbol",    sym   ? lilv_node_as_string(sym)   : ""},
-                {"name",      pname ? lilv_node_as_string(pname) : ""},
-                {"type",      type_str},
-                {"direction", dir_str},
-            };
-
-            // For control ports, collect range and UI hints
-            if (is_control) {
-                LilvNode *def_n = nullptr, *min_n = nullptr, *max_n = nullptr;
-                lilv_port_get_range(p, port, &def_n, &min_n, &max_n);
-                float def_val = lilv_node_as_number(def_n, 0.0f);
-                float min_val = lilv_node_as_number(min_n, 0.0f);
-                float max_val = lilv_node_as_number(max_n, 1.0f);
-                lilv_node_free(def_n);
-                lilv_node_free(min_n);
-                lilv_node_free(max_n);
-
-                port_obj["default"] = def_val;
-                port_obj["min"]     = min_val;
-                port_obj["max"]     = max_val;
-
-                // UI property hints
-                if (lilv_port_has_property(p, port, prop_toggled))
-                    port_obj["is_toggle"] = true;
-                if (lilv_port_has_property(p, port, prop_integer))
-                    port_obj["is_integer"] = true;
-                if (lilv_port_has_property(p, port, prop_logarithmic))
-                    port_obj["is_logarithmic"] = true;
-                if (lilv_port_has_property(p, port, prop_enumeration))
-                    port_obj["is_enumeration"] = true;
-
-                // Scale points (named values for enums and discrete controls)
-                LilvScalePoints* sps = lilv_port_get_scale_points(p, port);
-                if (sps) {
-                    nlohmann::json sp_arr = nlohmann::json::array();
-                    LILV_FOREACH(scale_points, si, sps) {
-                        const LilvScalePoint* sp = lilv_scale_points_get(sps, si);
-                        const LilvNode* sp_val   = lilv_scale_point_get_value(sp);
-                        const LilvNode* sp_label = lilv_scale_point_get_label(sp);
-                        sp_arr.push_back({
-                            {"value", lilv_node_as_number(sp_val, 0.0f)},
-                            {"label", sp_label ? lilv_node_as_string(sp_label) : ""},
-                        });
-                    }
-                    lilv_scale_points_free(sps);
-                    if (!sp_arr.empty())
-                        port_obj["scale_points"] = sp_arr;
+    LilvNode* atom_supports;
+    LilvNode* midi_event_uri;
+
+    explicit DescribeUris(LilvWorld* world)
+        : audio_class     (lilv_new_uri(world, LILV_URI_AUDIO_PORT)),
+          control_class   (lilv_new_uri(world, LILV_URI_CONTROL_PORT)),
+          input_class     (lilv_new_uri(world, LILV_URI_INPUT_PORT)),
+          output_class    (lilv_new_uri(world, LILV_URI_OUTPUT_PORT)),
+          atom_class      (lilv_new_uri(world, LV2_ATOM__AtomPort)),
+          event_class     (lilv_new_uri(world, LILV_URI_EVENT_PORT)),
+          prop_toggled    (lilv_new_uri(world, LV2_CORE__toggled)),
+          prop_integer    (lilv_new_uri(world, LV2_CORE__integer)),
+          prop_logarithmic(lilv_new_uri(world, "http://lv2plug.in/ns/ext/port-props#logarithmic")),
+          prop_enumeration(lilv_new_uri(world, LV2_CORE__enumeration)),
+          atom_supports   (lilv_new_uri(world, LV2_ATOM__supports)),
+          midi_event_uri  (lilv_new_uri(world, LV2_MIDI__MidiEvent)) {}
+
+    ~DescribeUris() {
+        for (LilvNode* n : { audio_class, control_class, input_class, output_class,
+                             atom_class, event_class, prop_toggled, prop_integer,
+                             prop_logarithmic, prop_enumeration, atom_supports,
+                             midi_event_uri })
+            lilv_node_free(n);
+    }
+};
+
+json describe_plugin(const LilvPlugin* p, const DescribeUris& u) {
+    std::string uri = lilv_node_as_uri(lilv_plugin_get_uri(p));
+
+    LilvNode* name_node = lilv_plugin_get_name(p);
+    std::string name = name_node ? lilv_node_as_string(name_node) : "";
+    lilv_node_free(name_node);
+
+    // Collect port descriptors
+    json ports_arr = json::array();
+    uint32_t n_ports = lilv_plugin_get_num_ports(p);
+    for (uint32_t pi = 0; pi < n_ports; ++pi) {
+        const LilvPort* port = lilv_plugin_get_port_by_index(p, pi);
+
+        const LilvNode* sym   = lilv_port_get_symbol(p, port);
+        LilvNode*       pname = lilv_port_get_name(p, port);
+
+        bool is_audio   = lilv_port_is_a(p, port, u.audio_class);
+        bool is_control = lilv_port_is_a(p, port, u.control_class);
+        bool is_input   = lilv_port_is_a(p, port, u.input_class);
+        bool is_output  = lilv_port_is_a(p, port, u.output_class);
+        bool is_atom    = lilv_port_is_a(p, port, u.atom_class);
+        bool is_event   = lilv_port_is_a(p, port, u.event_class);
+
+        std::string type_str;
+        if (is_audio)        type_str = "audio";
+        else if (is_control) type_str = "control";
+        else if (is_atom)    type_str = "atom";
+        else if (is_event)   type_str = "event";
+        else                 type_str = "other";
+
+        std::string dir_str  = is_input  ? "input"
+                             : is_output ? "output"
+                             :             "unknown";
+
+        json port_obj = {
+            {"symbol",    sym   ? lilv_node_as_string(sym)   : ""},
+            {"name",      pname ? lilv_node_as_string(pname) : ""},
+            {"type",      type_str},
+            {"direction", dir_str},
+        };
+
+        // For control ports, collect range and UI hints
+        if (is_control) {
+            LilvNode *def_n = nullptr, *min_n = nullptr, *max_n = nullptr;
+            lilv_port_get_range(p, port, &def_n, &min_n, &max_n);
+            float def_val = lilv_node_as_number(def_n, 0.0f);
+            float min_val = lilv_node_as_number(min_n, 0.0f);
+            float max_val = lilv_node_as_number(max_n, 1.0f);
+            lilv_node_free(def_n);
+            lilv_node_free(min_n);
+            lilv_node_free(max_n);
+
+            port_obj["default"] = def_val;
+            port_obj["min"]     = min_val;
+            port_obj["max"]     = max_val;
+
+            // UI property hints
+            if (lilv_port_has_property(p, port, u.prop_toggled))
+                port_obj["is_toggle"] = true;
+            if (lilv_port_has_property(p, port, u.prop_integer))
+                port_obj["is_integer"] = true;
+            if (lilv_port_has_property(p, port, u.prop_logarithmic))
+                port_obj["is_logarithmic"] = true;
+            if (lilv_port_has_property(p, port, u.prop_enumeration))
+                port_obj["is_enumeration"] = true;
+
+            // Scale points (named values for enums and discrete controls)
+            LilvScalePoints* sps = lilv_port_get_scale_points(p, port);
+            if (sps) {
+                json sp_arr = json::array();
+                LILV_FOREACH(scale_points, si, sps) {
+                    const LilvScalePoint* sp = lilv_scale_points_get(sps, si);
+                    const LilvNode* sp_val   = lilv_scale_point_get_value(sp);
+                    const LilvNode* sp_label = lilv_scale_point_get_label(sp);
+                    sp_arr.push_back({
+                        {"value", lilv_node_as_number(sp_val, 0.0f)},
+                        {"label", sp_label ? lilv_node_as_string(sp_label) : ""},
+                    });
                 }
+                lilv_scale_points_free(sps);
+                if (!sp_arr.empty())
+                    port_obj["scale_points"] = sp_arr;
             }
+        }
 
-            // For atom/event ports, flag if they support MIDI
-            if (is_atom || is_event) {
-                // Check if port supports MIDI events
-                LilvNodes* supported = lilv_port_get_value(p, port, atom_supports);
-                if (supported) {
-                    LILV_FOREACH(nodes, ni, supported) {
-                        const LilvNode* sn = lilv_nodes_get(supported, ni);
-                        if (lilv_node_equals(sn, midi_event_uri)) {
-                            port_obj["supports_midi"] = true;
-                            break;
-                        }
+        // For atom/event ports, flag if they support MIDI
+        if (is_atom || is_event) {
+            LilvNodes* supported = lilv_port_get_value(p, port, u.atom_supports);
+            if (supported) {
+                LILV_FOREACH(nodes, ni, supported) {
+                    const LilvNode* sn = lilv_nodes_get(supported, ni);
+                    if (lilv_node_equals(sn, u.midi_event_uri)) {
+                        port_obj["supports_midi"] = true;
+                        break;
                     }
-                    lilv_nodes_free(supported);
                 }
+                lilv_nodes_free(supported);
             }
+        }
+
+        ports_arr.push_back(port_obj);
+        lilv_node_free(pname);
+    }
 
-            ports_arr.push_back(port_obj);
-            lilv_node_free(pname);
+    // Plugin class / category
+    const LilvPluginClass* cls       = lilv_plugin_get_class(p);
+    const LilvNode*        cls_label = cls ? lilv_plugin_class_get_label(cls) : nullptr;
+    std::string category = cls_label ? lilv_node_as_string(cls_label) : "Plugin";
+
+    return {
+        {"uri",      uri},
+        {"name",     name},
+        {"category", category},
+        {"ports",    ports_arr},
+    };
+}
+
+// ---------------------------------------------------------------------------
+// Descriptor cache
+// ---------------------------------------------------------------------------
+
+constexpr int CACHE_VERSION = 1;
+
+fs::path cache_file() {
+    fs::path base;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) base = xdg;
+    else if (const char* home = std::getenv("HOME"); home && *home) base = fs::path(home) / ".cache";
+    else return {};
+    return base / "arranger" / "lv2_plugins.json";
+}
+
+// {"version": 1, "bundles": {path: {"mtime": int, "plugins": [entry, ...]}}}
+json load_cache() {
+    json empty = {{"version", CACHE_VERSION}, {"bundles", json::object()}};
+    fs::path file = cache_file();
+    if (file.empty()) return empty;
+    std::ifstream in(file);
+    if (!in) return empty;
+    json j = json::parse(in, nullptr, false);
+    if (j.is_discarded() || j.value("version", 0) != CACHE_VERSION ||
+        !j.contains("bundles") || !j["bundles"].is_object())
+        return empty;
+    return j;
+}
+
+// Written to a temporary and renamed, so a concurrent server never reads a
+// half-written file.  A cache that cannot be written is only slower.
+void save_cache(const json& j) {
+    fs::path file = cache_file();
+    if (file.empty()) return;
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    fs::path tmp = file;
+    tmp += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return;
+        out << j.dump();
+        if (!out) { out.close(); fs::remove(tmp, ec); return; }
+    }
+    fs::rename(tmp, file, ec);
+    if (ec) fs::remove(tmp, ec);
+}
+
+struct Index {
+    bool                                         loaded = false;
+    json                                         cache;        // on-disk form
+    std::string                                  signature;    // stamps it was built from
+    std::unordered_map<std::string, std::string> bundle_of;    // plugin URI → bundle path
+    std::string                                  all_json;     // serialized, every plugin
+};
+
+Index s_index;
+
+// Bring s_index up to date with the bundles on disk.  Caller holds s_mutex.
+void refresh_index() {
+    auto stamps = scan_bundles();
+    std::string signature;
+    for (auto& b : stamps) signature += b.path + '@' + std::to_string(b.mtime) + '\n';
+    if (s_index.loaded && signature == s_index.signature) return;
+
+    if (!s_index.loaded) {
+        s_index.cache  = load_cache();
+        s_index.loaded = true;
+    }
+    json& cached = s_index.cache["bundles"];
+
+    json bundles = json::object();
+    std::vector<const BundleStamp*> stale;
+    for (auto& b : stamps) {
+        auto it = cached.find(b.path);
+        if (it != cached.end() && it->value("mtime", int64_t(-1)) == b.mtime)
+            bundles[b.path] = std::move(*it);
+        else
+            stale.push_back(&b);
+    }
+    bool changed = !stale.empty() || bundles.size() != cached.size();
+
+    // Parse only the new and changed bundles, in a world of their own.
+    if (!stale.empty()) {
+        AS_LOG("lv2", "descriptor cache: parsing %zu of %zu bundles", stale.size(), stamps.size());
+        for (auto* b : stale) bundles[b->path] = {{"mtime", b->mtime}, {"plugins", json::array()}};
+        LilvWorld* world = new_world();
+        for (auto* b : stale) {
+            LilvNode* uri = bundle_uri(world, b->path);
+            lilv_world_load_bundle(world, uri);
+            lilv_node_free(uri);
+        }
+        DescribeUris u(world);
+        const LilvPlugins* plugins = lilv_world_get_all_plugins(world);
+        LILV_FOREACH(plugins, i, plugins) {
+            const LilvPlugin* p = lilv_plugins_get(plugins, i);
+            char* path = lilv_file_uri_parse(lilv_node_as_uri(lilv_plugin_get_bundle_uri(p)), nullptr);
+            if (!path) continue;
+            auto it = bundles.find(bundle_key(path));
+            lilv_free(path);
+            if (it != bundles.end()) (*it)["plugins"].push_back(describe_plugin(p, u));
+        }
+        lilv_world_free(world);
+    }
+
+    s_index.cache["bundles"] = std::move(bundles);
+    if (changed) save_cache(s_index.cache);
+
+    // lilv lists plugins by URI; so does the merged index.
+    json all = json::array();
+    s_index.bundle_of.clear();
+    for (auto& [path, b] : s_index.cache["bundles"].items())
+        for (auto& entry : b["plugins"]) {
+            s_index.bundle_of[entry.value("uri", "")] = path;
+            all.push_back(entry);
         }
+    std::sort(all.begin(), all.end(), [](const json& a, const json& b) {
+        return a.value("uri", "") < b.value("uri", "");
+    });
+    s_index.all_json  = all.dump();
+    s_index.signature = std::move(signature);
+}
+
+// The world shared by LV2Nodes and the bundles loaded into it so far.
+LilvWorld*                      s_world     = nullptr;
+int                             s_world_ref = 0;
+std::unordered_set<std::string> s_loaded_bundles;
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Shared world
+// ---------------------------------------------------------------------------
+
+void* lv2_world_acquire() {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    if (s_world_ref == 0) {
+        s_world = new_world();
+        s_loaded_bundles.clear();
+    }
+    ++s_world_ref;
+    return s_world;
+}
+
+void lv2_world_release() {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    if (--s_world_ref == 0) {
+        lilv_world_free(s_world);
+        s_world = nullptr;
+        s_loaded_bundles.clear();
+    }
+}
 
-        // Plugin class / category
-        const LilvPluginClass* cls       = lilv_plugin_get_class(p);
-        const LilvNode*        cls_label = lilv_plugin_class_get_label(cls);
-        std::string category = cls_label ? lilv_node_as_string(cls_label) : "Plugin";
-
-        arr.push_back({
-            {"uri",      uri},
-            {"name",     name},
-            {"category", category},
-            {"ports",    ports_arr},
-        });
+const void* lv2_world_load_plugin(void* world_ptr, const std::string& uri) {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    auto* world = static_cast<LilvWorld*>(world_ptr);
+    LilvNode* uri_node = lilv_new_uri(world, uri.c_str());
+    const LilvPlugin* p = lilv_plugins_get_by_uri(lilv_world_get_all_plugins(world), uri_node);
+    if (!p) {
+        refresh_index();
+        auto it = s_index.bundle_of.find(uri);
+        if (it != s_index.bundle_of.end() && s_loaded_bundles.insert(it->second).second) {
+            AS_LOG("lv2", "loading bundle '%s' for '%s'", it->second.c_str(), uri.c_str());
+            LilvNode* bundle = bundle_uri(world, it->second);
+            lilv_world_load_bundle(world, bundle);
+            lilv_node_free(bundle);
+            p = lilv_plugins_get_by_uri(lilv_world_get_all_plugins(world), uri_node);
+        }
     }
+    lilv_node_free(uri_node);
+    return p;
+}
+
+// ---------------------------------------------------------------------------
+// list_lv2_plugins
+// ---------------------------------------------------------------------------
+
+std::string list_lv2_plugins(const std::string& uri_prefix) {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    refresh_index();
+    if (uri_prefix.empty()) return s_index.all_json;
 
-    lilv_node_free(audio_class);
-    lilv_node_free(control_class);
-    lilv_node_free(input_class);
-    lilv_node_free(output_class);
-    lilv_node_free(atom_class);
-    lilv_node_free(event_class);
-    lilv_node_free(prop_toggled);
-    lilv_node_free(prop_integer);
-    lilv_node_free(prop_logarithmic);
-    lilv_node_free(prop_enumeration);
-    lilv_node_free(atom_supports);
-    lilv_node_free(midi_event_uri);
-
-    lv2_world_release();
+    json arr = json::array();
+    for (auto& entry : json::parse(s_index.all_json))
+        if (entry.value("uri", "").rfind(uri_prefix, 0) == 0) arr.push_back(std::move(entry));
     return arr.dump();
 }
 
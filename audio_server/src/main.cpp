@@ -5,6 +5,10 @@
 //   audio_server [--address <socket_path_or_pipe_name>]
 //                [--sample-rate 44100]
 //                [--block-size 512]
+//                [--workers 0]       extra graph worker threads (0 = serial)
+//                [--render-workers 0] the same for offline renders
+//                [--backend portaudio] audio backend: portaudio | jack
+//                [--outputs 2]       device output channels (graph "outputs")
 
 #include "server_handler.h"
 #include "ipc.h"
@@ -26,12 +30,20 @@ int main(int argc, char** argv) {
     std::string address    = protocol::DEFAULT_ADDRESS;
     float       sample_rate = 44100.0f;
     int         block_size  = 512;
+    int         workers     = 0;
+    int         render_workers = 0;
+    std::string backend     = "portaudio";
+    int         outputs     = 2;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--address"     && i+1 < argc) address     = argv[++i];
         if (arg == "--sample-rate" && i+1 < argc) sample_rate = std::stof(argv[++i]);
         if (arg == "--block-size"  && i+1 < argc) block_size  = std::stoi(argv[++i]);
+        if (arg == "--workers"     && i+1 < argc) workers     = std::stoi(argv[++i]);
+        if (arg == "--render-workers" && i+1 < argc) render_workers = std::stoi(argv[++i]);
+        if (arg == "--backend"     && i+1 < argc) backend     = argv[++i];
+        if (arg == "--outputs"     && i+1 < argc) outputs     = std::stoi(argv[++i]);
     }
 
     register_builtin_plugins();
@@ -42,23 +54,32 @@ int main(int argc, char** argv) {
     AudioEngineConfig cfg;
     cfg.sample_rate = sample_rate;
     cfg.block_size  = block_size;
+    cfg.worker_threads = workers;
+    cfg.render_worker_threads = render_workers;
+    cfg.backend        = backend;
+    cfg.output_channels = outputs;
 
     ServerHandler handler(cfg);
 
     // Intercept the shutdown command here so ServerHandler stays process-agnostic.
+    // Requests run on the IPC lanes (see ipc.h), so the handler is called
+    // from several threads.
     IpcServer server(address);
-    std::string err = server.start([&](const std::string& req) -> std::string {
-        if (req.find("\"shutdown\"") != std::string::npos) {
+    std::string err = server.start([&](const IpcMessage& req,
+                                       const ReplyWriter& write) -> IpcMessage {
+        if (req.json.find("\"shutdown\"") != std::string::npos) {
             try {
-                auto j = nlohmann::json::parse(req);
+                auto j = nlohmann::json::parse(req.json);
                 if (j.value("cmd", "") == protocol::CMD_SHUTDOWN) {
                     g_shutdown.store(true);
-                    return nlohmann::json({{"status", "ok"}}).dump();
+                    IpcMessage resp;
+                    resp.json = nlohmann::json({{"status", "ok"}}).dump();
+                    return resp;
                 }
             } catch (...) {}
         }
-        return handler.handle(req);
-    });
+        return handler.handle_message(req, write);
+    }, &ServerHandler::route);
     if (!err.empty()) {
         std::cerr << "[audio_server] IPC start failed: " << err << "\n";
         return 1;
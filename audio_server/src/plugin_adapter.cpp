@@ -5,6 +5,7 @@
 #include "debug.h"
 #include <cstring>
 #include <algorithm>
+#include <climits>
 
 // ---------------------------------------------------------------------------
 // Construction
@@ -102,13 +103,18 @@ void PluginAdapterNode::build_port_mapping() {
         buffers_.events.entries.push_back({m.plugin_port_id, {}});
     }
 
-    // Pre-allocate event output storage
+    // Pre-allocate event input/output storage
+    event_input_storage_.clear();
     event_output_storage_.clear();
     for (auto& m : event_map_) {
         if (m.is_output) {
             event_output_storage_.push_back({m.plugin_port_id, {}});
+        } else {
+            event_input_storage_.emplace_back();
         }
     }
+    block_controls_.assign(control_map_.size(), {});
+    event_out_marks_.assign(event_output_storage_.size(), 0);
 }
 
 // ---------------------------------------------------------------------------
@@ -166,6 +172,22 @@ void PluginAdapterNode::activate(float sample_rate, int max_block_size) {
     AS_LOG("plugin", "PluginAdapterNode '%s' activate (sr=%.0f, bs=%d)",
            id.c_str(), sample_rate, max_block_size);
     plugin_->activate(sample_rate, max_block_size);
+    timed_calls_.clear();
+    timed_calls_.reserve(MAX_TIMED_CALLS);
+
+    // Carve every event list out of one allocation.
+    size_t n_lists = event_input_storage_.size() + event_output_storage_.size();
+    event_arena_ = n_lists ? std::make_unique<MidiEvent[]>(n_lists * EVENT_LIST_CAPACITY) : nullptr;
+    MidiEvent* next = event_arena_.get();
+    for (auto& in : event_input_storage_) {
+        in = MidiEventList(next, EVENT_LIST_CAPACITY);
+        next += EVENT_LIST_CAPACITY;
+    }
+    for (auto& out : event_output_storage_) {
+        out.second = MidiEventList(next, EVENT_LIST_CAPACITY);
+        next += EVENT_LIST_CAPACITY;
+    }
+    events_dropped_.store(0, std::memory_order_relaxed);
 }
 
 void PluginAdapterNode::deactivate() {
@@ -189,6 +211,7 @@ void PluginAdapterNode::process(
     pctx.bpm              = ctx.bpm;
     pctx.beat_position    = ctx.beat_position;
     pctx.beats_per_sample = ctx.beats_per_sample;
+    pctx.offline          = ctx.offline;
 
     // --- Wire buffers ---
     // We must walk the descriptor in the same order as declare_ports()
@@ -196,6 +219,8 @@ void PluginAdapterNode::process(
     // the PortDecl list into is_output=false and is_output=true sequences.
     int in_i = 0, out_i = 0;
     int audio_map_i = 0, ctrl_map_i = 0;
+    bool quiet = !woken_;
+    woken_ = false;
 
     for (auto& pd : desc_.ports) {
         bool is_out = (pd.role == PortRole::Output ||
@@ -208,10 +233,13 @@ void PluginAdapterNode::process(
             if (is_out) {
                 ab.left = outputs[out_i++].audio;
                 ab.right = nullptr;
+                ab.silent = false;
                 std::memset(ab.left, 0, ctx.block_size * sizeof(float));
             } else {
+                ab.silent = inputs[in_i].is_silent(ctx.block_size);
                 ab.left = const_cast<float*>(inputs[in_i++].audio);
                 ab.right = nullptr;
+                quiet &= ab.silent;
             }
             audio_map_i++;
             break;
@@ -222,23 +250,31 @@ void PluginAdapterNode::process(
             if (is_out) {
                 ab.left  = outputs[out_i++].audio;
                 ab.right = outputs[out_i++].audio;
+                ab.silent = false;
                 std::memset(ab.left,  0, ctx.block_size * sizeof(float));
                 std::memset(ab.right, 0, ctx.block_size * sizeof(float));
             } else {
+                ab.silent = inputs[in_i].is_silent(ctx.block_size) &&
+                            inputs[in_i + 1].is_silent(ctx.block_size);
                 ab.left  = const_cast<float*>(inputs[in_i++].audio);
                 ab.right = const_cast<float*>(inputs[in_i++].audio);
+                quiet &= ab.silent;
             }
             audio_map_i++;
             break;
         }
         case PluginPortType::Control: {
             auto& cb = buffers_.control.entries[ctrl_map_i].second;
+            cb.ramp_frames = 0;
             if (is_out) {
                 cb.value = 0.0f;
                 out_i++;  // reserve the output slot
             } else {
                 // Read from graph connection
-                cb.value = inputs[in_i++].control;
+                const auto& in = inputs[in_i++];
+                cb.value       = in.control;
+                cb.ramp_from   = in.ramp_from;
+                cb.ramp_frames = in.ramp_frames;
                 // Apply pending default/set_param value only when there is no
                 // live upstream connection.  If is_connected is true, the graph
                 // value wins — this is what lets an LFO (or any control source)
@@ -247,6 +283,7 @@ void PluginAdapterNode::process(
                     !control_map_[ctrl_map_i].is_connected) {
                     cb.value = control_map_[ctrl_map_i].pending_value->load(
                         std::memory_order_relaxed);
+                    cb.ramp_frames = 0;
                 }
             }
             ctrl_map_i++;
@@ -259,7 +296,7 @@ void PluginAdapterNode::process(
     }
 
     // --- Wire event buffers ---
-    int evt_out_i = 0;
+    int evt_out_i = 0, evt_in_i = 0;
     for (size_t i = 0; i < event_map_.size(); ++i) {
         auto& eb = buffers_.events.entries[i].second;
         if (event_map_[i].is_output) {
@@ -268,48 +305,206 @@ void PluginAdapterNode::process(
             eb.events = nullptr;
             evt_out_i++;
         } else {
-            eb.events = &event_input_accum_;
+            auto& in_events = event_input_storage_[evt_in_i++];
+            // Batches from several upstream nodes are appended in eval order;
+            // restore the "sorted by frame" guarantee of EventPortBuffer.
+            // Insertion sort: stable, in place (std::stable_sort may
+            // allocate), and near-linear on the already sorted batches.
+            for (size_t k = 1; k < in_events.size(); ++k) {
+                MidiEvent ev = in_events[k];
+                size_t j = k;
+                for (; j > 0 && in_events[j - 1].frame > ev.frame; --j)
+                    in_events[j] = in_events[j - 1];
+                in_events[j] = ev;
+            }
+            eb.events = &in_events;
             eb.output_events = nullptr;
         }
     }
 
+    quiet_frames_ = quiet ? std::min(quiet_frames_, INT_MAX - ctx.block_size) + ctx.block_size : 0;
+
     // --- Call plugin process ---
-    plugin_->process(pctx, buffers_);
+    // Silence reported for a whole-block call becomes the pool flag; a block
+    // run in segments is left flagged not silent.
+    bool whole_block = timed_calls_.empty();
+    if (whole_block) {
+        plugin_->process(pctx, buffers_);
+    } else {
+        // Render up to each timed call, make it, carry on.  Control outputs
+        // keep the last segment's values.
+        for (size_t i = 0; i < block_controls_.size(); ++i)
+            block_controls_[i] = buffers_.control.entries[i].second;
+        int pos = 0;
+        for (auto& c : timed_calls_) {
+            int frame = std::min(c.frame, ctx.block_size);
+            if (frame > pos) {
+                process_segment(pctx, pos, frame - pos);
+                pos = frame;
+            }
+            make_call(c);
+        }
+        timed_calls_.clear();
+        if (pos < ctx.block_size) process_segment(pctx, pos, ctx.block_size - pos);
+    }
 
     // --- Write back control output values ---
+    // control_map_ is in descriptor order, so its index advances with every
+    // control port, input or output.
     out_i = 0;
-    ctrl_map_i = 0;
+    ctrl_map_i = audio_map_i = 0;
     for (auto& pd : desc_.ports) {
         bool is_out = (pd.role == PortRole::Output ||
                        pd.role == PortRole::Monitor);
-        if (!is_out) continue;
 
         switch (pd.type) {
         case PluginPortType::AudioMono:
-            out_i++;
-            break;
-        case PluginPortType::AudioStereo:
-            out_i += 2;
+        case PluginPortType::AudioStereo: {
+            const auto& ab = buffers_.audio.entries[audio_map_i++].second;
+            if (!is_out) break;
+            int n = pd.type == PluginPortType::AudioStereo ? 2 : 1;
+            if (whole_block && ab.silent)
+                for (int k = 0; k < n; ++k) outputs[out_i + k].set_silent(ctx.block_size);
+            out_i += n;
             break;
-        case PluginPortType::Control: {
-            // Find which control_map_ entry this is
-            for (size_t ci = 0; ci < control_map_.size(); ++ci) {
-                if (control_map_[ci].plugin_port_id == pd.id) {
-                    outputs[out_i].control =
-                        buffers_.control.entries[ci].second.value;
-                    break;
-                }
+        }
+        case PluginPortType::Control:
+            if (is_out) {
+                const auto& cb = buffers_.control.entries[ctrl_map_i].second;
+                auto& out = outputs[out_i++];
+                out.control     = cb.value;
+                out.ramp_from   = cb.ramp_from;
+                out.ramp_frames = std::clamp(cb.ramp_frames, 0, ctx.block_size);
             }
-            out_i++;
+            ctrl_map_i++;
             break;
-        }
         case PluginPortType::Event:
             break;
         }
     }
 
-    // Clear input event accumulator for next block
-    event_input_accum_.clear();
+    // Clear input event storage for next block
+    uint64_t dropped = 0;
+    for (auto& in_events : event_input_storage_) {
+        dropped += in_events.take_dropped();
+        in_events.clear();
+    }
+    for (auto& out : event_output_storage_) dropped += out.second.take_dropped();
+    if (dropped) events_dropped_.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+bool PluginAdapterNode::idle() const {
+    if (woken_ || !timed_calls_.empty()) return false;
+    int tail = plugin_->tail_frames();
+    return tail >= 0 && quiet_frames_ >= tail;
+}
+
+void PluginAdapterNode::process_segment(const PluginProcessContext& block_ctx,
+                                        int offset, int frames)
+{
+    PluginProcessContext pctx = block_ctx;
+    pctx.block_size     = frames;
+    pctx.beat_position += offset * block_ctx.beats_per_sample;
+
+    for (auto& entry : buffers_.audio.entries) {
+        auto& ab = entry.second;
+        ab.left  += offset;
+        if (ab.right) ab.right += offset;
+        ab.frames = frames;
+    }
+    for (size_t i = 0; i < block_controls_.size(); ++i) {
+        if (control_map_[i].is_output) continue;
+        const auto& full = block_controls_[i];
+        auto& cb = buffers_.control.entries[i].second;
+        cb.value       = full.value;
+        cb.ramp_from   = full.at(offset);
+        cb.ramp_frames = std::max(0, full.ramp_frames - offset);
+    }
+    for (size_t i = 0; i < event_output_storage_.size(); ++i)
+        event_out_marks_[i] = event_output_storage_[i].second.size();
+
+    plugin_->process(pctx, buffers_);
+
+    // Segment-relative frames back to block frames.
+    for (size_t i = 0; i < event_output_storage_.size(); ++i) {
+        auto& out = event_output_storage_[i].second;
+        for (size_t k = event_out_marks_[i]; k < out.size(); ++k) out[k].frame += offset;
+    }
+    for (auto& entry : buffers_.audio.entries) {
+        auto& ab = entry.second;
+        ab.left  -= offset;
+        if (ab.right) ab.right -= offset;
+        ab.frames = block_ctx.block_size;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Event routing (from upstream PluginAdapterNode event outputs)
+// ---------------------------------------------------------------------------
+
+int PluginAdapterNode::event_input_index(const std::string& port_id) const {
+    int in_i = 0;
+    for (auto& m : event_map_) {
+        if (m.is_output) continue;
+        if (m.plugin_port_id == port_id) return in_i;
+        in_i++;
+    }
+    return -1;
+}
+
+void PluginAdapterNode::deliver_events(int port_index, const MidiEvent* events,
+                                       size_t count)
+{
+    if (port_index < 0) port_index = 0;
+    if (port_index < static_cast<int>(event_input_storage_.size())) {
+        event_input_storage_[port_index].append(events, count);
+    }
+    for (size_t i = 0; i < count; ++i) forward_to_plugin(events[i]);
+}
+
+void PluginAdapterNode::accumulate_event(const MidiEvent& ev) {
+    if (!event_input_storage_.empty())
+        event_input_storage_.front().push_back(ev);
+}
+
+void PluginAdapterNode::forward_to_plugin(const MidiEvent& ev) {
+    uint8_t type = ev.status & 0xF0;
+    int ch = ev.channel;
+    if (type == 0x90 && ev.data2 > 0) {
+        post_call(CallKind::NoteOn, ev.frame, ch, ev.data1, ev.data2);
+    } else if (type == 0x80 || (type == 0x90 && ev.data2 == 0)) {
+        post_call(CallKind::NoteOff, ev.frame, ch, ev.data1);
+    } else if (type == 0xE0) {
+        post_call(CallKind::Bend, ev.frame, ch, ev.data1 | (ev.data2 << 7));
+    } else if (type == 0xC0) {
+        post_call(CallKind::Program, ev.frame, ch, 0, ev.data1);
+    }
+}
+
+void PluginAdapterNode::post_call(CallKind kind, int frame, int channel, int a, int b) {
+    TimedCall c { frame, kind, channel, a, b };
+    woken_ = true;
+    // Plugins with event inputs get their timing from the EventPortBuffers;
+    // start-of-block calls with nothing pending need no split.
+    if (!event_input_storage_.empty() ||
+        (frame <= 0 && timed_calls_.empty()) ||
+        timed_calls_.size() >= timed_calls_.capacity()) {
+        make_call(c);
+        return;
+    }
+    auto at = std::upper_bound(timed_calls_.begin(), timed_calls_.end(), frame,
+        [](int f, const TimedCall& t) { return f < t.frame; });
+    timed_calls_.insert(at, c);
+}
+
+void PluginAdapterNode::make_call(const TimedCall& c) {
+    switch (c.kind) {
+    case CallKind::NoteOn:  plugin_->note_on(c.channel, c.a, c.b);        break;
+    case CallKind::NoteOff: plugin_->note_off(c.channel, c.a);            break;
+    case CallKind::Program: plugin_->program_change(c.channel, c.a, c.b); break;
+    case CallKind::Bend:    plugin_->pitch_bend(c.channel, c.a);          break;
+    case CallKind::Volume:  plugin_->channel_volume(c.channel, c.a);      break;
+    }
 }
 
 // ---------------------------------------------------------------------------
@@ -337,6 +532,21 @@ void PluginAdapterNode::set_param(const std::string& name, float value) {
            id.c_str(), name.c_str());
 }
 
+int PluginAdapterNode::param_index(const std::string& name) const {
+    for (size_t i = 0; i < control_map_.size(); ++i) {
+        if (control_map_[i].plugin_port_id == name && !control_map_[i].is_output)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void PluginAdapterNode::set_param_index(int index, float value) {
+    if (index < 0 || index >= static_cast<int>(control_map_.size())) return;
+    auto& m = control_map_[index];
+    m.pending_value->store(value, std::memory_order_relaxed);
+    m.has_pending = true;
+}
+
 // ---------------------------------------------------------------------------
 // MIDI events (from TrackSourceNode fan-out)
 // ---------------------------------------------------------------------------
@@ -347,51 +557,57 @@ void PluginAdapterNode::set_param(const std::string& name, float value) {
 void PluginAdapterNode::note_on(int channel, int pitch, int velocity) {
     // Accumulate for EventPortBuffer
     MidiEvent ev;
-    ev.frame   = 0;  // start of block (we don't have sub-block timing here)
+    ev.frame   = event_frame();
     ev.status  = 0x90 | (channel & 0x0F);
     ev.data1   = static_cast<uint8_t>(pitch);
     ev.data2   = static_cast<uint8_t>(velocity);
     ev.channel = static_cast<uint8_t>(channel);
-    event_input_accum_.push_back(ev);
+    accumulate_event(ev);
 
     // Also call the convenience method
-    plugin_->note_on(channel, pitch, velocity);
+    post_call(CallKind::NoteOn, ev.frame, channel, pitch, velocity);
 }
 
 void PluginAdapterNode::note_off(int channel, int pitch) {
     MidiEvent ev;
-    ev.frame   = 0;
+    ev.frame   = event_frame();
     ev.status  = 0x80 | (channel & 0x0F);
     ev.data1   = static_cast<uint8_t>(pitch);
     ev.data2   = 0;
     ev.channel = static_cast<uint8_t>(channel);
-    event_input_accum_.push_back(ev);
+    accumulate_event(ev);
 
-    plugin_->note_off(channel, pitch);
+    post_call(CallKind::NoteOff, ev.frame, channel, pitch);
 }
 
 void PluginAdapterNode::all_notes_off(int channel) {
+    // Pending notes are dropped; pending program/bend/volume calls still apply.
+    timed_calls_.erase(std::remove_if(timed_calls_.begin(), timed_calls_.end(),
+        [channel](const TimedCall& c) {
+            return (c.kind == CallKind::NoteOn || c.kind == CallKind::NoteOff) &&
+                   (channel == -1 || c.channel == channel);
+        }), timed_calls_.end());
     plugin_->all_notes_off(channel);
 }
 
 void PluginAdapterNode::program_change(int channel, int bank, int program) {
-    plugin_->program_change(channel, bank, program);
+    post_call(CallKind::Program, event_frame(), channel, bank, program);
 }
 
 void PluginAdapterNode::pitch_bend(int channel, int value) {
     MidiEvent ev;
-    ev.frame   = 0;
+    ev.frame   = event_frame();
     ev.status  = 0xE0 | (channel & 0x0F);
     ev.data1   = static_cast<uint8_t>(value & 0x7F);
     ev.data2   = static_cast<uint8_t>((value >> 7) & 0x7F);
     ev.channel = static_cast<uint8_t>(channel);
-    event_input_accum_.push_back(ev);
+    accumulate_event(ev);
 
-    plugin_->pitch_bend(channel, value);
+    post_call(CallKind::Bend, ev.frame, channel, value);
 }
 
 void PluginAdapterNode::channel_volume(int channel, int volume) {
-    plugin_->channel_volume(channel, volume);
+    post_call(CallKind::Volume, event_frame(), channel, volume);
 }
 
 void PluginAdapterNode::push_control(double beat, float normalized_value) {
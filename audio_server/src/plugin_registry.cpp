@@ -37,6 +37,28 @@ const EventPortBuffer* PluginBuffers::EventMap::get(const std::string& id) const
     return nullptr;
 }
 
+// ---------------------------------------------------------------------------
+// Port handles
+// ---------------------------------------------------------------------------
+// Must number ports exactly as PluginAdapterNode::build_port_mapping() fills
+// the maps: descriptor order, one counter per map.
+
+PortHandle find_port(const PluginDescriptor& desc, const std::string& id) {
+    int audio = 0, control = 0, event = 0;
+    for (auto& pd : desc.ports) {
+        int* counter = nullptr;
+        switch (pd.type) {
+            case PluginPortType::AudioMono:
+            case PluginPortType::AudioStereo: counter = &audio;   break;
+            case PluginPortType::Control:     counter = &control; break;
+            case PluginPortType::Event:       counter = &event;   break;
+        }
+        if (pd.id == id) return PortHandle{ *counter };
+        ++*counter;
+    }
+    return {};
+}
+
 // ---------------------------------------------------------------------------
 // Registry singleton
 // ---------------------------------------------------------------------------
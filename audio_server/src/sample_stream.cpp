@@ -0,0 +1,355 @@
+// sample_stream.cpp
+// Memory-mapped sample files and the prefetch thread that streams them.
+
+#include "sample_stream.h"
+#include "debug.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifdef AS_PLATFORM_WINDOWS
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  ifndef _WIN32_WINNT
+#    define _WIN32_WINNT 0x0602   // PrefetchVirtualMemory (Windows 8)
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// WAV parsing and decoding
+// ---------------------------------------------------------------------------
+
+namespace {
+
+enum Format { Int16, Int24, Int32, Float32 };
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+float sample_at(const uint8_t* p, int format) {
+    switch (format) {
+        case Int16: return static_cast<int16_t>(le16(p)) * (1.0f / 32768.0f);
+        case Int24: return static_cast<int32_t>(static_cast<uint32_t>(p[0]) << 8 |
+                                                static_cast<uint32_t>(p[1]) << 16 |
+                                                static_cast<uint32_t>(p[2]) << 24) *
+                           (1.0f / 2147483648.0f);
+        case Int32: return static_cast<int32_t>(le32(p)) * (1.0f / 2147483648.0f);
+        default: {
+            uint32_t bits = le32(p);
+            float f;
+            std::memcpy(&f, &bits, sizeof f);
+            return f;
+        }
+    }
+}
+
+} // namespace
+
+SampleFile::~SampleFile() {
+#ifdef AS_PLATFORM_WINDOWS
+    if (map_) UnmapViewOfFile(map_);
+#else
+    if (map_) munmap(const_cast<uint8_t*>(map_), map_size_);
+#endif
+}
+
+void SampleFile::decode(int64_t start, int n, float* out) const {
+    const int bytes = frame_bytes_ / channels_;
+    const uint8_t* p = data_ + start * frame_bytes_;
+    for (int i = 0; i < n; ++i, p += frame_bytes_) {
+        float l = sample_at(p, format_);
+        float r = channels_ > 1 ? sample_at(p + bytes, format_) : l;
+        out[2 * i]     = l;
+        out[2 * i + 1] = r;
+    }
+}
+
+static uintptr_t page_size() {
+#ifdef AS_PLATFORM_WINDOWS
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwPageSize;
+#else
+    return static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Advice is applied to whole pages: release() rounds inwards so pages still
+// partly wanted stay mapped, will_need() rounds outwards.
+void SampleFile::advise(int64_t start, int64_t n, bool drop) const {
+    if (n <= 0) return;
+    static const uintptr_t page = page_size();
+    const uintptr_t base  = reinterpret_cast<uintptr_t>(map_);
+    uintptr_t lo = reinterpret_cast<uintptr_t>(data_ + start * frame_bytes_);
+    uintptr_t hi = reinterpret_cast<uintptr_t>(data_ + (start + n) * frame_bytes_);
+    if (drop) {
+        lo = (lo + page - 1) & ~(page - 1);
+        hi &= ~(page - 1);
+    } else {
+        lo &= ~(page - 1);
+        hi = std::min((hi + page - 1) & ~(page - 1), base + map_size_);
+    }
+    if (lo >= hi) return;
+#ifdef AS_PLATFORM_WINDOWS
+    if (drop) {
+        // Unlocking pages that are not locked takes them out of the working
+        // set (and reports ERROR_NOT_LOCKED); the file still backs them.
+        VirtualUnlock(reinterpret_cast<void*>(lo), hi - lo);
+    } else {
+        WIN32_MEMORY_RANGE_ENTRY range { reinterpret_cast<void*>(lo), hi - lo };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    madvise(reinterpret_cast<void*>(lo), hi - lo, drop ? MADV_DONTNEED : MADV_WILLNEED);
+#endif
+}
+
+void SampleFile::will_need(int64_t start, int64_t n) const { advise(start, n, false); }
+void SampleFile::release(int64_t start, int64_t n) const   { advise(start, n, true); }
+
+// ---------------------------------------------------------------------------
+// SampleFileCache
+// ---------------------------------------------------------------------------
+
+namespace {
+
+std::mutex                                          g_files_mutex;
+std::unordered_map<std::string, std::weak_ptr<SampleFile>> g_files;
+
+// path + modification time, as for SoundFontCache: an edited file is
+// mapped afresh while nodes holding the old one keep it.
+std::string file_key(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return path;
+    return path + '@' + std::to_string(mtime.time_since_epoch().count());
+}
+
+} // namespace
+
+std::shared_ptr<SampleFile> SampleFileCache::acquire(const std::string& path,
+                                                     std::string& err) {
+    const std::string key = file_key(path);
+    std::lock_guard<std::mutex> lk(g_files_mutex);
+    for (auto it = g_files.begin(); it != g_files.end(); )
+        it = it->second.expired() ? g_files.erase(it) : std::next(it);
+    if (auto f = g_files[key].lock()) return f;
+
+#ifdef AS_PLATFORM_WINDOWS
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        err = "sampler: cannot open " + path + ": error " + std::to_string(GetLastError());
+        return nullptr;
+    }
+    LARGE_INTEGER size_li {};
+    GetFileSizeEx(file, &size_li);
+    const int64_t size = size_li.QuadPart;
+    // The view keeps the file and the mapping object alive once made.
+    HANDLE mapping = size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+                              : nullptr;
+    void* mem = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (!mem) { err = "sampler: cannot map " + path; return nullptr; }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { err = "sampler: cannot open " + path + ": " + std::strerror(errno); return nullptr; }
+    off_t size = lseek(fd, 0, SEEK_END);
+    void* mem = size > 0 ? mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0)
+                         : MAP_FAILED;
+    ::close(fd);
+    if (mem == MAP_FAILED) { err = "sampler: cannot map " + path; return nullptr; }
+#endif
+
+    auto sf = std::make_shared<SampleFile>();
+    sf->path_     = path;
+    sf->map_      = static_cast<const uint8_t*>(mem);
+    sf->map_size_ = static_cast<size_t>(size);
+
+    // RIFF/WAVE: walk the chunks for "fmt " and "data".
+    const uint8_t* p   = sf->map_;
+    const uint8_t* end = p + sf->map_size_;
+    if (sf->map_size_ < 12 || std::memcmp(p, "RIFF", 4) || std::memcmp(p + 8, "WAVE", 4)) {
+        err = "sampler: " + path + " is not a WAV file";
+        return nullptr;
+    }
+    int tag = 0, bits = 0;
+    for (p += 12; p + 8 <= end; ) {
+        uint32_t       len  = le32(p + 4);
+        const uint8_t* body = p + 8;
+        if (len > static_cast<uint64_t>(end - body)) len = static_cast<uint32_t>(end - body);
+        if (!std::memcmp(p, "fmt ", 4) && len >= 16 && body + 16 <= end) {
+            tag              = le16(body);
+            sf->channels_    = le16(body + 2);
+            sf->sample_rate_ = static_cast<float>(le32(body + 4));
+            sf->frame_bytes_ = le16(body + 12);
+            bits             = le16(body + 14);
+            if (tag == 0xfffe && len >= 40 && body + 26 <= end)
+                tag = le16(body + 24);   // WAVE_FORMAT_EXTENSIBLE sub-format
+        } else if (!std::memcmp(p, "data", 4)) {
+            sf->data_ = body;
+            sf->frames_ = sf->frame_bytes_ > 0 ? len / sf->frame_bytes_ : 0;
+            break;
+        }
+        p = body + len + (len & 1);
+    }
+    if      (tag == 1 && bits == 16) sf->format_ = Int16;
+    else if (tag == 1 && bits == 24) sf->format_ = Int24;
+    else if (tag == 1 && bits == 32) sf->format_ = Int32;
+    else if (tag == 3 && bits == 32) sf->format_ = Float32;
+    else {
+        err = "sampler: " + path + ": unsupported WAV encoding (tag " +
+              std::to_string(tag) + ", " + std::to_string(bits) + " bits)";
+        return nullptr;
+    }
+    if (!sf->data_ || sf->channels_ < 1 || sf->frame_bytes_ != sf->channels_ * bits / 8) {
+        err = "sampler: " + path + ": malformed WAV";
+        return nullptr;
+    }
+
+    const int head = static_cast<int>(std::min<int64_t>(sf->frames_, SampleFile::HEAD_FRAMES));
+    sf->head_.resize(static_cast<size_t>(head) * 2);
+    sf->decode(0, head, sf->head_.data());
+    sf->release(0, head);
+
+    AS_LOG("sampler", "mapped '%s': %lld frames, %d ch, %.0f Hz",
+           path.c_str(), static_cast<long long>(sf->frames_), sf->channels_, sf->sample_rate_);
+    g_files[key] = sf;
+    return sf;
+}
+
+// ---------------------------------------------------------------------------
+// SampleStream
+// ---------------------------------------------------------------------------
+
+SampleStream::SampleStream() : ring_(static_cast<size_t>(RING_FRAMES) * 2) {}
+
+bool SampleStream::claim(const SampleFile* file) {
+    if (state_.load(std::memory_order_acquire) != Idle) return false;
+    file_      = file;
+    file_head_ = file->head_frames();
+    read_.store(0, std::memory_order_relaxed);
+    write_.store(0, std::memory_order_relaxed);
+    state_.store(Active, std::memory_order_release);
+    return true;
+}
+
+int SampleStream::service(int max_frames) {
+    const int state = state_.load(std::memory_order_acquire);
+    if (state == Retired) {
+        state_.store(Idle, std::memory_order_release);
+        return 0;
+    }
+    if (state != Active) return 0;
+
+    const int64_t w    = write_.load(std::memory_order_relaxed);
+    const int64_t r    = read_.load(std::memory_order_acquire);
+    const int64_t left = file_->frames() - (file_head_ + w);
+    const int n = static_cast<int>(std::min<int64_t>({ RING_FRAMES - (w - r), left,
+                                                       static_cast<int64_t>(max_frames) }));
+    if (n <= 0) return 0;
+
+    // Decode in at most two runs around the end of the ring.
+    const int at    = static_cast<int>(w & (RING_FRAMES - 1));
+    const int first = std::min(n, RING_FRAMES - at);
+    file_->decode(file_head_ + w, first, &ring_[static_cast<size_t>(at) * 2]);
+    if (first < n) file_->decode(file_head_ + w + first, n - first, ring_.data());
+    write_.store(w + n, std::memory_order_release);
+
+    // Drop what was just copied and ask for the next run ahead of time.
+    file_->release(file_head_ + w, n);
+    file_->will_need(file_head_ + w + n, std::min<int64_t>(left - n, max_frames));
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// SampleStreamer
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Frames per stream per pass, so one long fill cannot starve the others.
+constexpr int FILL_CHUNK = 4096;
+
+// How often an otherwise idle prefetch thread looks for new work.  A voice
+// plays HEAD_FRAMES (~370 ms at 44.1 kHz, less when pitched up) before it
+// needs the ring, so this only has to be well under that.
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(2);
+
+struct Streamer {
+    std::mutex                                   mutex;
+    std::condition_variable                      wake;
+    std::vector<std::pair<SampleStream*, int>>   groups;
+    std::thread                                  thread;
+    bool                                         quit = false;
+
+    ~Streamer() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lk(mutex);
+        while (!quit) {
+            if (groups.empty()) { wake.wait(lk); continue; }
+            int work = 0;
+            for (auto& [streams, count] : groups)
+                for (int i = 0; i < count; ++i)
+                    work += streams[i].service(FILL_CHUNK);
+            if (work == 0) {
+                wake.wait_for(lk, POLL_INTERVAL);
+            } else {
+                // Straight round again while rings still want data, letting
+                // a waiting add()/remove() in first.
+                lk.unlock();
+                std::this_thread::yield();
+                lk.lock();
+            }
+        }
+    }
+};
+
+Streamer& streamer() {
+    static Streamer s;
+    return s;
+}
+
+} // namespace
+
+void SampleStreamer::add(SampleStream* streams, int count) {
+    auto& s = streamer();
+    {
+        std::lock_guard<std::mutex> lk(s.mutex);
+        s.groups.emplace_back(streams, count);
+        if (!s.thread.joinable()) s.thread = std::thread([&s] { s.run(); });
+    }
+    s.wake.notify_one();
+}
+
+void SampleStreamer::remove(SampleStream* streams) {
+    auto& s = streamer();
+    std::lock_guard<std::mutex> lk(s.mutex);
+    s.groups.erase(std::remove_if(s.groups.begin(), s.groups.end(),
+                                  [&](auto& g) { return g.first == streams; }),
+                   s.groups.end());
+}
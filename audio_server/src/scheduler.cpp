@@ -1,56 +1,250 @@
 // scheduler.cpp
 #include "scheduler.h"
+#include "protocol.h"
 #include "nlohmann/json.hpp"
 #include <algorithm>
-#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
 
 using json = nlohmann::json;
 
 // ---------------------------------------------------------------------------
-// Schedule::from_json
+// EventBatch reader
 // ---------------------------------------------------------------------------
+// Single pass over the JSON text: SAX callbacks write straight into the
+// per-node tracks, so the event list never exists as a DOM.  Top-level
+// keys other than "events" (cmd, id, ...) and unknown event fields are
+// skipped, so a whole set_schedule request can be fed in as it arrived.
 
-std::unique_ptr<Schedule> Schedule::from_json(const std::string& j_str, std::string& err) {
-    json j;
-    try { j = json::parse(j_str); }
-    catch (const std::exception& e) {
-        err = std::string("Schedule JSON parse error: ") + e.what();
-        return nullptr;
+namespace {
+
+class EventBatchReader {
+public:
+    // With fixed_node set (patches) every event lands in one track, and an
+    // event naming another node is an error.
+    explicit EventBatchReader(const std::string* fixed_node) : fixed_node_(fixed_node) {
+        if (fixed_node_) new_track(*fixed_node_);
     }
 
-    auto sched = std::make_unique<Schedule>();
+    std::vector<std::shared_ptr<ScheduleTrack>> tracks;
+    std::string                                 error;
 
-    for (auto& je : j.value("events", json::array())) {
-        SchedEvent evt;
-        evt.beat     = je.value("beat", 0.0);
-        evt.channel  = static_cast<uint8_t>(je.value("channel", 0));
-        evt.pitch    = static_cast<uint8_t>(je.value("pitch", 0));
-        evt.velocity = static_cast<uint8_t>(je.value("velocity", 0));
-        evt.value    = je.value("value", 0.0f);
-        evt.node_id  = je.value("node_id", "");
+    // --- nlohmann SAX interface ---
+    bool null()                                          { return scalar(); }
+    bool boolean(bool)                                   { return scalar(); }
+    bool number_integer(json::number_integer_t v)        { return number(double(v)); }
+    bool number_unsigned(json::number_unsigned_t v)      { return number(double(v)); }
+    bool number_float(json::number_float_t v, const json::string_t&) { return number(v); }
+    bool binary(json::binary_t&)                         { return scalar(); }
+
+    bool string(json::string_t& v) {
+        if (skip_ || depth_ != 3) return scalar();
+        switch (field_) {
+            case Field::Type: return set_type(v);
+            case Field::Node: return set_node(v);
+            case Field::Other: return true;
+            default: return fail("event field " + key_ + " must be a number");
+        }
+    }
+
+    bool key(json::string_t& k) {
+        if (skip_) return true;
+        if (depth_ == 1) events_key_ = (k == "events");
+        else if (depth_ == 3) {
+            field_ = k == "beat"     ? Field::Beat
+                   : k == "value"    ? Field::Value
+                   : k == "channel"  ? Field::Channel
+                   : k == "pitch"    ? Field::Pitch
+                   : k == "velocity" ? Field::Velocity
+                   : k == "type"     ? Field::Type
+                   : k == "node_id"  ? Field::Node
+                   :                   Field::Other;
+            if (field_ != Field::Other) key_ = k;
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        if (skip_) { ++skip_; return true; }
+        if (depth_ == 1 && !events_key_) { skip_ = 1; return true; }
+        if (depth_ == 1) return fail("\"events\" must be an array");
+        if (depth_ == 2) begin_event();
+        if (depth_ >= 3) return nested();
+        ++depth_;
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (skip_) { ++skip_; return true; }
+        if (depth_ == 0) return fail("EventBatch must be an object");
+        if (depth_ == 1 && !events_key_) { skip_ = 1; return true; }
+        if (depth_ == 2) return fail("event must be an object");
+        if (depth_ >= 3) return nested();
+        ++depth_;
+        return true;
+    }
+
+    bool end_object() {
+        if (skip_) { --skip_; return true; }
+        if (depth_ == 3) end_event();
+        --depth_;
+        return true;
+    }
+
+    bool end_array() {
+        if (skip_) { --skip_; return true; }
+        --depth_;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) {
+        if (error.empty()) error = std::string("Schedule JSON parse error: ") + e.what();
+        return false;
+    }
+
+private:
+    enum class Field { Beat, Value, Channel, Pitch, Velocity, Type, Node, Other };
+    static constexpr size_t NO_TRACK = size_t(-1);
+
+    const std::string* fixed_node_;
+    std::unordered_map<std::string, size_t> node_index_;
+
+    int         depth_      = 0;      // containers open, outside skipped values
+    int         skip_       = 0;      // >0 while inside a skipped value
+    bool        events_key_ = false;
+    Field       field_      = Field::Other;
+    std::string key_;                 // name of field_, for errors
+    SchedEvent  evt_ {};
+    size_t      track_      = NO_TRACK;
+
+    bool fail(std::string msg) { error = std::move(msg); return false; }
+
+    // A scalar outside an event field.
+    bool scalar() {
+        if (skip_) return true;
+        if (depth_ == 0) return fail("EventBatch must be an object");
+        if (depth_ == 1) return events_key_ ? fail("\"events\" must be an array") : true;
+        if (depth_ == 2) return fail("event must be an object");
+        return field_ == Field::Other ? true : fail("event field " + key_ + " has the wrong type");
+    }
+
+    // An object or array as the value of an event field.
+    bool nested() {
+        if (field_ != Field::Other) return fail("event field " + key_ + " has the wrong type");
+        skip_ = 1;
+        return true;
+    }
 
+    bool number(double v) {
+        if (skip_ || depth_ != 3) return scalar();
+        switch (field_) {
+            case Field::Beat:     evt_.beat     = v; return true;
+            case Field::Value:    evt_.value    = static_cast<float>(v); return true;
+            case Field::Channel:  evt_.channel  = static_cast<uint8_t>(static_cast<int>(v)); return true;
+            case Field::Pitch:    evt_.pitch    = static_cast<uint8_t>(static_cast<int>(v)); return true;
+            case Field::Velocity: evt_.velocity = static_cast<uint8_t>(static_cast<int>(v)); return true;
+            case Field::Other:    return true;
+            default:              return fail("event field " + key_ + " must be a string");
+        }
+    }
+
+    bool set_type(const std::string& t) {
+        if      (t == "note_on")  evt_.type = EventType::NoteOn;
+        else if (t == "note_off") evt_.type = EventType::NoteOff;
+        else if (t == "program")  evt_.type = EventType::Program;
+        else if (t == "volume")   evt_.type = EventType::Volume;
+        else if (t == "bend")     evt_.type = EventType::Bend;
+        else if (t == "control")  evt_.type = EventType::Control;
+        else return fail("Unknown event type: " + t);
+        return true;
+    }
+
+    bool set_node(const std::string& id) {
+        if (fixed_node_) {
+            if (!id.empty() && id != *fixed_node_)
+                return fail("patch for " + *fixed_node_ + " has an event for " + id);
+            track_ = 0;
+            return true;
+        }
+        auto it = node_index_.find(id);
+        track_ = it != node_index_.end() ? it->second : new_track(id);
+        return true;
+    }
+
+    size_t new_track(const std::string& id) {
+        node_index_.emplace(id, tracks.size());
+        tracks.push_back(std::make_shared<ScheduleTrack>());
+        tracks.back()->node_id = id;
+        return tracks.size() - 1;
+    }
+
+    void begin_event() {
+        evt_   = SchedEvent{ 0.0, 0.0f, EventType::NoteOn, 0, 0, 0 };
+        track_ = NO_TRACK;
+        field_ = Field::Other;
+    }
+
+    void end_event() {
+        if (track_ == NO_TRACK) set_node("");
         // Setup events from the Python client have beat = -1 (program/volume
         // changes that must fire before any note-ons). Clamp to 0.0 so they
         // fire at the start of the arrangement rather than being skipped.
-        if (evt.beat < 0.0) evt.beat = 0.0;
-
-        std::string type_str = je.value("type", "note_on");
-        if      (type_str == "note_on")  evt.type = EventType::NoteOn;
-        else if (type_str == "note_off") evt.type = EventType::NoteOff;
-        else if (type_str == "program")  evt.type = EventType::Program;
-        else if (type_str == "volume")   evt.type = EventType::Volume;
-        else if (type_str == "bend")     evt.type = EventType::Bend;
-        else if (type_str == "control")  evt.type = EventType::Control;
-        else {
-            err = "Unknown event type: " + type_str;
-            return nullptr;
-        }
+        if (evt_.beat < 0.0) evt_.beat = 0.0;
+        tracks[track_]->events.push_back(evt_);
+        field_ = Field::Other;
+    }
+};
+
+} // namespace
+
+static bool read_batch(const std::string& text, EventBatchReader& reader, std::string& err) {
+    if (!json::sax_parse(text, &reader)) {
+        err = reader.error.empty() ? "Schedule JSON parse error" : reader.error;
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Packed events
+// ---------------------------------------------------------------------------
+// See "Packed events" in protocol.h.  Little-endian records:
+//   f64 beat | f32 value | u32 node | u8 type | u8 channel | u8 pitch | u8 velocity
 
-        sched->events_.push_back(evt);
-        if (evt.beat > sched->total_length_) sched->total_length_ = evt.beat;
+using protocol::PACKED_EVENT_BYTES;
+
+static bool read_packed(const uint8_t* p, SchedEvent& evt, uint32_t& node, std::string& err) {
+    uint8_t type = p[16];
+    std::memcpy(&evt.beat,  p,     8);
+    std::memcpy(&evt.value, p + 8, 4);
+    std::memcpy(&node,      p + 12, 4);
+    if (type > static_cast<uint8_t>(EventType::Control)) {
+        err = "Unknown event type: " + std::to_string(type);
+        return false;
     }
+    if (!std::isfinite(evt.beat)) { err = "event beat is not finite"; return false; }
+    evt.type     = static_cast<EventType>(type);
+    evt.channel  = p[17];
+    evt.pitch    = p[18];
+    evt.velocity = p[19];
+    if (evt.beat < 0.0) evt.beat = 0.0;   // setup events, as in from_json
+    return true;
+}
+
+static bool check_packed_size(size_t bytes, std::string& err) {
+    if (bytes % PACKED_EVENT_BYTES == 0) return true;
+    err = "packed event payload is not a multiple of " + std::to_string(PACKED_EVENT_BYTES) + " bytes";
+    return false;
+}
 
-    // Sort: beat ascending, then priority (off/bend/prog before on)
+// ---------------------------------------------------------------------------
+// Schedule construction
+// ---------------------------------------------------------------------------
+
+// Sort: beat ascending, then priority (off/bend/prog before on)
+static void sort_track(ScheduleTrack& track) {
     auto priority = [](EventType t) -> int {
         switch (t) {
             case EventType::NoteOff: return 0;
@@ -62,77 +256,244 @@ std::unique_ptr<Schedule> Schedule::from_json(const std::string& j_str, std::str
             default:                 return 1;
         }
     };
+    auto before = [&](const SchedEvent& a, const SchedEvent& b) {
+        if (a.beat != b.beat) return a.beat < b.beat;
+        return priority(a.type) < priority(b.type);
+    };
+
+    // Clients usually send events in order already.
+    if (!std::is_sorted(track.events.begin(), track.events.end(), before))
+        std::stable_sort(track.events.begin(), track.events.end(), before);
+    track.length = track.events.empty() ? 0.0 : track.events.back().beat;
+}
+
+std::unique_ptr<Schedule> Schedule::from_tracks(std::vector<std::shared_ptr<ScheduleTrack>> tracks) {
+    auto sched = std::make_unique<Schedule>();
+    for (auto& t : tracks) {
+        sort_track(*t);
+        sched->node_ids_.push_back(t->node_id);
+        sched->tracks_.push_back(std::move(t));
+    }
+    sched->update_length();
+    return sched;
+}
+
+std::unique_ptr<Schedule> Schedule::from_json(const std::string& j_str, std::string& err) {
+    EventBatchReader reader(nullptr);
+    if (!read_batch(j_str, reader, err)) return nullptr;
+    return from_tracks(std::move(reader.tracks));
+}
 
-    std::stable_sort(sched->events_.begin(), sched->events_.end(),
-        [&](const SchedEvent& a, const SchedEvent& b) {
-            if (a.beat != b.beat) return a.beat < b.beat;
-            return priority(a.type) < priority(b.type);
-        });
+std::unique_ptr<Schedule> Schedule::from_packed(const uint8_t* data, size_t bytes,
+                                                const std::vector<std::string>& node_ids,
+                                                std::string& err) {
+    if (!check_packed_size(bytes, err)) return nullptr;
+
+    // Tracks in first-use order, one per distinct id, as from_json does.
+    std::vector<std::shared_ptr<ScheduleTrack>> tracks;
+    std::vector<size_t> track_of(node_ids.size(), size_t(-1));
+    std::unordered_map<std::string, size_t> by_id;
+    for (size_t off = 0; off < bytes; off += PACKED_EVENT_BYTES) {
+        SchedEvent evt;
+        uint32_t node;
+        if (!read_packed(data + off, evt, node, err)) return nullptr;
+        if (node >= node_ids.size()) {
+            err = "packed event node " + std::to_string(node) + " is not in \"nodes\"";
+            return nullptr;
+        }
+        if (track_of[node] == size_t(-1)) {
+            auto [it, inserted] = by_id.emplace(node_ids[node], tracks.size());
+            if (inserted) {
+                tracks.push_back(std::make_shared<ScheduleTrack>());
+                tracks.back()->node_id = node_ids[node];
+            }
+            track_of[node] = it->second;
+        }
+        tracks[track_of[node]]->events.push_back(evt);
+    }
+    return from_tracks(std::move(tracks));
+}
+
+std::shared_ptr<ScheduleTrack> Schedule::track_from_json(const std::string& node_id,
+                                                         const std::string& j_str,
+                                                         std::string& err) {
+    EventBatchReader reader(&node_id);
+    if (!read_batch(j_str, reader, err)) return nullptr;
+    sort_track(*reader.tracks[0]);
+    return std::move(reader.tracks[0]);
+}
+
+std::shared_ptr<ScheduleTrack> Schedule::track_from_packed(const std::string& node_id,
+                                                           const uint8_t* data, size_t bytes,
+                                                           std::string& err) {
+    if (!check_packed_size(bytes, err)) return nullptr;
+    auto track = std::make_shared<ScheduleTrack>();
+    track->node_id = node_id;
+    track->events.reserve(bytes / PACKED_EVENT_BYTES);
+    for (size_t off = 0; off < bytes; off += PACKED_EVENT_BYTES) {
+        SchedEvent evt;
+        uint32_t node;
+        if (!read_packed(data + off, evt, node, err)) return nullptr;
+        if (node != 0) { err = "packed patch events must use node 0"; return nullptr; }
+        track->events.push_back(evt);
+    }
+    sort_track(*track);
+    return track;
+}
 
+std::unique_ptr<Schedule> Schedule::patched(const Schedule& base,
+                                            std::shared_ptr<const ScheduleTrack> track) {
+    auto sched = std::make_unique<Schedule>(base);   // shares the other tracks
+    auto it = std::find(sched->node_ids_.begin(), sched->node_ids_.end(), track->node_id);
+    if (it != sched->node_ids_.end()) {
+        sched->tracks_[size_t(it - sched->node_ids_.begin())] = std::move(track);
+    } else {
+        sched->node_ids_.push_back(track->node_id);
+        sched->tracks_.push_back(std::move(track));
+    }
+    sched->update_length();
     return sched;
 }
 
+std::unique_ptr<Schedule> Schedule::patched(const Schedule& base, const std::string& node_id,
+                                            const std::string& j_str, std::string& err) {
+    auto track = track_from_json(node_id, j_str, err);
+    if (!track) return nullptr;
+    return patched(base, std::move(track));
+}
+
+size_t Schedule::event_count() const {
+    size_t n = 0;
+    for (auto& t : tracks_) n += t->events.size();
+    return n;
+}
+
+void Schedule::update_length() {
+    total_length_ = 0.0;
+    for (auto& t : tracks_) total_length_ = std::max(total_length_, t->length);
+}
+
 // ---------------------------------------------------------------------------
 // Dispatcher
 // ---------------------------------------------------------------------------
 
-Schedule* Dispatcher::swap_schedule(Schedule* next) {
-    // Store in pending_ atomically. Returns the old pending (may be null).
-    Schedule* old = pending_.exchange(next, std::memory_order_acq_rel);
-    return old;
+void Dispatcher::free_retired(Pending* p) {
+    while (p) delete std::exchange(p, p->next);
+}
+
+Dispatcher::~Dispatcher() {
+    delete pending_.load(std::memory_order_acquire);
+    free_retired(retired_.load(std::memory_order_acquire));
+}
+
+void Dispatcher::swap_schedule(std::shared_ptr<const Schedule> next) {
+    // Release what the audio thread has swapped out since the last call.
+    free_retired(retired_.exchange(nullptr, std::memory_order_acquire));
+
+    // Store in pending_ atomically.  A pending schedule the audio thread never
+    // picked up is superseded and released here, off the audio thread.
+    auto* box = new Pending;
+    if (next) {
+        box->targets.assign(next->tracks().size(), nullptr);
+        box->cursors.assign(next->tracks().size(), UNRESOLVED);
+        box->loop_cursors.assign(next->tracks().size(), UNRESOLVED);
+    }
+    box->schedule = std::move(next);
+    delete pending_.exchange(box, std::memory_order_acq_rel);
 }
 
 bool Dispatcher::check_pending() {
-    Schedule* pending = pending_.exchange(nullptr, std::memory_order_acq_rel);
+    auto* pending = pending_.exchange(nullptr, std::memory_order_acq_rel);
     if (!pending) return false;
 
-    Schedule* old = current_;
-    current_ = pending;
-    idx_     = 0;
-    reindex(0.0);  // reindex from current beat (seek will have been sent separately)
-    delete old;
+    // Tracks the new schedule shares with the old one keep their place;
+    // the rest are located by the next dispatch().
+    if (current_ && pending->schedule) {
+        const auto& before = current_->tracks();
+        const auto& after  = pending->schedule->tracks();
+        for (size_t i = 0; i < after.size() && i < before.size(); ++i) {
+            if (after[i] != before[i]) continue;
+            pending->cursors[i]      = cursors_[i];
+            pending->loop_cursors[i] = loop_cursors_[i];
+        }
+    }
+
+    current_.swap(pending->schedule);
+    targets_.swap(pending->targets);
+    cursors_.swap(pending->cursors);
+    loop_cursors_.swap(pending->loop_cursors);
+    bound_serial_ = 0;
+
+    // The box now holds the old schedule and tables; the producer frees it.
+    pending->next = retired_.load(std::memory_order_relaxed);
+    while (!retired_.compare_exchange_weak(pending->next, pending,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
     return true;
 }
 
-void Dispatcher::dispatch(double start_beat, double end_beat, Graph* graph) {
+// First event at or after beat.
+static size_t lower_bound_beat(const std::vector<SchedEvent>& evts, double beat) {
+    return size_t(std::lower_bound(evts.begin(), evts.end(), beat,
+        [](const SchedEvent& e, double b) { return e.beat < b; }) - evts.begin());
+}
+
+void Dispatcher::dispatch(double start_beat, double end_beat, int frames, Graph* graph) {
     if (!current_ || !graph) return;
-    const auto& evts = current_->events();
-
-    while (idx_ < evts.size()) {
-        const auto& e = evts[idx_];
-        // Setup events (beat < 0) were rewritten to beat 0.0 by Schedule::from_json.
-        // Any that slipped through with negative beat are forwarded at beat 0.
-        double effective_beat = e.beat < 0.0 ? 0.0 : e.beat;
-        if (effective_beat >= end_beat) break;
-        if (effective_beat >= start_beat) {
-            Node* node = graph->find_node(e.node_id);
-            if (node) {
-                switch (e.type) {
-                    case EventType::NoteOn:
-                        node->note_on(e.channel, e.pitch, e.velocity);
-                        break;
-                    case EventType::NoteOff:
-                        node->note_off(e.channel, e.pitch);
-                        break;
-                    case EventType::Program:
-                        node->program_change(e.channel, e.velocity /*bank*/, e.pitch /*prog*/);
-                        break;
-                    case EventType::Volume:
-                        node->channel_volume(e.channel, e.pitch);
-                        break;
-                    case EventType::Bend:
-                        node->pitch_bend(e.channel, e.pitch | (e.velocity << 7));
-                        break;
-                    case EventType::Control:
-                        node->push_control(e.beat, e.value);
-                        break;
-                }
+    if (graph->serial() != bound_serial_) bind(graph);
+    const auto& tracks = current_->tracks();
+    const double frames_per_beat =
+        end_beat > start_beat ? frames / (end_beat - start_beat) : 0.0;
+
+    // Tracks target distinct nodes, so walking them one after another
+    // delivers each node's events in the same order as a global merge.
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        const auto& evts = tracks[t]->events;
+        size_t& idx = cursors_[t];
+        if (idx == UNRESOLVED) idx = lower_bound_beat(evts, start_beat);
+        Node* node = targets_[t];
+
+        for (; idx < evts.size(); ++idx) {
+            const auto& e = evts[idx];
+            // Setup events (beat < 0) were rewritten to beat 0.0 by Schedule::from_json.
+            if (e.beat >= end_beat) break;
+            if (!node || e.beat < start_beat) continue;
+
+            int frame = static_cast<int>((e.beat - start_beat) * frames_per_beat);
+            node->set_event_frame(std::clamp(frame, 0, std::max(frames - 1, 0)));
+            switch (e.type) {
+                case EventType::NoteOn:
+                    node->note_on(e.channel, e.pitch, e.velocity);
+                    break;
+                case EventType::NoteOff:
+                    node->note_off(e.channel, e.pitch);
+                    break;
+                case EventType::Program:
+                    node->program_change(e.channel, e.velocity /*bank*/, e.pitch /*prog*/);
+                    break;
+                case EventType::Volume:
+                    node->channel_volume(e.channel, e.pitch);
+                    break;
+                case EventType::Bend:
+                    node->pitch_bend(e.channel, e.pitch | (e.velocity << 7));
+                    break;
+                case EventType::Control:
+                    node->push_control(e.beat, e.value);
+                    break;
             }
+            node->set_event_frame(0);
         }
-        idx_++;
     }
 }
 
+void Dispatcher::bind(Graph* graph) {
+    // One lookup per track; excluded nodes bind to nullptr.
+    const auto& ids = current_->node_ids();
+    for (size_t i = 0; i < ids.size(); ++i)
+        targets_[i] = excluded_.count(ids[i]) ? nullptr : graph->find_node(ids[i]);
+    bound_serial_ = graph->serial();
+}
+
 void Dispatcher::seek(double beat) {
     // Also handle any all_notes_off externally before calling seek.
     reindex(beat);
@@ -142,13 +503,23 @@ double Dispatcher::arrangement_length() const {
     return current_ ? current_->total_length_beats() : 0.0;
 }
 
+void Dispatcher::set_loop_start(double beat) {
+    if (beat == loop_beat_) return;
+    loop_beat_ = beat;
+    std::fill(loop_cursors_.begin(), loop_cursors_.end(), UNRESOLVED);
+}
+
 void Dispatcher::reindex(double beat) {
-    if (!current_) { idx_ = 0; return; }
-    const auto& evts = current_->events();
-    // Skip setup events (beat < 0), then binary-search for beat position
-    idx_ = 0;
-    for (size_t i = 0; i < evts.size(); ++i) {
-        if (evts[i].beat >= beat) { idx_ = i; return; }
-    }
-    idx_ = evts.size();
+    if (!current_) return;
+    const auto& tracks = current_->tracks();
+    const bool loop = beat == loop_beat_;
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        if (!loop) {
+            cursors_[t] = lower_bound_beat(tracks[t]->events, beat);
+            continue;
+        }
+        size_t& c = loop_cursors_[t];
+        if (c == UNRESOLVED) c = lower_bound_beat(tracks[t]->events, beat);
+        cursors_[t] = c;
+    }
 }
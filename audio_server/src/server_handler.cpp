@@ -9,8 +9,17 @@
 #ifdef AS_ENABLE_LV2
 #include "synth_node.h"  // list_lv2_plugins
 #endif
+#ifdef AS_ENABLE_SF2
+#include "soundfont_cache.h"
+#endif
 
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
 
 using json = nlohmann::json;
 
@@ -36,6 +45,102 @@ static std::string base64_encode(const uint8_t* data, size_t len) {
     return out;
 }
 
+// ---------------------------------------------------------------------------
+// Request routing (IPC reader thread)
+// ---------------------------------------------------------------------------
+// Only the top-level "cmd" and "id" keys matter, so the header is scanned
+// rather than parsed: values of other keys (a set_schedule event list can be
+// megabytes) are skipped by bracket depth.  Malformed JSON routes as an
+// ordered slow request and fails properly in the handler.
+
+namespace {
+
+struct HeaderScan {
+    const char* p;
+    const char* end;
+
+    void ws() { while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p; }
+
+    // At an opening quote: step past the closing one.  out gets the raw
+    // (still escaped) contents when given.
+    bool string(std::string* out = nullptr) {
+        const char* start = ++p;
+        while (p < end && *p != '"') p += (*p == '\\') ? 2 : 1;
+        if (p >= end) return false;
+        if (out) out->assign(start, p);
+        ++p;
+        return true;
+    }
+
+    // Step past one value: a scalar, a string, or a whole object/array.
+    bool value() {
+        if (p >= end) return false;
+        if (*p == '"') return string();
+        if (*p != '{' && *p != '[') {
+            while (p < end && *p != ',' && *p != '}' && *p != ']') ++p;
+            return true;
+        }
+        int depth = 0;
+        while (p < end) {
+            const char c = *p;
+            if (c == '"') {
+                if (!string()) return false;
+                continue;
+            }
+            ++p;
+            if (c == '{' || c == '[') ++depth;
+            else if ((c == '}' || c == ']') && --depth == 0) return true;
+        }
+        return false;
+    }
+};
+
+const std::unordered_set<std::string>& fast_commands() {
+    static const std::unordered_set<std::string> cmds = {
+        protocol::CMD_PING, protocol::CMD_SHUTDOWN,
+        protocol::CMD_PLAY, protocol::CMD_STOP, protocol::CMD_SEEK, protocol::CMD_SET_LOOP,
+        protocol::CMD_SET_BPM, protocol::CMD_GET_POSITION,
+        protocol::CMD_SET_PARAM, protocol::CMD_RESOLVE_PARAMS, protocol::CMD_SET_PARAMS,
+        protocol::CMD_NOTE_ON, protocol::CMD_NOTE_OFF, protocol::CMD_ALL_NOTES_OFF,
+        protocol::CMD_GET_STATS, protocol::CMD_GET_NODE_DATA, protocol::CMD_OPEN_SHARED_STATE,
+    };
+    return cmds;
+}
+
+} // namespace
+
+IpcRoute ServerHandler::route(const IpcMessage& request) {
+    IpcRoute r;   // slow, ordered
+    HeaderScan s { request.json.data(), request.json.data() + request.json.size() };
+    s.ws();
+    if (s.p >= s.end || *s.p != '{') return r;
+    ++s.p;
+    std::string key, cmd;
+    bool tagged = false;
+    for (;;) {
+        s.ws();
+        if (s.p >= s.end || *s.p != '"' || !s.string(&key)) return r;
+        s.ws();
+        if (s.p >= s.end || *s.p != ':') return r;
+        ++s.p;
+        s.ws();
+        if (key == "cmd" && s.p < s.end && *s.p == '"') {
+            if (!s.string(&cmd)) return r;
+        } else {
+            if (key == "id") tagged = true;
+            if (!s.value()) return r;
+        }
+        s.ws();
+        if (s.p >= s.end) return r;
+        if (*s.p == '}') break;
+        if (*s.p != ',') return r;
+        ++s.p;
+    }
+    r.lane    = fast_commands().count(cmd) ? IpcLane::Fast : IpcLane::Slow;
+    r.ordered = !tagged;
+    return r;
+}
+
 // ---------------------------------------------------------------------------
 // ServerHandler
 // ---------------------------------------------------------------------------
@@ -43,19 +148,365 @@ static std::string base64_encode(const uint8_t* data, size_t len) {
 ServerHandler::ServerHandler(const AudioEngineConfig& cfg)
     : engine_(cfg) {}
 
+// One list_registered_plugins entry.
+static json descriptor_json(const PluginDescriptor* desc) {
+    json jp;
+    jp["id"]           = desc->id;
+    jp["display_name"] = desc->display_name;
+    jp["category"]     = desc->category;
+    jp["doc"]          = desc->doc;
+    jp["author"]       = desc->author;
+    jp["version"]      = desc->version;
+
+    json ports = json::array();
+    for (auto& p : desc->ports) {
+        json jport;
+        jport["id"]           = p.id;
+        jport["display_name"] = p.display_name;
+        jport["doc"]          = p.doc;
+
+        switch (p.type) {
+            case PluginPortType::AudioMono:   jport["type"] = "audio_mono"; break;
+            case PluginPortType::AudioStereo: jport["type"] = "audio_stereo"; break;
+            case PluginPortType::Event:       jport["type"] = "event"; break;
+            case PluginPortType::Control:     jport["type"] = "control"; break;
+        }
+        switch (p.role) {
+            case PortRole::Input:    jport["role"] = "input"; break;
+            case PortRole::Output:   jport["role"] = "output"; break;
+            case PortRole::Sidechain:jport["role"] = "sidechain"; break;
+            case PortRole::Monitor:  jport["role"] = "monitor"; break;
+        }
+
+        if (p.type == PluginPortType::Control) {
+            switch (p.hint) {
+                case ControlHint::Continuous:  jport["hint"] = "continuous"; break;
+                case ControlHint::Toggle:      jport["hint"] = "toggle"; break;
+                case ControlHint::Integer:     jport["hint"] = "integer"; break;
+                case ControlHint::Categorical: jport["hint"] = "categorical"; break;
+                case ControlHint::Radio:       jport["hint"] = "radio"; break;
+                case ControlHint::Meter:       jport["hint"] = "meter"; break;
+                case ControlHint::GraphEditor: jport["hint"] = "graph_editor"; break;
+            }
+            jport["default"] = p.default_value;
+            jport["min"]     = p.min_value;
+            jport["max"]     = p.max_value;
+            jport["step"]    = p.step;
+            jport["show_port_default"] = p.show_port_default;
+            if (!p.choices.empty())
+                jport["choices"] = p.choices;
+            if (!p.graph_type.empty())
+                jport["graph_type"] = p.graph_type;
+        }
+
+        ports.push_back(jport);
+    }
+    jp["ports"] = ports;
+
+    json config_params = json::array();
+    for (auto& cp : desc->config_params) {
+        json jcp;
+        jcp["id"]           = cp.id;
+        jcp["display_name"] = cp.display_name;
+        jcp["doc"]          = cp.doc;
+        switch (cp.type) {
+            case ConfigType::String:      jcp["type"] = "string"; break;
+            case ConfigType::FilePath:    jcp["type"] = "filepath"; break;
+            case ConfigType::Integer:     jcp["type"] = "integer"; break;
+            case ConfigType::Float:       jcp["type"] = "float"; break;
+            case ConfigType::Bool:        jcp["type"] = "bool"; break;
+            case ConfigType::Categorical: jcp["type"] = "categorical"; break;
+        }
+        jcp["default"] = cp.default_value;
+        if (!cp.file_filter.empty())
+            jcp["file_filter"] = cp.file_filter;
+        if (!cp.choices.empty())
+            jcp["choices"] = cp.choices;
+        config_params.push_back(jcp);
+    }
+    jp["config_params"] = config_params;
+    return jp;
+}
+
+// Parse a request header, leaving out a top-level "events" list: schedules
+// are read from the request text by Schedule's own single-pass reader, so a
+// large one never becomes a DOM here (see BinaryIo::text).
+static json parse_request(const std::string& text) {
+    return json::parse(text, [](int depth, json::parse_event_t event, json& parsed) {
+        return !(depth == 1 && event == json::parse_event_t::key && parsed == "events");
+    });
+}
+
+// list_registered_plugins and list_plugins answer with the same large array
+// every time, changing only when a plugin library is loaded (or, for LV2, a
+// bundle on disk).  The "plugins" text is kept serialized and spliced into
+// the reply, so a listing costs neither a DOM build nor a dump per request.
+bool ServerHandler::plugin_listing(const std::string& cmd,
+                                   [[maybe_unused]] const json& req,  // LV2 only
+                                   const json& id, std::string& reply) {
+    std::string body;
+    if (cmd == protocol::CMD_LIST_REGISTERED_PLUGINS) {
+        std::lock_guard<std::mutex> lk(plugins_mutex_);
+        const auto& all = PluginRegistry::all();
+        if (all.size() != registered_count_) {
+            // The registry only grows, and descriptors are fixed once read.
+            json plugins = json::array();
+            for (auto* reg : all)
+                if (auto desc = PluginRegistry::find_descriptor(reg->id))
+                    plugins.push_back(descriptor_json(desc));
+            registered_json_  = plugins.dump();
+            registered_count_ = all.size();
+        }
+        body = registered_json_;
+    }
+#ifdef AS_ENABLE_LV2
+    else if (cmd == protocol::CMD_LIST_PLUGINS) {
+        body = list_lv2_plugins(req.value("uri_prefix", ""));
+    }
+#endif
+    else {
+        return false;
+    }
+    reply = "{\"status\":\"ok\",\"plugins\":" + body;
+    if (!id.is_null()) reply += ",\"id\":" + id.dump();
+    reply += '}';
+    return true;
+}
+
 std::string ServerHandler::handle(const std::string& req_str) {
     json resp;
     try {
-        json req = json::parse(req_str);
+        json req = parse_request(req_str);
         std::string cmd = req.value("cmd", "");
-        resp = dispatch(cmd, req);
+        if (std::string reply; plugin_listing(cmd, req, req.value("id", json()), reply))
+            return reply;
+        BinaryIo bin;
+        bin.text = &req_str;
+        resp = dispatch(cmd, req, bin);
+        if (req.contains("id")) resp["id"] = req["id"];
     } catch (const std::exception& e) {
         resp = {{"status", "error"}, {"message", e.what()}};
     }
     return resp.dump();
 }
 
-json ServerHandler::dispatch(const std::string& cmd, const json& req) {
+IpcMessage ServerHandler::handle_message(const IpcMessage& request,
+                                         const ReplyWriter& write) {
+    IpcMessage reply;
+    reply.binary = request.binary;
+    json resp;
+    json id;
+    try {
+        json req = parse_request(request.json);
+        std::string cmd = req.value("cmd", "");
+        if (plugin_listing(cmd, req, req.value("id", json()), reply.json)) {
+            reply.payload.clear();
+            return reply;
+        }
+        BinaryIo bin;
+        bin.text = &request.json;
+        if (write) bin.write = &write;
+        if (request.binary) {
+            bin.in  = &request.payload;
+            bin.out = &reply.payload;
+        }
+        if (req.contains("id")) {
+            id     = req["id"];
+            bin.id = &id;
+        }
+        resp = dispatch(cmd, req, bin);
+    } catch (const std::exception& e) {
+        reply.payload.clear();
+        resp = {{"status", "error"}, {"message", e.what()}};
+    }
+    if (!id.is_null()) resp["id"] = id;
+    reply.json = resp.dump();
+    return reply;
+}
+
+std::string ServerHandler::ensure_stream_open() {
+    std::lock_guard<std::mutex> lk(stream_mutex_);
+    if (stream_open_) return {};
+    std::string err = engine_.open();
+    if (err.empty()) stream_open_ = true;
+    return err;
+}
+
+json ServerHandler::render_chunked(const json& req, BinaryIo bin) {
+    std::string fmt = req.value("format", "wav");
+    if (fmt != "wav" && fmt != "raw_f32")
+        return {{"status", "error"}, {"message", "unknown format: " + fmt}};
+    auto format = (fmt == "wav") ? AudioEngine::RenderFormat::Wav
+                                 : AudioEngine::RenderFormat::RawF32;
+
+    std::string path     = req.value("path", "");
+    bool        stream   = path.empty();
+    bool        progress = stream || req.value("progress", false);
+    if (progress && !bin.write)
+        return {{"status", "error"},
+                {"message", "streamed render needs a connection that accepts progress frames"}};
+
+    int chunk_frames = req.value("chunk_frames", AudioEngine::DEFAULT_RENDER_CHUNK_FRAMES);
+    chunk_frames = std::max(1, std::min(chunk_frames, protocol::MAX_RENDER_CHUNK_FRAMES));
+
+    std::ofstream file;
+    if (!path.empty()) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) return {{"status", "error"}, {"message", "cannot open " + path}};
+    }
+
+    int64_t     bytes_total = 0;
+    std::string fail;
+    auto sink = [&](const uint8_t* data, size_t bytes, int64_t done, int64_t total) {
+        bytes_total += static_cast<int64_t>(bytes);
+        if (file.is_open()) {
+            file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            if (!file) { fail = "write failed: " + path; return false; }
+            if (!progress) return true;
+        }
+
+        IpcMessage frame;
+        json note = {{"status", "progress"}, {"frames_done", done}, {"total_frames", total}};
+        if (bin.id) note["id"] = *bin.id;
+        if (stream) {
+            if (bin.out) {
+                frame.payload.assign(data, data + bytes);
+                note["payload_bytes"] = bytes;
+            } else {
+                note["data"] = base64_encode(data, bytes);
+            }
+        }
+        frame.json = note.dump();
+        if (!(*bin.write)(frame)) { fail = "client disconnected"; return false; }
+        return true;
+    };
+
+    std::string render_err;
+    int64_t frames = engine_.render_offline_stream(format, sink, chunk_frames,
+                                                   1.0f, req.value("duration_beats", 0.0),
+                                                   &render_err);
+    if (file.is_open()) file.close();
+    if (frames <= 0) {
+        if (!path.empty()) std::remove(path.c_str());
+        return {{"status", "error"}, {"message", fail.empty() ? render_err : fail}};
+    }
+
+    json resp = {{"status", "ok"}, {"format", fmt},
+                 {"sample_rate", (int)engine_.sample_rate()},
+                 {"channels", 2},
+                 {"frames", frames},
+                 {"bytes", bytes_total}};
+    if (!path.empty()) resp["path"] = path;
+    return resp;
+}
+
+json ServerHandler::render_stems(const json& req, BinaryIo bin) {
+    std::string fmt = req.value("format", "wav");
+    if (fmt != "wav" && fmt != "raw_f32")
+        return {{"status", "error"}, {"message", "unknown format: " + fmt}};
+    auto format = (fmt == "wav") ? AudioEngine::RenderFormat::Wav
+                                 : AudioEngine::RenderFormat::RawF32;
+
+    std::vector<AudioEngine::StemSpec> stems;
+    for (auto& js : req.value("stems", json::array())) {
+        AudioEngine::StemSpec st;
+        st.name  = js.value("name", "");
+        st.nodes = js.value("nodes", std::vector<std::string>{});
+        if (st.name.empty()) return {{"status", "error"}, {"message", "stem without a name"}};
+        for (auto& other : stems)
+            if (other.name == st.name)
+                return {{"status", "error"}, {"message", "duplicate stem name: " + st.name}};
+        stems.push_back(std::move(st));
+    }
+    if (stems.empty()) return {{"status", "error"}, {"message", "no stems given"}};
+
+    std::string dir      = req.value("dir", "");
+    bool        progress = req.value("progress", false);
+    if (progress && !bin.write)
+        return {{"status", "error"},
+                {"message", "stem progress needs a connection that accepts progress frames"}};
+
+    // Per-stem output: a file under dir, or an in-memory buffer.  Each is only
+    // touched by the thread rendering that stem.
+    std::vector<std::ofstream>        files(dir.empty() ? 0 : stems.size());
+    std::vector<std::vector<uint8_t>> buffers(dir.empty() ? stems.size() : 0);
+    std::vector<std::string>          paths;
+    std::vector<int64_t>              bytes_out(stems.size(), 0);
+    std::vector<char>                 write_failed(stems.size(), 0);
+    if (!dir.empty()) {
+        const char* ext = (format == AudioEngine::RenderFormat::Wav) ? ".wav" : ".f32";
+        for (size_t i = 0; i < stems.size(); ++i) {
+            const std::string& name = stems[i].name;
+            if (name.find_first_of("/\\") != std::string::npos || name == "." || name == "..")
+                return {{"status", "error"}, {"message", "invalid stem name for a file: " + name}};
+            paths.push_back(dir + "/" + name + ext);
+            files[i].open(paths.back(), std::ios::binary | std::ios::trunc);
+            if (!files[i]) return {{"status", "error"}, {"message", "cannot open " + paths.back()}};
+        }
+    }
+
+    std::mutex write_mutex;   // progress frames come from several render threads
+    bool       client_gone = false;
+    int64_t    total_frames = 0;
+
+    auto sink = [&](size_t i, const uint8_t* data, size_t bytes, int64_t done, int64_t total) {
+        bytes_out[i] += static_cast<int64_t>(bytes);
+        if (!dir.empty()) {
+            files[i].write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            if (!files[i]) { write_failed[i] = 1; return false; }
+        } else {
+            if (buffers[i].empty()) buffers[i].reserve(44 + static_cast<size_t>(total) * 8);
+            buffers[i].insert(buffers[i].end(), data, data + bytes);
+        }
+        std::lock_guard<std::mutex> lk(write_mutex);
+        total_frames = total;
+        if (!progress) return true;
+        IpcMessage frame;
+        json note = {{"status", "progress"}, {"stem", stems[i].name},
+                     {"frames_done", done}, {"total_frames", total}};
+        if (bin.id) note["id"] = *bin.id;
+        frame.json = note.dump();
+        client_gone = client_gone || !(*bin.write)(frame);
+        return !client_gone;
+    };
+
+    std::string err = engine_.render_stems(stems, format, sink, req.value("threads", 0),
+                                           AudioEngine::DEFAULT_RENDER_CHUNK_FRAMES, 1.0f,
+                                           req.value("duration_beats", 0.0));
+    for (auto& f : files) f.close();
+    for (size_t i = 0; i < write_failed.size(); ++i)
+        if (write_failed[i]) err = "write failed: " + paths[i];
+    if (client_gone) err = "client disconnected";
+    if (!err.empty()) {
+        for (auto& p : paths) std::remove(p.c_str());
+        return {{"status", "error"}, {"message", err}};
+    }
+
+    json out = json::array();
+    for (size_t i = 0; i < stems.size(); ++i) {
+        json js = {{"name", stems[i].name}};
+        if (!dir.empty()) {
+            js["path"]  = paths[i];
+            js["bytes"] = bytes_out[i];
+        } else if (bin.out) {
+            js["offset"] = bin.out->size();
+            js["bytes"]  = buffers[i].size();
+            bin.out->insert(bin.out->end(), buffers[i].begin(), buffers[i].end());
+            std::vector<uint8_t>().swap(buffers[i]);
+        } else {
+            js["data"] = base64_encode(buffers[i].data(), buffers[i].size());
+            std::vector<uint8_t>().swap(buffers[i]);
+        }
+        out.push_back(std::move(js));
+    }
+    return {{"status", "ok"}, {"format", fmt},
+            {"sample_rate", (int)engine_.sample_rate()},
+            {"channels", 2},
+            {"frames", total_frames},
+            {"stems", out}};
+}
+
+json ServerHandler::dispatch(const std::string& cmd, const json& req, BinaryIo bin) {
     // -------------------------------------------------------------------
     if (cmd == protocol::CMD_PING) {
         return {{"status", "ok"}, {"version", "0.1.0"},
@@ -67,7 +518,10 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
                     "lv2",
 #endif
                     "sine", "mixer", "control_source", "track_source",
-                    "note_on", "note_off", "all_notes_off", "set_node_config"
+                    "note_on", "note_off", "all_notes_off", "set_node_config",
+                    "set_params", "binary_framing", "render_stream", "render_stems",
+                    "patch_graph", "get_stats", "shared_state", "request_ids",
+                    "patch_schedule", "packed_events"
                 }}};
     }
 
@@ -79,20 +533,57 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
 
     // -------------------------------------------------------------------
     if (cmd == protocol::CMD_SET_GRAPH) {
-        if (!engine_.is_open()) {
-            std::string err = engine_.open();
-            if (!err.empty())
-                return {{"status", "error"}, {"message", "stream: " + err}};
-            stream_open_ = true;
-        }
-        std::string err = engine_.set_graph(req.dump());
+        std::string err = ensure_stream_open();
+        if (!err.empty()) return {{"status", "error"}, {"message", "stream: " + err}};
+        err = engine_.set_graph(req.dump());
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
+        return {{"status", "ok"}};
+    }
+
+    // -------------------------------------------------------------------
+    if (cmd == protocol::CMD_PATCH_GRAPH) {
+        std::string err = engine_.patch_graph(req.dump());
         if (!err.empty()) return {{"status", "error"}, {"message", err}};
         return {{"status", "ok"}};
     }
 
     // -------------------------------------------------------------------
     if (cmd == protocol::CMD_SET_SCHEDULE) {
-        std::string err = engine_.set_schedule(req.dump());
+        // Binary frames may carry the EventBatch document or packed events
+        // as the payload; otherwise the events are in the request itself.
+        std::string err;
+        if (bin.in && !bin.in->empty()) {
+            if (req.value("format", "json") == "packed") {
+                auto nodes = req.value("nodes", std::vector<std::string>{});
+                auto sched = Schedule::from_packed(bin.in->data(), bin.in->size(), nodes, err);
+                if (sched) err = engine_.set_schedule(std::move(sched));
+            } else {
+                err = engine_.set_schedule(std::string(bin.in->begin(), bin.in->end()));
+            }
+        } else {
+            err = engine_.set_schedule(bin.text ? *bin.text : req.dump());
+        }
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
+        return {{"status", "ok"}};
+    }
+
+    // -------------------------------------------------------------------
+    if (cmd == protocol::CMD_PATCH_SCHEDULE) {
+        std::string node_id = req.value("node_id", "");
+        if (node_id.empty())
+            return {{"status", "error"}, {"message", "node_id required"}};
+        std::string err;
+        if (bin.in && !bin.in->empty()) {
+            if (req.value("format", "json") == "packed") {
+                auto track = Schedule::track_from_packed(node_id, bin.in->data(),
+                                                         bin.in->size(), err);
+                if (track) err = engine_.patch_schedule(std::move(track));
+            } else {
+                err = engine_.patch_schedule(node_id, std::string(bin.in->begin(), bin.in->end()));
+            }
+        } else {
+            err = engine_.patch_schedule(node_id, bin.text ? *bin.text : req.dump());
+        }
         if (!err.empty()) return {{"status", "error"}, {"message", err}};
         return {{"status", "ok"}};
     }
@@ -139,14 +630,45 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
         );
         return {{"status", "ok"}};
     }
+    if (cmd == protocol::CMD_RESOLVE_PARAMS) {
+        std::vector<std::pair<std::string, std::string>> ids;
+        for (auto& p : req.value("params", json::array()))
+            ids.emplace_back(p.value("node_id", ""), p.value("param_id", ""));
+        std::vector<int> handles;
+        uint32_t serial = engine_.resolve_params(ids, handles);
+        if (serial == 0) return {{"status", "error"}, {"message", "no active graph"}};
+        return {{"status", "ok"}, {"graph", serial}, {"handles", handles}};
+    }
+    if (cmd == protocol::CMD_SET_PARAMS) {
+        std::vector<std::pair<int, float>> values;
+        for (auto& v : req.value("values", json::array())) {
+            if (!v.is_array() || v.size() != 2) continue;
+            values.emplace_back(v[0].get<int>(), v[1].get<float>());
+        }
+        std::string err = engine_.set_params(req.value("graph", 0u), values);
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
+        return {{"status", "ok"}};
+    }
 
     // -------------------------------------------------------------------
+    if (cmd == protocol::CMD_RENDER_STEMS) return render_stems(req, bin);
+
     if (cmd == protocol::CMD_RENDER) {
+        if (req.value("stream", false) || req.contains("path"))
+            return render_chunked(req, bin);
+
         std::string fmt       = req.value("format", "wav");
         double duration_beats = req.value("duration_beats", 0.0);
         if (fmt == "wav") {
             auto wav = engine_.render_offline_wav(1.0f, duration_beats);
             if (wav.empty()) return {{"status", "error"}, {"message", "nothing to render"}};
+            if (bin.out) {
+                *bin.out = std::move(wav);
+                return {{"status", "ok"}, {"format", "wav"},
+                        {"sample_rate", (int)engine_.sample_rate()},
+                        {"channels", 2},
+                        {"payload_bytes", bin.out->size()}};
+            }
             std::string b64 = base64_encode(wav.data(), wav.size());
             return {{"status", "ok"}, {"format", "wav"},
                     {"data", b64},
@@ -156,6 +678,15 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
         if (fmt == "raw_f32") {
             auto pcm = engine_.render_offline(1.0f, duration_beats);
             if (pcm.empty()) return {{"status", "error"}, {"message", "nothing to render"}};
+            if (bin.out) {
+                bin.out->resize(pcm.size() * sizeof(float));
+                std::memcpy(bin.out->data(), pcm.data(), bin.out->size());
+                return {{"status", "ok"}, {"format", "raw_f32"},
+                        {"sample_rate", (int)engine_.sample_rate()},
+                        {"channels", 2},
+                        {"frames", (int)(pcm.size() / 2)},
+                        {"payload_bytes", bin.out->size()}};
+            }
             std::string b64 = base64_encode(
                 reinterpret_cast<const uint8_t*>(pcm.data()),
                 pcm.size() * sizeof(float));
@@ -168,27 +699,16 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
         return {{"status", "error"}, {"message", "unknown format: " + fmt}};
     }
 
-    // -------------------------------------------------------------------
-#ifdef AS_ENABLE_LV2
-    if (cmd == protocol::CMD_LIST_PLUGINS) {
-        std::string prefix = req.value("uri_prefix", "");
-        std::string plugins_json = list_lv2_plugins(prefix);
-        return {{"status", "ok"}, {"plugins", json::parse(plugins_json)}};
-    }
-#endif
-
     // -------------------------------------------------------------------
     if (cmd == protocol::CMD_NOTE_ON) {
         std::string node_id = req.value("node_id", "");
         int channel  = req.value("channel",  0);
         int pitch    = req.value("pitch",    60);
         int velocity = req.value("velocity", 100);
-        if (!engine_.is_open()) {
-            std::string err = engine_.open();
-            if (!err.empty())
-                return {{"status", "error"}, {"message", "stream: " + err}};
-        }
-        engine_.preview_note_on(node_id, channel, pitch, velocity);
+        std::string err = ensure_stream_open();
+        if (!err.empty()) return {{"status", "error"}, {"message", "stream: " + err}};
+        err = engine_.preview_note_on(node_id, channel, pitch, velocity);
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
         return {{"status", "ok"}};
     }
 
@@ -196,13 +716,15 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
         std::string node_id = req.value("node_id", "");
         int channel = req.value("channel", 0);
         int pitch   = req.value("pitch",   60);
-        engine_.preview_note_off(node_id, channel, pitch);
+        std::string err = engine_.preview_note_off(node_id, channel, pitch);
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
         return {{"status", "ok"}};
     }
 
     if (cmd == protocol::CMD_ALL_NOTES_OFF) {
         std::string node_id = req.value("node_id", "");
-        engine_.preview_all_notes_off(node_id);
+        std::string err = engine_.preview_all_notes_off(node_id);
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
         return {{"status", "ok"}};
     }
 
@@ -224,95 +746,95 @@ json ServerHandler::dispatch(const std::string& cmd, const json& req) {
         if (node_id.empty())
             return {{"status", "error"}, {"message", "node_id required"}};
         std::string data = engine_.get_node_data(node_id, port_id);
+        if (bin.out) {
+            bin.out->assign(data.begin(), data.end());
+            return {{"status", "ok"}, {"payload_bytes", bin.out->size()}};
+        }
         return {{"status", "ok"}, {"data", data}};
     }
 
     // -------------------------------------------------------------------
-    if (cmd == protocol::CMD_LIST_REGISTERED_PLUGINS) {
-        json plugins = json::array();
-        for (auto* reg : PluginRegistry::all()) {
-            auto desc = PluginRegistry::find_descriptor(reg->id);
-            if (!desc) continue;
-
-            json jp;
-            jp["id"]           = desc->id;
-            jp["display_name"] = desc->display_name;
-            jp["category"]     = desc->category;
-            jp["doc"]          = desc->doc;
-            jp["author"]       = desc->author;
-            jp["version"]      = desc->version;
-
-            json ports = json::array();
-            for (auto& p : desc->ports) {
-                json jport;
-                jport["id"]           = p.id;
-                jport["display_name"] = p.display_name;
-                jport["doc"]          = p.doc;
-
-                switch (p.type) {
-                    case PluginPortType::AudioMono:   jport["type"] = "audio_mono"; break;
-                    case PluginPortType::AudioStereo: jport["type"] = "audio_stereo"; break;
-                    case PluginPortType::Event:       jport["type"] = "event"; break;
-                    case PluginPortType::Control:     jport["type"] = "control"; break;
-                }
-                switch (p.role) {
-                    case PortRole::Input:    jport["role"] = "input"; break;
-                    case PortRole::Output:   jport["role"] = "output"; break;
-                    case PortRole::Sidechain:jport["role"] = "sidechain"; break;
-                    case PortRole::Monitor:  jport["role"] = "monitor"; break;
-                }
-
-                if (p.type == PluginPortType::Control) {
-                    switch (p.hint) {
-                        case ControlHint::Continuous:  jport["hint"] = "continuous"; break;
-                        case ControlHint::Toggle:      jport["hint"] = "toggle"; break;
-                        case ControlHint::Integer:     jport["hint"] = "integer"; break;
-                        case ControlHint::Categorical: jport["hint"] = "categorical"; break;
-                        case ControlHint::Radio:       jport["hint"] = "radio"; break;
-                        case ControlHint::Meter:       jport["hint"] = "meter"; break;
-                        case ControlHint::GraphEditor: jport["hint"] = "graph_editor"; break;
-                    }
-                    jport["default"] = p.default_value;
-                    jport["min"]     = p.min_value;
-                    jport["max"]     = p.max_value;
-                    jport["step"]    = p.step;
-                    jport["show_port_default"] = p.show_port_default;
-                    if (!p.choices.empty())
-                        jport["choices"] = p.choices;
-                    if (!p.graph_type.empty())
-                        jport["graph_type"] = p.graph_type;
-                }
-
-                ports.push_back(jport);
-            }
-            jp["ports"] = ports;
-
-            json config_params = json::array();
-            for (auto& cp : desc->config_params) {
-                json jcp;
-                jcp["id"]           = cp.id;
-                jcp["display_name"] = cp.display_name;
-                jcp["doc"]          = cp.doc;
-                switch (cp.type) {
-                    case ConfigType::String:      jcp["type"] = "string"; break;
-                    case ConfigType::FilePath:    jcp["type"] = "filepath"; break;
-                    case ConfigType::Integer:     jcp["type"] = "integer"; break;
-                    case ConfigType::Float:       jcp["type"] = "float"; break;
-                    case ConfigType::Bool:        jcp["type"] = "bool"; break;
-                    case ConfigType::Categorical: jcp["type"] = "categorical"; break;
-                }
-                jcp["default"] = cp.default_value;
-                if (!cp.file_filter.empty())
-                    jcp["file_filter"] = cp.file_filter;
-                if (!cp.choices.empty())
-                    jcp["choices"] = cp.choices;
-                config_params.push_back(jcp);
-            }
-            jp["config_params"] = config_params;
-
-            plugins.push_back(jp);
+    if (cmd == protocol::CMD_GET_STATS) {
+        auto st = engine_.get_stats(req.value("reset", false));
+        const double budget_us = st.budget_ns / 1e3;
+        auto load = [&](double us) { return budget_us > 0 ? us / budget_us : 0.0; };
+        auto timing = [&](const perf::LoadSummary& l) {
+            return json{{"count",   l.count},
+                        {"mean_us", l.mean_ns() / 1e3},
+                        {"p50_us",  l.p50_ns / 1e3},
+                        {"p99_us",  l.p99_ns / 1e3},
+                        {"max_us",  l.max_ns / 1e3}};
+        };
+
+        json callback = timing(st.callback);
+        callback["budget_us"] = budget_us;
+        callback["mean_load"] = load(st.callback.mean_ns() / 1e3);
+        callback["peak_load"] = load(st.callback.max_ns / 1e3);
+        callback["overruns"]  = st.overruns;
+
+        json nodes = json::array();
+        for (auto& [id, l] : st.nodes) {
+            json jn = timing(l);
+            jn["id"]        = id;
+            jn["mean_load"] = load(l.mean_ns() / 1e3);
+            nodes.push_back(jn);
         }
-        return {{"status", "ok"}, {"plugins", plugins}};
+
+        const auto& rt = st.realtime;
+        json rt_sites = json::array();
+        for (auto& site : rt.sites)
+            rt_sites.push_back({{"kind", rtcheck::kind_name(site.kind)}, {"call", site.call},
+                                {"count", site.count}, {"stack", site.stack}});
+        json realtime = {{"enabled",     rt.enabled},
+                         {"allocations", rt.counts[rtcheck::Alloc]},
+                         {"frees",       rt.counts[rtcheck::Free]},
+                         {"locks",       rt.counts[rtcheck::Lock]},
+                         {"blocking",    rt.counts[rtcheck::Blocking]},
+                         {"unrecorded",  rt.unrecorded},
+                         {"sites",       rt_sites}};
+
+        json preview = json::array();
+        for (auto& [id, depth] : st.preview_queue_depths)
+            preview.push_back({{"node_id", id}, {"depth", depth},
+                               {"capacity", st.preview_queue_capacity}});
+
+        return {{"status", "ok"}, {"enabled", st.enabled},
+                {"sample_rate", (int)engine_.sample_rate()},
+                {"block_size", engine_.block_size()},
+                {"callback", callback},
+                {"xruns", {{"output_underflow", st.output_underflows},
+                           {"output_overflow",  st.output_overflows},
+                           {"input_underflow",  st.input_underflows},
+                           {"input_overflow",   st.input_overflows},
+                           {"priming_output",   st.priming_outputs}}},
+                {"output_latency_ms", st.output_latency_s * 1e3},
+                {"nodes", nodes},
+                {"queues", {{"commands", {{"depth", st.cmd_queue_depth},
+                                          {"capacity", st.cmd_queue_capacity}}},
+                            {"preview", preview}}},
+                {"event_overflows", st.event_overflows},
+                {"realtime", realtime}};
+    }
+
+    // -------------------------------------------------------------------
+    if (cmd == protocol::CMD_OPEN_SHARED_STATE) {
+        std::string name;
+        size_t size = 0;
+        std::string err = engine_.open_shared_state(name, size);
+        if (!err.empty()) return {{"status", "error"}, {"message", err}};
+        return {{"status", "ok"}, {"name", name}, {"size", size},
+                {"version", shm::VERSION}};
+    }
+
+    // -------------------------------------------------------------------
+    if (cmd == protocol::CMD_PRELOAD_SF2) {
+#ifdef AS_ENABLE_SF2
+        for (auto& p : req.value("paths", json::array()))
+            if (p.is_string()) SoundFontCache::preload(p.get<std::string>());
+        return {{"status", "ok"}};
+#else
+        return {{"status", "error"}, {"message", "preload_sf2: built without SF2 support"}};
+#endif
     }
 
     // -------------------------------------------------------------------
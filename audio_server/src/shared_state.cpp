@@ -0,0 +1,165 @@
+// shared_state.cpp
+#include "shared_state.h"
+#include "graph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef AS_PLATFORM_WINDOWS
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <errno.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Region lifetime
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<SharedState> SharedState::create(const std::string& name,
+                                                 std::string& error_out) {
+    const size_t bytes = sizeof(shm::Layout);
+    std::unique_ptr<SharedState> s(new SharedState());
+    s->name_ = name;
+    void* mem = nullptr;
+
+#ifdef AS_PLATFORM_WINDOWS
+    // name is "/audio_server_<pid>"; the mapping lives in the session namespace.
+    std::string tag = "Local\\" + name.substr(name.find_first_not_of('/'));
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        0, static_cast<DWORD>(bytes), tag.c_str());
+    if (!mapping) {
+        error_out = "CreateFileMapping failed: " + std::to_string(GetLastError());
+        return nullptr;
+    }
+    mem = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!mem) {
+        error_out = "MapViewOfFile failed: " + std::to_string(GetLastError());
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    s->mapping_ = mapping;
+#else
+    shm_unlink(name.c_str());   // stale region from a crashed server with our pid
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        error_out = std::string("shm_open failed: ") + std::strerror(errno);
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        error_out = std::string("ftruncate failed: ") + std::strerror(errno);
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        error_out = std::string("mmap failed: ") + std::strerror(errno);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+#endif
+
+    std::memset(mem, 0, bytes);
+    s->layout_ = new (mem) shm::Layout();
+    auto& h = s->layout_->header;
+    h.version         = shm::VERSION;
+    h.size            = static_cast<uint32_t>(bytes);
+    h.monitor_history = shm::MONITOR_HISTORY;
+    h.seq.store(0, std::memory_order_relaxed);
+    // Magic goes in last; readers treat a region without it as not ready.
+    std::atomic_thread_fence(std::memory_order_release);
+    h.magic = shm::MAGIC;
+    return s;
+}
+
+SharedState::~SharedState() {
+    if (!layout_) return;
+#ifdef AS_PLATFORM_WINDOWS
+    UnmapViewOfFile(layout_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+#else
+    munmap(layout_, sizeof(shm::Layout));
+    shm_unlink(name_.c_str());
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Audio-thread publish
+// ---------------------------------------------------------------------------
+
+static void copy_id(char (&dst)[shm::ID_LEN], const std::string& src) {
+    size_t n = std::min(src.size(), size_t(shm::ID_LEN - 1));
+    std::memcpy(dst, src.data(), n);
+    std::memset(dst + n, 0, shm::ID_LEN - n);
+}
+
+static bool same_id(const char (&a)[shm::ID_LEN], const std::string& b) {
+    size_t n = std::min(b.size(), size_t(shm::ID_LEN - 1));
+    return std::strncmp(a, b.c_str(), n) == 0 && a[n] == '\0';
+}
+
+void SharedState::publish(const Graph* graph, double beat, bool playing,
+                          double bpm, float sample_rate) {
+    auto& L = *layout_;
+    auto& h = L.header;
+    const uint32_t seq = h.seq.load(std::memory_order_relaxed);
+    h.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    h.blocks     += 1;
+    h.beat        = beat;
+    h.bpm         = bpm;
+    h.sample_rate = sample_rate;
+    h.playing     = playing ? 1u : 0u;
+
+    if (!graph) {
+        h.graph_serial  = 0;
+        h.meter_count   = 0;
+        h.monitor_count = 0;
+    } else {
+        const auto& meters   = graph->meters();
+        const auto& monitors = graph->monitors();
+        const int   nm = std::min<int>(int(meters.size()),   shm::MAX_METERS);
+        const int   nc = std::min<int>(int(monitors.size()), shm::MAX_MONITORS);
+
+        // Ids only change with the graph.  A monitor slot that now holds a
+        // different node starts a fresh history; nodes kept across a patch
+        // keep theirs.
+        if (h.graph_serial != graph->serial()) {
+            h.graph_serial = graph->serial();
+            for (int i = 0; i < nm; ++i) copy_id(L.meters[i].id, meters[i].id);
+            for (int i = 0; i < nc; ++i) {
+                auto& slot = L.monitors[i];
+                if (same_id(slot.id, monitors[i].id)) continue;
+                copy_id(slot.id, monitors[i].id);
+                slot.count = 0;
+                slot.head  = 0;
+            }
+        }
+
+        for (int i = 0; i < nm; ++i) {
+            auto& m = L.meters[i];
+            m.peak_L = meters[i].peak_L;
+            m.peak_R = meters[i].peak_R;
+            m.rms_L  = meters[i].rms_L;
+            m.rms_R  = meters[i].rms_R;
+        }
+        for (int i = 0; i < nc; ++i) {
+            auto& slot = L.monitors[i];
+            slot.latest = monitors[i].value;
+            slot.history[slot.head] = monitors[i].value;
+            slot.head = (slot.head + 1) % shm::MONITOR_HISTORY;
+            if (slot.count < uint32_t(shm::MONITOR_HISTORY)) ++slot.count;
+        }
+        h.meter_count   = uint32_t(nm);
+        h.monitor_count = uint32_t(nc);
+    }
+
+    h.seq.store(seq + 2, std::memory_order_release);
+}
@@ -0,0 +1,169 @@
+// sine_voice_pool.cpp
+#include "sine_voice_pool.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AS_SINE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr float TWO_PI = 6.28318530717958647692f;
+
+// Taylor coefficients for sin(t), t in [-pi/2, pi/2]; the truncation error
+// at the interval ends is ~3.6e-6.
+constexpr float S3 = -1.0f / 6.0f;
+constexpr float S5 =  1.0f / 120.0f;
+constexpr float S7 = -1.0f / 5040.0f;
+constexpr float S9 =  1.0f / 362880.0f;
+
+// sin(2*pi*p) for p in [0, 1).  sin(2*pi*p) = -sin(2*pi*x) with
+// x = p - 0.5 in [-0.5, 0.5); folding |x| about 0.25 (sin(pi - t) = sin(t))
+// brings the argument into [-pi/2, pi/2].
+inline float sin_cycle(float p) {
+    float x = p - 0.5f;
+    float a = std::min(std::fabs(x), 0.5f - std::fabs(x));
+    float t = std::copysign(a, x) * TWO_PI;
+    float t2 = t * t;
+    return -t * (1.0f + t2 * (S3 + t2 * (S5 + t2 * (S7 + t2 * S9))));
+}
+
+#ifdef AS_SINE_SSE2
+inline __m128 sin_cycle4(__m128 p) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 x  = _mm_sub_ps(p, half);
+    __m128 sx = _mm_and_ps(x, sign);
+    __m128 ax = _mm_andnot_ps(sign, x);
+    __m128 a  = _mm_min_ps(ax, _mm_sub_ps(half, ax));
+    // t = copysign(a, x) * 2pi; the result is negated by the final xor
+    __m128 t  = _mm_mul_ps(_mm_or_ps(a, sx), _mm_set1_ps(TWO_PI));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 r  = _mm_add_ps(_mm_set1_ps(S7), _mm_mul_ps(t2, _mm_set1_ps(S9)));
+    r = _mm_add_ps(_mm_set1_ps(S5), _mm_mul_ps(t2, r));
+    r = _mm_add_ps(_mm_set1_ps(S3), _mm_mul_ps(t2, r));
+    r = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(t2, r));
+    return _mm_xor_ps(_mm_mul_ps(t, r), sign);
+}
+
+// p - floor(p) for non-negative p
+inline __m128 wrap4(__m128 p) {
+    return _mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvttps_epi32(p)));
+}
+#endif
+
+inline float wrap(float p) { return p - static_cast<float>(static_cast<int>(p)); }
+
+// Add one voice to out.  phase and env are advanced in place.  Each sample
+// first decays the envelope, then reads the oscillator, then steps phase.
+void render_voice(float* out, int frames, float& phase, float inc,
+                  float amp, float& env, float decay)
+{
+    int i = 0;
+#ifdef AS_SINE_SSE2
+    if (frames >= 4) {
+        // Lane k holds sample i+k: phase + k*inc, envelope env*decay^k
+        // (the per-sample decay is folded into amp).
+        float d2 = decay * decay;
+        __m128 ph   = wrap4(_mm_setr_ps(phase, phase + inc, phase + 2 * inc, phase + 3 * inc));
+        __m128 ev   = _mm_setr_ps(env, env * decay, env * d2, env * d2 * decay);
+        __m128 step = _mm_set1_ps(4.0f * inc);
+        __m128 d4   = _mm_set1_ps(d2 * d2);
+        __m128 va   = _mm_set1_ps(amp * decay);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 s = _mm_mul_ps(_mm_mul_ps(sin_cycle4(ph), va), ev);
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), s));
+            ph = wrap4(_mm_add_ps(ph, step));
+            ev = _mm_mul_ps(ev, d4);
+        }
+        phase = _mm_cvtss_f32(ph);
+        env   = _mm_cvtss_f32(ev);
+    }
+#endif
+    for (; i < frames; ++i) {
+        env *= decay;
+        out[i] += sin_cycle(phase) * amp * env;
+        phase = wrap(phase + inc);
+    }
+}
+
+} // namespace
+
+void SineVoicePool::reserve(int polyphony) {
+    size_t n = static_cast<size_t>(std::max(1, std::min(MAX_POLYPHONY, polyphony)));
+    phase_.assign(n, 0.0f);
+    inc_.assign(n, 0.0f);
+    amp_.assign(n, 0.0f);
+    env_.assign(n, 0.0f);
+    decay_.assign(n, 1.0f);
+    key_.assign(n, -1);
+    age_.assign(n, 0);
+    count_ = 0;
+}
+
+int SineVoicePool::find(int key) const {
+    for (int i = 0; i < count_; ++i)
+        if (key_[i] == key) return i;
+    return -1;
+}
+
+int SineVoicePool::steal() const {
+    // Quietest releasing voice, else the oldest.
+    int best = -1;
+    for (int i = 0; i < count_; ++i)
+        if (decay_[i] < 1.0f && (best < 0 || env_[i] < env_[best])) best = i;
+    if (best >= 0) return best;
+    best = 0;
+    for (int i = 1; i < count_; ++i)
+        if (next_age_ - age_[i] > next_age_ - age_[best]) best = i;
+    return best;
+}
+
+void SineVoicePool::remove(int slot) {
+    // Swap-remove keeps the active voices packed.
+    int last = --count_;
+    phase_[slot] = phase_[last];
+    inc_[slot]   = inc_[last];
+    amp_[slot]   = amp_[last];
+    env_[slot]   = env_[last];
+    decay_[slot] = decay_[last];
+    key_[slot]   = key_[last];
+    age_[slot]   = age_[last];
+}
+
+void SineVoicePool::note_on(int key, double freq, float sample_rate, float amp) {
+    if (key_.empty()) return;   // not reserved
+    int slot = find(key);
+    if (slot < 0) slot = (count_ < capacity()) ? count_++ : steal();
+    phase_[slot] = 0.0f;
+    inc_[slot]   = wrap(static_cast<float>(freq / sample_rate));
+    amp_[slot]   = amp;
+    env_[slot]   = 1.0f;
+    decay_[slot] = 1.0f;
+    key_[slot]   = key;
+    age_[slot]   = next_age_++;
+}
+
+void SineVoicePool::release(int key, float rate) {
+    int slot = find(key);
+    if (slot >= 0) decay_[slot] = 1.0f - rate;
+}
+
+void SineVoicePool::clear() {
+    count_ = 0;
+}
+
+void SineVoicePool::clear_channel(int channel) {
+    for (int i = count_ - 1; i >= 0; --i)
+        if (key_[i] / 128 == channel) remove(i);
+}
+
+void SineVoicePool::render(float* out, int frames, float gain) {
+    for (int v = 0; v < count_; ++v)
+        render_voice(out, frames, phase_[v], inc_[v], amp_[v] * gain, env_[v], decay_[v]);
+
+    for (int v = count_ - 1; v >= 0; --v)
+        if (decay_[v] < 1.0f && env_[v] < 1e-4f) remove(v);
+}
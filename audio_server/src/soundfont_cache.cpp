@@ -0,0 +1,125 @@
+// soundfont_cache.cpp
+// Shared, reference-counted SoundFont loading for FluidSynth nodes.
+
+#ifdef AS_ENABLE_SF2
+
+#include "soundfont_cache.h"
+#include "debug.h"
+#include <fluidsynth.h>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+// Each font is loaded into a private, never-running synth and shared from
+// there.  Sample data is static (dynamic sample loading is off); the voice
+// counts playing synths keep on it are why sharers never run at once (see
+// soundfont_cache.h).
+SoundFont::~SoundFont() {
+    if (loader_)   delete_fluid_synth(static_cast<fluid_synth_t*>(loader_));
+    if (settings_) delete_fluid_settings(static_cast<fluid_settings_t*>(settings_));
+}
+
+namespace {
+
+using FontFuture = std::shared_future<std::shared_ptr<SoundFont>>;
+
+struct Entry {
+    std::string             path;
+    std::weak_ptr<SoundFont> font;
+    FontFuture              loading;   // valid while a load is in flight or unclaimed
+};
+
+std::mutex                             g_mutex;
+std::unordered_map<std::string, Entry> g_entries;
+
+thread_local SoundFontCache::PrivateScope* t_scope = nullptr;
+
+std::string cache_key(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return path;   // missing file: the load reports the error
+    return path + '@' + std::to_string(mtime.time_since_epoch().count());
+}
+
+// Caller holds g_mutex.  Drops entries nothing holds or waits for.
+void sweep() {
+    for (auto it = g_entries.begin(); it != g_entries.end(); ) {
+        if (it->second.font.expired() && !it->second.loading.valid())
+            it = g_entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace
+
+std::shared_ptr<SoundFont> SoundFontCache::load(const std::string& path) {
+    auto sf = std::make_shared<SoundFont>();
+    sf->path_ = path;
+    auto* settings = new_fluid_settings();
+    fluid_settings_setint(settings, "synth.dynamic-sample-loading", 0);
+    fluid_settings_setint(settings, "synth.threadsafe-api", 0);
+    sf->settings_ = settings;
+    auto* loader = new_fluid_synth(settings);
+    sf->loader_ = loader;
+    if (!loader) return nullptr;
+
+    int id = fluid_synth_sfload(loader, path.c_str(), 0);
+    if (id == FLUID_FAILED) return nullptr;
+    sf->sfont_ = fluid_synth_get_sfont_by_id(loader, id);
+    AS_LOG("sf2", "loaded '%s'", path.c_str());
+    return sf;
+}
+
+std::shared_ptr<SoundFont> SoundFontCache::acquire(const std::string& path,
+                                                   std::string& err) {
+    const std::string key = cache_key(path);
+    if (t_scope) {
+        auto& font = t_scope->fonts_[key];
+        if (!font) font = load(path);
+        if (!font) err = "FluidSynth: failed to load " + path;
+        return font;
+    }
+
+    FontFuture loading;
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        sweep();
+        auto& e = g_entries[key];
+        e.path = path;
+        if (auto font = e.font.lock()) return font;
+        if (!e.loading.valid())
+            e.loading = std::async(std::launch::deferred, load, path).share();
+        loading = e.loading;
+    }
+
+    // Outside the lock: a deferred load runs here, a preload is waited for.
+    // Concurrent acquirers of one key share the same future.
+    auto font = loading.get();
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        auto it = g_entries.find(key);
+        if (it != g_entries.end()) {
+            if (font) it->second.font = font;
+            it->second.loading = {};   // a failed load may be retried
+        }
+    }
+    if (!font) err = "FluidSynth: failed to load " + path;
+    return font;
+}
+
+void SoundFontCache::preload(const std::string& path) {
+    if (path.empty() || t_scope) return;
+    const std::string key = cache_key(path);
+    std::lock_guard<std::mutex> lk(g_mutex);
+    auto& e = g_entries[key];
+    e.path = path;
+    if (!e.font.expired() || e.loading.valid()) return;
+    e.loading = std::async(std::launch::async, load, path).share();
+}
+
+SoundFontCache::PrivateScope::PrivateScope() : outer_(t_scope) { t_scope = this; }
+SoundFontCache::PrivateScope::~PrivateScope() { t_scope = outer_; }
+
+#endif // AS_ENABLE_SF2
@@ -11,10 +11,12 @@
 #include "synth_node.h"
 #include "plugin_api.h"
 #include "plugin_adapter.h"
+#include "dsp_kernels.h"
 #include "debug.h"
 #include <cmath>
 #include <cstdio>
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <stdexcept>
 
@@ -23,10 +25,10 @@
 #endif
 
 // ---------------------------------------------------------------------------
-// SineNode  (unchanged from original)
+// SineNode
 // ---------------------------------------------------------------------------
 
-SineNode::SineNode(const std::string& id_) { id = id_; }
+SineNode::SineNode(const std::string& id_, int polyphony) : polyphony_(polyphony) { id = id_; }
 
 std::vector<Node::PortDecl> SineNode::declare_ports() const {
     return {
@@ -37,39 +39,59 @@ std::vector<Node::PortDecl> SineNode::declare_ports() const {
 
 void SineNode::activate(float sample_rate, int /*max_block_size*/) {
     sample_rate_ = sample_rate;
-    voices_.clear();
+    voices_.reserve(polyphony_);
 }
 
 void SineNode::note_on(int channel, int pitch, int velocity) {
-    int key = channel * 128 + pitch;
-    double freq = 440.0 * std::pow(2.0, (pitch - 69) / 12.0);
-    Voice v;
-    v.freq = freq;
-    v.amp  = velocity / 127.0f * gain_;
-    voices_[key] = v;
+    TimedNote n { event_frame(), channel * 128 + pitch, true,
+                  440.0 * std::pow(2.0, (pitch - 69) / 12.0), velocity / 127.0f * gain_ };
+    if (!queue_note(n)) apply_note(n);
 }
 
 void SineNode::note_off(int channel, int pitch) {
-    int key = channel * 128 + pitch;
-    auto it = voices_.find(key);
-    if (it != voices_.end()) {
-        it->second.releasing  = true;
-        it->second.env_release = 30.0f / sample_rate_;
-    }
+    TimedNote n { event_frame(), channel * 128 + pitch, false, 0.0, 0.0f };
+    if (!queue_note(n)) apply_note(n);
+}
+
+bool SineNode::queue_note(const TimedNote& n) {
+    // Start-of-block notes with nothing pending need no segment split.
+    if (n.frame <= 0 && n_timed_ == 0) return false;
+    if (n_timed_ == MAX_TIMED_NOTES) return false;
+    // Stable insert by frame; arrivals are nearly always already in order.
+    int i = n_timed_++;
+    for (; i > 0 && timed_[i - 1].frame > n.frame; --i) timed_[i] = timed_[i - 1];
+    timed_[i] = n;
+    return true;
+}
+
+void SineNode::apply_note(const TimedNote& n) {
+    if (n.on) voices_.note_on(n.key, n.freq, sample_rate_, n.amp);
+    else      voices_.release(n.key, 30.0f / sample_rate_);
 }
 
 void SineNode::all_notes_off(int channel) {
-    if (channel == -1) voices_.clear();
-    else {
-        for (auto it = voices_.begin(); it != voices_.end(); ) {
-            if (it->first / 128 == channel) it = voices_.erase(it);
-            else ++it;
-        }
+    if (channel == -1) {
+        n_timed_ = 0;
+        voices_.clear();
+    } else {
+        int kept = 0;
+        for (int i = 0; i < n_timed_; ++i)
+            if (timed_[i].key / 128 != channel) timed_[kept++] = timed_[i];
+        n_timed_ = kept;
+        voices_.clear_channel(channel);
     }
 }
 
 void SineNode::set_param(const std::string& name, float value) {
-    if (name == "gain") gain_ = std::max(0.0f, std::min(1.0f, value));
+    set_param_index(param_index(name), value);
+}
+
+int SineNode::param_index(const std::string& name) const {
+    return name == "gain" ? 0 : -1;
+}
+
+void SineNode::set_param_index(int index, float value) {
+    if (index == 0) gain_ = std::max(0.0f, std::min(1.0f, value));
 }
 
 void SineNode::process(const ProcessContext& ctx,
@@ -78,32 +100,26 @@ void SineNode::process(const ProcessContext& ctx,
 {
     float* L = outputs[0].audio;
     float* R = outputs[1].audio;
-    std::memset(L, 0, ctx.block_size * sizeof(float));
-    std::memset(R, 0, ctx.block_size * sizeof(float));
-
-    std::vector<int> dead;
-    for (auto& [key, v] : voices_) {
-        double phase_inc = 2.0 * M_PI * v.freq / sample_rate_;
-        for (int i = 0; i < ctx.block_size; ++i) {
-            float env = v.releasing ? (v.env *= (1.0f - v.env_release)) : 1.0f;
-            float sample = static_cast<float>(std::sin(v.phase)) * v.amp * env;
-            L[i] += sample;
-            R[i] += sample;
-            v.phase += phase_inc;
-            if (v.phase > 2.0 * M_PI) v.phase -= 2.0 * M_PI;
+    dsp::zero(L, ctx.block_size);
+
+    int pos = 0;
+    for (int i = 0; i < n_timed_; ++i) {
+        int frame = std::min(timed_[i].frame, ctx.block_size);
+        if (frame > pos) {
+            voices_.render(L + pos, frame - pos, 1.0f);
+            pos = frame;
         }
-        if (v.releasing && v.env < 1e-4f) dead.push_back(key);
+        apply_note(timed_[i]);
     }
-    for (int k : dead) voices_.erase(k);
+    n_timed_ = 0;
+    voices_.render(L + pos, ctx.block_size - pos, 1.0f);
 
-    for (int i = 0; i < ctx.block_size; ++i) {
-        L[i] = std::tanh(L[i]);
-        R[i] = std::tanh(R[i]);
-    }
+    dsp::soft_clip(L, ctx.block_size);
+    dsp::copy(R, L, ctx.block_size);
 }
 
 // ---------------------------------------------------------------------------
-// MixerNode  (unchanged from original)
+// MixerNode
 // ---------------------------------------------------------------------------
 
 MixerNode::MixerNode(const std::string& id_, int input_count)
@@ -134,42 +150,51 @@ void MixerNode::process(const ProcessContext& ctx,
 {
     float* out_L = outputs[0].audio;
     float* out_R = outputs[1].audio;
-    std::memset(out_L, 0, ctx.block_size * sizeof(float));
-    std::memset(out_R, 0, ctx.block_size * sizeof(float));
+    dsp::zero(out_L, ctx.block_size);
+    dsp::zero(out_R, ctx.block_size);
 
     for (int ch = 0; ch < input_count_; ++ch) {
+        const auto& in_L = inputs[ch * 2];
+        const auto& in_R = inputs[ch * 2 + 1];
         float g = channel_gain_[ch] * master_gain_;
-        const float* in_L = inputs[ch * 2    ].audio;
-        const float* in_R = inputs[ch * 2 + 1].audio;
-        for (int i = 0; i < ctx.block_size; ++i) {
-            out_L[i] += in_L[i] * g;
-            out_R[i] += in_R[i] * g;
-        }
+        if (!in_L.is_silent(ctx.block_size))
+            dsp::gain_accumulate(out_L, in_L.audio, g, ctx.block_size);
+        if (!in_R.is_silent(ctx.block_size))
+            dsp::gain_accumulate(out_R, in_R.audio, g, ctx.block_size);
     }
 
-    for (int i = 0; i < ctx.block_size; ++i) {
-        out_L[i] = std::tanh(out_L[i]);
-        out_R[i] = std::tanh(out_R[i]);
-    }
+    dsp::soft_clip(out_L, ctx.block_size);
+    dsp::soft_clip(out_R, ctx.block_size);
 }
 
 void MixerNode::set_param(const std::string& name, float value) {
-    if (name == "master_gain") {
-        master_gain_ = std::max(0.0f, value);
-        return;
-    }
-    if (name.substr(0, 5) == "gain_") {
-        int n = std::stoi(name.substr(5));
-        if (n >= 0 && n < input_count_)
-            channel_gain_[n] = std::max(0.0f, value);
+    set_param_index(param_index(name), value);
+}
+
+int MixerNode::param_index(const std::string& name) const {
+    if (name == "master_gain") return 0;
+    if (name.size() <= 5 || name.compare(0, 5, "gain_") != 0) return -1;
+    int n = 0;
+    for (size_t i = 5; i < name.size(); ++i) {
+        if (name[i] < '0' || name[i] > '9') return -1;
+        n = n * 10 + (name[i] - '0');
+        if (n >= input_count_) return -1;
     }
+    return 1 + n;
+}
+
+void MixerNode::set_param_index(int index, float value) {
+    if (index == 0)
+        master_gain_ = std::max(0.0f, value);
+    else if (index > 0 && index <= input_count_)
+        channel_gain_[index - 1] = std::max(0.0f, value);
 }
 
 // ---------------------------------------------------------------------------
-// ControlSourceNode  (unchanged from original)
+// ControlSourceNode
 // ---------------------------------------------------------------------------
 
-ControlSourceNode::ControlSourceNode(const std::string& id_) { id = id_; }
+ControlSourceNode::ControlSourceNode(const std::string& id_, bool ramp) : ramp_(ramp) { id = id_; }
 
 std::vector<Node::PortDecl> ControlSourceNode::declare_ports() const {
     return {
@@ -183,16 +208,27 @@ void ControlSourceNode::push_control(double beat, float value) {
     write_idx_.store(wi + 1, std::memory_order_release);
 }
 
-void ControlSourceNode::process(const ProcessContext& /*ctx*/,
+void ControlSourceNode::process(const ProcessContext& ctx,
                                   const std::vector<PortBuffer>& /*inputs*/,
                                   std::vector<PortBuffer>& outputs)
 {
-    int wi = write_idx_.load(std::memory_order_acquire);
+    int   wi    = write_idx_.load(std::memory_order_acquire);
+    float start = current_;
+    int   frame = 0;   // where the last value of this block lands
     while (read_idx_ < wi) {
-        current_ = ring_[read_idx_ % RING_SIZE].value;
+        const auto& cp = ring_[read_idx_ % RING_SIZE];
+        current_ = cp.value;
+        if (ramp_ && ctx.beats_per_sample > 0.0) {
+            double f = (cp.beat - ctx.beat_position) / ctx.beats_per_sample;
+            frame = std::clamp(static_cast<int>(f + 0.5), 0, ctx.block_size);
+        }
         read_idx_++;
     }
     outputs[0].control = current_;
+    if (frame > 0 && current_ != start) {
+        outputs[0].ramp_from   = start;
+        outputs[0].ramp_frames = frame;
+    }
 }
 
 // ---------------------------------------------------------------------------
@@ -202,19 +238,30 @@ void ControlSourceNode::process(const ProcessContext& /*ctx*/,
 #ifdef AS_ENABLE_SF2
 #include <fluidsynth.h>
 
-FluidSynthNode::FluidSynthNode(const std::string& id_, const std::string& sf2_path)
+FluidSynthNode::FluidSynthNode(const std::string& id_, const std::string& sf2_path,
+                               int audio_outputs)
     : sf2_path_(sf2_path)
+    , n_outputs_(std::max(1, std::min(MAX_OUTPUTS, audio_outputs)))
 {
     id = id_;
+    // Graphs build every node before activating any, so distinct files
+    // load in parallel while the rest of the graph is constructed.
+    SoundFontCache::preload(sf2_path_);
 }
 
 FluidSynthNode::~FluidSynthNode() { deactivate(); }
 
 std::vector<Node::PortDecl> FluidSynthNode::declare_ports() const {
-    return {
+    std::vector<PortDecl> ports = {
         {"audio_out_L", PortType::AudioMono, true},
         {"audio_out_R", PortType::AudioMono, true},
     };
+    for (int k = 1; k < n_outputs_; ++k) {
+        std::string pair = "audio_out_" + std::to_string(k);
+        ports.push_back({pair + "_L", PortType::AudioMono, true});
+        ports.push_back({pair + "_R", PortType::AudioMono, true});
+    }
+    return ports;
 }
 
 void FluidSynthNode::activate(float sample_rate, int max_block_size) {
@@ -228,44 +275,82 @@ void FluidSynthNode::activate(float sample_rate, int max_block_size) {
                           "synth.gain", 0.15);
     fluid_settings_setint(static_cast<fluid_settings_t*>(fset_),
                           "synth.threadsafe-api", 0);
+    // One output pair and one reverb/chorus unit per group; MIDI channels
+    // are assigned to groups modulo the group count.
+    fluid_settings_setint(static_cast<fluid_settings_t*>(fset_),
+                          "synth.audio-channels", n_outputs_);
+    fluid_settings_setint(static_cast<fluid_settings_t*>(fset_),
+                          "synth.audio-groups", n_outputs_);
+    fluid_settings_setint(static_cast<fluid_settings_t*>(fset_),
+                          "synth.effects-groups", n_outputs_);
 
     fs_ = new_fluid_synth(static_cast<fluid_settings_t*>(fset_));
-    sfid_ = fluid_synth_sfload(static_cast<fluid_synth_t*>(fs_),
-                                sf2_path_.c_str(), 1);
+    std::string err;
+    sfont_ = SoundFontCache::acquire(sf2_path_, err);
+    if (!sfont_) throw std::runtime_error(err);
+    sfid_ = fluid_synth_add_sfont(static_cast<fluid_synth_t*>(fs_),
+                                  static_cast<fluid_sfont_t*>(sfont_->sfont()));
     if (sfid_ == FLUID_FAILED)
-        throw std::runtime_error("FluidSynth: failed to load " + sf2_path_);
+        throw std::runtime_error("FluidSynth: failed to add " + sf2_path_);
 
     for (int ch = 0; ch < 16; ++ch)
         if (ch != 9)
             fluid_synth_program_select(static_cast<fluid_synth_t*>(fs_),
                                        ch, sfid_, 0, 0);
-
-    raw_buf_.resize(max_block_size * 2);
 }
 
 void FluidSynthNode::deactivate() {
+    // The cache owns the font: take it back before the synth would free it.
+    if (fs_ && sfont_ && sfid_ != -1)
+        fluid_synth_remove_sfont(static_cast<fluid_synth_t*>(fs_),
+                                 static_cast<fluid_sfont_t*>(sfont_->sfont()));
     if (fs_)   { delete_fluid_synth(static_cast<fluid_synth_t*>(fs_));     fs_   = nullptr; }
     if (fset_) { delete_fluid_settings(static_cast<fluid_settings_t*>(fset_)); fset_ = nullptr; }
+    sfont_.reset();
     sfid_ = -1;
 }
 
-void FluidSynthNode::note_on(int ch, int pitch, int vel) {
-    fluid_synth_noteon(static_cast<fluid_synth_t*>(fs_), ch, pitch, vel);
-}
-void FluidSynthNode::note_off(int ch, int pitch) {
-    fluid_synth_noteoff(static_cast<fluid_synth_t*>(fs_), ch, pitch);
-}
-void FluidSynthNode::program_change(int ch, int bank, int prog) {
-    fluid_synth_program_select(static_cast<fluid_synth_t*>(fs_), ch, sfid_, bank, prog);
-}
-void FluidSynthNode::pitch_bend(int ch, int value) {
-    fluid_synth_pitch_bend(static_cast<fluid_synth_t*>(fs_), ch, value);
+void FluidSynthNode::note_on(int ch, int pitch, int vel) { post(EvKind::NoteOn, ch, pitch, vel); }
+void FluidSynthNode::note_off(int ch, int pitch)        { post(EvKind::NoteOff, ch, pitch); }
+void FluidSynthNode::program_change(int ch, int bank, int prog) { post(EvKind::Program, ch, bank, prog); }
+void FluidSynthNode::pitch_bend(int ch, int value)      { post(EvKind::Bend, ch, value); }
+void FluidSynthNode::channel_volume(int ch, int vol)    { post(EvKind::Volume, ch, vol); }
+
+void FluidSynthNode::post(EvKind kind, int channel, int a, int b) {
+    TimedEvent ev { event_frame(), kind, channel, a, b };
+    // Start-of-block events with nothing pending need no segment split.
+    if ((ev.frame <= 0 && n_timed_ == 0) || n_timed_ == MAX_TIMED_EVENTS) {
+        apply(ev);
+        return;
+    }
+    int i = n_timed_++;
+    for (; i > 0 && timed_[i - 1].frame > ev.frame; --i) timed_[i] = timed_[i - 1];
+    timed_[i] = ev;
 }
-void FluidSynthNode::channel_volume(int ch, int vol) {
-    fluid_synth_cc(static_cast<fluid_synth_t*>(fs_), ch, 7, std::max(0, std::min(127, vol)));
+
+void FluidSynthNode::apply(const TimedEvent& ev) {
+    auto* fs = static_cast<fluid_synth_t*>(fs_);
+    switch (ev.kind) {
+    case EvKind::NoteOn:  fluid_synth_noteon(fs, ev.channel, ev.a, ev.b);              break;
+    case EvKind::NoteOff: fluid_synth_noteoff(fs, ev.channel, ev.a);                   break;
+    case EvKind::Program: fluid_synth_program_select(fs, ev.channel, sfid_, ev.a, ev.b); break;
+    case EvKind::Bend:    fluid_synth_pitch_bend(fs, ev.channel, ev.a);                break;
+    case EvKind::Volume:
+        fluid_synth_cc(fs, ev.channel, 7, std::max(0, std::min(127, ev.a)));
+        break;
+    }
 }
+
 void FluidSynthNode::all_notes_off(int channel) {
     auto* fs = static_cast<fluid_synth_t*>(fs_);
+    // Pending notes are dropped; pending program/volume changes still apply.
+    int kept = 0;
+    for (int i = 0; i < n_timed_; ++i) {
+        const auto& ev = timed_[i];
+        bool note = ev.kind == EvKind::NoteOn || ev.kind == EvKind::NoteOff;
+        if (!(note && (channel == -1 || ev.channel == channel))) timed_[kept++] = ev;
+    }
+    n_timed_ = kept;
     if (channel == -1) {
         for (int ch = 0; ch < 16; ++ch) {
             fluid_synth_cc(fs, ch, 123, 0);
@@ -281,14 +366,48 @@ void FluidSynthNode::process(const ProcessContext& ctx,
                                const std::vector<PortBuffer>& /*inputs*/,
                                std::vector<PortBuffer>& outputs)
 {
+    // Render up to each timed event, apply it, carry on.
+    int pos = 0;
+    for (int i = 0; i < n_timed_; ++i) {
+        int frame = std::min(timed_[i].frame, ctx.block_size);
+        if (frame > pos) {
+            render(outputs, pos, frame - pos);
+            pos = frame;
+        }
+        apply(timed_[i]);
+    }
+    n_timed_ = 0;
+    if (pos < ctx.block_size)
+        render(outputs, pos, ctx.block_size - pos);
+    for (auto& out : outputs) {
+        float* buf = out.audio;
+        for (int i = 0; i < ctx.block_size; ++i)
+            if (buf[i] > 0.95f || buf[i] < -0.95f) buf[i] = std::tanh(buf[i]);
+    }
+}
+
+void FluidSynthNode::render(std::vector<PortBuffer>& outputs, int pos, int frames) {
     auto* fs = static_cast<fluid_synth_t*>(fs_);
-    float* L = outputs[0].audio;
-    float* R = outputs[1].audio;
-    fluid_synth_write_float(fs, ctx.block_size, L, 0, 1, R, 0, 1);
-    for (int i = 0; i < ctx.block_size; ++i) {
-        if (L[i] > 0.95f || L[i] < -0.95f) L[i] = std::tanh(L[i]);
-        if (R[i] > 0.95f || R[i] < -0.95f) R[i] = std::tanh(R[i]);
+    if (n_outputs_ == 1) {
+        // Stereo: the float writer mixes the effects into the dry pair.
+        fluid_synth_write_float(fs, frames, outputs[0].audio, pos, 1,
+                                outputs[1].audio, pos, 1);
+        return;
+    }
+    // fluid_synth_process() adds into its buffers and sends effects to
+    // separate ones, laid out per group as reverb L/R then chorus L/R;
+    // point each group's effects at its own dry pair.
+    float* out[2 * MAX_OUTPUTS];
+    float* fx[4 * MAX_OUTPUTS];
+    for (int k = 0; k < 2 * n_outputs_; ++k) {
+        out[k] = outputs[k].audio + pos;
+        std::memset(out[k], 0, frames * sizeof(float));
     }
+    for (int g = 0; g < n_outputs_; ++g) {
+        fx[4 * g + 0] = fx[4 * g + 2] = out[2 * g];
+        fx[4 * g + 1] = fx[4 * g + 3] = out[2 * g + 1];
+    }
+    fluid_synth_process(fs, frames, 4 * n_outputs_, fx, 2 * n_outputs_, out);
 }
 
 #endif // AS_ENABLE_SF2
@@ -471,10 +590,7 @@ LV2Node::LV2Node(const std::string& id_, const std::string& uri) {
     impl_ = std::make_unique<Impl>();
     impl_->world = static_cast<LilvWorld*>(lv2_world_acquire());
 
-    auto* plugins = lilv_world_get_all_plugins(impl_->world);
-    LilvNode* uri_node = lilv_new_uri(impl_->world, uri.c_str());
-    impl_->plugin = lilv_plugins_get_by_uri(plugins, uri_node);
-    lilv_node_free(uri_node);
+    impl_->plugin = static_cast<const LilvPlugin*>(lv2_world_load_plugin(impl_->world, uri));
 
     if (!impl_->plugin) {
         lv2_world_release();
@@ -749,14 +865,27 @@ void LV2Node::deactivate() {
 }
 
 void LV2Node::set_param(const std::string& name, float value) {
-    for (auto& p : impl_->ports) {
-        if (p.symbol == name && p.type == PortType::Control && !p.is_output && p.graph_visible) {
-            AS_LOG("lv2", "set_param '%s': %s = %.4f", id.c_str(), name.c_str(), value);
-            p.value = value;
-            return;
-        }
+    int index = param_index(name);
+    if (index < 0) {
+        AS_LOG("lv2", "set_param '%s': unknown param '%s' (no-op)", id.c_str(), name.c_str());
+        return;
     }
-    AS_LOG("lv2", "set_param '%s': unknown param '%s' (no-op)", id.c_str(), name.c_str());
+    AS_LOG("lv2", "set_param '%s': %s = %.4f", id.c_str(), name.c_str(), value);
+    set_param_index(index, value);
+}
+
+int LV2Node::param_index(const std::string& name) const {
+    for (size_t i = 0; i < impl_->ports.size(); ++i) {
+        auto& p = impl_->ports[i];
+        if (p.symbol == name && p.type == PortType::Control && !p.is_output && p.graph_visible)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void LV2Node::set_param_index(int index, float value) {
+    if (index < 0 || index >= static_cast<int>(impl_->ports.size())) return;
+    impl_->ports[index].value = value;
 }
 
 // ---------------------------------------------------------------------------
@@ -898,19 +1027,43 @@ TrackSourceNode::TrackSourceNode(const std::string& id_) { id = id_; }
 
 std::vector<Node::PortDecl> TrackSourceNode::declare_ports() const { return {}; }
 
-void TrackSourceNode::process(const ProcessContext& /*ctx*/,
+// Scheduled and preview events keep their frame offset on the way downstream.
+template <typename F>
+static void fan_out(const std::vector<Node*>& nodes, int frame, F&& call) {
+    for (auto* n : nodes) {
+        n->set_event_frame(frame);
+        call(n);
+        n->set_event_frame(0);
+    }
+}
+
+void TrackSourceNode::process(const ProcessContext& ctx,
                                const std::vector<PortBuffer>& /*inputs*/,
                                std::vector<PortBuffer>& /*outputs*/)
 {
-    std::lock_guard<std::mutex> lk(preview_mutex_);
-    for (auto& [ch, pitch] : pending_off_) {
-        if (ch == -1) for (auto* n : downstream_) n->all_notes_off(-1);
-        else          for (auto* n : downstream_) n->note_off(ch, pitch);
+    if (preview_.empty()) return;
+    // An event that arrived age frames ago lands block_size - age frames in,
+    // giving every preview the same one-block latency; older ones start the
+    // block.
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    PreviewEvent ev;
+    while (preview_.pop(ev)) {
+        double age = (now - ev.arrival_ns) * 1e-9 * ctx.sample_rate;
+        int frame  = std::max(0, std::min(ctx.block_size - 1,
+                                          static_cast<int>(ctx.block_size - age)));
+        switch (ev.kind) {
+        case PreviewEvent::NoteOn:
+            fan_out(downstream_, frame, [&](Node* n) { n->note_on(ev.channel, ev.pitch, ev.velocity); });
+            break;
+        case PreviewEvent::NoteOff:
+            fan_out(downstream_, frame, [&](Node* n) { n->note_off(ev.channel, ev.pitch); });
+            break;
+        case PreviewEvent::AllOff:
+            for (auto* n : downstream_) n->all_notes_off(-1);
+            break;
+        }
     }
-    pending_off_.clear();
-    for (auto& pn : pending_on_)
-        for (auto* n : downstream_) n->note_on(pn.channel, pn.pitch, pn.velocity);
-    pending_on_.clear();
 }
 
 void TrackSourceNode::set_downstream(std::vector<Node*> nodes) {
@@ -920,39 +1073,41 @@ void TrackSourceNode::set_downstream(std::vector<Node*> nodes) {
 }
 
 void TrackSourceNode::note_on(int channel, int pitch, int velocity) {
-    for (auto* n : downstream_) n->note_on(channel, pitch, velocity);
+    fan_out(downstream_, event_frame(), [&](Node* n) { n->note_on(channel, pitch, velocity); });
 }
 void TrackSourceNode::note_off(int channel, int pitch) {
-    for (auto* n : downstream_) n->note_off(channel, pitch);
+    fan_out(downstream_, event_frame(), [&](Node* n) { n->note_off(channel, pitch); });
 }
 void TrackSourceNode::program_change(int channel, int bank, int program) {
-    for (auto* n : downstream_) n->program_change(channel, bank, program);
+    fan_out(downstream_, event_frame(), [&](Node* n) { n->program_change(channel, bank, program); });
 }
 void TrackSourceNode::pitch_bend(int channel, int value) {
-    for (auto* n : downstream_) n->pitch_bend(channel, value);
+    fan_out(downstream_, event_frame(), [&](Node* n) { n->pitch_bend(channel, value); });
 }
 void TrackSourceNode::channel_volume(int channel, int volume) {
-    for (auto* n : downstream_) n->channel_volume(channel, volume);
+    fan_out(downstream_, event_frame(), [&](Node* n) { n->channel_volume(channel, volume); });
 }
 void TrackSourceNode::all_notes_off(int channel) {
     for (auto* n : downstream_) n->all_notes_off(channel);
 }
-void TrackSourceNode::preview_note_on(int channel, int pitch, int velocity) {
-    std::lock_guard<std::mutex> lk(preview_mutex_);
-    pending_on_.push_back({channel, pitch, velocity});
+bool TrackSourceNode::post_preview(PreviewEvent::Kind kind, int channel, int pitch, int velocity) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lk(preview_push_mutex_);
+    return preview_.push({kind, channel, pitch, velocity, now});
 }
-void TrackSourceNode::preview_note_off(int channel, int pitch) {
-    std::lock_guard<std::mutex> lk(preview_mutex_);
-    pending_off_.push_back({channel, pitch});
+bool TrackSourceNode::preview_note_on(int channel, int pitch, int velocity) {
+    return post_preview(PreviewEvent::NoteOn, channel, pitch, velocity);
 }
-void TrackSourceNode::preview_all_notes_off() {
-    std::lock_guard<std::mutex> lk(preview_mutex_);
-    pending_on_.clear();
-    pending_off_.push_back({-1, -1});
+bool TrackSourceNode::preview_note_off(int channel, int pitch) {
+    return post_preview(PreviewEvent::NoteOff, channel, pitch, 0);
+}
+bool TrackSourceNode::preview_all_notes_off() {
+    return post_preview(PreviewEvent::AllOff, -1, -1, 0);
 }
 
 // ---------------------------------------------------------------------------
-// NoteGateNode  (unchanged from original)
+// NoteGateNode
 // ---------------------------------------------------------------------------
 
 NoteGateNode::NoteGateNode(const std::string& id_, int pitch_lo, int pitch_hi, int mode)
@@ -997,11 +1152,22 @@ void NoteGateNode::all_notes_off(int channel) {
 }
 
 void NoteGateNode::set_param(const std::string& name, float value) {
-    if (name == "pitch_lo")
+    set_param_index(param_index(name), value);
+}
+
+int NoteGateNode::param_index(const std::string& name) const {
+    if (name == "pitch_lo") return 0;
+    if (name == "pitch_hi") return 1;
+    if (name == "mode")     return 2;
+    return -1;
+}
+
+void NoteGateNode::set_param_index(int index, float value) {
+    if (index == 0)
         pitch_lo_ = std::max(0, std::min(127, static_cast<int>(value)));
-    else if (name == "pitch_hi")
+    else if (index == 1)
         pitch_hi_ = std::max(0, std::min(127, static_cast<int>(value)));
-    else if (name == "mode")
+    else if (index == 2)
         mode_ = std::max(0, std::min(3, static_cast<int>(value)));
     recompute_value_();
 }
@@ -1058,12 +1224,16 @@ std::unique_ptr<Node> make_node(const NodeDesc& desc, std::string& err) {
             plugin->configure("sf2_path", desc.sf2_path);
         if (desc.channel_count != 2)  // only if non-default
             plugin->configure("channel_count", std::to_string(desc.channel_count));
+        if (desc.audio_outputs != 1)
+            plugin->configure("audio_outputs", std::to_string(desc.audio_outputs));
         if (desc.pitch_lo != 0)
             plugin->configure("pitch_lo", std::to_string(desc.pitch_lo));
         if (desc.pitch_hi != 127)
             plugin->configure("pitch_hi", std::to_string(desc.pitch_hi));
         if (desc.gate_mode != 0)
             plugin->configure("gate_mode", std::to_string(desc.gate_mode));
+        if (desc.polyphony != SineVoicePool::DEFAULT_POLYPHONY)
+            plugin->configure("polyphony", std::to_string(desc.polyphony));
         // Generic float params
         for (auto& [k, v] : desc.params) {
             plugin->configure(k, std::to_string(v));
@@ -1072,12 +1242,17 @@ std::unique_ptr<Node> make_node(const NodeDesc& desc, std::string& err) {
     }
 
     // --- Legacy built-in types ---
+    if (desc.type == "sampler") {
+        NodeDesc d = desc;
+        d.type = "builtin.sampler";
+        return make_node(d, err);
+    }
     if (desc.type == "sine")
-        return std::make_unique<SineNode>(desc.id);
+        return std::make_unique<SineNode>(desc.id, desc.polyphony);
     if (desc.type == "mixer")
         return std::make_unique<MixerNode>(desc.id, desc.channel_count);
     if (desc.type == "control_source")
-        return std::make_unique<ControlSourceNode>(desc.id);
+        return std::make_unique<ControlSourceNode>(desc.id, desc.ramp);
     if (desc.type == "track_source")
         return std::make_unique<TrackSourceNode>(desc.id);
     if (desc.type == "note_gate")
@@ -1085,7 +1260,7 @@ std::unique_ptr<Node> make_node(const NodeDesc& desc, std::string& err) {
 #ifdef AS_ENABLE_SF2
     if (desc.type == "fluidsynth") {
         if (desc.sf2_path.empty()) { err = "fluidsynth node requires sf2_path"; return nullptr; }
-        try { return std::make_unique<FluidSynthNode>(desc.id, desc.sf2_path); }
+        try { return std::make_unique<FluidSynthNode>(desc.id, desc.sf2_path, desc.audio_outputs); }
         catch (const std::exception& e) { err = e.what(); return nullptr; }
     }
 #endif
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+test_bindings.py — Smoke-test for the arranger_engine extension's typed methods:
+render(), set_schedule() with EVENT_DTYPE records, and resolve_params() /
+set_params().  No server process and no audio device: everything is an
+offline render in-process.
+
+Build the module first (cmake -DENABLE_PYTHON_BINDINGS=ON; it lands in
+standalone/).  Skips, exit status 0, when it or numpy is missing.
+
+Usage:
+    python3 test/test_bindings.py
+"""
+
+import json, sys
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent.parent / "standalone"))
+
+try:
+    import numpy as np
+    import arranger_engine as ae
+except ImportError as e:
+    print(f"SKIP: {e}")
+    sys.exit(0)
+
+
+PASS = "\033[32mPASS\033[0m"
+FAIL = "\033[31mFAIL\033[0m"
+failures = 0
+
+def check(label, cond, detail=""):
+    global failures
+    tag = PASS if cond else FAIL
+    print(f"  [{tag}] {label}" + (f"  ({detail})" if detail else ""))
+    failures += not cond
+    return cond
+
+def raises(exc, fn, *args):
+    try:
+        fn(*args)
+    except exc:
+        return True
+    return False
+
+
+GRAPH = {
+    "cmd": "set_graph", "bpm": 120,
+    "nodes": [
+        {"id": "synth", "type": "sine"},
+        {"id": "mixer", "type": "mixer", "channel_count": 1},
+    ],
+    "connections": [
+        {"from_node": "synth", "from_port": "audio_out_L", "to_node": "mixer", "to_port": "audio_in_L_0"},
+        {"from_node": "synth", "from_port": "audio_out_R", "to_node": "mixer", "to_port": "audio_in_R_0"},
+    ],
+}
+
+def make_events():
+    ev = np.zeros(2, dtype=ae.EVENT_DTYPE)
+    ev[0] = (0.0, 0.0, 0, 0, 0, 69, 100)   # note_on A4 at beat 0
+    ev[1] = (1.0, 0.0, 0, 1, 0, 69, 0)     # note_off at beat 1
+    return ev
+
+
+def main():
+    cfg = ae.AudioEngineConfig()
+    cfg.sample_rate = 44100
+    cfg.block_size = 512
+    server = ae.AudioServer(cfg)
+
+    print("\n--- EVENT_DTYPE ---")
+    check("20-byte packed record", ae.EVENT_DTYPE.itemsize == 20)
+    check("field offsets", [ae.EVENT_DTYPE.fields[n][1] for n in ae.EVENT_DTYPE.names]
+          == [0, 8, 12, 16, 17, 18, 19])
+
+    resp = json.loads(server.handle(json.dumps(GRAPH)))
+    check("set_graph", resp.get("status") == "ok", resp)
+
+    print("\n--- set_schedule ---")
+    events = make_events()
+    server.set_schedule(events, ["synth"])
+    check("accepts EVENT_DTYPE records", True)
+    check("rejects another dtype",
+          raises(TypeError, server.set_schedule, np.zeros(2, dtype=np.float64), ["synth"]))
+    check("rejects a strided view",
+          raises(ValueError, server.set_schedule, np.zeros(4, dtype=ae.EVENT_DTYPE)[::2], ["synth"]))
+    check("rejects a bad node index", raises(RuntimeError, server.set_schedule, events, []))
+
+    print("\n--- render ---")
+    pcm = server.render(0.5)              # 1 beat at 120 bpm + 0.5 s tail
+    check("(frames, 2) float32", pcm.ndim == 2 and pcm.shape[1] == 2 and pcm.dtype == np.float32,
+          f"{pcm.shape} {pcm.dtype}")
+    check("1 s of audio", pcm.shape[0] == 44100, pcm.shape[0])
+    check("C-contiguous", pcm.flags["C_CONTIGUOUS"])
+    check("owns no copy (base holds the engine buffer)", not pcm.flags["OWNDATA"] and pcm.base is not None)
+    peak = float(np.abs(pcm).max())
+    check("the note is heard", np.isfinite(pcm).all() and peak > 0.01, f"peak {peak:.3f}")
+
+    print("\n--- set_params ---")
+    graph, handles = server.resolve_params(["mixer", "no_such"], ["master_gain", "gain"])
+    check("handles", handles.dtype == np.int32 and handles[0] >= 0 and handles[1] == -1, handles)
+    server.set_params(graph, handles[:1], [0.0])
+    silent = server.render(0.5)
+    check("master_gain 0 silences the render", float(np.abs(silent).max()) == 0.0)
+    server.set_params(graph, handles[:1].tolist(), np.array([1.0]))   # forcecast
+    check("restored gain", float(np.abs(server.render(0.5)).max()) > 0.01)
+    check("rejects mismatched lengths",
+          raises(ValueError, server.set_params, graph, handles, [1.0]))
+    check("rejects a stale graph",
+          raises(RuntimeError, server.set_params, graph % 0xFFFFFFFF + 1, handles[:1], [1.0]))
+
+    print("\nAll binding tests passed." if not failures else f"\n{failures} check(s) FAILED.")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
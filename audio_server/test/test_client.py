@@ -52,6 +52,9 @@ if IS_WINDOWS:
 else:
     DEFAULT_ADDRESS = "/tmp/audio_server.sock"
 
+# Length-prefix bit marking a binary frame (mirrors protocol.h BINARY_FRAME_FLAG)
+BINARY_FRAME_FLAG = 0x80000000
+
 
 # ---------------------------------------------------------------------------
 # IPC client
@@ -62,12 +65,15 @@ class AudioServerClient:
 
     Mirrors IpcClient in ipc.h — 4-byte LE length prefix, then UTF-8 JSON.
     This is the class that server_engine.py wraps in the actual frontend.
+    send()/send_binary() hold a lock for the whole request/reply exchange so
+    helper threads (e.g. delayed note_off) can share the connection.
     """
 
     def __init__(self, address: str = DEFAULT_ADDRESS):
         self.address = address
         self._sock = None
         self._pipe = None  # Windows only
+        self._lock = threading.Lock()
 
     def connect(self, timeout: float = 5.0) -> None:
         """Connect to the server, retrying for up to `timeout` seconds."""
@@ -118,12 +124,42 @@ class AudioServerClient:
         """Send a command dict, return the response dict."""
         payload = json.dumps(request).encode("utf-8")
         length  = struct.pack("<I", len(payload))
-        self._write(length + payload)
-
-        resp_len = struct.unpack("<I", self._read(4))[0]
-        resp_bytes = self._read(resp_len)
+        with self._lock:
+            self._write(length + payload)
+            resp_len = struct.unpack("<I", self._read(4))[0]
+            resp_bytes = self._read(resp_len)
         return json.loads(resp_bytes)
 
+    def send_binary(self, request: dict, payload: bytes = b"") -> tuple:
+        """Send a binary frame, return (response dict, payload bytes).
+
+        Mirrors "Binary framing" in protocol.h: the length prefix has bit 31
+        set and is followed by [json_len][json][raw payload].
+        """
+        header = json.dumps(request).encode("utf-8")
+        total  = 4 + len(header) + len(payload)
+        with self._lock:
+            self._write(struct.pack("<II", total | BINARY_FRAME_FLAG, len(header))
+                        + header + payload)
+            resp, body, binary = self.recv_frame()
+        assert binary, "expected a binary reply frame"
+        return resp, body
+
+    def recv_frame(self) -> tuple:
+        """Read the next frame of either type: (dict, payload bytes, is_binary).
+
+        Used directly for commands that send progress frames before their
+        final reply (render with stream/path).
+        """
+        prefix = struct.unpack("<I", self._read(4))[0]
+        if not prefix & BINARY_FRAME_FLAG:
+            return json.loads(self._read(prefix)), b"", False
+        total    = prefix & ~BINARY_FRAME_FLAG
+        json_len = struct.unpack("<I", self._read(4))[0]
+        resp     = json.loads(self._read(json_len))
+        body     = self._read(total - 4 - json_len) if total > 4 + json_len else b""
+        return resp, body, True
+
     def _write(self, data: bytes) -> None:
         if IS_WINDOWS:
             import ctypes
@@ -413,6 +449,9 @@ def test_ping(client):
     features = resp.get("features", [])
     for expected in ("track_source", "note_on", "note_off", "all_notes_off"):
         assert expected in features, f"Missing feature: {expected}"
+    if "request_ids" in features:
+        resp = client.send({"cmd": "ping", "id": 7})
+        assert resp.get("id") == 7, resp
     print("PASS")
 
 
@@ -741,6 +780,20 @@ def test_set_loop(client):
     print("\n--- test_set_loop ---")
     resp = client.send({"cmd": "set_loop", "start": 0.0, "end": 2.0, "enabled": True})
     assert resp["status"] == "ok", resp
+
+    # A half-beat loop wraps several times in 0.6 s at 120 bpm; the playhead
+    # must stay inside it.
+    client.send({"cmd": "set_loop", "start": 0.25, "end": 0.75, "enabled": True})
+    client.send({"cmd": "seek", "beat": 0.25})
+    client.send({"cmd": "play"})
+    time.sleep(0.6)
+    resp = client.send({"cmd": "get_position"})
+    client.send({"cmd": "stop"})
+    client.send({"cmd": "seek", "beat": 0.0})
+    print(f"  position in loop [0.25, 0.75): beat={resp['beat']:.3f}")
+    assert resp["playing"], resp
+    assert 0.25 <= resp["beat"] < 0.75, resp
+
     resp = client.send({"cmd": "set_loop", "enabled": False})
     assert resp["status"] == "ok", resp
     print("PASS")
@@ -758,6 +811,286 @@ def test_set_param(client):
     print("PASS")
 
 
+def test_set_params(client):
+    print("\n--- test_set_params ---")
+    resp = client.send({
+        "cmd": "resolve_params",
+        "params": [
+            {"node_id": "mixer",   "param_id": "master_gain"},
+            {"node_id": "no_such", "param_id": "gain"},
+        ],
+    })
+    assert resp["status"] == "ok", resp
+    handles = resp["handles"]
+    assert len(handles) == 2 and handles[0] >= 0 and handles[1] == -1, resp
+
+    resp = client.send({
+        "cmd": "set_params",
+        "graph": resp["graph"],
+        "values": [[handles[0], 0.25], [handles[0], 0.5]],
+    })
+    assert resp["status"] == "ok", resp
+
+    resp = client.send({"cmd": "set_params", "graph": 0xFFFFFFFF,
+                        "values": [[handles[0], 1.0]]})
+    assert resp["status"] == "error", "stale graph serial should be rejected"
+    print("PASS")
+
+
+def test_get_stats(client):
+    print("\n--- test_get_stats ---")
+    time.sleep(0.2)   # let a few callbacks run on the current graph
+    resp = client.send({"cmd": "get_stats"})
+    assert resp["status"] == "ok", resp
+    assert resp["queues"]["commands"]["capacity"] > 0, resp
+    ids = [n["id"] for n in resp["nodes"]]
+    if resp["enabled"]:
+        assert resp["callback"]["count"] > 0, resp
+        assert resp["callback"]["budget_us"] > 0, resp
+        assert "mixer" in ids, resp
+    print(f"  callbacks={resp['callback']['count']} "
+          f"peak_load={resp['callback']['peak_load']:.3f} nodes={ids}")
+
+    resp = client.send({"cmd": "get_stats", "reset": True})
+    assert resp["status"] == "ok", resp
+    before = resp["callback"]["count"]
+    resp = client.send({"cmd": "get_stats"})
+    if resp["enabled"]:
+        assert resp["callback"]["count"] < before, "reset should restart the counts"
+    print("PASS")
+
+
+def test_shared_state(client):
+    print("\n--- test_shared_state ---")
+    resp = client.send({"cmd": "ping"})
+    if "shared_state" not in resp.get("features", []):
+        print("  SKIP (server does not advertise shared_state)")
+        return
+    import mmap
+    resp = client.send({"cmd": "open_shared_state"})
+    assert resp["status"] == "ok", resp
+    assert resp["version"] == 1 and resp["size"] == 39232, resp
+    if IS_WINDOWS:
+        buf = mmap.mmap(-1, resp["size"], tagname="Local\\" + resp["name"].lstrip("/"),
+                        access=mmap.ACCESS_READ)
+    else:
+        with open("/dev/shm/" + resp["name"].lstrip("/"), "rb") as f:
+            buf = mmap.mmap(f.fileno(), resp["size"], access=mmap.ACCESS_READ)
+
+    def header():
+        # Seqlock read: retry while odd or changed underneath us.
+        while True:
+            seq = struct.unpack_from("<I", buf, 12)[0]
+            h = struct.unpack_from("<IIII Q dd f IIIII", buf, 0)
+            if not seq & 1 and struct.unpack_from("<I", buf, 12)[0] == seq:
+                return h
+
+    assert header()[0] == 0x4D485341, "bad magic"
+    client.send({"cmd": "seek", "beat": 0.0})
+    client.send({"cmd": "play"})
+    time.sleep(0.3)
+    h = header()
+    client.send({"cmd": "stop"})
+    blocks, beat, playing, meter_count = h[4], h[5], h[8], h[10]
+    assert playing == 1 and beat > 0.0, h
+    ids = [struct.unpack_from("<64s", buf, 64 + i * 80)[0].split(b"\0")[0].decode()
+           for i in range(meter_count)]
+    assert ids and ids[-1] == "master" and "synth" in ids, ids
+    print(f"  blocks={blocks} beat={beat:.3f} meters={ids}")
+    buf.close()
+    print("PASS")
+
+
+def test_binary_render(client):
+    print("\n--- test_binary_render ---")
+    resp = client.send({"cmd": "ping"})
+    if "binary_framing" not in resp.get("features", []):
+        print("  SKIP (server does not advertise binary_framing)")
+        return
+
+    resp, wav_bytes = client.send_binary({"cmd": "render", "format": "wav"})
+    assert resp["status"] == "ok", resp
+    assert "data" not in resp, "binary render must not embed base64 data"
+    assert resp["payload_bytes"] == len(wav_bytes), resp
+    assert wav_bytes[:4] == b"RIFF" and wav_bytes[8:12] == b"WAVE"
+
+    resp, pcm = client.send_binary({"cmd": "render", "format": "raw_f32"})
+    assert resp["status"] == "ok", resp
+    assert len(pcm) == resp["frames"] * resp["channels"] * 4, resp
+    print(f"  wav={len(wav_bytes)} bytes, raw_f32={len(pcm)} bytes")
+
+    # Schedule sent as the raw payload instead of inline JSON
+    sched = build_schedule(notes=[(0.0, 0.5, 60, 100)], node_id="track_abc")
+    resp, _ = client.send_binary({"cmd": "set_schedule"},
+                                 json.dumps(sched).encode("utf-8"))
+    assert resp["status"] == "ok", resp
+    print("PASS")
+
+
+def test_stream_render(client, out_path="/tmp/test_stream_render.wav"):
+    print("\n--- test_stream_render ---")
+    resp = client.send({"cmd": "ping"})
+    if "render_stream" not in resp.get("features", []):
+        print("  SKIP (server does not advertise render_stream)")
+        return
+
+    _, whole = client.send_binary({"cmd": "render", "format": "wav"})
+
+    # Binary frames: chunks arrive as raw payloads
+    resp, chunk = client.send_binary({"cmd": "render", "format": "wav",
+                                      "stream": True, "chunk_frames": 8192})
+    chunks = []
+    while resp["status"] == "progress":
+        assert resp["payload_bytes"] == len(chunk), resp
+        chunks.append(chunk)
+        resp, chunk, _ = client.recv_frame()
+    assert resp["status"] == "ok", resp
+    assert len(chunks) > 1, "expected more than one chunk"
+    assert b"".join(chunks) == whole, "streamed WAV differs from one-shot render"
+    assert resp["bytes"] == len(whole), resp
+    print(f"  binary: {len(chunks)} chunks, {len(whole)} bytes")
+
+    # JSON frames: chunks arrive base64-encoded
+    resp = client.send({"cmd": "render", "format": "raw_f32", "stream": True})
+    pcm = b""
+    while resp["status"] == "progress":
+        pcm += base64.b64decode(resp["data"])
+        last_done = resp["frames_done"]
+        resp, _, _ = client.recv_frame()
+    assert resp["status"] == "ok", resp
+    assert len(pcm) == resp["frames"] * 2 * 4 and last_done == resp["frames"], resp
+    print(f"  json:   {resp['frames']} frames")
+
+    # Direct-to-file with progress reports
+    resp = client.send({"cmd": "render", "format": "wav",
+                        "path": out_path, "progress": True})
+    reports = 0
+    while resp["status"] == "progress":
+        assert "data" not in resp
+        reports += 1
+        resp, _, _ = client.recv_frame()
+    assert resp["status"] == "ok" and resp["path"] == out_path, resp
+    with open(out_path, "rb") as f:
+        assert f.read() == whole, "file render differs from one-shot render"
+    print(f"  file:   {out_path} ({reports} progress reports)")
+    print("PASS")
+
+
+def test_render_stems(client, out_dir="/tmp/test_stems"):
+    print("\n--- test_render_stems ---")
+    resp = client.send({"cmd": "ping"})
+    if "render_stems" not in resp.get("features", []):
+        print("  SKIP (server does not advertise render_stems)")
+        return
+
+    client.send(build_track_source_graph(["abc", "def"]))
+    events = (build_schedule(notes=[(0.0, 1.0, 60, 100)], node_id="track_abc")["events"] +
+              build_schedule(notes=[(2.0, 1.0, 67, 100)], node_id="track_def")["events"])
+    resp = client.send({"cmd": "set_schedule", "events": events})
+    assert resp["status"] == "ok", resp
+
+    stems = [{"name": "abc", "nodes": ["track_abc"]},
+             {"name": "def", "nodes": ["track_def"]}]
+
+    # In memory over a binary frame, with progress reports
+    header = json.dumps({"cmd": "render_stems", "stems": stems, "progress": True}).encode()
+    client._write(struct.pack("<II", (4 + len(header)) | BINARY_FRAME_FLAG, len(header)) + header)
+    resp, payload, _ = client.recv_frame()
+    reports = 0
+    while resp["status"] == "progress":
+        reports += 1
+        resp, payload, _ = client.recv_frame()
+    assert resp["status"] == "ok", resp
+    assert reports >= len(stems), f"expected progress per stem, got {reports}"
+
+    def peak_in(wav_bytes, start_s, end_s):
+        with wave.open(io.BytesIO(wav_bytes)) as wf:
+            rate = wf.getframerate()
+            wf.setpos(int(start_s * rate))
+            raw = wf.readframes(int((end_s - start_s) * rate))
+        return max(abs(v) for v in struct.unpack_from(f"<{len(raw)//2}h", raw))
+
+    by_name = {}
+    for st in resp["stems"]:
+        by_name[st["name"]] = payload[st["offset"]:st["offset"] + st["bytes"]]
+    # 120 bpm: track_abc sounds in 0-0.5 s, track_def in 1.0-1.5 s
+    assert peak_in(by_name["abc"], 0.05, 0.45) > 100
+    assert peak_in(by_name["abc"], 1.05, 1.45) == 0
+    assert peak_in(by_name["def"], 0.05, 0.45) == 0
+    assert peak_in(by_name["def"], 1.05, 1.45) > 100
+    print(f"  memory: {len(stems)} stems, {len(payload)} bytes, {reports} progress reports")
+
+    # Straight to files
+    os.makedirs(out_dir, exist_ok=True)
+    resp = client.send({"cmd": "render_stems", "stems": stems, "dir": out_dir})
+    assert resp["status"] == "ok", resp
+    for st in resp["stems"]:
+        with open(st["path"], "rb") as f:
+            assert f.read() == by_name[st["name"]], st
+    print(f"  files:  {[st['path'] for st in resp['stems']]}")
+
+    resp = client.send({"cmd": "render_stems", "stems": [{"name": "../x", "nodes": []}],
+                        "dir": out_dir})
+    assert resp["status"] == "error", resp
+    print("PASS")
+
+
+def test_patch_schedule(client):
+    print("\n--- test_patch_schedule ---")
+    resp = client.send({"cmd": "ping"})
+    features = resp.get("features", [])
+    if "patch_schedule" not in features or "binary_framing" not in features:
+        print("  SKIP (server does not advertise patch_schedule)")
+        return
+
+    def frames():
+        resp, _ = client.send_binary({"cmd": "render", "format": "raw_f32"})
+        assert resp["status"] == "ok", resp
+        return resp["frames"]
+
+    client.send(build_track_source_graph(["abc", "def"]))
+    resp = client.send(build_schedule(notes=[(0.0, 1.0, 60, 100)], node_id="track_abc"))
+    assert resp["status"] == "ok", resp
+    base = frames()
+
+    # Adding a later track lengthens the arrangement; track_abc is untouched.
+    events = build_schedule(notes=[(3.0, 1.0, 62, 100)], node_id="track_def")["events"]
+    resp = client.send({"cmd": "patch_schedule", "node_id": "track_def", "events": events})
+    assert resp["status"] == "ok", resp
+    longer = frames()
+    assert longer > base, (base, longer)
+
+    resp = client.send({"cmd": "patch_schedule", "node_id": "track_def", "events": []})
+    assert resp["status"] == "ok", resp
+    assert frames() == base
+
+    resp = client.send({"cmd": "patch_schedule", "node_id": "track_abc", "events": events})
+    assert resp["status"] == "error", "events for another node must be rejected"
+    resp = client.send({"cmd": "patch_schedule", "events": []})
+    assert resp["status"] == "error", resp
+    print(f"  frames: {base} -> {longer} -> {base}")
+
+    if "packed_events" in features:
+        # Same two tracks as packed records: f64 beat, f32 value, u32 node,
+        # u8 type, channel, pitch, velocity
+        rec = struct.Struct("<dfIBBBB")
+        payload = (rec.pack(0.0, 0.0, 0, 0, 0, 60, 100) + rec.pack(1.0, 0.0, 0, 1, 0, 60, 0) +
+                   rec.pack(3.0, 0.0, 1, 0, 0, 62, 100) + rec.pack(4.0, 0.0, 1, 1, 0, 62, 0))
+        resp, _ = client.send_binary({"cmd": "set_schedule", "format": "packed",
+                                      "nodes": ["track_abc", "track_def"]}, payload)
+        assert resp["status"] == "ok", resp
+        assert frames() == longer
+        resp, _ = client.send_binary({"cmd": "patch_schedule", "format": "packed",
+                                      "node_id": "track_def"}, b"")
+        assert resp["status"] == "ok", resp
+        assert frames() == base
+        resp, _ = client.send_binary({"cmd": "set_schedule", "format": "packed",
+                                      "nodes": ["track_abc"]}, payload)
+        assert resp["status"] == "error", "node index out of range must be rejected"
+        print("  packed events: ok")
+    print("PASS")
+
+
 def test_offline_render(client, out_path="/tmp/test_render.wav"):
     print("\n--- test_offline_render ---")
     resp = client.send({"cmd": "render", "format": "wav"})
@@ -897,6 +1230,9 @@ def main():
         # ----------------------------------------------------------------
         # Offline render (schedule from test_setup_events still active)
         test_offline_render(client, out_path=args.wav_out)
+        test_binary_render(client)
+        test_stream_render(client)
+        test_render_stems(client)
 
         # ----------------------------------------------------------------
         # Control source
@@ -906,6 +1242,10 @@ def main():
         # Misc existing commands
         client.send(build_track_source_graph(["abc"]))
         test_set_param(client)
+        test_set_params(client)
+        test_get_stats(client)
+        test_shared_state(client)
+        test_patch_schedule(client)
         test_list_plugins(client)
 
         # ----------------------------------------------------------------
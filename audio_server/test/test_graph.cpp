@@ -3,15 +3,32 @@
 // and one block of offline processing.  No PortAudio, no IPC.
 
 #include "graph.h"
+#include "graph_executor.h"
+#include "plugin_api.h"
+#include "dsp_kernels.h"
 #include "scheduler.h"
+#include "sine_voice_pool.h"
+#include "synth_node.h"
+#include "plugin_adapter.h"
+#include "protocol.h"
 #include "nlohmann/json.hpp"
 
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 
 using json = nlohmann::json;
 
+void register_builtin_plugins();   // builtin_plugins.cpp
+std::unique_ptr<Plugin> make_reverb_plugin();   // plugins/builtin/reverb_plugin.cpp
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 static json make_test_graph() {
     return {
         {"bpm", 120},
@@ -29,6 +46,157 @@ static json make_test_graph() {
     };
 }
 
+// N independent sine → mixer chains, for the parallel executor test.
+static json make_wide_graph(int chains) {
+    json nodes = json::array();
+    json conns = json::array();
+    for (int i = 0; i < chains; ++i) {
+        std::string id = "synth" + std::to_string(i);
+        nodes.push_back({{"id", id}, {"type", "sine"}});
+        conns.push_back({{"from_node", id}, {"from_port", "audio_out_L"},
+                         {"to_node", "mixer"}, {"to_port", "audio_in_L_" + std::to_string(i)}});
+        conns.push_back({{"from_node", id}, {"from_port", "audio_out_R"},
+                         {"to_node", "mixer"}, {"to_port", "audio_in_R_" + std::to_string(i)}});
+    }
+    nodes.push_back({{"id", "mixer"}, {"type", "mixer"}, {"channel_count", chains}});
+    return {{"nodes", nodes}, {"connections", conns}};
+}
+
+// N sine → submix → mixer chains: each sine's outputs are dead once its
+// submix has run, so later chains can reuse those buffers.
+static json make_submix_graph(int chains) {
+    json nodes = json::array();
+    json conns = json::array();
+    for (int i = 0; i < chains; ++i) {
+        std::string synth = "synth" + std::to_string(i);
+        std::string sub   = "sub" + std::to_string(i);
+        nodes.push_back({{"id", synth}, {"type", "sine"}});
+        nodes.push_back({{"id", sub}, {"type", "mixer"}, {"channel_count", 1}});
+        for (const char* side : {"L", "R"}) {
+            conns.push_back({{"from_node", synth}, {"from_port", std::string("audio_out_") + side},
+                             {"to_node", sub}, {"to_port", std::string("audio_in_") + side + "_0"}});
+            conns.push_back({{"from_node", sub}, {"from_port", std::string("audio_out_") + side},
+                             {"to_node", "mixer"},
+                             {"to_port", std::string("audio_in_") + side + "_" + std::to_string(i)}});
+        }
+    }
+    nodes.push_back({{"id", "mixer"}, {"type", "mixer"}, {"channel_count", chains}});
+    return {{"nodes", nodes}, {"connections", conns}};
+}
+
+// Event input → event output, unchanged: exercises the adapter's event lists.
+class EventEchoPlugin final : public Plugin {
+public:
+    PluginDescriptor descriptor() const override {
+        PluginDescriptor d;
+        d.id = "test.event_echo";
+        d.ports = {
+            { "events_in",  "In",  "", PluginPortType::Event, PortRole::Input },
+            { "events_out", "Out", "", PluginPortType::Event, PortRole::Output },
+        };
+        return d;
+    }
+    void activate(float, int) override {
+        in_  = port_handle("events_in");
+        out_ = port_handle("events_out");
+    }
+    void process(const PluginProcessContext&, PluginBuffers& buffers) override {
+        auto& out = *buffers.events[out_].output_events;
+        for (auto& ev : *buffers.events[in_].events) out.push_back(ev);
+    }
+private:
+    PortHandle in_, out_;
+};
+
+// The reverb's freeverb engine as it was before vectorising: per sample,
+// four damped combs per channel summed, then two allpasses (44.1 kHz lengths).
+struct ScalarFreeverb {
+    struct Line {
+        std::vector<float> buf;
+        int pos = 0;
+        float state = 0.0f;
+        explicit Line(int len = 1) : buf(len, 0.0f) {}
+        float comb(float in, float fb, float damp) {
+            float d = buf[pos];
+            state = d * (1.0f - damp) + state * damp;
+            buf[pos] = in + state * fb;
+            if (++pos == static_cast<int>(buf.size())) pos = 0;
+            return d;
+        }
+        float allpass(float in) {
+            float d = buf[pos];
+            buf[pos] = in + d * 0.5f;
+            if (++pos == static_cast<int>(buf.size())) pos = 0;
+            return d - in;
+        }
+    };
+    Line comb_L[4] = { Line(1116), Line(1188), Line(1277), Line(1356) };
+    Line comb_R[4] = { Line(1139), Line(1211), Line(1300), Line(1379) };
+    Line ap_L[2]   = { Line(556), Line(441) };
+    Line ap_R[2]   = { Line(579), Line(464) };
+
+    void process(const float* in_L, const float* in_R, float* out_L, float* out_R, int n,
+                 float fb, float damp, float dry, float wet1, float wet2) {
+        for (int i = 0; i < n; ++i) {
+            float x = (in_L[i] + in_R[i]) * 0.5f, l = 0.0f, r = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                l += comb_L[c].comb(x, fb, damp);
+                r += comb_R[c].comb(x, fb, damp);
+            }
+            for (int a = 0; a < 2; ++a) {
+                l = ap_L[a].allpass(l);
+                r = ap_R[a].allpass(r);
+            }
+            out_L[i] = in_L[i] * dry + l * wet1 + r * wet2;
+            out_R[i] = in_R[i] * dry + r * wet1 + l * wet2;
+        }
+    }
+};
+
+// Stereo pass-through that claims a fixed tail, for the bypass tests.
+class FixedTailPlugin final : public Plugin {
+public:
+    static constexpr int TAIL = 2048;
+    PluginDescriptor descriptor() const override {
+        PluginDescriptor d;
+        d.id = "test.fixed_tail";
+        d.ports = {
+            { "audio_in",  "In",  "", PluginPortType::AudioStereo, PortRole::Input },
+            { "audio_out", "Out", "", PluginPortType::AudioStereo, PortRole::Output },
+        };
+        return d;
+    }
+    void activate(float, int) override {
+        in_  = port_handle("audio_in");
+        out_ = port_handle("audio_out");
+    }
+    int tail_frames() const override { return TAIL; }
+    void process(const PluginProcessContext& ctx, PluginBuffers& buffers) override {
+        auto& in  = buffers.audio[in_];
+        auto& out = buffers.audio[out_];
+        dsp::copy(out.left,  in.left,  ctx.block_size);
+        dsp::copy(out.right, in.right, ctx.block_size);
+    }
+private:
+    PortHandle in_, out_;
+};
+
+// Output-only, silent; configure("key", k) sets its shared_state_key().
+class SharedKeyPlugin final : public Plugin {
+public:
+    PluginDescriptor descriptor() const override {
+        PluginDescriptor d;
+        d.id = "test.shared_key";
+        d.ports = { { "audio_out", "Out", "", PluginPortType::AudioStereo, PortRole::Output } };
+        return d;
+    }
+    void configure(const std::string& k, const std::string& v) override { if (k == "key") key_ = v; }
+    std::string shared_state_key() const override { return key_; }
+    void process(const PluginProcessContext&, PluginBuffers&) override {}
+private:
+    std::string key_;
+};
+
 static json make_test_schedule() {
     return {{"events", {
         // note_on at beat 0, note_off at beat 1
@@ -68,16 +236,19 @@ int main() {
         std::cerr << "Schedule construction failed: " << err << "\n";
         return 1;
     }
-    assert(sched->events().size() == 2);
-    std::cout << "PASS: schedule built with " << sched->events().size() << " events\n";
+    assert(sched->event_count() == 2);
+    // Both events target synth1: one track
+    assert(sched->node_ids().size() == 1 && sched->node_ids()[0] == "synth1");
+    assert(sched->tracks()[0]->events.size() == 2);
+    std::cout << "PASS: schedule built with " << sched->event_count() << " events\n";
 
     // --- Dispatcher: trigger note_on ---
     Dispatcher disp;
-    disp.swap_schedule(sched.release());
+    disp.swap_schedule(std::move(sched));
     disp.check_pending();
 
     // Dispatch beat 0..0.01 (a few samples worth at 120bpm)
-    disp.dispatch(0.0, 0.01, graph.get());
+    disp.dispatch(0.0, 0.01, 512, graph.get());
 
     // --- Process one block ---
     ProcessContext ctx;
@@ -108,7 +279,864 @@ int main() {
     std::cout << "PASS: set_param master_gain=0.5, new max = " << max_half << "\n";
     assert(max_half < max_val * 0.75f);
 
+    // --- param handles ---
+    int h = graph->param_handle("mixer", "master_gain");
+    assert(h >= 0);
+    assert(graph->param_handle("mixer", "master_gain") == h);
+    assert(graph->param_handle("no_such_node", "gain") == -1);
+    assert(graph->param_handle("mixer", "gain_0") >= 0);
+    assert(graph->param_handle("mixer", "gain_x") == -1);
+    assert(graph->param_handle("mixer", "no_such_param") == -1);
+    graph->set_param(h, 1.0f);
+    graph->process(ctx);
+    float max_restored = 0.0f;
+    for (int i = 0; i < 512; ++i) max_restored = std::max(max_restored, std::abs(L[i]));
+    std::cout << "PASS: param handle restored master_gain=1.0, new max = " << max_restored << "\n";
+    assert(max_restored > max_half * 1.5f);
+
     graph->deactivate();
+
+    // --- Metering: one meter per mixer input pair, then master ---
+    {
+        auto mg = Graph::from_json(make_test_graph().dump(), err);
+        assert(mg);
+        mg->set_metering(true);
+        ok = mg->activate(44100.0f, 512);
+        assert(ok);
+        mg->find_node("synth1")->note_on(0, 69, 100);
+        mg->process(ctx);
+        auto& meters = mg->meters();
+        assert(meters.size() == 2);
+        assert(meters[0].id == "synth1" && meters[1].id == "master");
+        assert(meters[0].peak_L > 1e-3f && meters[0].rms_L > 0.0f &&
+               meters[0].rms_L <= meters[0].peak_L);
+        float master_peak = 0.0f;
+        for (int i = 0; i < 512; ++i)
+            master_peak = std::max(master_peak, std::abs(mg->output_L()[i]));
+        assert(std::abs(meters[1].peak_L - master_peak) < 1e-6f);
+        assert(mg->monitors().empty());
+        mg->deactivate();
+        std::cout << "PASS: metering (synth1 peak " << meters[0].peak_L << ")\n";
+    }
+
+    // --- Parallel executor matches serial output exactly ---
+    {
+        const int chains = 8;
+        GraphExecutor executor(3);
+        auto serial   = Graph::from_json(make_wide_graph(chains).dump(), err);
+        auto parallel = Graph::from_json(make_wide_graph(chains).dump(), err);
+        assert(serial && parallel);
+        parallel->set_executor(&executor);
+        ok = serial->activate(44100.0f, 512) && parallel->activate(44100.0f, 512);
+        assert(ok);
+
+        for (int i = 0; i < chains; ++i) {
+            std::string id = "synth" + std::to_string(i);
+            serial->find_node(id)->note_on(0, 60 + i, 100);
+            parallel->find_node(id)->note_on(0, 60 + i, 100);
+        }
+
+        for (int block = 0; block < 64; ++block) {
+            ctx.beat_position = block * 512 * ctx.beats_per_sample;
+            serial->process(ctx);
+            parallel->process(ctx);
+            for (int i = 0; i < 512; ++i) {
+                assert(serial->output_L()[i] == parallel->output_L()[i]);
+                assert(serial->output_R()[i] == parallel->output_R()[i]);
+            }
+        }
+        std::cout << "PASS: " << chains << "-chain graph on "
+                  << executor.worker_count() << " workers matches serial output\n";
+    }
+
+    // --- Buffer reuse: fewer buffers than ports, same output serial/parallel ---
+    {
+        const int chains = 6;
+        GraphExecutor executor(3);
+        auto serial   = Graph::from_json(make_submix_graph(chains).dump(), err);
+        auto parallel = Graph::from_json(make_submix_graph(chains).dump(), err);
+        assert(serial && parallel);
+        parallel->set_executor(&executor);
+        ok = serial->activate(44100.0f, 333) && parallel->activate(44100.0f, 333);
+        assert(ok);
+
+        // Silent buffer + two outputs per sine, submix and mixer.
+        const int without_reuse = 1 + 2 * (2 * chains + 1);
+        std::cout << "  buffers: " << serial->buffer_count()
+                  << " (without reuse " << without_reuse << ")\n";
+        assert(serial->buffer_count() < without_reuse);
+
+        for (int i = 0; i < chains; ++i) {
+            std::string id = "synth" + std::to_string(i);
+            serial->find_node(id)->note_on(0, 60 + i, 100);
+            parallel->find_node(id)->note_on(0, 60 + i, 100);
+        }
+
+        ProcessContext rctx = ctx;
+        rctx.block_size = 333;
+        float peak = 0.0f;
+        for (int block = 0; block < 32; ++block) {
+            rctx.beat_position = block * 333 * rctx.beats_per_sample;
+            serial->process(rctx);
+            parallel->process(rctx);
+            for (int i = 0; i < 333; ++i) {
+                assert(serial->output_L()[i] == parallel->output_L()[i]);
+                assert(serial->output_R()[i] == parallel->output_R()[i]);
+                peak = std::max(peak, std::fabs(serial->output_L()[i]));
+            }
+        }
+        assert(peak > 0.01f);
+        std::cout << "PASS: " << chains << " submix chains reuse buffers, serial == parallel\n";
+    }
+
+    // --- Steps with one shared_state_key() are chained ---
+    {
+        static PluginRegistration shared_reg { "test.shared_key",
+            []() -> std::unique_ptr<Plugin> { return std::make_unique<SharedKeyPlugin>(); } };
+        PluginRegistry::add(&shared_reg);
+        const int chains = 8;
+        auto roots = [&](auto key_of) {
+            json desc = make_wide_graph(chains);
+            for (int i = 0; i < chains; ++i) {
+                desc["nodes"][i]["type"]   = "test.shared_key";
+                desc["nodes"][i]["params"] = {{"key", key_of(i)}};
+            }
+            auto sg = Graph::from_json(desc.dump(), err);
+            assert(sg && sg->activate(44100.0f, 512));
+            size_t n = sg->dag().roots.size();
+            sg->deactivate();
+            return n;
+        };
+        assert(roots([](int i) { return std::to_string(i); }) == size_t(chains));
+        assert(roots([](int i) { return i % 2 ? "odd" : "even"; }) == 2);
+        assert(roots([](int)   { return "font"; }) == 1);
+        std::cout << "PASS: steps sharing state are chained\n";
+    }
+
+    // --- Output routing: graph renders in place into bound channels ---
+    {
+        auto desc = make_submix_graph(3);
+        desc["outputs"] = json::array({
+            {{"node", "sub0"}, {"port", "audio_out_L"}, {"channel", 2}},
+            {{"node", "sub0"}, {"port", "audio_out_R"}, {"channel", 3}},
+        });
+        auto ref   = Graph::from_json(make_submix_graph(3).dump(), err);
+        auto bound = Graph::from_json(desc.dump(), err);
+        assert(ref && bound && bound->output_routes().size() == 2);
+        ok = ref->activate(44100.0f, 512) && bound->activate(44100.0f, 512);
+        assert(ok);
+        assert(bound->writes_channel(0) && bound->writes_channel(3) && !bound->writes_channel(4));
+
+        for (auto* g : { ref.get(), bound.get() }) {
+            g->find_node("synth0")->note_on(0, 60, 100);
+            g->find_node("synth2")->note_on(0, 67, 100);
+        }
+
+        // Device buffers hold anything before the first block.
+        std::vector<std::vector<float>> device(5, std::vector<float>(512, 1e3f));
+        float* channels[5];
+        for (int c = 0; c < 5; ++c) channels[c] = device[c].data();
+
+        float stem_peak = 0.0f;
+        for (int block = 0; block < 8; ++block) {
+            ctx.beat_position = block * 512 * ctx.beats_per_sample;
+            bound->bind_outputs(channels, 5);
+            ref->process(ctx);
+            bound->process(ctx);
+            assert(bound->output_L() == channels[0] && bound->output_R() == channels[1]);
+            for (int i = 0; i < 512; ++i) {
+                // The mixer read sub0 from channels 2/3 and wrote 0/1.
+                assert(device[0][i] == ref->output_L()[i]);
+                assert(device[1][i] == ref->output_R()[i]);
+                stem_peak = std::max(stem_peak, std::fabs(device[2][i]));
+                assert(device[4][i] == 1e3f);   // unrouted: left to the caller
+            }
+        }
+        assert(stem_peak > 0.01f && stem_peak < 1.0f);
+
+        bound->bind_outputs(nullptr, 0);
+        ref->process(ctx);
+        bound->process(ctx);
+        assert(bound->output_L() != channels[0]);
+        for (int i = 0; i < 512; ++i) assert(bound->output_L()[i] == ref->output_L()[i]);
+
+        for (auto& [node, port, channel] : { std::make_tuple("sub0", "audio_out_L", 1),
+                                             std::make_tuple("sub9", "audio_out_L", 2),
+                                             std::make_tuple("sub0", "audio_in_L_0", 2) }) {
+            auto bad = make_submix_graph(3);
+            bad["outputs"] = json::array({ {{"node", node}, {"port", port}, {"channel", channel}} });
+            std::string route_err;
+            assert(!Graph::from_json(bad.dump(), route_err) && !route_err.empty());
+        }
+        std::cout << "PASS: output routes render in place into bound channels\n";
+    }
+
+    // --- Port handles: per-kind descriptor order, used by plugin builtins ---
+    {
+        register_builtin_plugins();
+        auto mixer = PluginRegistry::create("builtin.mixer");
+        assert(mixer);
+        mixer->configure("channel_count", "3");
+        PluginDescriptor d = mixer->descriptor();
+        assert(find_port(d, "audio_in_0").index == 0);
+        assert(find_port(d, "audio_in_2").index == 2);
+        assert(find_port(d, "gain_1").index == 1);
+        assert(mixer->port_handle("audio_out").index == 3);
+        assert(mixer->port_handle("master_gain").index == 3);
+        assert(!mixer->port_handle("no_such_port").valid());
+
+        json plugin_graph = {
+            {"nodes", {
+                {{"id","synth"}, {"type","builtin.sine"}},
+                {{"id","mixer"}, {"type","builtin.mixer"}, {"channel_count",3}}
+            }},
+            {"connections", {
+                {{"from_node","synth"},{"from_port","audio_out_L"},
+                 {"to_node","mixer"}, {"to_port","audio_in_2_L"}},
+                {{"from_node","synth"},{"from_port","audio_out_R"},
+                 {"to_node","mixer"}, {"to_port","audio_in_2_R"}}
+            }}
+        };
+        auto pg = Graph::from_json(plugin_graph.dump(), err);
+        assert(pg && pg->activate(44100.0f, 512));
+        pg->find_node("synth")->note_on(0, 69, 100);
+        ctx.beat_position = 0.0;
+        pg->process(ctx);
+        float peak = 0.0f;
+        for (int i = 0; i < 512; ++i) peak = std::max(peak, std::abs(pg->output_R()[i]));
+        assert(peak > 1e-3f);
+        pg->deactivate();
+        std::cout << "PASS: plugin port handles (builtin.sine -> builtin.mixer channel 2)\n";
+    }
+
+    // --- Control ports: scalar slots, not pool buffers; ramps reach plugins ---
+    {
+        auto control_graph = [](int extra_sources) {
+            json g = {
+                {"nodes", {
+                    {{"id","synth"}, {"type","builtin.sine"}},
+                    {{"id","lfo"},   {"type","control_source"}, {"ramp", true}},
+                    {{"id","mixer"}, {"type","builtin.mixer"}, {"channel_count",1}}
+                }},
+                {"connections", {
+                    {{"from_node","synth"},{"from_port","audio_out_L"},
+                     {"to_node","mixer"}, {"to_port","audio_in_0_L"}},
+                    {{"from_node","synth"},{"from_port","audio_out_R"},
+                     {"to_node","mixer"}, {"to_port","audio_in_0_R"}},
+                    {{"from_node","lfo"},  {"from_port","control_out"},
+                     {"to_node","mixer"}, {"to_port","gain_0"}}
+                }}
+            };
+            for (int i = 0; i < extra_sources; ++i)
+                g["nodes"].push_back({{"id", "cs" + std::to_string(i)}, {"type", "control_source"}});
+            return g;
+        };
+        auto small = Graph::from_json(control_graph(0).dump(), err);
+        auto big   = Graph::from_json(control_graph(16).dump(), err);
+        assert(small && big);
+        assert(small->activate(44100.0f, 512) && big->activate(44100.0f, 512));
+        assert(big->buffer_count() == small->buffer_count());
+        assert(big->control_slot_count() == small->control_slot_count() + 16);
+
+        // Gain glides 0 → 1 over the first half of the block, then holds.
+        small->find_node("synth")->note_on(0, 69, 100);
+        ctx.beat_position = 0.0;
+        small->find_node("lfo")->push_control(256 * ctx.beats_per_sample, 1.0f);
+        small->process(ctx);
+        auto peak = [&](int from, int to) {
+            float p = 0.0f;
+            for (int i = from; i < to; ++i) p = std::max(p, std::abs(small->output_L()[i]));
+            return p;
+        };
+        float head = peak(0, 8), first = peak(0, 128), tail = peak(256, 512);
+        assert(tail > 1e-3f);
+        assert(head < 0.05f * tail);
+        assert(first < 0.6f * tail);
+        small->deactivate();
+        big->deactivate();
+        std::cout << "PASS: control slots (" << small->control_slot_count()
+                  << " slots, " << small->buffer_count() << " buffers), gain ramp\n";
+    }
+
+    // --- Sample-accurate dispatch: a note mid-block starts on its frame ---
+    {
+        const int block = 512, onset = 300;
+        for (const char* type : {"sine", "builtin.sine"}) {
+            json g = {
+                {"nodes", {
+                    {{"id","synth"}, {"type",type}},
+                    {{"id","mixer"}, {"type","mixer"}, {"channel_count",1}}
+                }},
+                {"connections", {
+                    {{"from_node","synth"},{"from_port","audio_out_L"},
+                     {"to_node","mixer"}, {"to_port","audio_in_L_0"}},
+                    {{"from_node","synth"},{"from_port","audio_out_R"},
+                     {"to_node","mixer"}, {"to_port","audio_in_R_0"}}
+                }}
+            };
+            json events = {{"events", {
+                {{"beat", onset * ctx.beats_per_sample}, {"type","note_on"},
+                 {"node_id","synth"}, {"channel",0}, {"pitch",69}, {"velocity",100}}
+            }}};
+            auto tg = Graph::from_json(g.dump(), err);
+            assert(tg && tg->activate(44100.0f, block));
+            Dispatcher td;
+            td.swap_schedule(Schedule::from_json(events.dump(), err));
+            td.check_pending();
+            ctx.beat_position = 0.0;
+            td.dispatch(0.0, block * ctx.beats_per_sample, block, tg.get());
+            tg->process(ctx);
+            float before = 0.0f, after = 0.0f;
+            for (int i = 0; i < onset; ++i)     before = std::max(before, std::abs(tg->output_L()[i]));
+            for (int i = onset; i < block; ++i) after  = std::max(after,  std::abs(tg->output_L()[i]));
+            assert(before == 0.0f);
+            assert(after > 1e-3f);
+            tg->deactivate();
+            std::cout << "PASS: " << type << " note dispatched at frame " << onset
+                      << " of " << block << " starts there\n";
+        }
+    }
+
+    // --- Schedule::patched(): one track replaced, the others shared ---
+    {
+        json two = {{"events", {
+            {{"beat",0.0}, {"type","note_on"},  {"node_id","a"}, {"pitch",60}, {"velocity",100}},
+            {{"beat",4.0}, {"type","note_off"}, {"node_id","b"}, {"pitch",62}}
+        }}};
+        auto base = Schedule::from_json(two.dump(), err);
+        assert(base && base->tracks().size() == 2);
+
+        json edit = {{"events", {
+            {{"beat",8.0}, {"type","note_on"},  {"pitch",64}, {"velocity",90}},
+            {{"beat",2.0}, {"type","note_off"}, {"pitch",64}}
+        }}};
+        auto p = Schedule::patched(*base, "b", edit.dump(), err);
+        assert(p && p->tracks().size() == 2);
+        assert(p->tracks()[0] == base->tracks()[0]);
+        assert(p->tracks()[1]->events.size() == 2 && p->tracks()[1]->events[0].beat == 2.0);
+        assert(p->total_length_beats() == 8.0);
+
+        auto added = Schedule::patched(*p, "c", edit.dump(), err);
+        assert(added && added->node_ids().size() == 3 && added->node_ids()[2] == "c");
+        auto cleared = Schedule::patched(*p, "b", json{{"events", json::array()}}.dump(), err);
+        assert(cleared && cleared->tracks()[1]->events.empty());
+        assert(cleared->total_length_beats() == 0.0);
+
+        json foreign = {{"events", {{{"beat",1.0}, {"node_id","a"}}}}};
+        err.clear();
+        assert(!Schedule::patched(*p, "b", foreign.dump(), err) && !err.empty());
+
+        // A patch picked up mid-playback starts its track at the current beat.
+        json g = {
+            {"nodes", {
+                {{"id","synth"}, {"type","sine"}},
+                {{"id","mixer"}, {"type","mixer"}, {"channel_count",1}}
+            }},
+            {"connections", {
+                {{"from_node","synth"},{"from_port","audio_out_L"},
+                 {"to_node","mixer"}, {"to_port","audio_in_L_0"}},
+                {{"from_node","synth"},{"from_port","audio_out_R"},
+                 {"to_node","mixer"}, {"to_port","audio_in_R_0"}}
+            }}
+        };
+        const int block = 512, onset = 200;
+        ProcessContext pc;
+        pc.block_size = block;  pc.sample_rate = 44100.0f;  pc.bpm = 120.0f;
+        pc.beats_per_sample = 120.0 / 60.0 / 44100.0;
+        const double blk = block * pc.beats_per_sample;
+
+        auto tg = Graph::from_json(g.dump(), err);
+        assert(tg && tg->activate(44100.0f, block));
+        std::shared_ptr<const Schedule> live = Schedule::from_json(two.dump(), err);
+        Dispatcher td;
+        td.swap_schedule(live);
+        td.check_pending();
+        pc.beat_position = 0.0;
+        td.dispatch(0.0, blk, block, tg.get());
+        tg->process(pc);
+
+        json late = {{"events", {
+            {{"beat",0.0},                                    {"type","note_on"}, {"pitch",57}, {"velocity",100}},
+            {{"beat",blk + onset * pc.beats_per_sample},      {"type","note_on"}, {"pitch",69}, {"velocity",100}}
+        }}};
+        td.swap_schedule(Schedule::patched(*live, "synth", late.dump(), err));
+        td.check_pending();
+        pc.beat_position = blk;
+        td.dispatch(blk, 2 * blk, block, tg.get());
+        tg->process(pc);
+        float before = 0.0f, after = 0.0f;
+        for (int i = 0; i < onset; ++i)     before = std::max(before, std::abs(tg->output_L()[i]));
+        for (int i = onset; i < block; ++i) after  = std::max(after,  std::abs(tg->output_L()[i]));
+        assert(before == 0.0f);   // the beat-0 note is in the past and stays silent
+        assert(after > 1e-3f);
+        tg->deactivate();
+        std::cout << "PASS: schedule patch shares tracks and applies mid-playback\n";
+
+        // Loop wraps seek to the cached loop-start cursors; a patch drops the
+        // cached cursor of the track it replaces.
+        auto wrap_block = [&](int split) {
+            auto lg = Graph::from_json(g.dump(), err);
+            assert(lg && lg->activate(44100.0f, block));
+            td.seek(blk);
+            pc.beat_position = blk;
+            td.dispatch(blk, 2 * blk, block, lg.get());
+            lg->process(pc);
+            float pre = 0.0f, post = 0.0f;
+            for (int i = 0; i < split; ++i)     pre  = std::max(pre,  std::abs(lg->output_L()[i]));
+            for (int i = split; i < block; ++i) post = std::max(post, std::abs(lg->output_L()[i]));
+            lg->deactivate();
+            return pre == 0.0f && post > 1e-3f;
+        };
+        td.set_loop_start(blk);
+        assert(wrap_block(onset));
+        assert(wrap_block(onset));   // second wrap from the cache
+        json moved = {{"events", {
+            {{"beat",blk + 400 * pc.beats_per_sample}, {"type","note_on"}, {"pitch",69}, {"velocity",100}}
+        }}};
+        td.swap_schedule(Schedule::patched(*live, "synth", moved.dump(), err));
+        td.check_pending();
+        assert(wrap_block(400));
+        std::cout << "PASS: loop-start cursors cached across wraps and patches\n";
+
+        // A swapped-out schedule goes back to the producer; check_pending()
+        // never frees it on the audio thread.
+        Dispatcher rd;
+        std::weak_ptr<const Schedule> first = live;
+        rd.swap_schedule(std::move(live));
+        rd.check_pending();
+        rd.swap_schedule(nullptr);
+        rd.check_pending();
+        assert(!first.expired());
+        rd.swap_schedule(nullptr);
+        assert(first.expired());
+        std::cout << "PASS: swapped-out schedules are freed by the producer\n";
+    }
+
+    // --- Silence: idle nodes are skipped, their outputs flagged silent ---
+    {
+        auto stereo = [](const std::string& from, const std::string& to, const std::string& l,
+                         const std::string& r) {
+            return json::array({
+                {{"from_node",from},{"from_port","audio_out_L"},{"to_node",to},{"to_port",l}},
+                {{"from_node",from},{"from_port","audio_out_R"},{"to_node",to},{"to_port",r}}});
+        };
+        ProcessContext sc;
+        sc.block_size = 512;  sc.sample_rate = 44100.0f;  sc.bpm = 120.0f;
+        sc.beat_position = 0.0;  sc.beats_per_sample = 120.0 / 60.0 / 44100.0;
+        auto peak_of = [](const Graph& g) {
+            float p = 0.0f;
+            for (int i = 0; i < 512; ++i)
+                p = std::max({p, std::abs(g.output_L()[i]), std::abs(g.output_R()[i])});
+            return p;
+        };
+
+        json native = {
+            {"nodes", {{{"id","synth"}, {"type","sine"}},
+                       {{"id","mixer"}, {"type","mixer"}, {"channel_count",1}}}},
+            {"connections", stereo("synth", "mixer", "audio_in_L_0", "audio_in_R_0")}
+        };
+        auto ng = Graph::from_json(native.dump(), err);
+        assert(ng && ng->activate(44100.0f, 512));
+        ng->process(sc);
+        assert(ng->idle_steps() == 2 && peak_of(*ng) == 0.0f);
+        ng->find_node("synth")->note_on(0, 69, 100);
+        ng->process(sc);
+        assert(ng->idle_steps() == 0 && peak_of(*ng) > 1e-3f);
+        ng->find_node("synth")->all_notes_off();
+        ng->process(sc);
+        assert(ng->idle_steps() == 2 && peak_of(*ng) == 0.0f);
+        ng->deactivate();
+
+        // An effect keeps running for its tail after the synth falls
+        // silent, then is skipped too.
+        static PluginRegistration tail_reg { "test.fixed_tail",
+            []() -> std::unique_ptr<Plugin> { return std::make_unique<FixedTailPlugin>(); } };
+        PluginRegistry::add(&tail_reg);
+        json g = {
+            {"nodes", {{{"id","synth"}, {"type","builtin.sine"}},
+                       {{"id","fx"},    {"type","test.fixed_tail"}},
+                       {{"id","mixer"}, {"type","builtin.mixer"}, {"channel_count",1}}}},
+            {"connections", stereo("synth", "fx", "audio_in_L", "audio_in_R")}
+        };
+        for (auto& c : stereo("fx", "mixer", "audio_in_0_L", "audio_in_0_R"))
+            g["connections"].push_back(c);
+        auto tg = Graph::from_json(g.dump(), err);
+        assert(tg && tg->activate(44100.0f, 512));
+        tg->find_node("synth")->note_on(0, 69, 100);
+        tg->process(sc);
+        assert(tg->idle_steps() == 0);
+        tg->find_node("synth")->note_off(0, 69);
+        int release_blocks = 0, tail_blocks = 0;
+        for (int b = 0; b < 1000 && tg->idle_steps() != 3; ++b) {
+            tg->process(sc);
+            if (tg->idle_steps() == 0) ++release_blocks;
+            if (tg->idle_steps() == 1) ++tail_blocks;   // synth skipped, fx not
+        }
+        assert(tg->idle_steps() == 3 && peak_of(*tg) == 0.0f);
+        assert(release_blocks > 0 && tail_blocks == FixedTailPlugin::TAIL / 512);
+        tg->find_node("synth")->note_on(0, 69, 100);
+        tg->process(sc);
+        assert(tg->idle_steps() == 0 && peak_of(*tg) > 1e-3f);
+        tg->deactivate();
+        std::cout << "PASS: idle nodes bypassed once their tails end\n";
+    }
+
+    // --- Schedule readers: whole requests, bad input, packed records ---
+    {
+        // A set_schedule request as it arrives: extra keys (and nested
+        // values in them) are skipped.
+        json req = {{"cmd","set_schedule"}, {"id", {{"n",1}}},
+                    {"events", {
+                        {{"beat",-1}, {"type","program"}, {"node_id","b"}, {"pitch",5}, {"velocity",2}},
+                        {{"beat",1.5}, {"type","note_on"}, {"node_id","a"}, {"pitch",60},
+                         {"velocity",100}, {"extra", {1, {{"x",2}}}}},
+                        {{"beat",0.5}, {"node_id","a"}, {"pitch",62}, {"velocity",90}}
+                    }},
+                    {"trailer", json::array()}};
+        auto sched = Schedule::from_json(req.dump(), err);
+        assert(sched && sched->node_ids() == (std::vector<std::string>{"b", "a"}));
+        const auto& a = sched->tracks()[1]->events;
+        assert(a.size() == 2 && a[0].beat == 0.5 && a[0].type == EventType::NoteOn);
+        assert(sched->tracks()[0]->events[0].beat == 0.0);   // setup event clamped
+        assert(sched->total_length_beats() == 1.5);
+
+        for (const char* bad : {"[]", "{\"events\": {}}", "{\"events\": [1]}",
+                                "{\"events\": [{\"beat\": \"x\"}]}",
+                                "{\"events\": [{\"type\": \"nope\"}]}",
+                                "{\"events\": [{\"beat\": 1}"}) {
+            err.clear();
+            assert(!Schedule::from_json(bad, err) && !err.empty());
+        }
+
+        // The same events as packed records.
+        auto pack = [](std::vector<uint8_t>& out, double beat, uint32_t node, uint8_t type,
+                       uint8_t pitch, uint8_t vel) {
+            uint8_t r[protocol::PACKED_EVENT_BYTES] = {};
+            float value = 0.0f;
+            std::memcpy(r, &beat, 8);
+            std::memcpy(r + 8, &value, 4);
+            std::memcpy(r + 12, &node, 4);
+            r[16] = type; r[18] = pitch; r[19] = vel;
+            out.insert(out.end(), r, r + sizeof(r));
+        };
+        std::vector<uint8_t> packed;
+        pack(packed, -1.0, 0, 2, 5, 2);
+        pack(packed, 1.5, 1, 0, 60, 100);
+        pack(packed, 0.5, 1, 0, 62, 90);
+        auto ps = Schedule::from_packed(packed.data(), packed.size(), {"b", "a"}, err);
+        assert(ps && ps->node_ids() == sched->node_ids());
+        for (size_t t = 0; t < 2; ++t) {
+            const auto& x = ps->tracks()[t]->events;
+            const auto& y = sched->tracks()[t]->events;
+            assert(x.size() == y.size());
+            for (size_t i = 0; i < x.size(); ++i)
+                assert(x[i].beat == y[i].beat && x[i].type == y[i].type &&
+                       x[i].pitch == y[i].pitch && x[i].velocity == y[i].velocity);
+        }
+        assert(!Schedule::from_packed(packed.data(), packed.size() - 1, {"b", "a"}, err));
+        assert(!Schedule::from_packed(packed.data(), packed.size(), {"b"}, err));
+        assert(!Schedule::track_from_packed("a", packed.data(), packed.size(), err));
+        std::cout << "PASS: single-pass schedule reader and packed events\n";
+    }
+
+    // --- patched(): surviving nodes keep their instance and state ---
+    {
+        json g = {
+            {"nodes", {
+                {{"id","ts"},     {"type","track_source"}},
+                {{"id","synth1"}, {"type","sine"}},
+                {{"id","mixer"},  {"type","mixer"}, {"channel_count",2}}
+            }},
+            {"connections", {
+                {{"from_node","ts"},     {"from_port","events"},
+                 {"to_node","synth1"},   {"to_port","events"}},
+                {{"from_node","synth1"}, {"from_port","audio_out_L"},
+                 {"to_node","mixer"},    {"to_port","audio_in_L_0"}},
+                {{"from_node","synth1"}, {"from_port","audio_out_R"},
+                 {"to_node","mixer"},    {"to_port","audio_in_R_0"}}
+            }}
+        };
+        auto peak = [](Graph& pg, ProcessContext& c) {
+            pg.commit_wiring();
+            pg.process(c);
+            float m = 0.0f;
+            for (int i = 0; i < c.block_size; ++i) m = std::max(m, std::abs(pg.output_L()[i]));
+            return m;
+        };
+        ctx.beat_position = 0.0;
+        auto base = Graph::from_json(g.dump(), err);
+        assert(base && base->activate(44100.0f, 512));
+        Node* synth1 = base->find_node("synth1");
+        base->find_node("ts")->note_on(0, 69, 100);
+        assert(peak(*base, ctx) > 1e-3f);
+
+        json add = {
+            {"add_nodes", {{{"id","synth2"}, {"type","sine"}}}},
+            {"add_connections", {
+                {{"from_node","ts"},     {"from_port","events"},
+                 {"to_node","synth2"},   {"to_port","events"}},
+                {{"from_node","synth2"}, {"from_port","audio_out_L"},
+                 {"to_node","mixer"},    {"to_port","audio_in_L_1"}},
+                {{"from_node","synth2"}, {"from_port","audio_out_R"},
+                 {"to_node","mixer"},    {"to_port","audio_in_R_1"}}
+            }}
+        };
+        auto added = base->patched(add.dump(), err);
+        assert(added);
+        assert(added->find_node("synth1") == synth1);
+        assert(added->find_node("synth2") && added->eval_order().size() == 4);
+        assert(added->serial() != base->serial());
+        base.reset();                            // retires without touching synth1
+        assert(peak(*added, ctx) > 1e-3f);       // synth1's voice is still sounding
+
+        // Drop synth1: the track now only reaches synth2.
+        auto removed = added->patched(json{{"remove_nodes", {"synth1"}}}.dump(), err);
+        assert(removed && !removed->find_node("synth1"));
+        added.reset();
+        assert(peak(*removed, ctx) == 0.0f);
+        removed->find_node("ts")->note_on(0, 81, 100);
+        assert(peak(*removed, ctx) > 1e-3f);
+
+        assert(!removed->patched(json{{"remove_nodes", {"nope"}}}.dump(), err) && !err.empty());
+        assert(!removed->patched(json{{"add_nodes", {{{"id","synth2"}, {"type","sine"}}}}}.dump(), err));
+        assert(!removed->patched("{", err));
+        removed->deactivate();
+        std::cout << "PASS: patched graph shares surviving nodes, adds and removes\n";
+    }
+
+    // --- Preview ring: one block of latency, bounded capacity ---
+    {
+        json g = {
+            {"nodes", {
+                {{"id","ts"},    {"type","track_source"}},
+                {{"id","synth"}, {"type","sine"}},
+                {{"id","mixer"}, {"type","mixer"}, {"channel_count",1}}
+            }},
+            {"connections", {
+                {{"from_node","ts"},    {"from_port","events"},
+                 {"to_node","synth"},   {"to_port","events"}},
+                {{"from_node","synth"}, {"from_port","audio_out_L"},
+                 {"to_node","mixer"},   {"to_port","audio_in_L_0"}},
+                {{"from_node","synth"}, {"from_port","audio_out_R"},
+                 {"to_node","mixer"},   {"to_port","audio_in_R_0"}}
+            }}
+        };
+        auto pg = Graph::from_json(g.dump(), err);
+        assert(pg && pg->activate(44100.0f, 512));
+        auto* ts = dynamic_cast<TrackSourceNode*>(pg->find_node("ts"));
+        assert(ts);
+
+        // Just arrived: placed a block late, at the end of this block.
+        assert(ts->preview_note_on(0, 69, 100));
+        pg->process(ctx);
+        assert(std::abs(pg->output_L()[0]) == 0.0f);
+        pg->process(ctx);
+        float held = 0.0f;
+        for (int i = 0; i < 512; ++i) held = std::max(held, std::abs(pg->output_L()[i]));
+        assert(held > 1e-3f);
+
+        size_t queued = 0;
+        while (ts->preview_note_off(0, 69)) ++queued;
+        assert(queued == TrackSourceNode::PREVIEW_CAPACITY);
+        auto depths = pg->preview_queue_depths();
+        assert(depths.size() == 1 && depths[0].first == "ts" &&
+               depths[0].second == TrackSourceNode::PREVIEW_CAPACITY);
+        pg->process(ctx);                        // drains the ring
+        assert(pg->preview_queue_depths()[0].second == 0);
+        assert(ts->preview_all_notes_off());
+
+        // Three blocks so far, each timed once per node in plan order.
+        auto loads = pg->node_loads();
+        if (perf::enabled) {
+            assert(loads.size() == 3 && loads.back().first == "mixer");
+            for (auto& [id, l] : loads)
+                assert(l.count == 3 && l.p50_ns <= l.p99_ns && l.p99_ns <= l.max_ns);
+            pg->reset_node_loads();
+            assert(pg->node_loads()[0].second.count == 0);
+        } else {
+            assert(loads.empty());
+        }
+        pg->deactivate();
+        std::cout << "PASS: preview notes through the lock-free ring\n";
+    }
+
+    // --- Plugin event lists: sorted on input, bounded, overflow counted ---
+    {
+        PluginAdapterNode echo("echo", std::make_unique<EventEchoPlugin>());
+        echo.activate(44100.0f, 512);
+        const size_t cap = PluginAdapterNode::EVENT_LIST_CAPACITY;
+        std::vector<MidiEvent> late(cap, MidiEvent{400, 0x90, 60, 100, 0});
+        std::vector<MidiEvent> early(10, MidiEvent{5, 0x80, 60, 0, 0});
+        echo.deliver_events(0, late.data(), cap - 4);
+        echo.deliver_events(0, early.data(), early.size());   // 4 fit, 6 dropped
+        std::vector<PortBuffer> no_inputs, no_outputs;
+        echo.process(ctx, no_inputs, no_outputs);
+        auto& out = echo.event_outputs().at(0).second;
+        assert(out.size() == cap && out.capacity() == cap);
+        for (size_t i = 0; i < 4; ++i) assert(out[i].frame == 5);
+        assert(out[4].frame == 400 && out[cap - 1].frame == 400);
+        assert(echo.events_dropped() == 6);
+        echo.deactivate();
+        std::cout << "PASS: plugin event lists (" << cap << " per port, overflow counted)\n";
+    }
+
+    // --- DSP kernels against scalar references (odd length for the tails) ---
+    {
+        const int n = 37;
+        std::vector<float> a(n), b(n), acc(n, 0.25f), lr(2 * n);
+        for (int i = 0; i < n; ++i) {
+            a[i] = (i - 18) * 0.3f;     // -5.4 .. 5.4, past the clamp
+            b[i] = i * 0.01f;
+        }
+        dsp::gain_accumulate(acc.data(), b.data(), 2.0f, n);
+        dsp::interleave(lr.data(), a.data(), b.data(), n);
+        std::vector<float> clipped = a;
+        dsp::soft_clip(clipped.data(), n);
+        for (int i = 0; i < n; ++i) {
+            assert(std::abs(acc[i] - (0.25f + b[i] * 2.0f)) < 1e-6f);
+            assert(lr[2 * i] == a[i] && lr[2 * i + 1] == b[i]);
+            assert(std::abs(clipped[i] - std::tanh(a[i])) < 1.1e-4f);
+            assert(std::abs(clipped[i]) <= 1.0f);
+        }
+        float peak = 0.0f, energy = 0.0f, ref_energy = 0.0f;
+        dsp::peak_energy(a.data(), n, peak, energy);
+        for (float v : a) ref_energy += v * v;
+        assert(std::abs(peak - 5.4f) < 1e-5f);
+        assert(std::abs(energy - ref_energy) < 1e-3f);
+        std::cout << "PASS: dsp kernels (" << dsp::backend() << ")\n";
+    }
+
+    // --- Sine voice pool: oscillator accuracy, odd block sizes, stealing ---
+    {
+        SineVoicePool pool;
+        pool.reserve(2);
+        const float sr = 48000.0f;
+        pool.note_on(0, 1000.0, sr, 0.5f);
+        std::vector<float> out(1023, 0.0f);   // not a multiple of the SIMD width
+        pool.render(out.data(), 600, 1.0f);
+        pool.render(out.data() + 600, 423, 1.0f);
+        float max_err = 0.0f;
+        for (int i = 0; i < 1023; ++i) {
+            float ref = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * 1000.0 * i / sr));
+            max_err = std::max(max_err, std::abs(out[i] - ref));
+        }
+        assert(max_err < 1e-4f);
+
+        pool.note_on(1, 500.0, sr, 0.5f);
+        pool.note_on(2, 250.0, sr, 0.5f);   // pool full: steals the oldest (key 0)
+        assert(pool.active() == 2);
+        pool.release(0, 0.5f);              // stolen, so nothing to release
+        pool.release(1, 0.5f);
+        std::fill(out.begin(), out.end(), 0.0f);
+        pool.render(out.data(), 64, 1.0f);
+        assert(pool.active() == 1);         // key 1 decayed below the threshold
+        pool.clear_channel(0);
+        assert(pool.active() == 0);
+        std::cout << "PASS: sine voice pool (max error " << max_err << ")\n";
+    }
+
+    // --- Reverb: engines against the scalar loop, FDN decay, mode switch ---
+    {
+        // Ports: audio_in L/R, room_size, damping, wet, dry, width; audio_out
+        // L/R.  The controls are unconnected, so they take set_param values.
+        const int max_block = 512;
+        std::vector<float> in_L(max_block), in_R(max_block), out_L(max_block), out_R(max_block);
+        std::vector<PortBuffer> ins(7), outs(2);
+        ins[0].audio  = in_L.data();
+        ins[1].audio  = in_R.data();
+        outs[0].audio = out_L.data();
+        outs[1].audio = out_R.data();
+        const float room = 0.6f, damp = 0.4f, wet = 0.5f, dry = 0.8f, width = 0.7f;
+        ProcessContext rctx = ctx;
+        uint32_t seed = 12345;
+        auto noise = [&seed] {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / 8388608.0f - 1.0f;
+        };
+        // Input for the block: noise for the first `loud` frames, then silence.
+        auto feed = [&](int n, int& loud) {
+            for (int i = 0; i < n; ++i, --loud) {
+                in_L[i] = loud > 0 ? noise() : 0.0f;
+                in_R[i] = loud > 0 ? noise() : 0.0f;
+            }
+            rctx.block_size = n;
+        };
+        auto energy = [&](int n) {
+            float e = 0.0f;
+            for (int i = 0; i < n; ++i) e += out_L[i] * out_L[i] + out_R[i] * out_R[i];
+            return e;
+        };
+
+        // Freeverb: odd block sizes put the ring ends mid-block and mid-quad.
+        PluginAdapterNode verb("verb", make_reverb_plugin());
+        verb.activate(44100.0f, max_block);
+        verb.set_param("room_size", room);
+        verb.set_param("damping", damp);
+        verb.set_param("wet", wet);
+        verb.set_param("dry", dry);
+        verb.set_param("width", width);
+        ScalarFreeverb ref;
+        std::vector<float> ref_L(max_block), ref_R(max_block);
+        const int sizes[] = { 1, 3, 7, 61, 127, 509, 255, 2, 333 };
+        const float fb = std::min(room * 0.28f + 0.7f, 0.98f);
+        float max_err = 0.0f;
+        int loud = 3000, frames = 0;
+        for (int b = 0; frames < 4 * 1379; ++b) {
+            int n = sizes[b % 9];
+            feed(n, loud);
+            verb.process(rctx, ins, outs);
+            ref.process(in_L.data(), in_R.data(), ref_L.data(), ref_R.data(), n, fb, damp,
+                        dry, wet * (width * 0.5f + 0.5f), wet * ((1.0f - width) * 0.5f));
+            for (int i = 0; i < n; ++i)
+                max_err = std::max({ max_err, std::abs(out_L[i] - ref_L[i]),
+                                     std::abs(out_R[i] - ref_R[i]) });
+            frames += n;
+        }
+        assert(max_err < 1e-4f);
+
+        // Mode switch: the tail is still ringing, and the first block after
+        // configure() comes from empty tanks, so with silent input it is zero.
+        feed(64, loud);
+        verb.process(rctx, ins, outs);
+        assert(energy(64) > 1e-3f);
+        verb.plugin()->configure("mode", "fdn");
+        verb.process(rctx, ins, outs);
+        assert(energy(64) == 0.0f);
+        loud = 64;
+        feed(64, loud);
+        verb.process(rctx, ins, outs);
+        assert(energy(64) > 1e-3f);
+        verb.plugin()->configure("mode", "freeverb");
+        feed(64, loud);
+        verb.process(rctx, ins, outs);
+        assert(energy(64) == 0.0f);
+        verb.deactivate();
+
+        // FDN at the longest room: bounded, and ten seconds later well down.
+        PluginAdapterNode fdn("fdn", make_reverb_plugin());
+        fdn.plugin()->configure("mode", "fdn");
+        fdn.activate(44100.0f, max_block);
+        fdn.set_param("room_size", 1.0f);
+        fdn.set_param("dry", 0.0f);   // wet only
+        float peak = 0.0f, first = 0.0f, last = 0.0f;
+        loud = 4096;
+        for (int b = 0; b < 10 * 44100 / 509; ++b) {
+            feed(509, loud);
+            fdn.process(rctx, ins, outs);
+            for (int i = 0; i < 509; ++i) {
+                assert(std::isfinite(out_L[i]) && std::isfinite(out_R[i]));
+                peak = std::max({ peak, std::abs(out_L[i]), std::abs(out_R[i]) });
+            }
+            if (b == 10) first = energy(509);
+            last = energy(509);
+        }
+        assert(first > 0.0f && peak < 8.0f);
+        assert(last < first * 1e-4f);
+        fdn.deactivate();
+        std::cout << "PASS: reverb engines (freeverb max error " << max_err
+                  << ", fdn peak " << peak << ")\n";
+    }
+
     std::cout << "All graph tests passed.\n";
     return 0;
 }
@@ -9,6 +9,8 @@
 #include <thread>
 #include <chrono>
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
 
 using json = nlohmann::json;
 
@@ -91,9 +93,247 @@ int main() {
         std::cout << "PASS: unknown command → error\n";
     }
 
+    // Test 5: binary frame through a JSON-only handler — header passes
+    // through, reply is a binary frame with an empty payload
+    {
+        IpcMessage req, resp;
+        req.json = json{{"cmd","ping"}}.dump();
+        req.payload.assign(16, 0xAB);
+        std::string err = client.send(req, resp);
+        assert(err.empty());
+        assert(resp.binary);
+        assert(json::parse(resp.json)["pong"] == true);
+        assert(resp.payload.empty());
+        std::cout << "PASS: binary frame via JSON handler\n";
+    }
+
     client.disconnect();
     server.stop();
 
+    // Test 6: binary payload round trip (1 MB of raw, non-UTF-8 bytes) mixed
+    // with plain JSON frames on the same connection
+    {
+        IpcServer bin_server(ADDR);
+        std::string err = bin_server.start([](const IpcMessage& req) -> IpcMessage {
+            IpcMessage resp;
+            resp.json    = json{{"status","ok"},{"bytes", req.payload.size()}}.dump();
+            resp.payload = req.payload;
+            return resp;
+        });
+        assert(err.empty());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        IpcClient bin_client(ADDR);
+        err = bin_client.connect();
+        assert(err.empty());
+
+        IpcMessage req, resp;
+        req.json = json{{"cmd","echo"}}.dump();
+        req.payload.resize(1 << 20);
+        for (size_t i = 0; i < req.payload.size(); ++i)
+            req.payload[i] = static_cast<uint8_t>(i * 31);
+        err = bin_client.send(req, resp);
+        assert(err.empty());
+        assert(resp.binary);
+        assert(json::parse(resp.json)["bytes"] == req.payload.size());
+        assert(resp.payload == req.payload);
+
+        std::string plain;
+        err = bin_client.send(json{{"cmd","ping"}}.dump(), plain);
+        assert(err.empty());
+        assert(json::parse(plain)["status"] == "ok");
+        std::cout << "PASS: binary payload round trip 1MB\n";
+
+        bin_client.disconnect();
+        bin_server.stop();
+    }
+
+    // Test 7: streaming handler — intermediate frames precede the reply, in
+    // the request's frame type
+    {
+        IpcServer stream_server(ADDR);
+        std::string err = stream_server.start(
+            [](const IpcMessage& req, const ReplyWriter& write) -> IpcMessage {
+                int n = json::parse(req.json).value("count", 0);
+                for (int i = 0; i < n; ++i) {
+                    IpcMessage frame;
+                    frame.json = json{{"status","progress"},{"i",i}}.dump();
+                    frame.payload.assign(8, static_cast<uint8_t>(i));
+                    if (!write(frame)) break;
+                }
+                IpcMessage resp;
+                resp.json = json{{"status","ok"},{"sent",n}}.dump();
+                return resp;
+            });
+        assert(err.empty());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        IpcClient stream_client(ADDR);
+        err = stream_client.connect();
+        assert(err.empty());
+
+        IpcMessage req, frame;
+        req.json = json{{"cmd","stream"},{"count",3}}.dump();
+        err = stream_client.send(req, frame);
+        int seen = 0;
+        while (err.empty() && json::parse(frame.json)["status"] == "progress") {
+            assert(frame.binary);
+            assert(json::parse(frame.json)["i"] == seen);
+            assert(frame.payload == std::vector<uint8_t>(8, static_cast<uint8_t>(seen)));
+            ++seen;
+            err = stream_client.receive(frame);
+        }
+        assert(err.empty());
+        assert(seen == 3);
+        assert(json::parse(frame.json)["sent"] == 3);
+
+        std::string plain;
+        err = stream_client.send(json{{"cmd","stream"},{"count",2}}.dump(), plain);
+        assert(err.empty());
+        assert(json::parse(plain)["status"] == "progress");
+        for (int i = 0; i < 2; ++i) {
+            err = stream_client.receive(frame);
+            assert(err.empty() && !frame.binary);
+        }
+        assert(json::parse(frame.json)["status"] == "ok");
+        std::cout << "PASS: streaming handler intermediate frames\n";
+
+        stream_client.disconnect();
+        stream_server.stop();
+    }
+
+    // Test 8: lanes — a tagged fast request overtakes a slow one on the same
+    // connection, and another connection is served while the slow one runs.
+    // The slow handler waits for "release", so a serial server would time out.
+    {
+        std::mutex m;
+        std::condition_variable cv;
+        bool released = false;
+
+        IpcServer lane_server(ADDR);
+        std::string err = lane_server.start(
+            [&](const IpcMessage& req, const ReplyWriter&) -> IpcMessage {
+                json j = json::parse(req.json);
+                std::string cmd = j.value("cmd", "");
+                json resp = {{"status","ok"},{"cmd",cmd}};
+                if (j.contains("id")) resp["id"] = j["id"];
+                if (cmd == "slow") {
+                    std::unique_lock<std::mutex> lk(m);
+                    resp["released"] = cv.wait_for(lk, std::chrono::seconds(2),
+                                                   [&] { return released; });
+                } else if (cmd == "release") {
+                    { std::lock_guard<std::mutex> lk(m); released = true; }
+                    cv.notify_all();
+                }
+                IpcMessage out;
+                out.json = resp.dump();
+                return out;
+            },
+            [](const IpcMessage& req) {
+                json j = json::parse(req.json);
+                IpcRoute r;
+                r.lane    = j.value("cmd", "") == "slow" ? IpcLane::Slow : IpcLane::Fast;
+                r.ordered = !j.contains("id");
+                return r;
+            });
+        assert(err.empty());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        IpcClient a(ADDR), b(ADDR);
+        err = a.connect();
+        assert(err.empty());
+        err = b.connect();
+        assert(err.empty());
+
+        IpcMessage req, frame;
+        req.binary = false;
+        req.json = json{{"cmd","slow"},{"id",1}}.dump();
+        err = a.post(req);
+        assert(err.empty());
+        req.json = json{{"cmd","ping"},{"id",2}}.dump();
+        err = a.post(req);
+        assert(err.empty());
+
+        err = a.receive(frame);
+        assert(err.empty());
+        assert(json::parse(frame.json)["id"] == 2);
+
+        std::string plain;
+        err = b.send(json{{"cmd","release"}}.dump(), plain);
+        assert(err.empty());
+        assert(json::parse(plain)["status"] == "ok");
+
+        err = a.receive(frame);
+        assert(err.empty());
+        auto j = json::parse(frame.json);
+        assert(j["id"] == 1);
+        assert(j["released"] == true);
+
+        // Untagged requests are still answered in order.
+        err = a.send(json{{"cmd","ping"}}.dump(), plain);
+        assert(err.empty());
+        assert(json::parse(plain)["cmd"] == "ping");
+        std::cout << "PASS: fast lane overtakes slow request\n";
+
+        a.disconnect();
+        b.disconnect();
+        lane_server.stop();
+    }
+
+    // Test 9: a client that stops reading is hung up on once a reply frame
+    // has waited past the send deadline, and the fast lane moves on.
+    {
+        std::mutex m;
+        std::condition_variable cv;
+        bool write_failed = false;
+
+        IpcServer stall_server(ADDR);
+        std::string err = stall_server.start(
+            [&](const IpcMessage& req, const ReplyWriter& write) -> IpcMessage {
+                IpcMessage out;
+                out.json = json{{"status","ok"}}.dump();
+                if (json::parse(req.json).value("cmd", "") != "flood") return out;
+                IpcMessage frame;
+                frame.json = json{{"status","progress"}}.dump();
+                frame.payload.assign(1 << 20, 0);
+                for (int i = 0; i < 256; ++i) {
+                    if (write(frame)) continue;
+                    { std::lock_guard<std::mutex> lk(m); write_failed = true; }
+                    cv.notify_all();
+                    break;
+                }
+                return out;
+            },
+            [](const IpcMessage&) { IpcRoute r; r.lane = IpcLane::Fast; r.ordered = false; return r; });
+        assert(err.empty());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        IpcClient stalled(ADDR), other(ADDR);
+        err = stalled.connect();
+        assert(err.empty());
+        err = other.connect();
+        assert(err.empty());
+
+        IpcMessage req;
+        req.json = json{{"cmd","flood"}}.dump();
+        err = stalled.post(req);   // and never read the replies
+        assert(err.empty());
+        {
+            std::unique_lock<std::mutex> lk(m);
+            bool failed = cv.wait_for(lk, std::chrono::seconds(10), [&] { return write_failed; });
+            assert(failed);
+        }
+        std::string plain;
+        err = other.send(json{{"cmd","ping"}}.dump(), plain);
+        assert(err.empty());
+        assert(json::parse(plain)["status"] == "ok");
+        std::cout << "PASS: stalled reader hung up after the send deadline\n";
+
+        stalled.disconnect();
+        other.disconnect();
+        stall_server.stop();
+    }
+
     std::cout << "All IPC tests passed.\n";
     return 0;
 }
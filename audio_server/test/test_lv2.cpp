@@ -0,0 +1,138 @@
+// test/test_lv2.cpp
+// Tests LV2 discovery against real lilv: the on-disk descriptor cache (a
+// hit, then a bundle whose mtime changed) and lv2_world_load_plugin()
+// loading a bundle into the shared world on first use.  Builds a throwaway
+// bundle (Turtle only; nothing is instantiated) under a temporary LV2_PATH
+// and XDG_CACHE_HOME.  Built with ENABLE_LV2.
+
+#include "synth_node.h"
+#include "nlohmann/json.hpp"
+#include <lilv/lilv.h>
+
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+static const std::string URI = "urn:arranger:test:gain";
+
+static void set_env(const char* name, const std::string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+static void write_file(const fs::path& file, const std::string& text) {
+    std::ofstream out(file, std::ios::trunc);
+    out << text;
+    assert(out);
+}
+
+static void write_plugin_ttl(const fs::path& bundle, const std::string& name) {
+    write_file(bundle / "gain.ttl",
+        "@prefix lv2:  <http://lv2plug.in/ns/lv2core#> .\n"
+        "@prefix doap: <http://usefulinc.com/ns/doap#> .\n"
+        "<" + URI + "> a lv2:Plugin ;\n"
+        "    doap:name \"" + name + "\" ;\n"
+        "    lv2:port [ a lv2:InputPort, lv2:ControlPort ; lv2:index 0 ;\n"
+        "               lv2:symbol \"gain\" ; lv2:name \"Gain\" ;\n"
+        "               lv2:default 0.5 ; lv2:minimum 0 ; lv2:maximum 2 ] ,\n"
+        "             [ a lv2:InputPort, lv2:AudioPort ; lv2:index 1 ;\n"
+        "               lv2:symbol \"in\" ; lv2:name \"In\" ] ,\n"
+        "             [ a lv2:OutputPort, lv2:AudioPort ; lv2:index 2 ;\n"
+        "               lv2:symbol \"out\" ; lv2:name \"Out\" ] .\n");
+}
+
+// What refresh_index() stamps a bundle with: the newest of the directory
+// and its top-level .ttl files.
+static int64_t bundle_stamp(const fs::path& bundle) {
+    auto t = fs::last_write_time(bundle);
+    for (auto& f : fs::directory_iterator(bundle))
+        if (f.path().extension() == ".ttl") t = std::max(t, fs::last_write_time(f.path()));
+    return static_cast<int64_t>(t.time_since_epoch().count());
+}
+
+static json find_plugin(const std::string& listing) {
+    for (auto& entry : json::parse(listing))
+        if (entry.value("uri", "") == URI) return entry;
+    return nullptr;
+}
+
+int main() {
+    std::cout << "=== test_lv2 ===\n";
+
+    fs::path root = fs::temp_directory_path() /
+        ("arranger_test_lv2_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::path lv2_dir = root / "lv2", bundle = lv2_dir / "gain.lv2", cache_dir = root / "cache";
+    fs::create_directories(bundle);
+    set_env("LV2_PATH", lv2_dir.string());
+    set_env("XDG_CACHE_HOME", cache_dir.string());
+
+    write_file(bundle / "manifest.ttl",
+        "@prefix lv2:  <http://lv2plug.in/ns/lv2core#> .\n"
+        "@prefix rdfs: <http://www.w3.org/2000/01/rdf-schema#> .\n"
+        "<" + URI + "> a lv2:Plugin ;\n"
+        "    lv2:binary <gain.so> ;\n"
+        "    rdfs:seeAlso <gain.ttl> .\n");
+    write_plugin_ttl(bundle, "Test Gain");
+
+    // --- Cache hit: an entry at the bundle's current stamp is not re-parsed ---
+    // The planted entry names the plugin differently from its Turtle, so the
+    // listing shows which one it came from.
+    std::string key = (bundle.lexically_normal() / "").string();
+    fs::path cache_file = cache_dir / "arranger" / "lv2_plugins.json";
+    fs::create_directories(cache_file.parent_path());
+    json cached_entry = {{"uri", URI}, {"name", "From Cache"}, {"category", "Plugin"},
+                         {"ports", json::array()}};
+    write_file(cache_file, json{
+        {"version", 1},
+        {"bundles", {{key, {{"mtime", bundle_stamp(bundle)}, {"plugins", {cached_entry}}}}}},
+    }.dump());
+    json entry = find_plugin(list_lv2_plugins());
+    assert(entry.is_object() && entry["name"] == "From Cache");
+    std::cout << "PASS: descriptor cache hit\n";
+
+    // --- mtime change: the bundle is parsed again and the cache rewritten ---
+    write_plugin_ttl(bundle, "Test Gain 2");
+    fs::last_write_time(bundle / "gain.ttl", fs::last_write_time(bundle) + std::chrono::seconds(10));
+    entry = find_plugin(list_lv2_plugins());
+    assert(entry.is_object() && entry["name"] == "Test Gain 2");
+    assert(entry["ports"].size() == 3);
+    assert(entry["ports"][0]["symbol"] == "gain" && entry["ports"][0]["type"] == "control");
+    assert(entry["ports"][0]["default"] == 0.5f && entry["ports"][0]["max"] == 2.0f);
+    assert(entry["ports"][2]["direction"] == "output");
+    std::ifstream in(cache_file);
+    json on_disk = json::parse(in);
+    assert(on_disk["bundles"][key]["mtime"] == bundle_stamp(bundle));
+    assert(on_disk["bundles"][key]["plugins"][0]["name"] == "Test Gain 2");
+    assert(find_plugin(list_lv2_plugins("urn:arranger:")).is_object());
+    assert(!find_plugin(list_lv2_plugins("urn:other:")).is_object());
+    std::cout << "PASS: changed bundle re-parsed\n";
+
+    // --- Lazy loading: the world holds no plugins until one is asked for ---
+    auto* world = static_cast<LilvWorld*>(lv2_world_acquire());
+    assert(lilv_plugins_size(lilv_world_get_all_plugins(world)) == 0);
+    auto* p = static_cast<const LilvPlugin*>(lv2_world_load_plugin(world, URI));
+    assert(p);
+    assert(lilv_plugins_size(lilv_world_get_all_plugins(world)) == 1);
+    LilvNode* name = lilv_plugin_get_name(p);
+    assert(name && std::string(lilv_node_as_string(name)) == "Test Gain 2");
+    lilv_node_free(name);
+    assert(lv2_world_load_plugin(world, URI) == p);              // already loaded
+    assert(!lv2_world_load_plugin(world, "urn:arranger:test:missing"));
+    lv2_world_release();
+    std::cout << "PASS: bundle loaded on first use\n";
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    std::cout << "All LV2 tests passed.\n";
+    return 0;
+}
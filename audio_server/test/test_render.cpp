@@ -4,6 +4,7 @@
 // No PortAudio stream is opened (render_offline doesn't need one).
 
 #include "audio_engine.h"
+#include "sample_stream.h"
 #include "nlohmann/json.hpp"
 
 #include <iostream>
@@ -11,9 +12,15 @@
 #include <cstring>
 #include <cmath>
 #include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 using json = nlohmann::json;
 
+void register_builtin_plugins();   // builtin_plugins.cpp
+
 // Read WAV header fields
 struct WavHeader {
     uint32_t data_size;
@@ -113,6 +120,226 @@ int main() {
     std::cout << "PASS: peak sample value = " << peak << "\n";
     assert(peak > 100);  // 440Hz sine at amp 0.15 should give ~4000+ peak
 
+    // Streamed render: concatenated chunks must equal the one-shot float
+    // render, and no chunk may exceed the requested size (rounded up to a
+    // whole block).
+    {
+        auto pcm = engine.render_offline(0.5f);
+        std::vector<uint8_t> streamed;
+        size_t  max_chunk = 0;
+        int     chunks    = 0;
+        int64_t last_done = 0;
+        int64_t frames = engine.render_offline_stream(
+            AudioEngine::RenderFormat::RawF32,
+            [&](const uint8_t* data, size_t bytes, int64_t done, int64_t total) {
+                assert(done > last_done && done <= total);
+                last_done = done;
+                streamed.insert(streamed.end(), data, data + bytes);
+                max_chunk = std::max(max_chunk, bytes);
+                ++chunks;
+                return true;
+            },
+            1000, 0.5f);
+        assert(frames == last_done && frames * 2 == (int64_t)pcm.size());
+        assert(streamed.size() == pcm.size() * sizeof(float));
+        assert(std::memcmp(streamed.data(), pcm.data(), streamed.size()) == 0);
+        assert(max_chunk <= 1024 * 2 * sizeof(float));
+        std::cout << "PASS: streamed render matches in " << chunks << " chunks\n";
+
+        // Aborting from the sink stops the render early
+        int calls = 0;
+        frames = engine.render_offline_stream(
+            AudioEngine::RenderFormat::RawF32,
+            [&](const uint8_t*, size_t, int64_t, int64_t) { return ++calls < 2; },
+            1000, 0.5f);
+        assert(frames == -1 && calls == 2);
+        std::cout << "PASS: streamed render aborts when the sink returns false\n";
+
+        // Each render builds its own graph, so concurrent renders neither
+        // share voice state nor disturb one another
+        std::vector<float> side;
+        std::thread t([&] { side = engine.render_offline(0.5f); });
+        auto again = engine.render_offline(0.5f);
+        t.join();
+        assert(again == pcm && side == pcm);
+        std::cout << "PASS: concurrent renders are independent\n";
+
+        // A render pool of its own gives the same samples as serial
+        AudioEngineConfig par_cfg = cfg;
+        par_cfg.render_worker_threads = 2;
+        AudioEngine par_engine(par_cfg);
+        assert(par_engine.set_graph(graph_desc.dump()).empty());
+        assert(par_engine.set_schedule(sched.dump()).empty());
+        assert(par_engine.render_offline(0.5f) == pcm);
+        std::cout << "PASS: render on 2 render workers matches serial\n";
+
+        // A patch the description edit cannot apply is refused whole: the
+        // live graph and the description renders rebuild from are kept
+        assert(!engine.patch_graph(R"({"remove_connections": [1]})").empty());
+        assert(engine.render_offline(0.5f) == pcm);
+        std::cout << "PASS: rejected patch keeps the last good graph\n";
+    }
+
+    // --- Stems: two synths, one stem each plus one with both ---
+    {
+        AudioEngine stem_engine(cfg);
+        json two_synths = {
+            {"bpm", 120},
+            {"nodes", {
+                {{"id","a"}, {"type","sine"}},
+                {{"id","b"}, {"type","sine"}},
+                {{"id","mixer"}, {"type","mixer"}, {"channel_count",2}}
+            }},
+            {"connections", {
+                {{"from_node","a"},{"from_port","audio_out_L"},{"to_node","mixer"},{"to_port","audio_in_L_0"}},
+                {{"from_node","a"},{"from_port","audio_out_R"},{"to_node","mixer"},{"to_port","audio_in_R_0"}},
+                {{"from_node","b"},{"from_port","audio_out_L"},{"to_node","mixer"},{"to_port","audio_in_L_1"}},
+                {{"from_node","b"},{"from_port","audio_out_R"},{"to_node","mixer"},{"to_port","audio_in_R_1"}}
+            }}
+        };
+        // a plays beats 0-2, b plays beats 2-4
+        json two_parts = {{"events", {
+            {{"beat",0.0},{"type","note_on"}, {"node_id","a"},{"channel",0},{"pitch",69},{"velocity",100}},
+            {{"beat",2.0},{"type","note_off"},{"node_id","a"},{"channel",0},{"pitch",69},{"velocity",0}},
+            {{"beat",2.0},{"type","note_on"}, {"node_id","b"},{"channel",0},{"pitch",72},{"velocity",100}},
+            {{"beat",4.0},{"type","note_off"},{"node_id","b"},{"channel",0},{"pitch",72},{"velocity",0}},
+        }}};
+        err = stem_engine.set_graph(two_synths.dump());
+        assert(err.empty());
+        err = stem_engine.set_schedule(two_parts.dump());
+        assert(err.empty());
+        auto full_mix = stem_engine.render_offline(0.5f);
+
+        std::vector<AudioEngine::StemSpec> stems = {
+            {"a", {"a"}}, {"b", {"b"}}, {"both", {"a", "b"}}
+        };
+        std::vector<std::vector<float>> out;
+        auto render_all = [&] {
+            out.assign(stems.size(), {});
+            return stem_engine.render_stems(
+                stems, AudioEngine::RenderFormat::RawF32,
+                [&](size_t i, const uint8_t* data, size_t bytes, int64_t, int64_t) {
+                    const float* f = reinterpret_cast<const float*>(data);
+                    out[i].insert(out[i].end(), f, f + bytes / sizeof(float));
+                    return true;
+                },
+                2, AudioEngine::DEFAULT_RENDER_CHUNK_FRAMES, 0.5f);
+        };
+        err = render_all();
+        assert(err.empty());
+
+        // The stem holding every node reproduces the live render
+        assert(out[2] == full_mix);
+
+        // Beats 0-2 are the first second at 120 bpm.  Allow a block of slack
+        // (events fire at block starts) and half a second of release tail.
+        auto peak = [](const std::vector<float>& v, size_t from, size_t to) {
+            float p = 0.0f;
+            for (size_t i = from; i < to && i < v.size(); ++i) p = std::max(p, std::abs(v[i]));
+            return p;
+        };
+        size_t half = 44100 * 2;
+        assert(peak(out[0], 0, half) > 0.01f && peak(out[0], half + 44100, 2 * half) < 1e-4f);
+        assert(peak(out[1], 0, half - 2 * 512) < 1e-4f && peak(out[1], half, 2 * half) > 0.01f);
+        std::cout << "PASS: render_stems isolates stems and matches the full mix\n";
+
+        // Parameter changes made after set_graph carry over to the stem graphs
+        stem_engine.set_param("mixer", "master_gain", 0.0f);
+        err = render_all();
+        assert(err.empty());
+        assert(peak(out[2], 0, out[2].size()) == 0.0f);
+        std::cout << "PASS: render_stems applies parameter changes since set_graph\n";
+    }
+
+    // --- Sampler: the head and the disk stream join without a seam ---
+    {
+        // 16-bit mono, several heads long, so most of the note is streamed.
+        const int frames = 4 * SampleFile::HEAD_FRAMES + 123;
+        std::vector<int16_t> pcm16(frames);
+        for (int k = 0; k < frames; ++k)
+            pcm16[k] = static_cast<int16_t>(std::lround(1000.0 * std::sin(k * 0.01)));
+        auto u32 = [](std::string& s, uint32_t v) { for (int i = 0; i < 4; ++i) s += char(v >> (8 * i)); };
+        auto u16 = [](std::string& s, uint16_t v) { s += char(v); s += char(v >> 8); };
+        std::string wav_file = "RIFF";
+        u32(wav_file, 36 + frames * 2);
+        wav_file += "WAVEfmt ";
+        u32(wav_file, 16); u16(wav_file, 1); u16(wav_file, 1);
+        u32(wav_file, 44100); u32(wav_file, 44100 * 2); u16(wav_file, 2); u16(wav_file, 16);
+        wav_file += "data";
+        u32(wav_file, frames * 2);
+        wav_file.append(reinterpret_cast<const char*>(pcm16.data()), frames * 2);
+        register_builtin_plugins();
+        std::string path = (std::filesystem::temp_directory_path() / "test_render_sampler.wav").string();
+        { std::ofstream(path, std::ios::binary) << wav_file; }
+
+        AudioEngine smp_engine(cfg);
+        json smp_graph = {
+            {"bpm", 120},
+            {"nodes", {
+                {{"id","smp"}, {"type","sampler"}, {"sample_path", path},
+                 {"params", {{"gain", 1.0}}}},
+                {{"id","mixer"}, {"type","mixer"}, {"channel_count",1}}
+            }},
+            {"connections", {
+                {{"from_node","smp"},{"from_port","audio_out_L"},{"to_node","mixer"},{"to_port","audio_in_L_0"}},
+                {{"from_node","smp"},{"from_port","audio_out_R"},{"to_node","mixer"},{"to_port","audio_in_R_0"}}
+            }}
+        };
+        err = smp_engine.set_graph(smp_graph.dump());
+        assert(err.empty());
+        json smp_note = {{"events", {
+            {{"beat",0.0},{"type","note_on"},{"node_id","smp"},{"channel",0},{"pitch",60},{"velocity",127}},
+        }}};
+        err = smp_engine.set_schedule(smp_note.dump());
+        assert(err.empty());
+
+        // Root key at the file's rate plays it back sample for sample; the
+        // amplitude keeps the mixer's soft clip within the tolerance.
+        auto out = smp_engine.render_offline(0.0f, 4.0);
+        assert(out.size() >= static_cast<size_t>(frames) * 2);
+        float worst = 0.0f;
+        for (int k = 0; k < frames - 1; ++k) {
+            float want = pcm16[k] / 32768.0f;
+            worst = std::max({ worst, std::abs(out[2 * k] - want), std::abs(out[2 * k + 1] - want) });
+        }
+        assert(worst < 1e-4f);
+        assert(out[2 * frames + 2] == 0.0f);   // the voice ends with the file
+        std::filesystem::remove(path);
+        std::cout << "PASS: sampler streams past the resident head (max error " << worst << ")\n";
+    }
+
+    // Realtime-safety checker: calls inside an AudioThreadScope are counted
+    // with their site, the same calls outside it are not.
+    if (rtcheck::enabled) {
+        auto before = rtcheck::report(true);
+        std::cout << "INFO: offline renders above made " << before.counts[rtcheck::Alloc]
+                  << " allocations and " << before.counts[rtcheck::Lock]
+                  << " locks on the audio thread\n";
+
+        void* (*volatile alloc)(size_t) = std::malloc;   // not elided
+        std::mutex m;
+        std::free(alloc(64));
+        void* p;
+        {
+            rtcheck::AudioThreadScope rt;
+            p = alloc(64);
+            std::lock_guard<std::mutex> lk(m);
+        }
+        std::free(p);
+
+        auto r = rtcheck::report(true);
+        assert(r.counts[rtcheck::Alloc] == 1);
+        assert(r.counts[rtcheck::Free]  == 0);
+        assert(r.counts[rtcheck::Lock]  == 1);
+        bool found = false;
+        for (auto& site : r.sites)
+            found |= site.kind == rtcheck::Alloc && site.call == "malloc" &&
+                     site.count == 1 && !site.stack.empty();
+        assert(found);
+        assert(rtcheck::report().counts[rtcheck::Alloc] == 0);   // reset took
+        std::cout << "PASS: realtime checker records audio-thread allocations and locks\n";
+    }
+
     std::cout << "All render tests passed.\n";
     return 0;
 }
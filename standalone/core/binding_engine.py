@@ -5,25 +5,32 @@ needs no changes beyond backend selection.
 
 The _send() method accepts the same command dicts that ServerEngine sends
 over IPC and routes them through ServerHandler::handle() in-process.
-JSON serialisation still occurs (memory-to-memory), which is negligible
-for the payload sizes involved and keeps a single dispatch table in C++.
+JSON serialisation still occurs (memory-to-memory) for graph edits and
+other small commands, keeping a single dispatch table in C++.
 
-The position poll thread is gone: current_beat and is_playing are direct
-reads via handle("get_position"), called from the existing QTimer path in
-app.py rather than a background thread.
+The heavy paths use the typed methods instead: schedules go in as an
+EVENT_DTYPE array, renders come back as a float32 array over the engine's
+own buffer, and the position is a direct read — no JSON, no base64.
+
+The position poll thread is gone: current_beat and is_playing are read
+from the existing QTimer path in app.py rather than a background thread.
 """
 
 from __future__ import annotations
 
+import io
 import json
 import threading
 import time
+import wave
 from typing import Optional
 
 from pathlib import Path
 
-from ..arranger_engine import AudioServer, AudioEngineConfig, load_plugin_library
-from .server_engine import _build_graph, _build_server_schedule
+import numpy as np
+
+from ..arranger_engine import AudioServer, AudioEngineConfig, EVENT_DTYPE, load_plugin_library
+from .server_engine import _build_graph, _build_server_schedule, _pack_events
 from .settings import Settings
 
 # ---------------------------------------------------------------------------
@@ -160,8 +167,13 @@ class BindingEngine:
         self._graph_loaded    = True
         self._graph_track_ids = self._current_track_ids()
         self._send({"cmd": "set_bpm", "bpm": self.state.bpm})
-        self._send({"cmd": "set_schedule",
-                    "events": _build_server_schedule(self.state)})
+        nodes: dict[str, int] = {}
+        packed = _pack_events(_build_server_schedule(self.state),
+                              lambda n: nodes.setdefault(n, len(nodes)))
+        try:
+            self._server.set_schedule(np.frombuffer(packed, dtype=EVENT_DTYPE), list(nodes))
+        except RuntimeError as e:
+            print(f"[BindingEngine] set_schedule error: {e}")
 
     def play(self):
         self.mark_dirty()
@@ -186,11 +198,8 @@ class BindingEngine:
     @property
     def current_beat(self) -> float:
         # Poll on demand rather than in a background thread.
-        # Called from app.py's QTimer (~30fps) so the overhead is negligible.
-        resp = self._send({"cmd": "get_position"})
-        if resp and resp.get("status") == "ok":
-            self._current_beat = resp.get("beat", self._current_beat)
-            self._is_playing   = resp.get("playing", self._is_playing)
+        # Called from app.py's QTimer (~30fps); two atomic loads.
+        self._current_beat, self._is_playing = self._server.position()
         return self._current_beat
 
     @property
@@ -255,17 +264,28 @@ class BindingEngine:
     # Offline render
     # ------------------------------------------------------------------
 
-    def render_offline_wav(self) -> Optional[bytes]:
-        import base64
+    def render_offline(self) -> Optional[np.ndarray]:
+        """(frames, 2) float32 stereo, owning the engine's render buffer."""
         self.mark_dirty()
-        resp = self._send({"cmd": "render", "format": "wav"})
-        if resp is None or resp.get("status") != "ok":
-            return None
         try:
-            return base64.b64decode(resp["data"])
-        except Exception as e:
-            print(f"[BindingEngine] render decode error: {e}")
+            return self._server.render()
+        except RuntimeError as e:
+            print(f"[BindingEngine] render error: {e}")
+            return None
+
+    def render_offline_wav(self) -> Optional[bytes]:
+        pcm = self.render_offline()
+        if pcm is None:
             return None
+        # 16-bit PCM, as the server's own WAV writer produces.
+        samples = (np.clip(pcm, -1.0, 1.0) * 32767.0).astype("<i2")
+        out = io.BytesIO()
+        with wave.open(out, "wb") as w:
+            w.setnchannels(2)
+            w.setsampwidth(2)
+            w.setframerate(int(self.settings.sample_rate))
+            w.writeframes(samples.tobytes())
+        return out.getvalue()
 
     # ------------------------------------------------------------------
     # Cleanup
@@ -20,6 +20,9 @@ Note preview:
 
 IPC wire format (mirrors protocol.h / ipc.h in the C++ server):
   4-byte LE uint32 length prefix, then UTF-8 JSON.  Same framing on replies.
+  If the server advertises "binary_framing" in its ping features, a frame may
+  instead set bit 31 of the prefix and carry [json_len][json][raw payload];
+  offline renders use this to skip the base64 round trip.
 """
 
 from __future__ import annotations
@@ -36,6 +39,7 @@ from typing import Optional
 from .engine import (
     _emit_bend_events, SchedEvent,
 )
+from .shared_state import SharedStateView
 
 
 # ---------------------------------------------------------------------------
@@ -46,6 +50,8 @@ IS_WINDOWS = platform.system() == "Windows"
 
 DEFAULT_ADDRESS = r"\\.\pipe\AudioServer" if IS_WINDOWS else "/tmp/audio_server.sock"
 
+BINARY_FRAME_FLAG = 0x80000000  # mirrors protocol.h
+
 
 # ---------------------------------------------------------------------------
 # Low-level IPC client
@@ -62,6 +68,9 @@ class _IpcClient:
         self.address = address
         self._sock = None
         self._pipe = None  # Windows named pipe handle
+        self.binary_framing = False  # set from ping features after connect
+        self.patch_schedule = False  # likewise
+        self.packed_events = False
 
     def connect(self, timeout: float = 5.0) -> None:
         deadline = time.time() + timeout
@@ -118,6 +127,18 @@ class _IpcClient:
         resp_len = struct.unpack("<I", self._read(4))[0]
         return json.loads(self._read(resp_len))
 
+    def send_binary(self, request: dict, payload: bytes = b"") -> tuple:
+        """Send a binary frame and return (response dict, payload bytes)."""
+        header = json.dumps(request).encode("utf-8")
+        total = 4 + len(header) + len(payload)
+        self._write(struct.pack("<II", total | BINARY_FRAME_FLAG, len(header))
+                    + header + payload)
+        total = struct.unpack("<I", self._read(4))[0] & ~BINARY_FRAME_FLAG
+        json_len = struct.unpack("<I", self._read(4))[0]
+        resp = json.loads(self._read(json_len))
+        body = self._read(total - 4 - json_len) if total > 4 + json_len else b""
+        return resp, body
+
     def _write(self, data: bytes) -> None:
         if IS_WINDOWS:
             import ctypes
@@ -307,6 +328,30 @@ def _build_server_schedule(state) -> list[dict]:
     return events
 
 
+# Packed event records (audio_server protocol.h "Packed events").
+_PACKED_EVENT = struct.Struct("<dfIBBBB")
+_PACKED_TYPES = {"note_on": 0, "note_off": 1, "program": 2, "volume": 3,
+                 "bend": 4, "control": 5}
+
+
+def _pack_events(events: list[dict], node_index) -> bytes:
+    """Pack server event dicts; node_index(node_id) gives each record's node."""
+    pack = _PACKED_EVENT.pack
+    return b"".join(
+        pack(e["beat"], e.get("value", 0.0), node_index(e["node_id"]),
+             _PACKED_TYPES[e["type"]], e.get("channel", 0), e.get("pitch", 0),
+             e.get("velocity", 0))
+        for e in events)
+
+
+def _events_by_node(events: list[dict]) -> dict[str, list[dict]]:
+    """Split a server event list into per-node slices (patch_schedule units)."""
+    tracks: dict[str, list[dict]] = {}
+    for e in events:
+        tracks.setdefault(e["node_id"], []).append(e)
+    return tracks
+
+
 # ---------------------------------------------------------------------------
 # ServerEngine  —  drop-in replacement for AudioEngine
 # ---------------------------------------------------------------------------
@@ -336,6 +381,10 @@ class ServerEngine:
         self._lock = threading.Lock()
         self._client: Optional[_IpcClient] = None
 
+        # Per-node event slices the server last acknowledged; None forces a
+        # full set_schedule (new connection, or a patch failed).
+        self._sent_tracks: Optional[dict] = None
+
         # Written by poll thread, read by app.py QTimer
         self._current_beat: float = 0.0
         self._is_playing: bool = False
@@ -343,6 +392,11 @@ class ServerEngine:
         self._poll_thread: Optional[threading.Thread] = None
         self._poll_stop = threading.Event()
 
+        # Mapped server state block (transport, meters, monitor histories);
+        # None when the server predates it — callers fall back to IPC.
+        self._shared: Optional[SharedStateView] = None
+        self._shared_lock = threading.Lock()
+
         self._connect()
         # Fetch plugin descriptors after connection is established
         if self._client is not None:
@@ -356,7 +410,13 @@ class ServerEngine:
         try:
             client = _IpcClient(self.address)
             client.connect(timeout=2.0)
+            features = client.send({"cmd": "ping"}).get("features", [])
+            client.binary_framing = "binary_framing" in features
+            client.patch_schedule = "patch_schedule" in features
+            client.packed_events = client.binary_framing and "packed_events" in features
             self._client = client
+            self._sent_tracks = None
+            self._open_shared_state(client, features)
             print(f"[ServerEngine] Connected to audio_server at {self.address!r}")
             return True
         except Exception as e:
@@ -364,6 +424,21 @@ class ServerEngine:
             self._client = None
             return False
 
+    def _open_shared_state(self, client: _IpcClient, features: list) -> None:
+        """Map the server's state block if it offers one (once per connection)."""
+        with self._shared_lock:
+            if self._shared is not None:
+                self._shared.close()
+                self._shared = None
+            if "shared_state" not in features:
+                return
+            try:
+                resp = client.send({"cmd": "open_shared_state"})
+                if resp.get("status") == "ok":
+                    self._shared = SharedStateView.open(resp["name"], resp["size"])
+            except Exception as e:
+                print(f"[ServerEngine] Shared state unavailable, polling over IPC: {e}")
+
     def _fetch_plugin_descriptors(self) -> None:
         """Fetch registered plugin descriptors and cache them in graph_model.
 
@@ -402,6 +477,29 @@ class ServerEngine:
                     self._client = None
             return None
 
+    def _send_binary(self, request: dict, payload: bytes = b"") -> tuple:
+        """Like _send() but over a binary frame; returns (response, payload).
+
+        Falls back to a plain JSON frame (empty payload) if the server does
+        not support binary framing.
+        """
+        with self._lock:
+            if self._client is None or not self._client.connected:
+                if not self._connect():
+                    return None, b""
+            try:
+                if not self._client.binary_framing:
+                    return self._client.send(request), b""
+                return self._client.send_binary(request, payload)
+            except Exception as e:
+                print(f"[ServerEngine] IPC error: {e}")
+                try:
+                    self._client.disconnect()
+                except Exception:
+                    pass
+                self._client = None
+                return None, b""
+
     @property
     def is_connected(self) -> bool:
         return self._client is not None and self._client.connected
@@ -427,8 +525,16 @@ class ServerEngine:
         """Retrieve graph/monitor data from a plugin node.
 
         Returns a Python list (parsed from the JSON the plugin returns), or
-        an empty list if the node is not found / not connected.
+        an empty list if the node is not found / not connected.  Monitor
+        histories come from the shared state block when the server publishes
+        them there.
         """
+        if port_id == "history":
+            with self._shared_lock:
+                hist = self._shared.monitor_history(node_id) if self._shared else None
+            if hist is not None:
+                return hist
+
         import json as _json
         resp = self._send({
             "cmd": "get_node_data",
@@ -442,6 +548,15 @@ class ServerEngine:
         except Exception:
             return []
 
+    def meters(self) -> list:
+        """Last block's peak/RMS per mixer input, then "master".
+
+        [{id, peak_L, peak_R, rms_L, rms_R}, ...] from the shared state block;
+        empty if the server does not publish one.
+        """
+        with self._shared_lock:
+            return self._shared.meters() if self._shared else []
+
     # ------------------------------------------------------------------
     # Graph / soundfont
     # ------------------------------------------------------------------
@@ -505,7 +620,57 @@ class ServerEngine:
         self._graph_loaded = True
         self._graph_track_ids = self._current_track_ids()
         self._send({"cmd": "set_bpm", "bpm": self.state.bpm})
-        self._send({"cmd": "set_schedule", "events": _build_server_schedule(self.state)})
+        self._sync_schedule()
+
+    def _sync_schedule(self):
+        """Bring the server schedule up to date, resending only changed tracks.
+
+        Editing one note then costs one patch_schedule of that track's
+        events instead of a set_schedule of the whole song.
+        """
+        events = _build_server_schedule(self.state)
+        tracks = _events_by_node(events)
+        sent = self._sent_tracks
+        if sent is None or self._client is None or not self._client.patch_schedule:
+            resp = self._send_schedule("set_schedule", events)
+            ok = resp is not None and resp.get("status") == "ok"
+            self._sent_tracks = tracks if ok else None
+            return
+
+        for node_id in list(tracks) + [n for n in sent if n not in tracks]:
+            slice_ = tracks.get(node_id, [])
+            if sent.get(node_id, []) == slice_:
+                continue
+            resp = self._send_schedule("patch_schedule", slice_, node_id)
+            if resp is None or resp.get("status") != "ok" or self._sent_tracks is None:
+                # Failed, or reconnected mid-sync: fall back to a full resend.
+                self._sent_tracks = None
+                self._sync_schedule()
+                return
+        self._sent_tracks = tracks
+
+    def _send_schedule(self, cmd: str, events: list[dict],
+                       node_id: Optional[str] = None) -> Optional[dict]:
+        """set_schedule / patch_schedule, as packed records when the server takes them."""
+        client = self._client
+        if client is None or not client.packed_events:
+            request = {"cmd": cmd, "events": events}
+            if node_id is not None:
+                request["node_id"] = node_id
+            return self._send(request)
+
+        request = {"cmd": cmd, "format": "packed"}
+        if node_id is None:
+            nodes: dict[str, int] = {}
+            payload = _pack_events(events, lambda n: nodes.setdefault(n, len(nodes)))
+            request["nodes"] = list(nodes)
+        else:
+            request["node_id"] = node_id
+            payload = _pack_events(events, lambda n: 0)
+        resp, _ = self._send_binary(request, payload)
+        if resp is not None and resp.get("status") != "ok":
+            print(f"[ServerEngine] Server error: {resp.get('message', resp)}")
+        return resp
 
     def play(self):
         self.mark_dirty()
@@ -592,9 +757,11 @@ class ServerEngine:
     def render_offline_wav(self) -> Optional[bytes]:
         """Ask the server to render the current schedule and return WAV bytes."""
         self.mark_dirty()
-        resp = self._send({"cmd": "render", "format": "wav"})
+        resp, wav = self._send_binary({"cmd": "render", "format": "wav"})
         if resp is None or resp.get("status") != "ok":
             return None
+        if "payload_bytes" in resp:
+            return wav
         try:
             return base64.b64decode(resp["data"])
         except Exception as e:
@@ -617,7 +784,21 @@ class ServerEngine:
 
     def _poll_loop(self):
         """Poll server position at ~30fps.  Exits when server reports not playing."""
+        first_block = None
         while not self._poll_stop.is_set():
+            with self._shared_lock:
+                h = self._shared.header() if self._shared else None
+            if h is not None:
+                # The play command may still be queued for the audio thread;
+                # only trust "stopped" once a couple of blocks have run.
+                if first_block is None:
+                    first_block = h["blocks"]
+                self._current_beat = h["beat"]
+                self._is_playing   = h["playing"]
+                if not self._is_playing and h["blocks"] >= first_block + 2:
+                    break
+                time.sleep(0.033)
+                continue
             resp = self._send({"cmd": "get_position"})
             if resp:
                 self._current_beat = resp.get("beat", self._current_beat)
@@ -635,6 +816,10 @@ class ServerEngine:
         if self._poll_thread:
             self._poll_thread.join(timeout=1.0)
         self.all_notes_off()
+        with self._shared_lock:
+            if self._shared is not None:
+                self._shared.close()
+                self._shared = None
         if self._client:
             try:
                 self._client.disconnect()
@@ -0,0 +1,125 @@
+"""Read-only view of the audio server's shared-memory state block.
+
+The server publishes transport position, per-track peak/RMS meters and
+control_monitor histories into a shared-memory region every audio block
+(see audio_server/include/shared_state.h for the layout).  Reading it costs
+no IPC round-trip and never touches the server's graph lock, so UI timers
+can poll it at display rate.
+
+Usage:
+    resp = client.send({"cmd": "open_shared_state"})
+    view = SharedStateView.open(resp["name"], resp["size"])
+    beat, playing = view.transport()
+
+Consistency: the header carries a seqlock counter that is odd while the
+audio thread is writing.  Every read copies what it needs between two loads
+of the counter and retries when they differ.
+"""
+
+from __future__ import annotations
+
+import mmap
+import platform
+import struct
+from typing import Optional
+
+MAGIC = 0x4D485341            # "ASHM"
+VERSION = 1
+
+# Mirrors shm:: constants and struct layouts in shared_state.h.
+_HEADER = struct.Struct("<IIII Q dd f IIIII")
+_SEQ_OFFSET = 12
+_ID_LEN = 64
+_METER = struct.Struct(f"<{_ID_LEN}s ffff")
+_METERS_OFFSET = 64
+_MAX_METERS = 64
+_MONITOR_HEAD = struct.Struct(f"<{_ID_LEN}s IIfI")
+_MONITOR_HISTORY = 512
+_MONITOR_SIZE = _MONITOR_HEAD.size + 4 * _MONITOR_HISTORY
+_MONITORS_OFFSET = _METERS_OFFSET + _MAX_METERS * _METER.size
+
+_RETRIES = 100
+
+
+class SharedStateView:
+    """Seqlock reader over a mapped state block.  Not thread-safe on its own."""
+
+    def __init__(self, buf: mmap.mmap):
+        self._buf = buf
+        magic, version = struct.unpack_from("<II", buf, 0)
+        if magic != MAGIC or version != VERSION:
+            buf.close()
+            raise ValueError(f"not an audio_server state block (magic={magic:#x}, "
+                             f"version={version})")
+
+    @classmethod
+    def open(cls, name: str, size: int) -> "SharedStateView":
+        if platform.system() == "Windows":
+            buf = mmap.mmap(-1, size, tagname="Local\\" + name.lstrip("/"),
+                            access=mmap.ACCESS_READ)
+        else:
+            with open("/dev/shm/" + name.lstrip("/"), "rb") as f:
+                buf = mmap.mmap(f.fileno(), size, access=mmap.ACCESS_READ)
+        return cls(buf)
+
+    def close(self) -> None:
+        self._buf.close()
+
+    # ------------------------------------------------------------------
+
+    def _read(self, fn):
+        """Run fn() between two even, equal seq values; None if never stable."""
+        for _ in range(_RETRIES):
+            seq = struct.unpack_from("<I", self._buf, _SEQ_OFFSET)[0]
+            if seq & 1:
+                continue
+            result = fn()
+            if struct.unpack_from("<I", self._buf, _SEQ_OFFSET)[0] == seq:
+                return result
+        return None
+
+    def _header(self) -> tuple:
+        return _HEADER.unpack_from(self._buf, 0)
+
+    def header(self) -> Optional[dict]:
+        h = self._read(self._header)
+        if h is None:
+            return None
+        return {"blocks": h[4], "beat": h[5], "bpm": h[6], "sample_rate": h[7],
+                "playing": bool(h[8]), "graph_serial": h[9],
+                "meter_count": h[10], "monitor_count": h[11]}
+
+    def transport(self) -> Optional[tuple]:
+        """(beat, playing), or None if the writer never let go."""
+        h = self._read(self._header)
+        return None if h is None else (h[5], bool(h[8]))
+
+    def meters(self) -> list:
+        """[{id, peak_L, peak_R, rms_L, rms_R}, ...] — mixer inputs, then "master"."""
+        def read():
+            n = min(self._header()[10], _MAX_METERS)
+            return [_METER.unpack_from(self._buf, _METERS_OFFSET + i * _METER.size)
+                    for i in range(n)]
+        rows = self._read(read) or []
+        return [{"id": _id(r[0]), "peak_L": r[1], "peak_R": r[2],
+                 "rms_L": r[3], "rms_R": r[4]} for r in rows]
+
+    def monitor_history(self, node_id: str) -> Optional[list]:
+        """Chronological history of a control_monitor node; None if not published."""
+        def read():
+            n = self._header()[11]
+            for i in range(n):
+                off = _MONITORS_OFFSET + i * _MONITOR_SIZE
+                raw_id, count, head, _latest, _ = _MONITOR_HEAD.unpack_from(self._buf, off)
+                if _id(raw_id) != node_id:
+                    continue
+                hist = struct.unpack_from(f"<{_MONITOR_HISTORY}f", self._buf,
+                                          off + _MONITOR_HEAD.size)
+                start = (head - count) % _MONITOR_HISTORY
+                return [hist[(start + k) % _MONITOR_HISTORY] for k in range(count)]
+            return None
+        return self._read(read)
+
+
+def _id(raw: bytes) -> str:
+    return raw.split(b"\0", 1)[0].decode("utf-8", "replace")
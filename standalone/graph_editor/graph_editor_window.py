@@ -19,7 +19,7 @@ Add Node dropdown is hierarchical:
   Synthesizers
     → FluidSynth
     → Sine (debug)
-    → Sampler  [future]
+    → Sampler
   Plugins
     → LV2: <name>  (populated from server at open time)
   Utilities
@@ -198,8 +198,8 @@ class GraphEditorWindow(QWidget):
             lambda: self._add_node("fluidsynth"))
         synth_menu.addAction("Sine (debug)").triggered.connect(
             lambda: self._add_node("sine"))
-        smp_action = synth_menu.addAction("Sampler  [future]")
-        smp_action.triggered.connect(lambda: self._add_node("sampler"))
+        synth_menu.addAction("Sampler").triggered.connect(
+            lambda: self._add_node("sampler"))
 
         # Plugins (LV2) — disabled for now; kept for future re-enablement
         # self._plugins_menu = menu.addMenu("Plugins  (LV2)")
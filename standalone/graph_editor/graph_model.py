@@ -32,7 +32,7 @@ Node types:
   Synthesizers (MIDI in → AUDIO out):
     fluidsynth     – SF2-backed
     sine           – built-in debug synth
-    sampler        – sample player [future]
+    sampler        – disk-streaming sample player
 
   Plugins:
     lv2            – LV2 plugin; ports are dynamic (AUDIO_MONO / CONTROL)